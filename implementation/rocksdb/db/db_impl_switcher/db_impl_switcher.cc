@@ -20,7 +20,11 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
   std::vector<ColumnFamilyDescriptor> column_families;
   column_families.push_back(
       ColumnFamilyDescriptor(kDefaultColumnFamilyName, cf_options));
-  if (db_options.persist_stats_to_disk) {
+  if (db_options.persist_stats_to_disk
+#ifdef TROPODB_PLUGIN_ENABLED
+      && !db_options.use_tropodb_impl
+#endif
+  ) {
     column_families.push_back(
         ColumnFamilyDescriptor(kPersistentStatsColumnFamilyName, cf_options));
   }
@@ -28,6 +32,10 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
   Status s = DB::Open(db_options, dbname, column_families, &handles, dbptr);
 #ifdef TROPODB_PLUGIN_ENABLED
   if (db_options.use_tropodb_impl) {
+    // TropoDB also holds its own default column family handle
+    for (auto handle : handles) {
+      delete handle;
+    }
     return s;
   }
 #endif
@@ -21,6 +21,7 @@
 #include "db/tropodb/index/tropodb_version.h"
 #include "db/tropodb/index/tropodb_version_set.h"
 #include "db/tropodb/io/szd_port.h"
+#include "db/tropodb/io/szd_shared_device.h"
 #include "db/tropodb/persistence/tropodb_manifest.h"
 #include "db/tropodb/persistence/tropodb_wal.h"
 #include "db/tropodb/persistence/tropodb_wal_manager.h"
@@ -55,18 +56,21 @@ TropoDBImpl::TropoDBImpl(const DBOptions& options, const std::string& dbname,
       internal_comparator_(BytewiseComparator()),
       env_(options.env),
       // Will be initialised after SPDK
-      zns_device_(nullptr),
-      channel_factory_(nullptr),
       ss_manager_(nullptr),
       manifest_(nullptr),
       table_cache_(nullptr),
       versions_(nullptr),
-      // Thread count (1 HIGH for each flush thread, 1~3 HIGH for each L0 thread
-      // and 1~3 LOW for each LN thread)
+      column_families_(std::make_shared<TropoColumnFamilySet>()),
+      default_cf_handle_(new TropoColumnFamilyHandle(
+          0, kDefaultColumnFamilyName, ColumnFamilyOptions())),
+      merge_operator_(
+          std::make_shared<TropoColumnFamilyMergeOperator>(column_families_)),
+      // Thread count (1~flush_ranges HIGH for each flush thread, 1~3 HIGH for
+      // each L0 thread and 1~3 LOW for each LN thread)
       low_level_threads_((1 + TropoDBConfig::compaction_allow_prefetching +
                           TropoDBConfig::compaction_allow_deferring_writes)),
       high_level_threads_(
-          TropoDBConfig::lower_concurrency +
+          TropoDBConfig::lower_concurrency * TropoDBConfig::flush_ranges +
           TropoDBConfig::lower_concurrency *
               (1 + TropoDBConfig::compaction_allow_prefetching +
                TropoDBConfig::compaction_allow_deferring_writes +
@@ -90,6 +94,7 @@ TropoDBImpl::TropoDBImpl(const DBOptions& options, const std::string& dbname,
     mem_[i] = nullptr;
     imm_[i] = nullptr;
     bg_flush_scheduled_[i] = false;
+    flush_claimed_[i] = false;
     tmp_batch_[i] = new WriteBatch;
     wal_reserved_[i] = 0;
   }
@@ -146,15 +151,19 @@ TropoDBImpl::~TropoDBImpl() {
     if (ss_manager_ != nullptr) ss_manager_->Unref();
     if (manifest_ != nullptr) manifest_->Unref();
     if (table_cache_ != nullptr) delete table_cache_;
-    if (channel_factory_ != nullptr) channel_factory_->Unref();
-    if (zns_device_ != nullptr) delete zns_device_;
+    if (row_cache_ != nullptr) delete row_cache_;
+    delete default_cf_handle_;
+    for (const auto& device_name : device_names_) {
+      CloseSharedZNSDevice(device_name);
+    }
   }
   TROPO_LOG_INFO("INFO: Exiting\n");
 }
 
 Status TropoDBImpl::ValidateOptions(const DBOptions& db_options) {
-  if (db_options.db_paths.size() > 1) {
-    return Status::NotSupported("We do not support multiple db paths.");
+  // Each db path is a ZNS device
+  if (db_options.db_paths.size() > TropoDBConfig::max_devices) {
+    return Status::NotSupported("More db paths than supported ZNS devices.");
   }
   // We do not support most other options, but rather we ignore them for now.
   if (!db_options.use_tropodb_impl) {
@@ -163,48 +172,61 @@ Status TropoDBImpl::ValidateOptions(const DBOptions& db_options) {
   return Status::OK();
 }
 
-Status TropoDBImpl::OpenZNSDevice(const std::string dbname) {
-  zns_device_ = new SZD::SZDDevice(dbname);
-  Status s;
-  s = FromStatus(zns_device_->Init());
-  if (!s.ok()) {
-    TROPO_LOG_ERROR("ERROR: SPDK will not init. Are you root?\n");
-    return Status::IOError("Error opening SPDK");
+Status TropoDBImpl::OpenZNSDevices(const std::string dbname) {
+  // With multiple db paths, each path names a device. Otherwise name_ does.
+  std::vector<std::string> devices;
+  if (options_.db_paths.size() > 1) {
+    for (const auto& path : options_.db_paths) {
+      devices.push_back(path.path);
+    }
+  } else {
+    devices.push_back(this->name_);
   }
-  s = FromStatus(zns_device_->Open(this->name_, TropoDBConfig::min_zone,
-                                   TropoDBConfig::max_zone));
-  if (!s.ok()) {
-    TROPO_LOG_ERROR("ERROR: SZD device does not open. Is it ZNS?\n");
-    return Status::IOError("Error opening ZNS device");
+  Status s;
+  for (const auto& device : devices) {
+    SZD::SZDDevice* zns_device;
+    SZD::SZDChannelFactory* channel_factory;
+    s = OpenSharedZNSDevice(dbname, device, &zns_device, &channel_factory);
+    if (!s.ok()) {
+      return s;
+    }
+    device_names_.push_back(device);
+    zns_devices_.push_back(zns_device);
+    channel_factories_.push_back(channel_factory);
   }
-  channel_factory_ = new SZD::SZDChannelFactory(zns_device_->GetDeviceManager(),
-                                                TropoDBConfig::max_channels);
-  channel_factory_->Ref();
   return Status::OK();
 }
 
-Status TropoDBImpl::ResetZNSDevice() {
+Status TropoDBImpl::ResetZNSDevices() {
   Status s;
-  channel_factory_->Ref();
-  SZD::SZDChannel* channel;
-  s = FromStatus(channel_factory_->register_channel(&channel));
-  if (s.ok()) {
-    s = FromStatus(channel->ResetAllZones());
-  } else {
-    TROPO_LOG_ERROR("ERROR: Can not create I/O QPair for clearing device\n");
-  }
-  if (s.ok()) {
-    s = FromStatus(channel_factory_->unregister_channel(channel));
-  } else {
-    TROPO_LOG_ERROR("ERROR: Can not clear device \n");
+  // Only the zones of this database are reset, the device can be shared
+  for (size_t d = 0; d < channel_factories_.size(); d++) {
+    SZD::SZDChannelFactory* channel_factory = channel_factories_[d];
+    channel_factory->Ref();
+    SZD::SZDChannel* channel;
+    s = FromStatus(channel_factory->register_channel(
+        &channel, device_zones_[d].first, device_zones_[d].second));
+    if (s.ok()) {
+      s = FromStatus(channel->ResetAllZones());
+    } else {
+      TROPO_LOG_ERROR("ERROR: Can not create I/O QPair for clearing device\n");
+    }
+    if (s.ok()) {
+      s = FromStatus(channel_factory->unregister_channel(channel));
+    } else {
+      TROPO_LOG_ERROR("ERROR: Can not clear device \n");
+    }
+    channel_factory->Unref();
+    if (!s.ok()) {
+      break;
+    }
   }
-  channel_factory_->Unref();
   return s.ok() ? Status::OK() : Status::IOError("Error resetting device");
 }
 
 Status TropoDBImpl::InitDB(const DBOptions& options,
                            const size_t max_write_buffer_size) {
-  assert(zns_device_ != nullptr);
+  assert(!zns_devices_.empty());
   max_write_buffer_size_ = max_write_buffer_size;
 
   // Setup info string
@@ -218,21 +240,46 @@ Status TropoDBImpl::InitDB(const DBOptions& options,
   info_str << std::setfill('-') << std::setw(76) << "\n" << std::setfill(' ');
 
   // Get device info
-  SZD::DeviceInfo device_info;
-  zns_device_->GetInfo(&device_info);
-  uint64_t zone_head = device_info.min_lba / device_info.zone_size;
+  const size_t device_count = zns_devices_.size();
+  std::vector<SZD::DeviceInfo> device_info(device_count);
+  std::vector<uint64_t> zone_head(device_count);
+  device_zones_.resize(device_count);
+  for (size_t d = 0; d < device_count; d++) {
+    zns_devices_[d]->GetInfo(&device_info[d]);
+    const uint64_t min_zone = device_info[d].min_lba / device_info[d].zone_size;
+    const uint64_t max_zone = device_info[d].max_lba / device_info[d].zone_size;
+    device_zones_[d] = std::make_pair(min_zone, max_zone);
+    // Tenants only get a part of the device
+    if (options.tropodb_max_zone != 0) {
+      if (options.tropodb_min_zone < min_zone ||
+          options.tropodb_min_zone >= options.tropodb_max_zone ||
+          options.tropodb_max_zone > max_zone) {
+        TROPO_LOG_ERROR("ERROR: Zone range %lu-%lu not on device %lu-%lu\n",
+                        options.tropodb_min_zone, options.tropodb_max_zone,
+                        min_zone, max_zone);
+        return Status::InvalidArgument("Zone range is not on the device");
+      }
+      device_zones_[d] =
+          std::make_pair(options.tropodb_min_zone, options.tropodb_max_zone);
+    }
+    zone_head[d] = device_zones_[d].first;
+  }
   uint64_t zone_step = 0;
+  // Structures are suffixed with their device if there are multiple
+  auto on_device = [device_count](const std::string& name, size_t d) {
+    return device_count > 1 ? name + "@" + std::to_string(d) : name;
+  };
 
   // Init manifest
   {
     zone_step = TropoDBConfig::manifest_zones;
-    manifest_ = new TropoManifest(channel_factory_, device_info, zone_head,
-                                  zone_head + zone_step);
+    manifest_ = new TropoManifest(channel_factories_[0], device_info[0],
+                                  zone_head[0], zone_head[0] + zone_step);
     manifest_->Ref();
-    info_str << std::left << std::setw(15) << "Manifest" << std::right
-             << std::setw(25) << zone_head << std::setw(25)
-             << zone_head + zone_step << "\n";
-    zone_head += zone_step;
+    info_str << std::left << std::setw(15) << on_device("Manifest", 0)
+             << std::right << std::setw(25) << zone_head[0] << std::setw(25)
+             << zone_head[0] + zone_step << "\n";
+    zone_head[0] += zone_step;
   }
 
   // Init WALs
@@ -240,48 +287,65 @@ Status TropoDBImpl::InitDB(const DBOptions& options,
     zone_step = TropoDBConfig::wal_count * TropoDBConfig::zones_foreach_wal;
     zone_step /= TropoDBConfig::lower_concurrency;
     for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      const size_t d = i % device_count;
       wal_man_[i] = new TropoWALManager<TropoDBConfig::wal_manager_zone_count>(
-          channel_factory_, device_info, zone_head, zone_step + zone_head);
+          channel_factories_[d], device_info[d], zone_head[d],
+          zone_step + zone_head[d]);
       wal_man_[i]->Ref();
-      info_str << std::left << std::setw(15) << ("WALMAN-" + std::to_string(i))
-               << std::right << std::setw(25) << zone_head << std::setw(25)
-               << (zone_head + zone_step) << "\n";
-      zone_head += zone_step;
+      info_str << std::left << std::setw(15)
+               << on_device("WALMAN-" + std::to_string(i), d) << std::right
+               << std::setw(25) << zone_head[d] << std::setw(25)
+               << (zone_head[d] + zone_step) << "\n";
+      zone_head[d] += zone_step;
     }
   }
 
   // Init SSTable manager
   {
-    zone_step = device_info.max_lba / device_info.zone_size - zone_head - 1;
+    std::vector<TropoSSTableManager::DeviceRegion> regions(device_count);
+    for (size_t d = 0; d < device_count; d++) {
+      regions[d].channel_factory = channel_factories_[d];
+      regions[d].info = device_info[d];
+      regions[d].min_zone = zone_head[d];
+      regions[d].max_zone = device_zones_[d].second - 1;
+      for (size_t i = d; i < TropoDBConfig::lower_concurrency;
+           i += device_count) {
+        regions[d].l0_stripes.push_back(i);
+      }
+    }
     // If only we had access to C++23.
-    ss_manager_ =
-        TropoSSTableManager::NewTropoDBSSTableManager(
-            channel_factory_, device_info, zone_head, zone_head + zone_step)
-            .value_or(nullptr);
+    ss_manager_ = TropoSSTableManager::NewTropoDBSSTableManager(regions)
+                      .value_or(nullptr);
     if (ss_manager_ == nullptr) {
       TROPO_LOG_ERROR("ERROR: Could not initialise SSTable manager\n");
       return Status::Corruption();
     }
     ss_manager_->Ref();
+    ss_manager_->SetPrefixExtractor(prefix_extractor_.get());
+    ss_manager_->SetRateLimiter(options_.rate_limiter.get());
+    ss_manager_->SetColumnFamilies(column_families_.get());
     info_str << ss_manager_->LayoutDivisionString();
-    zone_head = device_info.max_lba / device_info.zone_size;
   }
 
   // Init Memtables, table ache and version structure
   {
     for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
       mem_[i] = new TropoMemtable(options, internal_comparator_,
-                                  max_write_buffer_size_);
+                                  max_write_buffer_size_, merge_operator_);
       mem_[i]->Ref();
     }
 
     Options opts(options, ColumnFamilyOptions());
     table_cache_ = new TropoTableCache(opts, internal_comparator_,
                                        1024 * 1024 * 4, ss_manager_);
+    if (options.row_cache != nullptr) {
+      row_cache_ = new TropoRowCache(options.row_cache);
+    }
 
     versions_ = new TropoVersionSet(
-        internal_comparator_, ss_manager_, manifest_, device_info.lba_size,
-        device_info.zone_cap, table_cache_, this->env_);
+        internal_comparator_, ss_manager_, manifest_, device_info[0].lba_size,
+        device_info[0].zone_cap, table_cache_, this->env_,
+        merge_operator_.get(), tiered_compaction_);
   }
 
   // Print info string (if enabled)
@@ -300,7 +364,7 @@ void TropoDBImpl::RecoverBackgroundFlow() {
       if (mem_[i]->GetInternalSize() > 0) {
         imm_[i] = mem_[i];
         mem_[i] = new TropoMemtable(options_, internal_comparator_,
-                                    max_write_buffer_size_);
+                                    max_write_buffer_size_, merge_operator_);
         mem_[i]->Ref();
       }
       MaybeScheduleFlush(i);
@@ -322,12 +386,18 @@ void TropoDBImpl::RecoverBackgroundFlow() {
 Status TropoDBImpl::Recover() {
   TROPO_LOG_INFO("INFO: recovering TropoDB\n");
   Status s;
+  const uint64_t start = clock_->NowMicros();
 
   // Recover index structure
   s = versions_->Recover();
+  recovery_manifest_counter_.AddTiming(clock_->NowMicros() - start);
   // If there is no version to be recovered, we assume there is no valid DB.
   if (!s.ok()) {
-    return options_.create_if_missing ? ResetZNSDevice() : s;
+    if (options_.create_if_missing) {
+      versions_->InitColumnFamilies();
+      return ResetZNSDevices();
+    }
+    return s;
     // TODO: this is not enough when version is corrupt, then device WILL be
     // reset, but metadata still points to corrupt.
   }
@@ -339,6 +409,7 @@ Status TropoDBImpl::Recover() {
 
   // Recover WAL and MVCC
   {
+    const uint64_t before = clock_->NowMicros();
     SequenceNumber old_seq;
     for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
       s = wal_man_[i]->Recover(mem_[i], &old_seq);
@@ -347,10 +418,15 @@ Status TropoDBImpl::Recover() {
       return s;
     }
     versions_->SetLastSequence(old_seq);
+    recovery_wal_counter_.AddTiming(clock_->NowMicros() - before);
   }
 
   // Recover flow
+  const uint64_t before = clock_->NowMicros();
   RecoverBackgroundFlow();
+  const uint64_t now = clock_->NowMicros();
+  recovery_background_counter_.AddTiming(now - before);
+  recovery_total_counter_.AddTiming(now - start);
   return s;
 }
 
@@ -365,7 +441,6 @@ Status TropoDBImpl::Open(
     TROPO_LOG_ERROR("ERROR: Invalid options for TropoDB\n");
     return s;
   }
-  // We do not support column families, so we just clear them
   handles->clear();
 
   // Set write buffer size to an acceptable level
@@ -377,7 +452,20 @@ Status TropoDBImpl::Open(
 
   // Open a SZD connection
   TropoDBImpl* impl = new TropoDBImpl(db_options, name);
-  s = impl->OpenZNSDevice("TropoDB");
+  for (auto cf : column_families) {
+    if (cf.options.prefix_extractor != nullptr) {
+      impl->prefix_extractor_ = cf.options.prefix_extractor;
+      break;
+    }
+  }
+  for (auto cf : column_families) {
+    if (cf.options.compaction_style == kCompactionStyleUniversal) {
+      impl->tiered_compaction_ = true;
+      TROPO_LOG_INFO("INFO: Using tiered compaction for LN\n");
+      break;
+    }
+  }
+  s = impl->OpenZNSDevices("TropoDB");
   if (!s.ok()) {
     return s;
   }
@@ -390,12 +478,19 @@ Status TropoDBImpl::Open(
   // Lock to ensure we are master of TropoDB, not bg threads
   impl->mutex_.Lock();
   s = impl->Recover();
+  if (s.ok()) {
+    s = impl->OpenColumnFamilies(column_families, handles);
+  }
   impl->mutex_.Unlock();
 
   // Return DB or null based on state
   if (s.ok()) {
     *dbptr = reinterpret_cast<DB*>(impl);
   } else {
+    for (auto handle : *handles) {
+      delete handle;
+    }
+    handles->clear();
     delete impl;
   }
   return s;
@@ -410,6 +505,15 @@ bool TropoDBImpl::AnyFlushScheduled() {
   return false;
 }
 
+bool TropoDBImpl::AnyImmutable() {
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    if (imm_[i] != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Status TropoDBImpl::Close() {
   // Wait till all jobs are done
   TROPO_LOG_INFO("INFO: Closing: waiting for background jobs to finish\n");
@@ -436,12 +540,12 @@ Status TropoDBImpl::Close() {
 
 Status TropoDBImpl::DestroyDB(const std::string& dbname,
                               const Options& options) {
-  // Destroy "all files" from the DB. Since we do not use multitenancy, we
-  // might as well reset the device.
+  // Destroy "all files" from the DB. This resets all zones of the DB, other
+  // databases on the device are not affected.
   Status s;
   TropoDBImpl* impl = new TropoDBImpl(options, dbname);
-  TROPO_LOG_INFO("INFO: Attemtping to reset entire ZNS device\n");
-  s = impl->OpenZNSDevice("TropoDB");
+  TROPO_LOG_INFO("INFO: Attemtping to reset all zones of the DB\n");
+  s = impl->OpenZNSDevices("TropoDB");
   if (!s.ok()) {
     return s;
   }
@@ -449,11 +553,11 @@ Status TropoDBImpl::DestroyDB(const std::string& dbname,
   if (!s.ok()) {
     return s;
   }
-  s = impl->ResetZNSDevice();
+  s = impl->ResetZNSDevices();
   if (!s.ok()) {
     return s;
   }
-  TROPO_LOG_INFO("INFO: Entire ZNS device has been reset\n");
+  TROPO_LOG_INFO("INFO: All zones of the DB have been reset\n");
   delete impl;
   return s;
 }
@@ -467,7 +571,12 @@ const std::string& TropoDBImpl::GetName() const { return name_; }
 Env* TropoDBImpl::GetEnv() const { return env_; }
 
 Options TropoDBImpl::GetOptions(ColumnFamilyHandle* column_family) const {
-  Options options(options_, ColumnFamilyOptions());
+  if (column_family == nullptr) {
+    column_family = default_cf_handle_;
+  }
+  Options options(
+      options_,
+      static_cast<TropoColumnFamilyHandle*>(column_family)->GetOptions());
   return options;
 }
 
@@ -38,22 +38,59 @@
 #include "rocksdb/transaction_log.h"
 #include "rocksdb/write_batch.h"
 #include "rocksdb/write_buffer_manager.h"
+#include "test_util/sync_point.h"
 #include "util/coding.h"
+#include "util/string_util.h"
 
 namespace ROCKSDB_NAMESPACE {
 
 Status TropoDBImpl::FlushL0SSTables(std::vector<SSZoneMetaData>& metas,
-                                    uint8_t parallel_number) {
-  return ss_manager_->FlushMemTable(imm_[parallel_number], metas,
-                                    parallel_number, env_);
+                                    uint8_t parallel_number, bool borrow,
+                                    const std::vector<uint8_t>& merged) {
+  if (borrow) {
+    return ss_manager_->FlushMemTableBorrowed(imm_[parallel_number], metas);
+  }
+  if (merged.empty()) {
+    return ss_manager_->FlushMemTable(imm_[parallel_number], metas,
+                                      parallel_number, env_);
+  }
+  std::vector<TropoMemtable*> mems = {imm_[parallel_number]};
+  for (auto i : merged) {
+    mems.push_back(imm_[i]);
+  }
+  return ss_manager_->FlushMemTables(mems, metas, parallel_number, env_);
+}
+
+void TropoDBImpl::ClaimMergedFlush(uint8_t parallel_number,
+                                   std::vector<uint8_t>* merged) {
+  mutex_.AssertHeld();
+  double size = imm_[parallel_number]->GetInternalSize() * 1.2;
+  const uint64_t space = ss_manager_->SpaceRemainingInBytesL0(parallel_number);
+  for (uint8_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    if (i == parallel_number || imm_[i] == nullptr || flush_claimed_[i] ||
+        size + imm_[i]->GetInternalSize() * 1.2 > space) {
+      continue;
+    }
+    size += imm_[i]->GetInternalSize() * 1.2;
+    flush_claimed_[i] = true;
+    merged->push_back(i);
+  }
 }
 
 Status TropoDBImpl::CompactMemtable(uint8_t parallel_number) {
   mutex_.AssertHeld();
+  flush_claimed_[parallel_number] = true;
   // Wait till there is space to flush (* 1.2 leaves buffer space for
   // serialisation)
+  bool borrow = false;
   while (imm_[parallel_number]->GetInternalSize() * 1.2 >
          ss_manager_->SpaceRemainingInBytesL0(parallel_number)) {
+    // Rather than waiting on L0 compaction, take free zones from LN.
+    if (versions_->CanBorrowForL0(imm_[parallel_number]->GetInternalSize() *
+                                  1.2)) {
+      borrow = true;
+      break;
+    }
     // Maybe there is no peer yet?, try to create one.
     MaybeScheduleCompactionL0();
     TROPO_LOG_DEBUG(
@@ -65,6 +102,11 @@ Status TropoDBImpl::CompactMemtable(uint8_t parallel_number) {
   }
   assert(imm_[parallel_number] != nullptr);
   assert(bg_flush_scheduled_[parallel_number]);
+  std::vector<uint8_t> merged;
+  if (TropoDBConfig::flush_merge_stripes && !borrow) {
+    ClaimMergedFlush(parallel_number, &merged);
+    TROPO_LOG_DEBUG("Flush: merging %lu other stripes\n", merged.size());
+  }
 
   uint64_t before;
   Status s = Status::OK();
@@ -78,7 +120,7 @@ Status TropoDBImpl::CompactMemtable(uint8_t parallel_number) {
     // Flush memtable and generate "N" new SSTables (metadata still needs to be
     // transformed)
     std::vector<SSZoneMetaData> metas;
-    s = FlushL0SSTables(metas, parallel_number);
+    s = FlushL0SSTables(metas, parallel_number, borrow, merged);
     mutex_.Lock();
     flush_flush_memtable_counter_.AddTiming(clock_->NowMicros() - before);
     if (!s.ok()) {
@@ -87,6 +129,7 @@ Status TropoDBImpl::CompactMemtable(uint8_t parallel_number) {
     }
 
     if (s.ok() && metas.size() > 0) {
+      TEST_SYNC_POINT("TropoDBImpl::CompactMemtable:AfterWriteL0");
       before = clock_->NowMicros();
       TropoVersionEdit edit;
       uint64_t l0_number = versions_->NewSSNumberL0();
@@ -107,18 +150,31 @@ Status TropoDBImpl::CompactMemtable(uint8_t parallel_number) {
     }
     imm_[parallel_number]->Unref();
     imm_[parallel_number] = nullptr;
+    for (auto i : merged) {
+      imm_[i]->Unref();
+      imm_[i] = nullptr;
+    }
   }
 
-  // Reset WALs
-  {
+  // Reset WALs, merged stripes stay claimed till their WALs are reset as well
+  merged.push_back(parallel_number);
+  for (auto i : merged) {
     before = clock_->NowMicros();
-    s = wal_man_[parallel_number]->ResetOldWALs(&mutex_);
+    Status reset = wal_man_[i]->ResetOldWALs(&mutex_);
     flush_reset_wal_counter_.AddTiming(clock_->NowMicros() - before);
-    if (!s.ok()) {
+    if (!reset.ok()) {
+      s = reset;
       bg_error_ = s;
       TROPO_LOG_ERROR("ERROR: Flush: WALs could not be reset\n");
     }
   }
+  for (auto i : merged) {
+    flush_claimed_[i] = false;
+    // Merged stripes may have a new immutable memtable by now
+    if (i != parallel_number && !shutdown_) {
+      MaybeScheduleFlush(i);
+    }
+  }
   return s;
 }
 
@@ -126,6 +182,11 @@ void TropoDBImpl::BackgroundFlush(uint8_t parallel_number) {
   mutex_.AssertHeld();
   Status s;
 
+  // The immutable table is flushed along with another stripe, that flush
+  // schedules this stripe again when it is done.
+  if (flush_claimed_[parallel_number]) {
+    return;
+  }
   // It is possible that a flush is scheduled because there are no WALs left,
   // but there is no immutable table. Only reset WAL in this case.
   if (imm_[parallel_number] != nullptr) {
@@ -139,7 +200,8 @@ void TropoDBImpl::BackgroundFlush(uint8_t parallel_number) {
     s = wal_man_[parallel_number]->ResetOldWALs(&mutex_);
     flush_reset_wal_counter_.AddTiming(clock_->NowMicros() - before);
     TROPO_LOG_INFO("BG operation: Reset WALs to make space\n");
-  } else {
+  } else if (!TropoDBConfig::flush_merge_stripes) {
+    // With merged flushes, another stripe can have flushed the table already
     TROPO_LOG_ERROR(
         "ERROR: Flush: No immutable table to flush or WAL to reset\n");
   }
@@ -187,7 +249,7 @@ void TropoDBImpl::BGFlushWork(void* data) {
 void TropoDBImpl::MaybeScheduleFlush(uint8_t parallel_number) {
   mutex_.AssertHeld();
   // No duplicate or unnecessary flushes
-  if (bg_flush_scheduled_[parallel_number]) {
+  if (bg_flush_scheduled_[parallel_number] || flush_claimed_[parallel_number]) {
     return;
   } else if ((imm_[parallel_number] == nullptr &&
               wal_man_[parallel_number]->WALAvailable())) {
@@ -235,8 +297,20 @@ void TropoDBImpl::BackgroundCompactionL0Call() {
 
 void TropoDBImpl::BackgroundCompactionL0() {
   mutex_.AssertHeld();
-  // We do not need a compaction in L0, return.
-  if (!versions_->NeedsL0Compaction()) {
+  const bool is_manual =
+      manual_compaction_ != nullptr && manual_compaction_->level == 0;
+  if (is_manual) {
+    // L0 is always compacted from its tail, continue till the range is gone.
+    std::vector<SSZoneMetaData*> overlap;
+    versions_->current()->GetOverlappingInputs(0, manual_compaction_->begin,
+                                               manual_compaction_->end,
+                                               &overlap);
+    if (overlap.empty()) {
+      manual_compaction_->done = true;
+      return;
+    }
+  } else if (!versions_->NeedsL0Compaction()) {
+    // We do not need a compaction in L0, return.
     return;
   }
 
@@ -342,6 +416,9 @@ void TropoDBImpl::BackgroundCompactionL0() {
     }
     // Diag
     compactions_[0 /*level*/]++;
+    if (is_manual && manual_compaction_ != nullptr) {
+      manual_compaction_->compactions++;
+    }
   }
 
   // Reset L0 zones
@@ -368,7 +445,12 @@ void TropoDBImpl::MaybeScheduleCompactionL0() {
   // No duplicate scheduling or unnecessary scheduling
   if (!bg_error_.ok()) {
     return;
-  } else if (bg_compaction_l0_scheduled_) {
+  } else if (bg_compaction_l0_scheduled_ || bg_work_paused_ > 0) {
+    return;
+  } else if (manual_compaction_ != nullptr && manual_compaction_->level == 0 &&
+             !manual_compaction_->done) {
+    // Manual compactions do not depend on the score
+  } else if (manual_compaction_ != nullptr && manual_compaction_->exclusive) {
     return;
   } else if (!versions_->NeedsL0Compaction()) {
     return;
@@ -397,9 +479,14 @@ void TropoDBImpl::BackgroundCompaction() {
   Status s;
   TropoVersion* current = versions_->current();
   uint64_t before;
+  // A manual compaction overrides the level picked by score
+  const bool is_manual =
+      manual_compaction_ != nullptr && manual_compaction_->level > 0;
+  uint8_t level =
+      is_manual ? manual_compaction_->level : current->CompactionLevel();
 
   // Not a valid compaction
-  if (current->CompactionLevel() >= TropoDBConfig::level_count) {
+  if (level >= TropoDBConfig::level_count) {
     TROPO_LOG_ERROR("ERROR: LN Compaction: not a valid compaction level \n");
     return;
   }
@@ -407,7 +494,7 @@ void TropoDBImpl::BackgroundCompaction() {
   // It is possible that we only need deletes (and not compaction)
   // This happens when a lot of readers or threads kept references to the MVCC
   // of TropoDB (hence we could not delete)
-  if (versions_->OnlyNeedDeletes(current->CompactionLevel())) {
+  if (versions_->OnlyNeedDeletes(level)) {
     // TODO: we should probably wait a while instead of spamming reset requests.
     // Then probably all clients are done with their reads on old versions.
     before = clock_->NowMicros();
@@ -427,8 +514,15 @@ void TropoDBImpl::BackgroundCompaction() {
   {
     // Pick compaction
     before = clock_->NowMicros();
-    TropoCompaction* c = versions_->PickCompaction(current->CompactionLevel(),
-                                                   reserved_comp_[0]);
+    TropoCompaction* c =
+        is_manual ? versions_->CompactRange(level, manual_compaction_->begin,
+                                            manual_compaction_->end)
+                  : versions_->PickCompaction(level, reserved_comp_[0]);
+    if (c == nullptr) {
+      // Nothing left in the range of the manual compaction
+      manual_compaction_->done = true;
+      return;
+    }
     while (reserve_claimed_ == 0 ||
            c->HasOverlapWithOtherCompaction(reserved_comp_[0]) || c->IsBusy()) {
       TROPO_LOG_DEBUG(
@@ -441,8 +535,17 @@ void TropoDBImpl::BackgroundCompaction() {
       bg_work_l0_finished_signal_.Wait();
       compaction_wait_compaction_LN_.AddTiming(clock_->NowMicros() - before_wait);
       current = versions_->current();
-      c = versions_->PickCompaction(current->CompactionLevel(),
-                                    reserved_comp_[0]);
+      if (is_manual && manual_compaction_ != nullptr) {
+        c = versions_->CompactRange(level, manual_compaction_->begin,
+                                    manual_compaction_->end);
+        if (c == nullptr) {
+          manual_compaction_->done = true;
+          return;
+        }
+      } else {
+        level = current->CompactionLevel();
+        c = versions_->PickCompaction(level, reserved_comp_[0]);
+      }
     }
     reserve_claimed_ = reserve_claimed_ == 1 ? -1 : reserve_claimed_;
     c->GetCompactionTargets(&reserved_comp_[1]);
@@ -501,7 +604,10 @@ void TropoDBImpl::BackgroundCompaction() {
       return;
     }
     // Diag
-    compactions_[current->CompactionLevel()]++;
+    compactions_[level]++;
+    if (is_manual && manual_compaction_ != nullptr) {
+      manual_compaction_->compactions++;
+    }
   }
 
   // Reset LN zones
@@ -557,7 +663,12 @@ void TropoDBImpl::MaybeScheduleCompaction(bool force) {
   // No duplicate or unnecessary compactions
   if (!bg_error_.ok()) {
     return;
-  } else if (bg_compaction_scheduled_) {
+  } else if (bg_compaction_scheduled_ || bg_work_paused_ > 0) {
+    return;
+  } else if (manual_compaction_ != nullptr && manual_compaction_->level > 0 &&
+             !manual_compaction_->done) {
+    // Manual compactions do not depend on the score
+  } else if (manual_compaction_ != nullptr && manual_compaction_->exclusive) {
     return;
   } else if (!force && !versions_->NeedsCompaction()) {
     return;
@@ -567,4 +678,166 @@ void TropoDBImpl::MaybeScheduleCompaction(bool force) {
   env_->Schedule(&TropoDBImpl::BGCompactionWork, this, rocksdb::Env::LOW);
 }
 
+Status TropoDBImpl::RunManualCompaction(uint8_t first_level,
+                                        uint8_t last_level,
+                                        const InternalKey* begin,
+                                        const InternalKey* end, bool exclusive,
+                                        std::atomic<bool>* canceled) {
+  MutexLock l(&mutex_);
+  // Only one manual compaction at a time
+  while (manual_compaction_ != nullptr && bg_error_.ok() && !shutdown_) {
+    bg_work_finished_signal_.Wait();
+  }
+  ManualCompaction manual;
+  manual.exclusive = exclusive;
+  manual.begin = begin;
+  manual.end = end;
+  manual.compactions = 0;
+  manual_compaction_ = &manual;
+
+  // Push the range down level by level, the background threads do the work.
+  Status s = bg_error_;
+  for (uint8_t level = first_level; level < last_level && s.ok(); level++) {
+    manual.level = level;
+    std::vector<SSZoneMetaData*> overlap;
+    versions_->current()->GetOverlappingInputs(level, begin, end, &overlap);
+    manual.done = overlap.empty();
+    TROPO_LOG_INFO("INFO: Manual compaction: L%u has %lu tables in range\n",
+                   level, overlap.size());
+    while (!manual.done) {
+      if (!bg_error_.ok()) {
+        s = bg_error_;
+        break;
+      } else if (shutdown_) {
+        s = Status::ShutdownInProgress();
+        break;
+      } else if (canceled != nullptr && canceled->load()) {
+        s = Status::Incomplete(Status::SubCode::kManualCompactionPaused);
+        break;
+      }
+      if (level == 0) {
+        MaybeScheduleCompactionL0();
+        bg_work_l0_finished_signal_.Wait();
+      } else {
+        MaybeScheduleCompaction(false);
+        bg_work_finished_signal_.Wait();
+      }
+    }
+  }
+  TROPO_LOG_INFO("INFO: Manual compaction: finished after %lu compactions\n",
+                 manual.compactions);
+
+  manual_compaction_ = nullptr;
+  // Wake up other manual compactions and resume automatic compactions
+  bg_work_finished_signal_.SignalAll();
+  if (!shutdown_) {
+    MaybeScheduleCompactionL0();
+    MaybeScheduleCompaction(false);
+  }
+  return s;
+}
+
+Status TropoDBImpl::CompactRange(const CompactRangeOptions& options,
+                                 ColumnFamilyHandle* column_family,
+                                 const Slice* begin, const Slice* end) {
+  if (!column_families_->Keyed()) {
+    return CompactRangeImpl(options, begin, end);
+  }
+  // Open bounds end at the key range of the family
+  std::string begin_buf, end_buf;
+  TropoColumnFamilySet::KeyRange(column_family->GetID(), &begin_buf, &end_buf);
+  if (begin != nullptr) {
+    FamilyKey(column_family, *begin, &begin_buf);
+  }
+  if (end != nullptr) {
+    FamilyKey(column_family, *end, &end_buf);
+  }
+  Slice begin_key(begin_buf), end_key(end_buf);
+  return CompactRangeImpl(options, &begin_key, &end_key);
+}
+
+Status TropoDBImpl::CompactRangeImpl(const CompactRangeOptions& options,
+                                     const Slice* begin, const Slice* end) {
+  // Data in the memtables is part of the range as well
+  FlushOptions flush_options;
+  flush_options.wait = true;
+  Status s = Flush(flush_options, DefaultColumnFamily());
+  if (!s.ok()) {
+    return s;
+  }
+  InternalKey begin_storage, end_storage;
+  const InternalKey* begin_key = nullptr;
+  const InternalKey* end_key = nullptr;
+  if (begin != nullptr) {
+    begin_storage = InternalKey(*begin, kMaxSequenceNumber, kValueTypeForSeek);
+    begin_key = &begin_storage;
+  }
+  if (end != nullptr) {
+    end_storage = InternalKey(*end, 0, static_cast<ValueType>(0));
+    end_key = &end_storage;
+  }
+  return RunManualCompaction(0, TropoDBConfig::level_count - 1, begin_key,
+                             end_key, options.exclusive_manual_compaction,
+                             options.canceled);
+}
+
+Status TropoDBImpl::CompactFiles(
+    const CompactionOptions& compact_options, ColumnFamilyHandle* column_family,
+    const std::vector<std::string>& input_file_names, const int output_level,
+    const int output_path_id, std::vector<std::string>* const output_file_names,
+    CompactionJobInfo* compaction_job_info) {
+  // There are no files, SSTables are identified by their number.
+  InternalKey smallest, largest;
+  int input_level = -1;
+  {
+    MutexLock l(&mutex_);
+    TropoVersion* current = versions_->current();
+    std::vector<SSZoneMetaData*> inputs;
+    for (const auto& name : input_file_names) {
+      uint64_t number;
+      Slice in(name);
+      if (!ConsumeDecimalNumber(&in, &number) || !in.empty()) {
+        return Status::InvalidArgument("Not an SSTable number", name);
+      }
+      bool found = false;
+      for (uint8_t level = 0; level < TropoDBConfig::level_count; level++) {
+        for (SSZoneMetaData* m : current->LevelSSTables(level)) {
+          if (m->number != number) {
+            continue;
+          }
+          if (input_level >= 0 && input_level != level) {
+            return Status::InvalidArgument("SSTables are from multiple levels");
+          }
+          input_level = level;
+          inputs.push_back(m);
+          found = true;
+        }
+      }
+      if (!found) {
+        return Status::InvalidArgument("SSTable does not exist", name);
+      }
+    }
+    if (inputs.empty()) {
+      return Status::InvalidArgument("No SSTables to compact");
+    }
+    if (output_level <= input_level ||
+        output_level >= TropoDBConfig::level_count) {
+      return Status::InvalidArgument("Output level must be below input level");
+    }
+    versions_->GetRange(inputs, &smallest, &largest);
+  }
+  Status s = RunManualCompaction(input_level, output_level, &smallest,
+                                 &largest, true, nullptr);
+  if (s.ok() && output_file_names != nullptr) {
+    MutexLock l(&mutex_);
+    std::vector<SSZoneMetaData*> outputs;
+    versions_->current()->GetOverlappingInputs(output_level, &smallest,
+                                               &largest, &outputs);
+    for (const SSZoneMetaData* m : outputs) {
+      output_file_names->push_back(std::to_string(m->number));
+    }
+  }
+  return s;
+}
+
 }  // namespace ROCKSDB_NAMESPACE
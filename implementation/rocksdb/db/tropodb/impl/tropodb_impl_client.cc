@@ -29,10 +29,64 @@ Status TropoDBImpl::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
-Status TropoDBImpl::MakeRoomForWrite(size_t size, uint8_t parallel_number) {
+Status TropoDBImpl::Put(const WriteOptions& options,
+                        ColumnFamilyHandle* column_family, const Slice& key,
+                        const Slice& value) {
+  WriteBatch batch;
+  Status s = batch.Put(column_family, key, value);
+  if (!s.ok()) {
+    return s;
+  }
+  return Write(options, &batch);
+}
+
+Status TropoDBImpl::Delete(const WriteOptions& options,
+                           ColumnFamilyHandle* column_family,
+                           const Slice& key) {
+  WriteBatch batch;
+  Status s = batch.Delete(column_family, key);
+  if (!s.ok()) {
+    return s;
+  }
+  return Write(options, &batch);
+}
+
+Status TropoDBImpl::DeleteRange(const WriteOptions& options,
+                                ColumnFamilyHandle* column_family,
+                                const Slice& begin_key, const Slice& end_key) {
+  if (internal_comparator_.user_comparator()->Compare(begin_key, end_key) >
+      0) {
+    return Status::InvalidArgument("end key comes before start key");
+  }
+  WriteBatch batch;
+  Status s = batch.DeleteRange(column_family, begin_key, end_key);
+  if (!s.ok()) {
+    return s;
+  }
+  return Write(options, &batch);
+}
+
+Status TropoDBImpl::Merge(const WriteOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          const Slice& value) {
+  if (column_families_->GetMergeOperator(column_family->GetID()) == nullptr) {
+    TROPO_LOG_ERROR("ERROR: Merge: no merge_operator for column family\n");
+    return Status::NotSupported(
+        "Provide a merge_operator for the column family");
+  }
+  WriteBatch batch;
+  Status s = batch.Merge(column_family, key, value);
+  if (!s.ok()) {
+    return s;
+  }
+  return Write(options, &batch);
+}
+
+Status TropoDBImpl::MakeRoomForWrite(size_t size, uint8_t parallel_number,
+                                     bool force) {
   mutex_.AssertHeld();
   Status s;
-  bool allow_delay = true;
+  bool allow_delay = !force;
   uint64_t before;
   while (true) {
     if (!bg_error_.ok()) {
@@ -40,7 +94,10 @@ Status TropoDBImpl::MakeRoomForWrite(size_t size, uint8_t parallel_number) {
       s = bg_error_;
       return s;
     }
-    if (allow_delay &&
+    if (force && mem_[parallel_number]->GetNumEntries() == 0) {
+      // Nothing to flush
+      break;
+    } else if (allow_delay &&
         versions_->NumLevelZones(0) > TropoDBConfig::L0_slow_down) {
       // Throttle
       before = clock_->NowMicros();
@@ -49,7 +106,7 @@ Status TropoDBImpl::MakeRoomForWrite(size_t size, uint8_t parallel_number) {
       allow_delay = false;
       mutex_.Lock();
       put_slowdown_.AddTiming(clock_->NowMicros() - before);
-    } else if (!mem_[parallel_number]->ShouldScheduleFlush() &&
+    } else if (!force && !mem_[parallel_number]->ShouldScheduleFlush() &&
                wal_[parallel_number]->SpaceLeft(size)) {
       // space left in memory table
       break;
@@ -58,9 +115,11 @@ Status TropoDBImpl::MakeRoomForWrite(size_t size, uint8_t parallel_number) {
       before = clock_->NowMicros();
       bg_flush_work_finished_signal_.Wait();
       put_wait_on_flush_.AddTiming(clock_->NowMicros() - before);
-    } else if (versions_->NeedsL0CompactionForce() ||
-               versions_->NeedsL0CompactionForceParallel(parallel_number)) {
-      // No more space in L0. Better to wait till compaction is done
+    } else if ((versions_->NeedsL0CompactionForce() ||
+                versions_->NeedsL0CompactionForceParallel(parallel_number)) &&
+               !versions_->CanBorrowForL0(max_write_buffer_size_ * 1.2)) {
+      // No more space in L0 (or LN to borrow from). Better to wait till
+      // compaction is done
       TROPO_LOG_DEBUG("DEBUG: Forcing L0 compaction, no space left\n");
       before = clock_->NowMicros();
       MaybeScheduleCompactionL0();
@@ -88,21 +147,24 @@ Status TropoDBImpl::MakeRoomForWrite(size_t size, uint8_t parallel_number) {
 #ifdef DISABLE_BACKGROUND_OPS
       // Drop all that was in the memtable (NOT PERSISTENT!)
       mem_[parallel_number]->Unref();
-      mem_[parallel_number] = new TropoMemtable(options_, internal_comparator_,
-                                                max_write_buffer_size_);
+      mem_[parallel_number] =
+          new TropoMemtable(options_, internal_comparator_,
+                            max_write_buffer_size_, merge_operator_);
       mem_[parallel_number]->Ref();
       FlushData* dat = new FlushData(this, parallel_number);
       env_->Schedule(&TropoDBImpl::BGFlushWork, dat, rocksdb::Env::HIGH);
 #else
       // Switch to fresh memtable
       imm_[parallel_number] = mem_[parallel_number];
-      mem_[parallel_number] = new TropoMemtable(options_, internal_comparator_,
-                                                max_write_buffer_size_);
+      mem_[parallel_number] =
+          new TropoMemtable(options_, internal_comparator_,
+                            max_write_buffer_size_, merge_operator_);
       mem_[parallel_number]->Ref();
       // Ensure the background knows about these thingss
       MaybeScheduleFlush(parallel_number);
       MaybeScheduleCompactionL0();
 #endif
+      force = false;
       put_create_new_mem_.AddTiming(clock_->NowMicros() - before);
     }
   }
@@ -136,28 +198,51 @@ WriteBatch* TropoDBImpl::BuildBatchGroup(Writer** last_writer,
   ++iter;  // Advance past "first"
   for (; iter != writers_[parallel_number].end(); ++iter) {
     Writer* w = *iter;
-    if (w->batch != nullptr) {
-      size += WriteBatchInternal::ByteSize(w->batch);
-      if (size > max_size) {
-        // Do not make batch too big
-        break;
-      }
+    if (w->batch == nullptr) {
+      // Flush and sync requests are not part of a group
+      break;
+    }
+    size += WriteBatchInternal::ByteSize(w->batch);
+    if (size > max_size) {
+      // Do not make batch too big
+      break;
+    }
 
-      // Append to *result
-      if (result == first->batch) {
-        // Switch to temporary batch instead of disturbing caller's batch
-        result = tmp_batch_[parallel_number];
-        assert(WriteBatchInternal::Count(result) == 0);
-        WriteBatchInternal::Append(result, first->batch);
-      }
-      WriteBatchInternal::Append(result, w->batch);
+    // Append to *result
+    if (result == first->batch) {
+      // Switch to temporary batch instead of disturbing caller's batch
+      result = tmp_batch_[parallel_number];
+      assert(WriteBatchInternal::Count(result) == 0);
+      WriteBatchInternal::Append(result, first->batch);
     }
+    WriteBatchInternal::Append(result, w->batch);
     *last_writer = w;
   }
   return result;
 }
 
 Status TropoDBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  if (!column_families_->Keyed()) {
+    return WriteImpl(options, updates, -1, false);
+  }
+  // The WAL and memtables only see stored keys, which keeps recovery and the
+  // row cache unaware of families.
+  WriteBatch batch;
+  Status s = column_families_->EncodeBatch(updates, &batch);
+  if (!s.ok()) {
+    return s;
+  }
+  return WriteImpl(options, &batch, -1, false);
+}
+
+Status TropoDBImpl::WriteImpl(const WriteOptions& options, WriteBatch* updates,
+                              int parallel_number, bool force_flush) {
+  // Operands of one key must stay in one stripe to keep their order, batches
+  // are striped round-robin.
+  if (TropoDBConfig::lower_concurrency > 1 && parallel_number < 0 &&
+      updates != nullptr && updates->HasMerge()) {
+    return Status::NotSupported("Merge requires lower_concurrency == 1");
+  }
   uint64_t before = clock_->NowMicros();
   Status s;
 
@@ -167,10 +252,15 @@ Status TropoDBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
   MutexLock l(&mutex_);
 
   // TODO: Striping is NOT the way to go.
-  uint8_t striped_index = writer_striper_;
-  writer_striper_ = writer_striper_ + 1 == TropoDBConfig::lower_concurrency
-                        ? 0
-                        : writer_striper_ + 1;
+  uint8_t striped_index;
+  if (parallel_number >= 0) {
+    striped_index = parallel_number;
+  } else {
+    striped_index = writer_striper_;
+    writer_striper_ = writer_striper_ + 1 == TropoDBConfig::lower_concurrency
+                          ? 0
+                          : writer_striper_ + 1;
+  }
 
   // Add to writer group
   writers_[striped_index].push_back(&w);
@@ -186,7 +276,7 @@ Status TropoDBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
                            ? 0
                            : WriteBatchInternal::Contents(updates).size() +
                                  wal_reserved_[striped_index],
-                       striped_index);
+                       striped_index, force_flush);
   uint64_t last_sequence = versions_->LastSequence();
   Writer* last_writer = &w;
   // Write to what is needed
@@ -223,6 +313,10 @@ Status TropoDBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
         if (!s.ok()) {
           TROPO_LOG_ERROR("ERROR: memtable error: %s\n", s.getState());
         }
+        // Before the sequence number is published, see TropoRowCache
+        if (row_cache_ != nullptr) {
+          row_cache_->Invalidate(write_batch, last_sequence);
+        }
       } else {
         TROPO_LOG_ERROR("ERROR: WAL append error\n");
       }
@@ -234,6 +328,16 @@ Status TropoDBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
       tmp_batch_[striped_index]->Clear();
     }
     versions_->SetLastSequence(last_sequence);
+  } else if (s.ok() && options.sync) {
+    // Only persist what is already in the WAL
+    wal_[striped_index]->Ref();
+    mutex_.Unlock();
+    s = wal_[striped_index]->Sync();
+    mutex_.Lock();
+    wal_[striped_index]->Unref();
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: WAL sync error\n");
+    }
   }
 
   // Writer group coordination
@@ -256,11 +360,97 @@ Status TropoDBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
   return s;
 }
 
+void TropoDBImpl::BlockWriters(std::vector<Writer*>* blockers) {
+  mutex_.AssertHeld();
+  // An empty writer at the front of each queue, groups never include it.
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    Writer* w = new Writer(&mutex_);
+    writers_[i].push_back(w);
+    while (w != writers_[i].front()) {
+      w->cv.Wait();
+    }
+    blockers->push_back(w);
+  }
+}
+
+void TropoDBImpl::UnblockWriters(std::vector<Writer*>* blockers) {
+  mutex_.AssertHeld();
+  for (size_t i = 0; i < blockers->size(); i++) {
+    assert(writers_[i].front() == (*blockers)[i]);
+    writers_[i].pop_front();
+    delete (*blockers)[i];
+    if (!writers_[i].empty()) {
+      writers_[i].front()->cv.Signal();
+    }
+  }
+  blockers->clear();
+}
+
+Status TropoDBImpl::Flush(const FlushOptions& options,
+                          ColumnFamilyHandle* column_family) {
+  // A write without updates switches the memtable of the stripe
+  Status s;
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency && s.ok(); i++) {
+    s = WriteImpl(WriteOptions(), nullptr, i, true);
+  }
+  if (s.ok() && options.wait) {
+    MutexLock l(&mutex_);
+    while (bg_error_.ok() && AnyImmutable()) {
+      bg_flush_work_finished_signal_.Wait();
+    }
+    s = bg_error_;
+  }
+  return s;
+}
+
+Status TropoDBImpl::Flush(
+    const FlushOptions& options,
+    const std::vector<ColumnFamilyHandle*>& column_families) {
+  return Flush(options, DefaultColumnFamily());
+}
+
+Status TropoDBImpl::SyncWAL() {
+  WriteOptions options;
+  options.sync = true;
+  Status s;
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency && s.ok(); i++) {
+    s = WriteImpl(options, nullptr, i, false);
+  }
+  return s;
+}
+
 Status TropoDBImpl::Get(const ReadOptions& options, const Slice& key,
                         std::string* value) {
-  MutexLock l(&mutex_);
+  PinnableSlice pinnable(value);
+  Status s = GetImpl(options, default_cf_handle_, key, &pinnable);
+  if (pinnable.IsPinned()) {
+    value->assign(pinnable.data(), pinnable.size());
+  }
+  return s;
+}
+
+Status TropoDBImpl::GetImpl(const ReadOptions& options,
+                            ColumnFamilyHandle* column_family,
+                            const Slice& user_key, PinnableSlice* value,
+                            MergeContext* merge_operands) {
   Status s;
-  value->clear();
+  std::string key_buf;
+  const Slice key = FamilyKey(column_family, user_key, &key_buf);
+  value->Reset();
+  value->GetSelf()->clear();
+  // Hot keys are answered by the row cache, but operands are never cached.
+  const bool use_row_cache = row_cache_ != nullptr && merge_operands == nullptr;
+  if (use_row_cache && row_cache_->Lookup(key, value->GetSelf(), &s)) {
+    value->PinSelf();
+    return s;
+  }
+  MutexLock l(&mutex_);
+  // Operands are merged on the fly, unless the caller wants the operands.
+  const bool do_merge = merge_operands == nullptr;
+  MergeContext merge_context;
+  if (merge_operands == nullptr) {
+    merge_operands = &merge_context;
+  }
   // This is absolutely necessary for locking logic because private pointers
   // can be changed in background work. (snapshotting)
   std::vector<TropoMemtable*> mem;
@@ -276,38 +466,51 @@ Status TropoDBImpl::Get(const ReadOptions& options, const Slice& key,
 
   // Get on the snapshot
   {
-    LookupKey lkey(key, versions_->LastSequence());
+    const SequenceNumber read_seq = versions_->LastSequence();
+    const uint64_t row_generation =
+        use_row_cache ? row_cache_->Generation() : 0;
+    LookupKey lkey(key, read_seq);
     mutex_.Unlock();
     SequenceNumber seq;
     SequenceNumber seq_pot;
+    SequenceNumber max_covering_tombstone_seq = 0;
     bool found = false;
     std::string tmp;
     // TODO: ALL memtables?
     for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
-      if (mem[i]->Get(options, lkey, &tmp, &s, &seq_pot)) {
-        if (!found) {
+      if (mem[i]->Get(options, lkey, &tmp, &s, &seq_pot,
+                      &max_covering_tombstone_seq, merge_operands, do_merge)) {
+        if (!found || seq_pot > seq) {
           found = true;
           seq = seq_pot;
-          *value = tmp;
-        } else if (seq_pot > seq) {
-          seq = seq_pot;
-          *value = tmp;
+          value->GetSelf()->swap(tmp);
         }
       } else if (imm[i] != nullptr &&
-                 imm[i]->Get(options, lkey, &tmp, &s, &seq_pot)) {
-        if (!found) {
+                 imm[i]->Get(options, lkey, &tmp, &s, &seq_pot,
+                             &max_covering_tombstone_seq, merge_operands,
+                             do_merge)) {
+        if (!found || seq_pot > seq) {
           found = true;
           seq = seq_pot;
-          *value = tmp;
-        } else if (seq_pot > seq) {
-          seq = seq_pot;
-          *value = tmp;
+          value->GetSelf()->swap(tmp);
         }
       }
     }
-    // Look in SSTables
+    // A range tombstone in another stripe can still cover the entry
+    if (found && seq < max_covering_tombstone_seq) {
+      value->GetSelf()->clear();
+      s = Status::NotFound("Entry deleted by range");
+    }
+    if (found) {
+      value->PinSelf();
+    }
+    // Look in SSTables, the memtables can already hold merge operands
     if (!found) {
-      s = current->Get(options, lkey, value);
+      s = current->Get(options, lkey, value, max_covering_tombstone_seq,
+                       merge_operands, do_merge);
+    }
+    if (use_row_cache) {
+      row_cache_->Insert(key, read_seq, row_generation, s, *value);
     }
     mutex_.Lock();
   }
@@ -322,12 +525,43 @@ Status TropoDBImpl::Get(const ReadOptions& options, const Slice& key,
   return s;
 }
 
+Status TropoDBImpl::GetMergeOperands(
+    const ReadOptions& options, ColumnFamilyHandle* column_family,
+    const Slice& key, PinnableSlice* merge_operands,
+    GetMergeOperandsOptions* get_merge_operands_options,
+    int* number_of_operands) {
+  MergeContext merge_context;
+  PinnableSlice value;
+  Status s = GetImpl(options, column_family, key, &value, &merge_context);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+  // Operands are returned from oldest to newest, a base value is the first.
+  const std::vector<Slice>& operands = merge_context.GetOperands();
+  *number_of_operands = static_cast<int>(operands.size());
+  if (operands.empty()) {
+    return Status::NotFound();
+  }
+  if (*number_of_operands >
+      get_merge_operands_options->expected_max_number_of_operands) {
+    return Status::Incomplete(
+        Status::SubCode::KMergeOperandsInsufficientCapacity);
+  }
+  for (size_t i = 0; i < operands.size(); i++) {
+    merge_operands[i].PinSelf(operands[i]);
+  }
+  return Status::OK();
+}
+
 Status TropoDBImpl::Get(const ReadOptions& options,
                         ColumnFamilyHandle* column_family, const Slice& key,
                         PinnableSlice* value, std::string* timestamp) {
-  std::string* val = new std::string;
-  Status s = Get(options, key, val);
-  *value = PinnableSlice(val);
-  return s;
+  return GetImpl(options, column_family, key, value);
+}
+
+Status TropoDBImpl::Get(const ReadOptions& options,
+                        ColumnFamilyHandle* column_family, const Slice& key,
+                        PinnableSlice* value) {
+  return GetImpl(options, column_family, key, value);
 }
 }  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,198 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/tropodb/index/tropodb_column_family.h"
+#include "db/tropodb/index/tropodb_version_set.h"
+#include "db/tropodb/tropodb_impl.h"
+#include "db/tropodb/utils/tropodb_logger.h"
+#include "db/write_batch_internal.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+Status TropoDBImpl::OpenColumnFamilies(
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    std::vector<ColumnFamilyHandle*>* handles) {
+  mutex_.AssertHeld();
+  const std::map<uint32_t, std::string>& existing =
+      versions_->ColumnFamilies();
+  const bool keyed = !existing.empty();
+  column_families_->SetKeyed(keyed);
+
+  // Like RocksDB, all families must be opened and default is one of them.
+  auto requested = [&](const std::string& name) {
+    for (const auto& cf : column_families) {
+      if (cf.name == name) {
+        return true;
+      }
+    }
+    return false;
+  };
+  if (!requested(kDefaultColumnFamilyName)) {
+    return Status::InvalidArgument("Default column family not specified");
+  }
+  const ColumnFamilyOptions* default_options = nullptr;
+  for (const auto& cf : column_families) {
+    if (cf.name == kDefaultColumnFamilyName) {
+      default_options = &cf.options;
+    }
+  }
+  for (const auto& cf : existing) {
+    if (!requested(cf.second)) {
+      return Status::InvalidArgument("Column family not opened", cf.second);
+    }
+  }
+
+  Status s;
+  for (const auto& cf : column_families) {
+    s = TropoColumnFamilySet::CheckOptions(cf.options, *default_options);
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: Open: unsupported options for family %s\n",
+                      cf.name.data());
+      return s;
+    }
+  }
+  for (const auto& cf : column_families) {
+    uint32_t id = 0;
+    bool found = !keyed && cf.name == kDefaultColumnFamilyName;
+    for (const auto& family : existing) {
+      if (family.second == cf.name) {
+        id = family.first;
+        found = true;
+        break;
+      }
+    }
+    if (!found && !keyed) {
+      TROPO_LOG_ERROR("ERROR: Open: database has no column families\n");
+      s = Status::NotSupported(
+          "Database was created without column families");
+    } else if (!found && !options_.create_missing_column_families) {
+      s = Status::InvalidArgument("Column family not found", cf.name);
+    } else if (!found) {
+      s = versions_->AddColumnFamily(cf.name, &id);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    column_families_->Add(id, cf.options.merge_operator);
+    handles->push_back(new TropoColumnFamilyHandle(id, cf.name, cf.options));
+    if (id == 0) {
+      delete default_cf_handle_;
+      default_cf_handle_ = new TropoColumnFamilyHandle(id, cf.name, cf.options);
+    }
+  }
+  return s;
+}
+
+ColumnFamilyHandle* TropoDBImpl::DefaultColumnFamily() const {
+  return default_cf_handle_;
+}
+
+Slice TropoDBImpl::FamilyKey(ColumnFamilyHandle* column_family,
+                             const Slice& key, std::string* buf) const {
+  if (!column_families_->Keyed()) {
+    return key;
+  }
+  buf->clear();
+  column_families_->AppendKey(column_family->GetID(), key, buf);
+  return Slice(*buf);
+}
+
+Status TropoDBImpl::CreateColumnFamily(const ColumnFamilyOptions& options,
+                                       const std::string& column_family_name,
+                                       ColumnFamilyHandle** handle) {
+  MutexLock l(&mutex_);
+  if (!column_families_->Keyed()) {
+    return Status::NotSupported(
+        "Database was created without column families");
+  }
+  Status s = TropoColumnFamilySet::CheckOptions(
+      options, default_cf_handle_->GetOptions());
+  if (!s.ok()) {
+    return s;
+  }
+  uint32_t id;
+  s = versions_->AddColumnFamily(column_family_name, &id);
+  if (!s.ok()) {
+    return s;
+  }
+  column_families_->Add(id, options.merge_operator);
+  *handle = new TropoColumnFamilyHandle(id, column_family_name, options);
+  TROPO_LOG_INFO("INFO: Created column family %s (%u)\n",
+                 column_family_name.data(), id);
+  return s;
+}
+
+Status TropoDBImpl::CreateColumnFamilies(
+    const ColumnFamilyOptions& options,
+    const std::vector<std::string>& column_family_names,
+    std::vector<ColumnFamilyHandle*>* handles) {
+  Status s;
+  for (const auto& name : column_family_names) {
+    ColumnFamilyHandle* handle;
+    s = CreateColumnFamily(options, name, &handle);
+    if (!s.ok()) {
+      break;
+    }
+    handles->push_back(handle);
+  }
+  return s;
+}
+
+Status TropoDBImpl::CreateColumnFamilies(
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    std::vector<ColumnFamilyHandle*>* handles) {
+  Status s;
+  for (const auto& cf : column_families) {
+    ColumnFamilyHandle* handle;
+    s = CreateColumnFamily(cf.options, cf.name, &handle);
+    if (!s.ok()) {
+      break;
+    }
+    handles->push_back(handle);
+  }
+  return s;
+}
+
+Status TropoDBImpl::DropColumnFamily(ColumnFamilyHandle* column_family) {
+  const uint32_t id = column_family->GetID();
+  if (id == 0) {
+    return Status::InvalidArgument("Can not drop default column family");
+  }
+  if (!column_families_->Contains(id)) {
+    return Status::InvalidArgument("Column family already dropped");
+  }
+  // First hide all data of the family, compactions remove it over time. A
+  // crash before the drop is persisted leaves an empty family behind.
+  std::string begin, end;
+  TropoColumnFamilySet::KeyRange(id, &begin, &end);
+  WriteBatch batch;
+  Status s = WriteBatchInternal::DeleteRange(&batch, 0, begin, end);
+  s = s.ok() ? WriteImpl(WriteOptions(), &batch, -1, false) : s;
+  if (!s.ok()) {
+    TROPO_LOG_ERROR("ERROR: Drop column family: Could not delete data\n");
+    return s;
+  }
+  MutexLock l(&mutex_);
+  s = versions_->DropColumnFamily(id);
+  if (s.ok()) {
+    column_families_->Remove(id);
+    TROPO_LOG_INFO("INFO: Dropped column family %s (%u)\n",
+                   column_family->GetName().data(), id);
+  }
+  return s;
+}
+
+Status TropoDBImpl::DropColumnFamilies(
+    const std::vector<ColumnFamilyHandle*>& column_families) {
+  Status s;
+  for (ColumnFamilyHandle* column_family : column_families) {
+    s = DropColumnFamily(column_family);
+    if (!s.ok()) {
+      break;
+    }
+  }
+  return s;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -19,12 +19,14 @@ namespace ROCKSDB_NAMESPACE {
 
 static void PrintPerfCounterHeader() {
   std::ostringstream out;
-  std::string table_line(113, '-');
+  std::string table_line(158, '-');
   out << table_line << "\n";
   out << std::left << std::setw(20) << "| name" << std::setw(15)
       << "| total (ops)" << std::setw(15) << "| sum (micros)" << std::setw(15)
       << "| min (micros)" << std::setw(15) << "| max (micros)" << std::setw(15)
       << "| avg (micros)" << std::setw(15) << "| StdDev (micros)"
+      << std::setw(15) << "| p50 (micros)" << std::setw(15) << "| p99 (micros)"
+      << std::setw(15) << "| p999 (micros)"
       << "|\n";
   out << table_line << "\n";
   TROPO_LOG_PERF("%s", out.str().data());
@@ -42,13 +44,17 @@ static void PrintPerfCounterRow(std::string name,
       << counter.GetMax() << std::fixed << std::setprecision(2) << std::left
       << "|" << std::right << std::setw(14) << counter.GetAvg() << std::left
       << "|" << std::right << std::setw(14) << counter.GetStandardDeviation()
+      << std::left << "|" << std::right << std::setw(14)
+      << counter.GetPercentile(50.0) << std::left << "|" << std::right
+      << std::setw(14) << counter.GetPercentile(99.0) << std::left << "|"
+      << std::right << std::setw(14) << counter.GetPercentile(99.9)
       << "  |\n";
   TROPO_LOG_PERF("%s", out.str().data());
 }
 
 static void PrintPerfCounterTail() {
   std::ostringstream out;
-  std::string table_line(113, '-');
+  std::string table_line(158, '-');
   out << table_line << "\n";
   TROPO_LOG_PERF("%s", out.str().data());
 }
@@ -0,0 +1,352 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/tropodb/index/tropodb_version.h"
+#include "db/tropodb/index/tropodb_version_edit.h"
+#include "db/tropodb/index/tropodb_version_set.h"
+#include "db/tropodb/table/tropodb_sst_file_writer.h"
+#include "db/tropodb/table/tropodb_sstable_builder.h"
+#include "db/tropodb/table/tropodb_sstable_manager.h"
+#include "db/tropodb/tropodb_config.h"
+#include "db/tropodb/tropodb_impl.h"
+#include "db/tropodb/utils/tropodb_logger.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+bool TropoDBImpl::MemtablesOverlap(const Slice& smallest,
+                                   const Slice& largest) {
+  mutex_.AssertHeld();
+  const Comparator* ucmp = internal_comparator_.user_comparator();
+  LookupKey lkey(smallest, kMaxSequenceNumber);
+  bool overlap = false;
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency && !overlap; i++) {
+    for (TropoMemtable* mem : {mem_[i], imm_[i]}) {
+      if (mem == nullptr || overlap) {
+        continue;
+      }
+      // Iterator is allocated in the arena of the memtable
+      InternalIterator* it = mem->NewIterator();
+      it->Seek(lkey.internal_key());
+      overlap = it->Valid() &&
+                ucmp->Compare(ExtractUserKey(it->key()), largest) <= 0;
+      it->~InternalIterator();
+      std::vector<TropoRangeTombstone> tombstones;
+      mem->GetRangeTombstones(&tombstones);
+      for (const auto& t : tombstones) {
+        overlap |= ucmp->Compare(t.start, largest) <= 0 &&
+                   ucmp->Compare(t.end, smallest) > 0;
+      }
+    }
+  }
+  return overlap;
+}
+
+Status TropoDBImpl::PrepareIngestion(const Slice& smallest,
+                                     const Slice& largest,
+                                     bool allow_blocking_flush, uint8_t* level,
+                                     SequenceNumber* seq) {
+  InternalKey begin(smallest, kMaxSequenceNumber, kValueTypeForSeek);
+  InternalKey end(largest, 0, static_cast<ValueType>(0));
+  // Writes can land in the range again after pushing it down, so retry.
+  for (int attempt = 0; attempt < 3; attempt++) {
+    {
+      MutexLock l(&mutex_);
+      if (!bg_error_.ok()) {
+        return bg_error_;
+      }
+      std::vector<Writer*> blockers;
+      BlockWriters(&blockers);
+      // No compaction may change the levels till the ingestion is applied
+      bg_work_paused_++;
+      while (bg_compaction_l0_scheduled_ || bg_compaction_scheduled_) {
+        bg_work_finished_signal_.Wait();
+      }
+      // Ingested data is the newest, so it must be above all data in its
+      // range. L0 and L1 leave no LN level above them.
+      TropoVersion* current = versions_->current();
+      std::vector<SSZoneMetaData*> overlap;
+      bool blocked = MemtablesOverlap(smallest, largest);
+      for (uint8_t l = 0; l < 2 && !blocked; l++) {
+        current->GetOverlappingInputs(l, &begin, &end, &overlap);
+        blocked = !overlap.empty();
+      }
+      if (!blocked) {
+        *level = TropoDBConfig::level_count - 1;
+        for (uint8_t l = 2; l < TropoDBConfig::level_count; l++) {
+          current->GetOverlappingInputs(l, &begin, &end, &overlap);
+          if (!overlap.empty()) {
+            *level = l - 1;
+            break;
+          }
+        }
+        *seq = versions_->LastSequence() + 1;
+        versions_->SetLastSequence(*seq);
+        UnblockWriters(&blockers);
+        return Status::OK();
+      }
+      bg_work_paused_--;
+      UnblockWriters(&blockers);
+      MaybeScheduleCompactionL0();
+      MaybeScheduleCompaction(false);
+    }
+    if (!allow_blocking_flush) {
+      return Status::InvalidArgument(
+          "Ingested range overlaps with memtables, L0 or L1");
+    }
+    // Push the range to the last level, this frees the levels above it.
+    Status s = CompactRangeImpl(CompactRangeOptions(), &smallest, &largest);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::TryAgain("Ingested range keeps receiving writes");
+}
+
+Status TropoDBImpl::FinishIngestion(uint8_t level,
+                                    const std::vector<SSZoneMetaData>& tables,
+                                    Status s) {
+  MutexLock l(&mutex_);
+  // All tables become visible at once
+  if (s.ok() && !tables.empty()) {
+    TropoVersionEdit edit;
+    for (const auto& meta : tables) {
+      edit.AddSSDefinition(level, meta);
+    }
+    s = versions_->LogAndApply(&edit);
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: Ingest: Could not apply to version\n");
+    }
+  }
+  if (!s.ok()) {
+    for (const auto& meta : tables) {
+      ss_manager_->DeleteLNTable(level, meta);
+    }
+  } else if (row_cache_ != nullptr) {
+    row_cache_->InvalidateAll();
+  }
+  bg_work_paused_--;
+  MaybeScheduleCompactionL0();
+  MaybeScheduleCompaction(false);
+  bg_work_l0_finished_signal_.SignalAll();
+  bg_work_finished_signal_.SignalAll();
+  bg_flush_work_finished_signal_.SignalAll();
+  return s;
+}
+
+Status TropoDBImpl::IngestIterator(Iterator* input, bool internal_keys,
+                                   const std::string& prefix, uint8_t level,
+                                   SequenceNumber seq,
+                                   std::vector<SSZoneMetaData>* tables) {
+  const Comparator* ucmp = internal_comparator_.user_comparator();
+  SSZoneMetaData meta;
+  TropoSSTableBuilder* builder =
+      ss_manager_->NewTropoSSTableBuilder(level, &meta);
+  auto flush = [&]() -> Status {
+    meta.number = versions_->NewSSNumber();
+    Status fs = builder->Finalise();
+    fs = fs.ok() ? builder->Flush() : fs;
+    if (fs.ok()) {
+      tables->push_back(SSZoneMetaData::copy(meta));
+    } else {
+      TROPO_LOG_ERROR("ERROR: Ingest: Could not write table\n");
+    }
+    delete builder;
+    builder = ss_manager_->NewTropoSSTableBuilder(level, &meta);
+    return fs;
+  };
+
+  Status s;
+  std::string last_key;
+  std::string key_buf;
+  for (input->SeekToFirst(); input->Valid() && s.ok(); input->Next()) {
+    Slice input_key =
+        internal_keys ? ExtractUserKey(input->key()) : input->key();
+    key_buf.assign(prefix);
+    key_buf.append(input_key.data(), input_key.size());
+    Slice user_key(key_buf);
+    if (builder->GetSize() > 0 || !tables->empty()) {
+      if (ucmp->Compare(user_key, last_key) <= 0) {
+        s = Status::InvalidArgument("Keys must be in increasing order");
+        break;
+      }
+    }
+    InternalKey ikey(user_key, seq, kTypeValue);
+    if (builder->GetSize() > 0 &&
+        builder->GetFinalSize() +
+                builder->EstimateSizeImpact(ikey.Encode(), input->value()) >
+            versions_->MaxLNTableBytes()) {
+      s = flush();
+      if (!s.ok()) {
+        break;
+      }
+    }
+    last_key.assign(user_key.data(), user_key.size());
+    s = builder->Apply(ikey.Encode(), input->value());
+  }
+  s = s.ok() ? input->status() : s;
+  if (s.ok() && builder->GetSize() > 0) {
+    s = flush();
+  }
+  delete builder;
+  return s;
+}
+
+Status TropoDBImpl::IngestSortedStream(Iterator* input,
+                                       bool allow_blocking_flush) {
+  input->SeekToLast();
+  if (!input->Valid()) {
+    return input->status();
+  }
+  std::string prefix;
+  FamilyKey(DefaultColumnFamily(), Slice(), &prefix);
+  std::string largest = prefix + input->key().ToString();
+  input->SeekToFirst();
+  std::string smallest = prefix + input->key().ToString();
+
+  uint8_t level;
+  SequenceNumber seq;
+  Status s =
+      PrepareIngestion(smallest, largest, allow_blocking_flush, &level, &seq);
+  if (!s.ok()) {
+    return s;
+  }
+  TROPO_LOG_INFO("INFO: Ingest: Loading sorted stream into L%u\n", level);
+  std::vector<SSZoneMetaData> tables;
+  s = IngestIterator(input, false, prefix, level, seq, &tables);
+  return FinishIngestion(level, tables, s);
+}
+
+Status TropoDBImpl::IngestExternalFile(
+    ColumnFamilyHandle* column_family,
+    const std::vector<std::string>& external_files,
+    const IngestExternalFileOptions& ingestion_options) {
+  IngestExternalFileArg arg;
+  arg.column_family = column_family;
+  arg.external_files = external_files;
+  arg.options = ingestion_options;
+  return IngestExternalFiles({arg});
+}
+
+Status TropoDBImpl::IngestExternalFiles(
+    const std::vector<IngestExternalFileArg>& args) {
+  if (args.empty()) {
+    return Status::InvalidArgument("No files to ingest");
+  }
+  const IngestExternalFileOptions& options = args[0].options;
+  if (options.ingest_behind) {
+    return Status::NotSupported("ingest_behind is not supported");
+  }
+  const Comparator* ucmp = internal_comparator_.user_comparator();
+
+  // Read the table ranges of all files first, tables must not overlap. Each
+  // file goes with the key prefix of its family.
+  std::vector<std::pair<std::string, std::string>> files;
+  std::vector<SSZoneMetaData> ranges;
+  uint64_t total_bytes = 0;
+  Status s;
+  for (const auto& arg : args) {
+    ColumnFamilyHandle* column_family = arg.column_family != nullptr
+                                            ? arg.column_family
+                                            : DefaultColumnFamily();
+    std::string prefix;
+    FamilyKey(column_family, Slice(), &prefix);
+    for (const auto& file : arg.external_files) {
+      files.emplace_back(file, prefix);
+    }
+  }
+  for (const auto& file_prefix : files) {
+    const std::string& file = file_prefix.first;
+    const std::string& prefix = file_prefix.second;
+    uint64_t file_size;
+    s = env_->GetFileSize(file, &file_size);
+    TropoSSTFileReader reader(env_);
+    s = s.ok() ? reader.Open(file) : s;
+    bool done = false;
+    while (s.ok() && !done) {
+      SSZoneMetaData meta;
+      s = reader.Next(nullptr, &meta, &done);
+      if (s.ok() && !done) {
+        if (!prefix.empty()) {
+          meta.smallest = InternalKey(
+              prefix + meta.smallest.user_key().ToString(), 0, kTypeValue);
+          meta.largest = InternalKey(
+              prefix + meta.largest.user_key().ToString(), 0, kTypeValue);
+        }
+        ranges.push_back(meta);
+      }
+    }
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: Ingest: Can not read %s\n", file.data());
+      return s;
+    }
+    total_bytes += file_size;
+  }
+  if (ranges.empty()) {
+    return Status::OK();
+  }
+  std::sort(ranges.begin(), ranges.end(),
+            [ucmp](const SSZoneMetaData& a, const SSZoneMetaData& b) {
+              return ucmp->Compare(a.smallest.user_key(),
+                                   b.smallest.user_key()) < 0;
+            });
+  for (size_t i = 1; i < ranges.size(); i++) {
+    if (ucmp->Compare(ranges[i - 1].largest.user_key(),
+                      ranges[i].smallest.user_key()) >= 0) {
+      return Status::InvalidArgument("External files overlap");
+    }
+  }
+  if (total_bytes > ss_manager_->SpaceRemainingInBytesLN()) {
+    return Status::NoSpace("Not enough space in LN for external files");
+  }
+
+  uint8_t level;
+  SequenceNumber seq;
+  s = PrepareIngestion(ranges.front().smallest.user_key(),
+                       ranges.back().largest.user_key(),
+                       options.allow_blocking_flush, &level, &seq);
+  if (!s.ok()) {
+    return s;
+  }
+  // Without any data in the range, the tables are appended as is. Otherwise
+  // their keys get the ingestion sequence number, to shadow older data. Keys
+  // of families need their prefix, so those tables are always rewritten.
+  const bool rewrite =
+      level != TropoDBConfig::level_count - 1 || column_families_->Keyed();
+  TROPO_LOG_INFO("INFO: Ingest: Loading %lu tables into L%u (rewrite %d)\n",
+                 ranges.size(), level, rewrite);
+  std::vector<SSZoneMetaData> tables;
+  for (size_t f = 0; f < files.size() && s.ok(); f++) {
+    TropoSSTFileReader reader(env_);
+    s = reader.Open(files[f].first);
+    bool done = false;
+    while (s.ok()) {
+      std::string table;
+      SSZoneMetaData meta;
+      s = reader.Next(&table, &meta, &done);
+      if (!s.ok() || done) {
+        break;
+      }
+      if (rewrite) {
+        std::unique_ptr<Iterator> it(
+            TropoSSTFileReader::NewTableIterator(table, ucmp));
+        s = IngestIterator(it.get(), true, files[f].second, level, seq,
+                           &tables);
+      } else {
+        meta.number = versions_->NewSSNumber();
+        s = ss_manager_->WriteSSTable(level, table, &meta);
+        if (s.ok()) {
+          tables.push_back(meta);
+        }
+      }
+    }
+  }
+  return FinishIngestion(level, tables, s);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
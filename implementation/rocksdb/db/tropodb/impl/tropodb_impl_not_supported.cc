@@ -13,13 +13,6 @@ Iterator* TropoDBImpl::NewIterator(const ReadOptions& options,
   return NULL;
 }
 
-Status TropoDBImpl::Merge(const WriteOptions& options,
-                          ColumnFamilyHandle* column_family, const Slice& key,
-                          const Slice& value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::OK();
-}
-
 int TropoDBImpl::MaxMemCompactionLevel(ColumnFamilyHandle* column_family) {
   TROPO_LOG_INFO("Not implemented\n");
   return 0;
@@ -34,15 +27,6 @@ const Snapshot* TropoDBImpl::GetSnapshot() { return nullptr; }
 
 void TropoDBImpl::ReleaseSnapshot(const Snapshot* snapshot) {}
 
-Status TropoDBImpl::GetMergeOperands(
-    const ReadOptions& options, ColumnFamilyHandle* column_family,
-    const Slice& key, PinnableSlice* merge_operands,
-    GetMergeOperandsOptions* get_merge_operands_options,
-    int* number_of_operands) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
-
 std::vector<Status> TropoDBImpl::MultiGet(
     const ReadOptions& options,
     const std::vector<ColumnFamilyHandle*>& column_family,
@@ -75,39 +59,18 @@ Status TropoDBImpl::SingleDelete(const WriteOptions& options,
   return Status::NotSupported();
 }
 
-Status TropoDBImpl::Put(const WriteOptions& options,
-                        ColumnFamilyHandle* column_family, const Slice& key,
-                        const Slice& value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported("Column families not supported");
-}
-
 Status TropoDBImpl::Put(const WriteOptions& options,
                         ColumnFamilyHandle* column_family, const Slice& key,
                         const Slice& ts, const Slice& value) {
   TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported("Column families not supported");
-}
-
-Status TropoDBImpl::Delete(const WriteOptions& options,
-                           ColumnFamilyHandle* column_family,
-                           const Slice& key) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported("Column families not supported");
+  return Status::NotSupported("Timestamps not supported");
 }
 
 Status TropoDBImpl::Delete(const WriteOptions& options,
                            ColumnFamilyHandle* column_family, const Slice& key,
                            const Slice& ts) {
   TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported("Column families not supported");
-}
-
-Status TropoDBImpl::Get(const ReadOptions& options,
-                        ColumnFamilyHandle* column_family, const Slice& key,
-                        PinnableSlice* value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported("Column families not supported");
+  return Status::NotSupported("Timestamps not supported");
 }
 
 Status TropoDBImpl::NewIterators(
@@ -117,27 +80,6 @@ Status TropoDBImpl::NewIterators(
   TROPO_LOG_ERROR("Not implemented\n");
   return Status::NotSupported();
 }
-bool TropoDBImpl::GetProperty(ColumnFamilyHandle* column_family,
-                              const Slice& property, std::string* value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return false;
-}
-bool TropoDBImpl::GetMapProperty(ColumnFamilyHandle* column_family,
-                                 const Slice& property,
-                                 std::map<std::string, std::string>* value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return false;
-}
-bool TropoDBImpl::GetIntProperty(ColumnFamilyHandle* column_family,
-                                 const Slice& property, uint64_t* value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return false;
-}
-bool TropoDBImpl::GetAggregatedIntProperty(const Slice& property,
-                                           uint64_t* aggregated_value) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return false;
-};
 Status TropoDBImpl::GetApproximateSizes(const SizeApproximationOptions& options,
                                         ColumnFamilyHandle* column_family,
                                         const Range* range, int n,
@@ -149,25 +91,11 @@ void TropoDBImpl::GetApproximateMemTableStats(ColumnFamilyHandle* column_family,
                                               const Range& range,
                                               uint64_t* const count,
                                               uint64_t* const size){};
-Status TropoDBImpl::CompactRange(const CompactRangeOptions& options,
-                                 ColumnFamilyHandle* column_family,
-                                 const Slice* begin, const Slice* end) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-};
 Status TropoDBImpl::SetDBOptions(
     const std::unordered_map<std::string, std::string>& options_map) {
   TROPO_LOG_ERROR("Not implemented\n");
   return Status::NotSupported();
 }
-Status TropoDBImpl::CompactFiles(
-    const CompactionOptions& compact_options, ColumnFamilyHandle* column_family,
-    const std::vector<std::string>& input_file_names, const int output_level,
-    const int output_path_id, std::vector<std::string>* const output_file_names,
-    CompactionJobInfo* compaction_job_info) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
 Status TropoDBImpl::PauseBackgroundWork() {
   TROPO_LOG_ERROR("Not implemented\n");
   return Status::NotSupported();
@@ -188,23 +116,6 @@ void TropoDBImpl::DisableManualCompaction() {
   TROPO_LOG_ERROR("Not implemented\n");
 }
 
-Status TropoDBImpl::Flush(const FlushOptions& options,
-                          ColumnFamilyHandle* column_family) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
-Status TropoDBImpl::Flush(
-    const FlushOptions& options,
-    const std::vector<ColumnFamilyHandle*>& column_families) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
-
-Status TropoDBImpl::SyncWAL() {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
-
 Status TropoDBImpl::DisableFileDeletions() {
   TROPO_LOG_ERROR("Not implemented\n");
   return Status::NotSupported();
@@ -271,20 +182,6 @@ Status TropoDBImpl::GetLiveFilesStorageInfo(
   return Status::NotSupported();
 }
 
-Status TropoDBImpl::IngestExternalFile(
-    ColumnFamilyHandle* column_family,
-    const std::vector<std::string>& external_files,
-    const IngestExternalFileOptions& ingestion_options) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
-
-Status TropoDBImpl::IngestExternalFiles(
-    const std::vector<IngestExternalFileArg>& args) {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return Status::NotSupported();
-}
-
 Status TropoDBImpl::CreateColumnFamilyWithImport(
     const ColumnFamilyOptions& options, const std::string& column_family_name,
     const ImportColumnFamilyOptions& import_options,
@@ -308,11 +205,6 @@ Status TropoDBImpl::GetDbSessionId(std::string& session_id) const {
   return Status::NotSupported();
 }
 
-ColumnFamilyHandle* TropoDBImpl::DefaultColumnFamily() const {
-  TROPO_LOG_ERROR("Not implemented\n");
-  return NULL;
-}
-
 Status TropoDBImpl::GetPropertiesOfAllTables(ColumnFamilyHandle* column_family,
                                              TablePropertiesCollection* props) {
   TROPO_LOG_ERROR("Not implemented\n");
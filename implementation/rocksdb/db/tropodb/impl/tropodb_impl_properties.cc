@@ -0,0 +1,441 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "db/tropodb/tropodb_config.h"
+#include "db/tropodb/tropodb_impl.h"
+#include "db/tropodb/tropodb_properties.h"
+#include "db/tropodb/utils/tropodb_diagnostics.h"
+#include "util/string_util.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Everything that needs mutex_ to be read consistently. Taking a snapshot is
+// O(levels + lower_concurrency), the rest is computed without the lock.
+struct TropoDBImpl::PropertySnapshot {
+  TropoVersion* version;
+  std::array<size_t, TropoDBConfig::level_count> dead_tables;
+  std::array<double, TropoDBConfig::lower_concurrency> l0_fill;
+  double ln_fill;
+  std::array<size_t, TropoDBConfig::lower_concurrency> free_wals;
+  uint64_t mem_entries;
+  uint64_t mem_bytes;
+  std::array<uint64_t, TropoDBConfig::level_count - 1> compactions;
+};
+
+void TropoDBImpl::TakePropertySnapshot(PropertySnapshot* snapshot) {
+  MutexLock l(&mutex_);
+  snapshot->version = versions_->current();
+  snapshot->version->Ref();
+  for (uint8_t level = 0; level < TropoDBConfig::level_count; level++) {
+    snapshot->dead_tables[level] = versions_->NumDeadLevelZones(level);
+  }
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    snapshot->l0_fill[i] = ss_manager_->GetFractionFilledL0(i);
+    snapshot->free_wals[i] = wal_man_[i]->FreeWALs();
+  }
+  snapshot->ln_fill = ss_manager_->GetFractionFilled(1);
+  snapshot->mem_entries = 0;
+  snapshot->mem_bytes = 0;
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    snapshot->mem_entries += mem_[i]->GetNumEntries();
+    snapshot->mem_bytes += mem_[i]->GetMemoryUsage();
+    if (imm_[i] != nullptr) {
+      snapshot->mem_entries += imm_[i]->GetNumEntries();
+      snapshot->mem_bytes += imm_[i]->GetMemoryUsage();
+    }
+  }
+  snapshot->compactions = compactions_;
+}
+
+void TropoDBImpl::ReleasePropertySnapshot(PropertySnapshot* snapshot) {
+  MutexLock l(&mutex_);
+  snapshot->version->Unref();
+  snapshot->version = nullptr;
+}
+
+// Diagnostics of all zone regions. Only uses counters, does not need mutex_.
+std::vector<TropoDiagnostics> TropoDBImpl::GetZoneRegionDiagnostics() {
+  std::vector<TropoDiagnostics> diags;
+  diags.push_back(manifest_->IODiagnostics());
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    for (auto& diag : wal_man_[i]->IODiagnostics()) {
+      diag.name_ += "-" + std::to_string(i);
+      diags.push_back(diag);
+    }
+  }
+  for (auto& diag : ss_manager_->IODiagnostics()) {
+    diags.push_back(diag);
+  }
+  return diags;
+}
+
+static void AddTimingProperties(std::map<std::string, std::string>* value,
+                                const std::string& name,
+                                const TimingCounter& counter) {
+  (*value)[name + ".count"] = std::to_string(counter.GetNum());
+  (*value)[name + ".sum"] = std::to_string(counter.GetSum());
+  (*value)[name + ".avg"] = std::to_string(counter.GetAvg());
+  (*value)[name + ".max"] = std::to_string(counter.GetMax());
+  (*value)[name + ".p50"] = std::to_string(counter.GetPercentile(50.0));
+  (*value)[name + ".p99"] = std::to_string(counter.GetPercentile(99.0));
+  (*value)[name + ".p999"] = std::to_string(counter.GetPercentile(99.9));
+}
+
+static std::string JoinCounters(const std::vector<uint64_t>& counters) {
+  std::string joined;
+  for (uint64_t counter : counters) {
+    if (!joined.empty()) {
+      joined += ",";
+    }
+    joined += std::to_string(counter);
+  }
+  return joined;
+}
+
+static bool ConsumeLevel(const Slice& property, const char* prefix,
+                         uint8_t* level) {
+  Slice in = property;
+  Slice pre = prefix;
+  uint64_t parsed;
+  if (!in.starts_with(pre)) {
+    return false;
+  }
+  in.remove_prefix(pre.size());
+  if (!ConsumeDecimalNumber(&in, &parsed) || !in.empty() ||
+      parsed >= TropoDBConfig::level_count) {
+    return false;
+  }
+  *level = static_cast<uint8_t>(parsed);
+  return true;
+}
+
+bool TropoDBImpl::GetIntProperty(ColumnFamilyHandle* column_family,
+                                 const Slice& property, uint64_t* value) {
+  uint8_t level;
+  bool found = true;
+  PropertySnapshot snapshot;
+
+  // Properties that do not need any snapshot
+  if (property == TropoDBProperties::kZoneResets) {
+    *value = 0;
+    for (auto& diag : GetZoneRegionDiagnostics()) {
+      *value += diag.zones_erased_counter_;
+    }
+    return true;
+  } else if (property == TropoDBProperties::kIOStats) {
+    *value = 0;
+    for (auto& diag : GetZoneRegionDiagnostics()) {
+      *value += diag.bytes_written_;
+    }
+    return true;
+  }
+
+  TakePropertySnapshot(&snapshot);
+  if (ConsumeLevel(property, "rocksdb.num-files-at-level", &level) ||
+      ConsumeLevel(property, TropoDBProperties::kNumTablesAtLevelPrefix,
+                   &level)) {
+    *value = snapshot.version->LevelSSTables(level).size();
+  } else if (ConsumeLevel(property, TropoDBProperties::kBytesAtLevelPrefix,
+                          &level)) {
+    *value =
+        ss_manager_->GetBytesInLevel(snapshot.version->LevelSSTables(level));
+  } else if (ConsumeLevel(property,
+                          TropoDBProperties::kDeadTablesAtLevelPrefix,
+                          &level)) {
+    *value = snapshot.dead_tables[level];
+  } else if (property == "rocksdb.estimate-num-keys") {
+    *value = snapshot.mem_entries;
+    for (uint8_t l = 0; l < TropoDBConfig::level_count; l++) {
+      for (const auto& meta : snapshot.version->LevelSSTables(l)) {
+        *value += meta->numbers;
+      }
+    }
+  } else if (property == "rocksdb.cur-size-all-mem-tables") {
+    *value = snapshot.mem_bytes;
+  } else if (property == TropoDBProperties::kFreeWALs) {
+    *value = 0;
+    for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      *value += snapshot.free_wals[i];
+    }
+  } else if (property == TropoDBProperties::kDeadTables) {
+    *value = 0;
+    for (uint8_t l = 0; l < TropoDBConfig::level_count; l++) {
+      *value += snapshot.dead_tables[l];
+    }
+  } else {
+    found = false;
+  }
+  ReleasePropertySnapshot(&snapshot);
+  return found;
+}
+
+bool TropoDBImpl::GetAggregatedIntProperty(const Slice& property,
+                                           uint64_t* aggregated_value) {
+  // There is only one column family, nothing to aggregate.
+  return GetIntProperty(DefaultColumnFamily(), property, aggregated_value);
+}
+
+bool TropoDBImpl::GetMapProperty(ColumnFamilyHandle* column_family,
+                                 const Slice& property,
+                                 std::map<std::string, std::string>* value) {
+  value->clear();
+  // Timings and IO counters are thread-safe, no snapshot needed
+  if (property == TropoDBProperties::kZoneResets) {
+    for (auto& diag : GetZoneRegionDiagnostics()) {
+      (*value)[diag.name_] = std::to_string(diag.zones_erased_counter_);
+    }
+    return true;
+  } else if (property == TropoDBProperties::kIOStats) {
+    TropoDiagnostics total = {};
+    for (auto& diag : GetZoneRegionDiagnostics()) {
+      (*value)[diag.name_ + ".bytes-written"] =
+          std::to_string(diag.bytes_written_);
+      (*value)[diag.name_ + ".appends"] =
+          std::to_string(diag.append_operations_counter_);
+      (*value)[diag.name_ + ".bytes-read"] = std::to_string(diag.bytes_read_);
+      (*value)[diag.name_ + ".reads"] =
+          std::to_string(diag.read_operations_counter_);
+      total.bytes_written_ += diag.bytes_written_;
+      total.append_operations_counter_ += diag.append_operations_counter_;
+      total.bytes_read_ += diag.bytes_read_;
+      total.read_operations_counter_ += diag.read_operations_counter_;
+    }
+    (*value)["total.bytes-written"] = std::to_string(total.bytes_written_);
+    (*value)["total.appends"] =
+        std::to_string(total.append_operations_counter_);
+    (*value)["total.bytes-read"] = std::to_string(total.bytes_read_);
+    (*value)["total.reads"] = std::to_string(total.read_operations_counter_);
+    return true;
+  } else if (property == TropoDBProperties::kFlushStats) {
+    AddTimingProperties(value, "total", flush_total_counter_);
+    AddTimingProperties(value, "write-l0", flush_flush_memtable_counter_);
+    AddTimingProperties(value, "update-version",
+                        flush_update_version_counter_);
+    AddTimingProperties(value, "reset-wal", flush_reset_wal_counter_);
+    AddTimingProperties(value, "write-l0.setup",
+                        ss_manager_->GetFlushPreparePerfCounter());
+    AddTimingProperties(value, "write-l0.merge",
+                        ss_manager_->GetFlushMergePerfCounter());
+    AddTimingProperties(value, "write-l0.write",
+                        ss_manager_->GetFlushWritePerfCounter());
+    AddTimingProperties(value, "write-l0.finish",
+                        ss_manager_->GetFlushFinishPerfCounter());
+    return true;
+  } else if (property == TropoDBProperties::kCompactionStats) {
+    AddTimingProperties(value, "l0.total", compaction_compaction_L0_total_);
+    AddTimingProperties(value, "l0.pick", compaction_pick_compaction_);
+    AddTimingProperties(value, "l0.wait", compaction_wait_compaction_);
+    AddTimingProperties(value, "l0.write", compaction_compaction_);
+    AddTimingProperties(value, "l0.copy", compaction_compaction_trivial_);
+    AddTimingProperties(value, "l0.update-version", compaction_version_edit_);
+    AddTimingProperties(value, "l0.reset", compaction_reset_L0_counter_);
+    AddTimingProperties(value, "ln.total", compaction_compaction_LN_total_);
+    AddTimingProperties(value, "ln.pick", compaction_pick_compaction_LN_);
+    AddTimingProperties(value, "ln.wait", compaction_wait_compaction_LN_);
+    AddTimingProperties(value, "ln.write", compaction_compaction_LN_);
+    AddTimingProperties(value, "ln.copy", compaction_compaction_trivial_LN_);
+    AddTimingProperties(value, "ln.update-version",
+                        compaction_version_edit_LN_);
+    AddTimingProperties(value, "ln.reset", compaction_reset_LN_counter_);
+    AddTimingProperties(value, "write.setup", compaction_setup_perf_counter_);
+    AddTimingProperties(value, "write.k-merge",
+                        compaction_k_merge_perf_counter_);
+    AddTimingProperties(value, "write.flush", compaction_flush_perf_counter_);
+    AddTimingProperties(value, "write.cleanup",
+                        compaction_breakdown_perf_counter_);
+    PropertySnapshot snapshot;
+    TakePropertySnapshot(&snapshot);
+    for (uint8_t level = 0; level < TropoDBConfig::level_count - 1; level++) {
+      (*value)["count.to-L" + std::to_string(level + 1)] =
+          std::to_string(snapshot.compactions[level]);
+    }
+    ReleasePropertySnapshot(&snapshot);
+    return true;
+  } else if (property == TropoDBProperties::kWriteStallStats) {
+    AddTimingProperties(value, "total", put_total_);
+    AddTimingProperties(value, "wal", put_wal_);
+    AddTimingProperties(value, "mem", put_mem_);
+    AddTimingProperties(value, "slowdown", put_slowdown_);
+    AddTimingProperties(value, "wait-flush", put_wait_on_flush_);
+    AddTimingProperties(value, "wait-l0", put_wait_on_forced_l0_);
+    AddTimingProperties(value, "wait-wal", put_wait_on_WAL_);
+    AddTimingProperties(value, "new-mem", put_create_new_mem_);
+    return true;
+  } else if (property == TropoDBProperties::kWALStats) {
+    for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      const std::string prefix = "WALS-" + std::to_string(i) + ".";
+      for (auto& stat : wal_man_[i]->GetAdditionalWALStatistics()) {
+        AddTimingProperties(value, prefix + stat.first, stat.second);
+      }
+    }
+    return true;
+  } else if (property == TropoDBProperties::kRecoveryStats) {
+    TimingCounter wal_pointers;
+    TimingCounter wal_replay;
+    for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      for (auto& stat : wal_man_[i]->GetAdditionalWALStatistics()) {
+        if (stat.first == "Recovery") {
+          wal_pointers += stat.second;
+        } else if (stat.first == "Replays") {
+          wal_replay += stat.second;
+        }
+      }
+    }
+    AddTimingProperties(value, "total", recovery_total_counter_);
+    AddTimingProperties(value, "manifest", recovery_manifest_counter_);
+    AddTimingProperties(value, "wal", recovery_wal_counter_);
+    AddTimingProperties(value, "wal.pointers", wal_pointers);
+    AddTimingProperties(value, "wal.replay", wal_replay);
+    AddTimingProperties(value, "background-flow",
+                        recovery_background_counter_);
+    return true;
+  } else if (property == TropoDBProperties::kHotZones) {
+    for (auto& diag : GetZoneRegionDiagnostics()) {
+      (*value)[diag.name_ + ".resets"] = JoinCounters(diag.zones_erased_);
+      (*value)[diag.name_ + ".appends"] =
+          JoinCounters(diag.append_operations_);
+    }
+    return true;
+  } else if (property == TropoDBProperties::kManualCompaction) {
+    MutexLock l(&mutex_);
+    (*value)["active"] = manual_compaction_ != nullptr ? "1" : "0";
+    if (manual_compaction_ != nullptr) {
+      std::vector<SSZoneMetaData*> overlap;
+      versions_->current()->GetOverlappingInputs(manual_compaction_->level,
+                                                 manual_compaction_->begin,
+                                                 manual_compaction_->end,
+                                                 &overlap);
+      (*value)["level"] = std::to_string(manual_compaction_->level);
+      (*value)["compactions"] = std::to_string(manual_compaction_->compactions);
+      (*value)["tables-left-in-level"] = std::to_string(overlap.size());
+    }
+    return true;
+  }
+
+  bool found = true;
+  PropertySnapshot snapshot;
+  TakePropertySnapshot(&snapshot);
+  if (property == TropoDBProperties::kLevelZoneUsage) {
+    for (uint8_t level = 0; level < TropoDBConfig::level_count; level++) {
+      const std::vector<SSZoneMetaData*>& ss =
+          snapshot.version->LevelSSTables(level);
+      std::string prefix = "L" + std::to_string(level);
+      (*value)[prefix + ".tables"] = std::to_string(ss.size());
+      (*value)[prefix + ".bytes"] =
+          std::to_string(ss_manager_->GetBytesInLevel(ss));
+      (*value)[prefix + ".dead-tables"] =
+          std::to_string(snapshot.dead_tables[level]);
+    }
+    double l0_fill = 0;
+    for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      l0_fill += snapshot.l0_fill[i];
+    }
+    (*value)["L0.fill"] = std::to_string(
+        100. * l0_fill / static_cast<double>(TropoDBConfig::lower_concurrency));
+    (*value)["LN.fill"] = std::to_string(100. * snapshot.ln_fill);
+  } else if (property == TropoDBProperties::kL0Fill) {
+    for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      (*value)["L0-" + std::to_string(i)] =
+          std::to_string(100. * snapshot.l0_fill[i]);
+    }
+  } else if (property == TropoDBProperties::kFreeWALs) {
+    for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+      (*value)["WALS-" + std::to_string(i)] =
+          std::to_string(snapshot.free_wals[i]);
+    }
+  } else if (property == TropoDBProperties::kDeadTables) {
+    for (uint8_t level = 0; level < TropoDBConfig::level_count; level++) {
+      (*value)["L" + std::to_string(level)] =
+          std::to_string(snapshot.dead_tables[level]);
+    }
+  } else {
+    found = false;
+  }
+  ReleasePropertySnapshot(&snapshot);
+  return found;
+}
+
+bool TropoDBImpl::GetProperty(ColumnFamilyHandle* column_family,
+                              const Slice& property, std::string* value) {
+  value->clear();
+  uint64_t int_value;
+  std::map<std::string, std::string> map_value;
+  if (property == "rocksdb.stats" || property == TropoDBProperties::kStats) {
+    std::ostringstream out;
+    const char* maps[] = {
+        TropoDBProperties::kLevelZoneUsage, TropoDBProperties::kL0Fill,
+        TropoDBProperties::kFreeWALs, TropoDBProperties::kZoneResets,
+        TropoDBProperties::kIOStats, TropoDBProperties::kFlushStats,
+        TropoDBProperties::kCompactionStats,
+        TropoDBProperties::kWriteStallStats, TropoDBProperties::kWALStats};
+    for (const char* name : maps) {
+      if (!GetMapProperty(column_family, name, &map_value)) {
+        continue;
+      }
+      out << "** " << name << " **\n";
+      for (auto& kv : map_value) {
+        out << std::left << std::setw(32) << kv.first << kv.second << "\n";
+      }
+    }
+    *value = out.str();
+    return true;
+  } else if (GetIntProperty(column_family, property, &int_value)) {
+    *value = std::to_string(int_value);
+    return true;
+  } else if (GetMapProperty(column_family, property, &map_value)) {
+    std::ostringstream out;
+    for (auto& kv : map_value) {
+      out << kv.first << ": " << kv.second << "\n";
+    }
+    *value = out.str();
+    return true;
+  }
+  return false;
+}
+
+void TropoDBImpl::GetColumnFamilyMetaData(ColumnFamilyHandle* column_family,
+                                          ColumnFamilyMetaData* metadata) {
+  PropertySnapshot snapshot;
+  TakePropertySnapshot(&snapshot);
+  const uint32_t id = column_family->GetID();
+  metadata->name = column_family->GetName();
+  metadata->size = 0;
+  metadata->file_count = 0;
+  metadata->levels.clear();
+  std::string checksum, checksum_func;
+  for (uint8_t level = 0; level < TropoDBConfig::level_count; level++) {
+    std::vector<SstFileMetaData> files;
+    uint64_t level_size = 0;
+    for (SSZoneMetaData* m : snapshot.version->LevelSSTables(level)) {
+      // Tables never span families
+      uint32_t family = 0;
+      Slice smallest = m->smallest.user_key();
+      Slice largest = m->largest.user_key();
+      if (!column_families_->ParseKey(smallest, &family, &smallest) ||
+          family != id ||
+          !column_families_->ParseKey(largest, &family, &largest)) {
+        continue;
+      }
+      const uint64_t size = ss_manager_->GetBytesInLevel({m});
+      files.emplace_back(std::to_string(m->number), m->number, name_, size, 0,
+                         0, smallest.ToString(), largest.ToString(), 0, false,
+                         Temperature::kUnknown, 0, 0, 0, checksum,
+                         checksum_func);
+      files.back().num_entries = m->numbers;
+      level_size += size;
+    }
+    metadata->size += level_size;
+    metadata->file_count += files.size();
+    metadata->levels.emplace_back(level, level_size, std::move(files));
+  }
+  ReleasePropertySnapshot(&snapshot);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,225 @@
+// Thread-safe (provides internal synchronization)
+
+#include "db/tropodb/index/tropodb_column_family.h"
+
+#include "db/write_batch_internal.h"
+#include "rocksdb/comparator.h"
+#include "util/coding.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// Moves all keys of a batch into their stored form
+class EncodeHandler : public WriteBatch::Handler {
+ public:
+  EncodeHandler(TropoColumnFamilySet* families, WriteBatch* dst)
+      : families_(families), dst_(dst) {}
+  Status PutCF(uint32_t column_family_id, const Slice& key,
+               const Slice& value) override {
+    Status s = Encode(column_family_id, key, &key_);
+    return s.ok() ? WriteBatchInternal::Put(dst_, 0, key_, value) : s;
+  }
+  Status DeleteCF(uint32_t column_family_id, const Slice& key) override {
+    Status s = Encode(column_family_id, key, &key_);
+    return s.ok() ? WriteBatchInternal::Delete(dst_, 0, key_) : s;
+  }
+  Status SingleDeleteCF(uint32_t column_family_id, const Slice& key) override {
+    Status s = Encode(column_family_id, key, &key_);
+    return s.ok() ? WriteBatchInternal::SingleDelete(dst_, 0, key_) : s;
+  }
+  Status MergeCF(uint32_t column_family_id, const Slice& key,
+                 const Slice& value) override {
+    Status s = Encode(column_family_id, key, &key_);
+    return s.ok() ? WriteBatchInternal::Merge(dst_, 0, key_, value) : s;
+  }
+  Status DeleteRangeCF(uint32_t column_family_id, const Slice& begin_key,
+                       const Slice& end_key) override {
+    Status s = Encode(column_family_id, begin_key, &key_);
+    s = s.ok() ? Encode(column_family_id, end_key, &end_key_) : s;
+    return s.ok() ? WriteBatchInternal::DeleteRange(dst_, 0, key_, end_key_)
+                  : s;
+  }
+  void LogData(const Slice& blob) override { dst_->PutLogData(blob); }
+
+ private:
+  Status Encode(uint32_t column_family_id, const Slice& key,
+                std::string* dst) {
+    if (column_family_id != checked_ &&
+        !families_->Contains(column_family_id)) {
+      return Status::InvalidArgument(
+          "Invalid column family specified in write batch");
+    }
+    checked_ = column_family_id;
+    dst->clear();
+    families_->AppendKey(column_family_id, key, dst);
+    return Status::OK();
+  }
+
+  TropoColumnFamilySet* families_;
+  WriteBatch* dst_;
+  std::string key_;
+  std::string end_key_;
+  // Last family that is known to exist
+  uint32_t checked_{UINT32_MAX};
+};
+}  // namespace
+
+TropoColumnFamilyHandle::TropoColumnFamilyHandle(
+    uint32_t id, const std::string& name, const ColumnFamilyOptions& options)
+    : ColumnFamilyHandleImpl(nullptr, nullptr, nullptr),
+      id_(id),
+      name_(name),
+      options_(options) {}
+
+Status TropoColumnFamilyHandle::GetDescriptor(ColumnFamilyDescriptor* desc) {
+  *desc = ColumnFamilyDescriptor(name_, options_);
+  return Status::OK();
+}
+
+const Comparator* TropoColumnFamilyHandle::GetComparator() const {
+  // TropoDB always orders keys bytewise
+  return BytewiseComparator();
+}
+
+void TropoColumnFamilySet::Add(uint32_t id,
+                               std::shared_ptr<MergeOperator> merge_operator) {
+  mutex_.WriteLock();
+  live_.insert(id);
+  merge_operators_[id] = merge_operator;
+  mutex_.WriteUnlock();
+}
+
+void TropoColumnFamilySet::Remove(uint32_t id) {
+  mutex_.WriteLock();
+  live_.erase(id);
+  mutex_.WriteUnlock();
+}
+
+bool TropoColumnFamilySet::Contains(uint32_t id) {
+  mutex_.ReadLock();
+  bool contains = live_.count(id) != 0;
+  mutex_.ReadUnlock();
+  return contains;
+}
+
+std::shared_ptr<MergeOperator> TropoColumnFamilySet::GetMergeOperator(
+    uint32_t id) {
+  std::shared_ptr<MergeOperator> merge_operator;
+  mutex_.ReadLock();
+  auto it = merge_operators_.find(id);
+  if (it != merge_operators_.end()) {
+    merge_operator = it->second;
+  }
+  mutex_.ReadUnlock();
+  return merge_operator;
+}
+
+void TropoColumnFamilySet::AppendKey(uint32_t id, const Slice& user_key,
+                                     std::string* dst) const {
+  if (Keyed()) {
+    PutVarint32(dst, id);
+  }
+  dst->append(user_key.data(), user_key.size());
+}
+
+void TropoColumnFamilySet::KeyRange(uint32_t id, std::string* begin,
+                                    std::string* end) {
+  begin->clear();
+  PutVarint32(begin, id);
+  // The last byte of a varint is below 0x80, so it can not overflow.
+  *end = *begin;
+  end->back()++;
+}
+
+bool TropoColumnFamilySet::ParseKey(const Slice& key, uint32_t* id,
+                                    Slice* user_key) const {
+  *user_key = key;
+  if (!Keyed()) {
+    *id = 0;
+    return true;
+  }
+  return GetVarint32(user_key, id);
+}
+
+Status TropoColumnFamilySet::EncodeBatch(const WriteBatch* src,
+                                         WriteBatch* dst) {
+  EncodeHandler handler(this, dst);
+  return src->Iterate(&handler);
+}
+
+Status TropoColumnFamilySet::CheckOptions(
+    const ColumnFamilyOptions& options,
+    const ColumnFamilyOptions& default_options) {
+  const std::pair<const char*, bool> shared[] = {
+      {"write_buffer_size",
+       options.write_buffer_size == default_options.write_buffer_size},
+      {"target_file_size_base",
+       options.target_file_size_base == default_options.target_file_size_base},
+      {"target_file_size_multiplier",
+       options.target_file_size_multiplier ==
+           default_options.target_file_size_multiplier},
+      {"max_bytes_for_level_base",
+       options.max_bytes_for_level_base ==
+           default_options.max_bytes_for_level_base},
+      {"max_bytes_for_level_multiplier",
+       options.max_bytes_for_level_multiplier ==
+           default_options.max_bytes_for_level_multiplier},
+      {"level0_file_num_compaction_trigger",
+       options.level0_file_num_compaction_trigger ==
+           default_options.level0_file_num_compaction_trigger},
+      {"level0_slowdown_writes_trigger",
+       options.level0_slowdown_writes_trigger ==
+           default_options.level0_slowdown_writes_trigger},
+      {"level0_stop_writes_trigger",
+       options.level0_stop_writes_trigger ==
+           default_options.level0_stop_writes_trigger},
+      {"num_levels", options.num_levels == default_options.num_levels},
+      {"compaction_style",
+       options.compaction_style == default_options.compaction_style}};
+  for (const auto& option : shared) {
+    if (!option.second) {
+      return Status::NotSupported(
+          "Option must match the default column family", option.first);
+    }
+  }
+  return Status::OK();
+}
+
+TropoColumnFamilyMergeOperator::TropoColumnFamilyMergeOperator(
+    std::shared_ptr<TropoColumnFamilySet> families)
+    : families_(families) {}
+
+std::shared_ptr<MergeOperator> TropoColumnFamilyMergeOperator::Find(
+    const Slice& key, Slice* user_key) const {
+  uint32_t id;
+  if (!families_->ParseKey(key, &id, user_key)) {
+    return nullptr;
+  }
+  return families_->GetMergeOperator(id);
+}
+
+bool TropoColumnFamilyMergeOperator::FullMergeV2(
+    const MergeOperationInput& merge_in,
+    MergeOperationOutput* merge_out) const {
+  Slice user_key;
+  std::shared_ptr<MergeOperator> merge_operator = Find(merge_in.key, &user_key);
+  if (merge_operator == nullptr) {
+    return false;
+  }
+  MergeOperationInput family_in(user_key, merge_in.existing_value,
+                                merge_in.operand_list, merge_in.logger);
+  return merge_operator->FullMergeV2(family_in, merge_out);
+}
+
+bool TropoColumnFamilyMergeOperator::PartialMergeMulti(
+    const Slice& key, const std::deque<Slice>& operand_list,
+    std::string* new_value, Logger* logger) const {
+  Slice user_key;
+  std::shared_ptr<MergeOperator> merge_operator = Find(key, &user_key);
+  if (merge_operator == nullptr) {
+    return false;
+  }
+  return merge_operator->PartialMergeMulti(user_key, operand_list, new_value,
+                                           logger);
+}
+}  // namespace ROCKSDB_NAMESPACE
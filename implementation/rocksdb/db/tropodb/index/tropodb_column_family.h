@@ -0,0 +1,118 @@
+// Thread-safe (provides internal synchronization)
+
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_COLUMN_FAMILY_H
+#define TROPODB_COLUMN_FAMILY_H
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "db/column_family.h"
+#include "port/port.h"
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/write_batch.h"
+
+namespace ROCKSDB_NAMESPACE {
+/**
+ * @brief Handle of a column family. Derives from ColumnFamilyHandleImpl
+ * (without column family data) as WriteBatch expects that type.
+ */
+class TropoColumnFamilyHandle : public ColumnFamilyHandleImpl {
+ public:
+  TropoColumnFamilyHandle(uint32_t id, const std::string& name,
+                          const ColumnFamilyOptions& options);
+  uint32_t GetID() const override { return id_; }
+  const std::string& GetName() const override { return name_; }
+  Status GetDescriptor(ColumnFamilyDescriptor* desc) override;
+  const Comparator* GetComparator() const override;
+  inline const ColumnFamilyOptions& GetOptions() const { return options_; }
+
+ private:
+  const uint32_t id_;
+  const std::string name_;
+  const ColumnFamilyOptions options_;
+};
+
+/**
+ * @brief The live column families of a database. All families share the
+ * WALs, memtables and logs. Keys of a family are stored behind the varint32
+ * id of the family, so that each family is one contiguous key range and a
+ * batch over multiple families stays one atomic write. SSTables are cut at
+ * family boundaries, a table only holds keys of one family. Databases created
+ * before column families store plain keys and only have the default family.
+ */
+class TropoColumnFamilySet {
+ public:
+  TropoColumnFamilySet() = default;
+  TropoColumnFamilySet(const TropoColumnFamilySet&) = delete;
+  TropoColumnFamilySet& operator=(const TropoColumnFamilySet&) = delete;
+
+  // Set on recovery, before the first read or write.
+  inline void SetKeyed(bool keyed) { keyed_.store(keyed); }
+  inline bool Keyed() const { return keyed_.load(); }
+
+  void Add(uint32_t id, std::shared_ptr<MergeOperator> merge_operator);
+  // The merge operator stays, merges of dropped data can still be compacted.
+  void Remove(uint32_t id);
+  bool Contains(uint32_t id);
+  // nullptr if the family has no merge operator.
+  std::shared_ptr<MergeOperator> GetMergeOperator(uint32_t id);
+
+  // Appends the stored form of user_key in family id to dst.
+  void AppendKey(uint32_t id, const Slice& user_key, std::string* dst) const;
+  // All stored keys of family id are in [begin, end).
+  static void KeyRange(uint32_t id, std::string* begin, std::string* end);
+  // Splits a stored key in its family and user key.
+  bool ParseKey(const Slice& key, uint32_t* id, Slice* user_key) const;
+  // Rewrites src to dst with all keys in their stored form (default family
+  // in dst). Fails if src writes to a family that does not exist.
+  Status EncodeBatch(const WriteBatch* src, WriteBatch* dst);
+  // Memtables, table sizes and compactions are shared by all families.
+  // Fails if options tunes them differently than default_options, the
+  // options of the default family.
+  static Status CheckOptions(const ColumnFamilyOptions& options,
+                             const ColumnFamilyOptions& default_options);
+
+ private:
+  port::RWMutex mutex_;
+  std::set<uint32_t> live_;
+  std::map<uint32_t, std::shared_ptr<MergeOperator>> merge_operators_;
+  std::atomic<bool> keyed_{false};
+};
+
+/**
+ * @brief Hands merges to the merge operator of the family of the key, with
+ * the family removed from the key.
+ */
+class TropoColumnFamilyMergeOperator : public MergeOperator {
+ public:
+  explicit TropoColumnFamilyMergeOperator(
+      std::shared_ptr<TropoColumnFamilySet> families);
+
+  bool FullMergeV2(const MergeOperationInput& merge_in,
+                   MergeOperationOutput* merge_out) const override;
+  bool PartialMergeMulti(const Slice& key,
+                         const std::deque<Slice>& operand_list,
+                         std::string* new_value,
+                         Logger* logger) const override;
+  const char* Name() const override { return "TropoColumnFamilyMerge"; }
+
+ private:
+  std::shared_ptr<MergeOperator> Find(const Slice& key,
+                                      Slice* user_key) const;
+
+  std::shared_ptr<TropoColumnFamilySet> families_;
+};
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
@@ -3,8 +3,12 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #include "db/tropodb/index/tropodb_compaction.h"
 
+#include <algorithm>
+#include <deque>
 #include <numeric>
 
+#include "db/merge_helper.h"
+
 #include "db/tropodb/index/tropodb_version.h"
 #include "db/tropodb/index/tropodb_version_edit.h"
 #include "db/tropodb/index/tropodb_version_set.h"
@@ -20,8 +24,8 @@ namespace ROCKSDB_NAMESPACE {
 TropoCompaction::TropoCompaction(TropoVersionSet* vset, uint8_t first_level,
                                  Env* env)
     : first_level_(first_level),
-      max_lba_count_((TropoDBConfig::max_bytes_sstable_ + vset->lba_size_ - 1) /
-                     vset->lba_size_),
+      move_level_(0),
+      max_lba_count_(vset->MaxLNTableLbas()),
       vset_(vset),
       version_(nullptr),
       busy_(false),
@@ -52,6 +56,11 @@ bool TropoCompaction::HasOverlapWithOtherCompaction(
         return true;
       }
     }
+    for (const auto& c : covered_) {
+      if (target->number == c->number) {
+        return true;
+      }
+    }
   }
   return false;
 }
@@ -61,6 +70,7 @@ void TropoCompaction::GetCompactionTargets(
   metas->clear();
   metas->insert(metas->end(), targets_[0].begin(), targets_[0].end());
   metas->insert(metas->end(), targets_[1].begin(), targets_[1].end());
+  metas->insert(metas->end(), covered_.begin(), covered_.end());
 }
 
 static uint64_t LbasInSSTables(const std::vector<SSZoneMetaData*>& ss) {
@@ -80,6 +90,9 @@ bool TropoCompaction::IsTrivialMove() const {
   // A move is trivial if it requires no merging in the next level.
   // Unlesss, a move has many impacts on grandparents (level + 2), requiring
   // high costs later.
+  if (move_level_ != 0) {
+    return true;
+  }
   return targets_[0].size() == 1 && targets_[1].size() == 0 &&
          LbasInSSTables(grandparents_) <=
              MaxGrandParentOverlapBytes(vset_->lba_size_);
@@ -87,19 +100,54 @@ bool TropoCompaction::IsTrivialMove() const {
 
 Status TropoCompaction::DoTrivialMove(TropoVersionEdit* edit) {
   Status s = Status::OK();
-  SSZoneMetaData* old_meta = targets_[0][0];
-  SSZoneMetaData meta;
-  s = vset_->znssstable_->CopySSTable(first_level_, first_level_ + 1, *old_meta,
-                                      &meta);
-  meta.number = vset_->NewSSNumber();
-  if (!s.ok()) {
-    return s;
+  // A tiered run move takes all tables of the run, otherwise there is one.
+  const uint8_t level = move_level_ != 0 ? move_level_ : first_level_ + 1;
+  for (SSZoneMetaData* old_meta : targets_[0]) {
+    SSZoneMetaData meta;
+    s = vset_->znssstable_->CopySSTable(first_level_, level, *old_meta, &meta);
+    meta.number = vset_->NewSSNumber();
+    if (!s.ok()) {
+      return s;
+    }
+    edit->AddSSDefinition(level, meta);
   }
-  edit->AddSSDefinition(first_level_ + 1, meta);
   return s;
 }
 
+void TropoCompaction::DropCoveredTables() {
+  if (first_level_ + 1 >= TropoDBConfig::level_count) {
+    return;
+  }
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  std::vector<SSZoneMetaData*> remaining;
+  for (SSZoneMetaData* m : targets_[1]) {
+    // LevelDB invariant: for the same key, data in first_level_ is newer than
+    // in first_level_ + 1. The sequence checks are only a sanity check.
+    bool covered = false;
+    for (const SSZoneMetaData* upper : targets_[0]) {
+      if (CoveredByRangeTombstone(ucmp, *m, *upper)) {
+        covered = true;
+        break;
+      }
+    }
+    if (covered) {
+      TROPO_LOG_DEBUG(
+          "DEBUG: Compaction: SSTable %lu covered by range delete\n",
+          m->number);
+      covered_.push_back(m);
+    } else {
+      remaining.push_back(m);
+    }
+  }
+  targets_[1] = remaining;
+}
+
 void TropoCompaction::MarkCompactedTablesAsDead(TropoVersionEdit* edit) {
+  // Tables covered by a range delete are never read, only their zones are
+  // reclaimed.
+  for (SSZoneMetaData* m : covered_) {
+    edit->RemoveSSDefinition(first_level_ + 1, *m);
+  }
   for (int i = 0; i <= 1; i++) {
     std::vector<SSZoneMetaData*>::const_iterator base_iter =
         targets_[i].begin();
@@ -148,6 +196,13 @@ Iterator* TropoCompaction::GetLNIterator(void* arg, const Slice& file_value,
   return iterator;
 }
 
+void TropoCompaction::GetLNIterators(
+    void* arg, const std::vector<std::string>& file_values,
+    const Comparator* cmp, std::vector<Iterator*>* iterators) {
+  TropoSSTableManager* zns = reinterpret_cast<TropoSSTableManager*>(arg);
+  zns->GetLNIterators(file_values, cmp, iterators);
+}
+
 Iterator* TropoCompaction::MakeCompactionIterator() {
   size_t iterators_needed = 0;
   // When first level = 0, we need an iterator for each target L0 SStable, else
@@ -175,7 +230,7 @@ Iterator* TropoCompaction::MakeCompactionIterator() {
         new LNIterator(new LNZoneIterator(vset_->icmp_.user_comparator(),
                                           &targets_[i], first_level_ + i),
                        &GetLNIterator, vset_->znssstable_,
-                       vset_->icmp_.user_comparator(), env_);
+                       vset_->icmp_.user_comparator(), env_, &GetLNIterators);
   }
   // Merge all iterators together
   return NewMergingIterator(&vset_->icmp_, iterators, iterators_needed);
@@ -304,6 +359,136 @@ bool TropoCompaction::IsBaseLevelForKey(const Slice& user_key) {
   return true;
 }
 
+bool TropoCompaction::IsBaseLevelForRange(const Slice& begin,
+                                          const Slice& end) {
+  // Look if any data outside of this compaction can be covered by the range.
+  const Comparator* user_cmp = vset_->icmp_.user_comparator();
+  for (size_t lvl = 0; lvl < TropoDBConfig::level_count; lvl++) {
+    if (lvl == first_level_ + 1 || (lvl > 0 && lvl <= first_level_)) {
+      continue;
+    }
+    for (const SSZoneMetaData* m : vset_->current_->ss_[lvl]) {
+      if (lvl == 0 && std::find(targets_[0].begin(), targets_[0].end(), m) !=
+                          targets_[0].end()) {
+        continue;
+      }
+      if (user_cmp->Compare(m->smallest.user_key(), end) < 0 &&
+          user_cmp->Compare(m->largest.user_key(), begin) >= 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void TropoCompaction::AddClippedTombstones(
+    TropoSSTableBuilder* builder,
+    const std::vector<TropoRangeTombstone>& tombstones,
+    const std::string* lower, const Slice* upper) {
+  // Tables in LN can not overlap, so only give a table the part of each
+  // tombstone that lies in [lower, upper).
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  Slice lower_slice = lower != nullptr ? Slice(*lower) : Slice();
+  std::vector<TropoRangeTombstone> clipped;
+  ClipRangeTombstones(ucmp, tombstones,
+                      lower != nullptr ? &lower_slice : nullptr, upper,
+                      &clipped);
+  for (const auto& t : clipped) {
+    builder->AddRangeTombstone(vset_->icmp_, t);
+  }
+}
+
+Status TropoCompaction::MergeOperands(
+    Iterator* merger, const Comparator* ucmp,
+    const MergeOperator* merge_operator,
+    const std::vector<const TropoRangeTombstone*>& active,
+    SequenceNumber min_seq, bool base_level, const TableAdder& add_to_table,
+    SequenceNumber* last_sequence_for_key, SystemClock* clock) {
+  ParsedInternalKey ikey;
+  if (!ParseInternalKey(merger->key(), &ikey, false).ok()) {
+    return Status::Corruption("Invalid merge key");
+  }
+  const std::string user_key = ikey.user_key.ToString();
+  const SequenceNumber newest_seq = ikey.sequence;
+  // Operands from newest to oldest, with their original internal keys.
+  std::vector<std::pair<std::string, std::string>> operands;
+  std::string base;
+  bool has_base = false;
+  bool reached_base = false;
+  for (; merger->Valid(); merger->Next()) {
+    if (!ParseInternalKey(merger->key(), &ikey, false).ok() ||
+        ucmp->Compare(ikey.user_key, user_key) != 0) {
+      break;
+    }
+    // Older entries covered by a range delete act as a deletion.
+    bool covered = false;
+    for (const TropoRangeTombstone* t : active) {
+      if (ikey.sequence < t->seq && t->seq <= min_seq) {
+        covered = true;
+        break;
+      }
+    }
+    if (covered) {
+      reached_base = true;
+      break;
+    }
+    if (ikey.type == kTypeMerge) {
+      operands.emplace_back(merger->key().ToString(),
+                            merger->value().ToString());
+    } else if (ikey.type == kTypeValue) {
+      base = merger->value().ToString();
+      has_base = true;
+      reached_base = true;
+      merger->Next();
+      break;
+    } else if (ikey.type == kTypeDeletion) {
+      reached_base = true;
+      merger->Next();
+      break;
+    } else {
+      break;
+    }
+  }
+
+  // All remaining entries of this key are shadowed after a full merge
+  *last_sequence_for_key = reached_base ? newest_seq : kMaxSequenceNumber;
+  std::string result;
+  if (reached_base || base_level) {
+    std::vector<Slice> ops;
+    for (auto it = operands.rbegin(); it != operands.rend(); ++it) {
+      ops.push_back(it->second);
+    }
+    Slice base_slice(base);
+    Status s = MergeHelper::TimedFullMerge(
+        merge_operator, user_key, has_base ? &base_slice : nullptr, ops,
+        &result, nullptr, nullptr, clock);
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: Compaction: Full merge failed\n");
+      return s;
+    }
+    InternalKey merged(user_key, newest_seq, kTypeValue);
+    return add_to_table(merged.Encode(), result, user_key);
+  }
+  // Older values can still be in lower levels, so only combine operands.
+  if (operands.size() > 1) {
+    std::deque<Slice> ops;
+    for (const auto& op : operands) {
+      ops.push_front(op.second);
+    }
+    if (merge_operator->PartialMergeMulti(user_key, ops, &result, nullptr)) {
+      InternalKey merged(user_key, newest_seq, kTypeMerge);
+      return add_to_table(merged.Encode(), result, user_key);
+    }
+  }
+  for (const auto& op : operands) {
+    Status s = add_to_table(op.first, op.second, user_key);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
 Status TropoCompaction::DoCompaction(TropoVersionEdit* edit) {
   Status s = Status::OK();
   SSZoneMetaData meta;
@@ -332,12 +517,42 @@ Status TropoCompaction::DoCompaction(TropoVersionEdit* edit) {
   {
     merger = MakeCompactionIterator();
     merger->SeekToFirst();
-    if (!merger->Valid()) {
+    // Tables can hold only range tombstones
+    bool has_tombstones = false;
+    for (int i = 0; i <= 1; i++) {
+      for (const SSZoneMetaData* m : targets_[i]) {
+        has_tombstones |= !m->range_tombstones.empty();
+      }
+    }
+    if (!merger->Valid() && !has_tombstones) {
       delete merger;
       TROPO_LOG_ERROR("ERROR: Compaction: Merging iterator invalid\n");
       return Status::Corruption("No valid merging iterator");
     }
   }
+  // Range tombstones of all inputs, sorted on start key. Tombstones that can
+  // still cover data outside of this compaction are carried to the output.
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  std::vector<TropoRangeTombstone> tombstones;
+  std::vector<TropoRangeTombstone> carried_tombstones;
+  for (int i = 0; i <= 1; i++) {
+    for (const SSZoneMetaData* m : targets_[i]) {
+      for (const auto& t : m->range_tombstones) {
+        tombstones.push_back(t);
+        if (!IsBaseLevelForRange(t.start, t.end)) {
+          carried_tombstones.push_back(t);
+        }
+      }
+    }
+  }
+  std::sort(tombstones.begin(), tombstones.end(),
+            [ucmp](const TropoRangeTombstone& a, const TropoRangeTombstone& b) {
+              return ucmp->Compare(a.start, b.start) < 0;
+            });
+  size_t next_tombstone = 0;
+  std::vector<const TropoRangeTombstone*> active_tombstones;
+  std::string tombstone_lower;
+  bool has_tombstone_lower = false;
   compaction_setup_perf_counter_.AddTiming(clock_->NowMicros() - before);
 
   // Iterate over SSTable iterator, merge and write
@@ -346,11 +561,64 @@ Status TropoCompaction::DoCompaction(TropoVersionEdit* edit) {
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
   SequenceNumber min_seq = vset_->LastSequence();
-  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  const MergeOperator* merge_operator = vset_->merge_operator_;
+  // Input keys not yet added, estimates how much output is left.
+  uint64_t keys_left = 0;
+  for (int i = 0; i <= 1; i++) {
+    for (const SSZoneMetaData* m : targets_[i]) {
+      keys_left += m->numbers;
+    }
+  }
+  uint64_t keys_added = 0;
+  uint64_t bytes_added = 0;
+  // Adds a key to the current SSTable, flushes first if it does not fit.
+  auto add_to_table = [&](const Slice& key, const Slice& value,
+                          const Slice& user_key) -> Status {
+    const uint64_t lba_size = vset_->lba_size_;
+    const uint64_t impact = builder->EstimateSizeImpact(key, value);
+    const uint64_t lbas =
+        (builder->GetFinalSize() + impact + lba_size - 1) / lba_size;
+    // Tables end at a zone boundary. If the rest of the output fits in one
+    // more zone, it is packed into this table instead of a tail table that
+    // leaves most of its zone unused.
+    bool cut = lbas > max_lba_count_;
+    if (cut && keys_added > 0) {
+      uint64_t tail = (keys_left * (bytes_added / keys_added)) / lba_size;
+      cut = lbas + tail > max_lba_count_ + vset_->zone_cap_;
+    }
+    // Tables never span column families
+    cut = cut || builder->CrossesFamily(key);
+    keys_left = keys_left > 0 ? keys_left - 1 : 0;
+    keys_added++;
+    bytes_added += impact;
+    if (cut) {
+      // Flush
+      compaction_k_merge_perf_counter_.AddTiming(clock_->NowMicros() - before);
+      before = clock_->NowMicros();
+      AddClippedTombstones(builder, carried_tombstones,
+                           has_tombstone_lower ? &tombstone_lower : nullptr,
+                           &user_key);
+      tombstone_lower.assign(user_key.data(), user_key.size());
+      has_tombstone_lower = true;
+      Status fs;
+      if (TropoDBConfig::compaction_allow_deferring_writes) {
+        fs = FlushSSTable(&builder, edit, metas_[metas_.size() - 1]);
+      } else {
+        fs = FlushSSTable(&builder, edit, &meta);
+      }
+      if (!fs.ok()) {
+        TROPO_LOG_ERROR("ERROR: Compaction: Could not flush\n");
+        return fs;
+      }
+      compaction_flush_perf_counter_.AddTiming(clock_->NowMicros() - before);
+      before = clock_->NowMicros();
+    }
+    return builder->Apply(key, value);
+  };
   {
     // K-way Merge-sort old SSTables and write new SSTables
     before = clock_->NowMicros();
-    for (; merger->Valid(); merger->Next()) {
+    while (merger->Valid()) {
       const Slice& key = merger->key();
       const Slice& value = merger->value();
       bool drop = false;
@@ -377,43 +645,58 @@ Status TropoCompaction::DoCompaction(TropoVersionEdit* edit) {
                    IsBaseLevelForKey(ikey.user_key)) {
           drop = true;
         }
+        // Check if key is covered by a range tombstone. Keys arrive sorted, so
+        // sweep over the tombstones.
+        if (!drop && !tombstones.empty()) {
+          while (next_tombstone < tombstones.size() &&
+                 ucmp->Compare(tombstones[next_tombstone].start,
+                               ikey.user_key) <= 0) {
+            active_tombstones.push_back(&tombstones[next_tombstone++]);
+          }
+          active_tombstones.erase(
+              std::remove_if(active_tombstones.begin(), active_tombstones.end(),
+                             [&](const TropoRangeTombstone* t) {
+                               return ucmp->Compare(t->end, ikey.user_key) <= 0;
+                             }),
+              active_tombstones.end());
+          for (const TropoRangeTombstone* t : active_tombstones) {
+            if (ikey.sequence < t->seq && t->seq <= min_seq) {
+              drop = true;
+              break;
+            }
+          }
+        }
       }
       // Ensure that next iteration we can recognise the key
       last_sequence_for_key = ikey.sequence;
 
       // Add key to "new" tables or drop key
       if (drop) {
+        merger->Next();
+      } else if (ikey.type == kTypeMerge && merge_operator != nullptr) {
+        s = MergeOperands(merger, vset_->icmp_.user_comparator(),
+                          merge_operator, active_tombstones, min_seq,
+                          IsBaseLevelForKey(ikey.user_key), add_to_table,
+                          &last_sequence_for_key, clock_);
+        if (!s.ok()) {
+          break;
+        }
       } else {
-        // Estimate impact on size and determine if we need to flush first
-        uint64_t max_size = max_lba_count_;
-        if ((builder->GetSize() + builder->EstimateSizeImpact(key, value) +
-             vset_->lba_size_ - 1) /
-                vset_->lba_size_ >=
-            max_size) {
-          // Flush
-          compaction_k_merge_perf_counter_.AddTiming(clock_->NowMicros() -
-                                                     before);
-          before = clock_->NowMicros();
-          if (TropoDBConfig::compaction_allow_deferring_writes) {
-            s = FlushSSTable(&builder, edit, metas_[metas_.size() - 1]);
-          } else {
-            s = FlushSSTable(&builder, edit, &meta);
-          }
-          if (!s.ok()) {
-            TROPO_LOG_ERROR("ERROR: Compaction: Could not flush\n");
-            break;
-          }
-          compaction_flush_perf_counter_.AddTiming(clock_->NowMicros() -
-                                                   before);
-          before = clock_->NowMicros();
+        s = add_to_table(key, value, ikey.user_key);
+        if (!s.ok()) {
+          break;
         }
-        // Only now add key to SSTable
-        s = builder->Apply(key, value);
+        merger->Next();
       }
     }
 
     // Now write the last remaining SSTable to storage
-    if (s.ok() && builder->GetSize() > 0) {
+    if (s.ok()) {
+      AddClippedTombstones(builder, carried_tombstones,
+                           has_tombstone_lower ? &tombstone_lower : nullptr,
+                           nullptr);
+    }
+    if (s.ok() && (builder->GetSize() > 0 || builder->HasRangeTombstones())) {
       compaction_k_merge_perf_counter_.AddTiming(clock_->NowMicros() - before);
       before = clock_->NowMicros();
       if (TropoDBConfig::compaction_allow_deferring_writes) {
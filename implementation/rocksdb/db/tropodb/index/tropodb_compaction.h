@@ -6,6 +6,8 @@
 #ifndef TROPODB_COMPACTION_H
 #define TROPODB_COMPACTION_H
 
+#include <functional>
+
 #include "db/dbformat.h"
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/index/tropodb_version.h"
@@ -15,6 +17,7 @@
 #include "db/tropodb/ref_counter.h"
 #include "db/tropodb/table/tropodb_sstable_manager.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "rocksdb/merge_operator.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 
@@ -52,6 +55,20 @@ class TropoCompaction {
   void MarkCompactedTablesAsDead(TropoVersionEdit* edit);
   Status DoCompaction(TropoVersionEdit* edit);
 
+  // Merge operands
+  typedef std::function<Status(const Slice& key, const Slice& value,
+                               const Slice& user_key)>
+      TableAdder;
+  // Collects the merge chain of the key merger points to and passes the
+  // result to add_to_table. Operands are only fully merged when a base value,
+  // deletion or covering tombstone is found, or when base_level is set.
+  static Status MergeOperands(
+      Iterator* merger, const Comparator* ucmp,
+      const MergeOperator* merge_operator,
+      const std::vector<const TropoRangeTombstone*>& active,
+      SequenceNumber min_seq, bool base_level, const TableAdder& add_to_table,
+      SequenceNumber* last_sequence_for_key, SystemClock* clock);
+
   // Diag
   inline TimingCounter GetCompactionSetupPerfCounter() { return compaction_setup_perf_counter_; }
   inline TimingCounter GetCompactionKMergePerfCounter() { return compaction_k_merge_perf_counter_; }
@@ -64,6 +81,10 @@ class TropoCompaction {
   // Compaction
   static Iterator* GetLNIterator(void* arg, const Slice& file_value,
                                  const Comparator* cmp);
+  static void GetLNIterators(void* arg,
+                             const std::vector<std::string>& file_values,
+                             const Comparator* cmp,
+                             std::vector<Iterator*>* iterators);
   Iterator* MakeCompactionIterator();
   Status FlushSSTable(TropoSSTableBuilder** builder, TropoVersionEdit* edit_,
                       SSZoneMetaData* meta);
@@ -71,9 +92,18 @@ class TropoCompaction {
 
   // helpers
   bool IsBaseLevelForKey(const Slice& user_key);
+  bool IsBaseLevelForRange(const Slice& begin, const Slice& end);
+
+  // Range deletes
+  void DropCoveredTables();
+  void AddClippedTombstones(TropoSSTableBuilder* builder,
+                            const std::vector<TropoRangeTombstone>& tombstones,
+                            const std::string* lower, const Slice* upper);
 
   // Meta
   uint8_t first_level_;
+  // Tiered compaction only, level the whole run is moved to (0 if none).
+  uint8_t move_level_;
   uint64_t max_lba_count_;
   // References
   TropoVersionSet* vset_;
@@ -83,6 +113,10 @@ class TropoCompaction {
   std::array<std::vector<SSZoneMetaData*>, 2U> targets_;
   size_t level_ptrs_[TropoDBConfig::level_count];
 
+  // Tables in first_level_ + 1 that are fully covered by a range tombstone,
+  // they are removed without reading them.
+  std::vector<SSZoneMetaData*> covered_;
+
   std::vector<SSZoneMetaData*> grandparents_;
   bool busy_;
 
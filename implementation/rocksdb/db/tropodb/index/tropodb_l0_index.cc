@@ -0,0 +1,100 @@
+#include "db/tropodb/index/tropodb_l0_index.h"
+
+#include <algorithm>
+
+namespace ROCKSDB_NAMESPACE {
+
+TropoL0Index::TropoL0Index(const Comparator* ucmp,
+                           const std::vector<SSZoneMetaData*>& tables)
+    : ucmp_(ucmp), leaves_(0) {
+  auto less = [ucmp](const Slice& a, const Slice& b) {
+    return ucmp->Compare(a, b) < 0;
+  };
+  bounds_.reserve(2 * tables.size());
+  for (const SSZoneMetaData* m : tables) {
+    bounds_.push_back(m->smallest.user_key());
+    bounds_.push_back(m->largest.user_key());
+  }
+  std::sort(bounds_.begin(), bounds_.end(), less);
+  bounds_.erase(std::unique(bounds_.begin(), bounds_.end(),
+                            [ucmp](const Slice& a, const Slice& b) {
+                              return ucmp->Compare(a, b) == 0;
+                            }),
+                bounds_.end());
+  if (bounds_.empty()) {
+    return;
+  }
+
+  // A table covers the segments from its smallest to its largest bound,
+  // which the tree splits in at most two nodes for each level.
+  const size_t segments = 2 * bounds_.size() - 1;
+  leaves_ = 1;
+  while (leaves_ < segments) {
+    leaves_ <<= 1;
+  }
+  auto for_each_node = [&](const SSZoneMetaData* m, auto&& fn) {
+    size_t low = 2 * (std::lower_bound(bounds_.begin(), bounds_.end(),
+                                       m->smallest.user_key(), less) -
+                      bounds_.begin());
+    size_t high = 2 * (std::lower_bound(bounds_.begin(), bounds_.end(),
+                                        m->largest.user_key(), less) -
+                       bounds_.begin()) +
+                  1;
+    for (low += leaves_, high += leaves_; low < high; low >>= 1, high >>= 1) {
+      if (low & 1) {
+        fn(low++);
+      }
+      if (high & 1) {
+        fn(--high);
+      }
+    }
+  };
+  offsets_.assign(2 * leaves_ + 1, 0);
+  for (const SSZoneMetaData* m : tables) {
+    for_each_node(m, [&](size_t node) { offsets_[node + 1]++; });
+  }
+  for (size_t i = 1; i < offsets_.size(); i++) {
+    offsets_[i] += offsets_[i - 1];
+  }
+  tables_.resize(offsets_.back());
+  std::vector<uint32_t> fill(offsets_.begin(), offsets_.end() - 1);
+  for (SSZoneMetaData* m : tables) {
+    for_each_node(m, [&](size_t node) { tables_[fill[node]++] = m; });
+  }
+}
+
+bool TropoL0Index::FindSegment(const Slice& user_key, size_t* segment) const {
+  const Comparator* ucmp = ucmp_;
+  const size_t i =
+      std::lower_bound(bounds_.begin(), bounds_.end(), user_key,
+                       [ucmp](const Slice& a, const Slice& b) {
+                         return ucmp->Compare(a, b) < 0;
+                       }) -
+      bounds_.begin();
+  if (i < bounds_.size() && ucmp_->Compare(bounds_[i], user_key) == 0) {
+    *segment = 2 * i;
+  } else if (i == 0 || i == bounds_.size()) {
+    // Before the first or after the last table
+    return false;
+  } else {
+    *segment = 2 * i - 1;
+  }
+  return true;
+}
+
+void TropoL0Index::Overlapping(const Slice& user_key, Tables* tables) const {
+  tables->clear();
+  size_t segment;
+  if (!FindSegment(user_key, &segment)) {
+    return;
+  }
+  // A table is in at most one node on the path to the root
+  for (size_t node = leaves_ + segment; node > 0; node >>= 1) {
+    for (uint32_t i = offsets_[node]; i < offsets_[node + 1]; i++) {
+      tables->push_back(tables_[i]);
+    }
+  }
+  std::sort(tables->begin(), tables->end(), &TropoL0Index::IsNewer);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,67 @@
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_L0_INDEX_H
+#define TROPODB_L0_INDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/slice.h"
+#include "util/autovector.h"
+
+namespace ROCKSDB_NAMESPACE {
+/**
+ * @brief Immutable interval index over the (overlapping) L0 tables of a
+ * version. The user key space is cut at every table boundary into segments
+ * and a segment tree over these segments holds each table in the O(log n)
+ * nodes that together cover its key range. The index takes O(n log n) space,
+ * also when all tables overlap. A lookup is one binary search and a walk from
+ * a leaf to the root. Built once when a version is installed and shared by
+ * later versions as long as L0 does not change.
+ */
+class TropoL0Index {
+ public:
+  // Lookups do not allocate as long as this many tables overlap a key.
+  using Tables = autovector<SSZoneMetaData*, 16>;
+
+  // The tables must outlive the index, versions hold a ref to them.
+  TropoL0Index(const Comparator* ucmp,
+               const std::vector<SSZoneMetaData*>& tables);
+  TropoL0Index(const TropoL0Index&) = delete;
+  TropoL0Index& operator=(const TropoL0Index&) = delete;
+
+  // Sets tables to the L0 tables whose key range contains user_key, newest
+  // first.
+  void Overlapping(const Slice& user_key, Tables* tables) const;
+  // Table references held by the tree nodes.
+  size_t NumEntries() const { return tables_.size(); }
+  // Newer L0 tables have a higher L0 number, ties are broken by number.
+  static bool IsNewer(const SSZoneMetaData* a, const SSZoneMetaData* b) {
+    if (a->L0.number != b->L0.number) {
+      return a->L0.number > b->L0.number;
+    }
+    return a->number > b->number;
+  }
+
+ private:
+  // Segment of the bound at or around user_key, false if no table can hold
+  // the key.
+  bool FindSegment(const Slice& user_key, size_t* segment) const;
+
+  const Comparator* ucmp_;
+  // Sorted unique user keys at which tables start or end. Segment 2i is the
+  // point bounds_[i], segment 2i+1 lies between bounds_[i] and bounds_[i+1].
+  std::vector<Slice> bounds_;
+  // Leaves of the tree, a power of two. Node 1 is the root, the children of
+  // node i are 2i and 2i+1 and segment i is leaf leaves_ + i.
+  size_t leaves_;
+  // Tables of node i are tables_[offsets_[i]..offsets_[i+1]).
+  std::vector<uint32_t> offsets_;
+  std::vector<SSZoneMetaData*> tables_;
+};
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
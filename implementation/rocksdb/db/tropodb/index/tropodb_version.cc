@@ -3,9 +3,11 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #include "db/tropodb/index/tropodb_version.h"
 
+#include "db/merge_helper.h"
 #include "db/tropodb/index/tropodb_version_set.h"
 #include "db/tropodb/table/iterators/merging_iterator.h"
 #include "db/tropodb/table/iterators/sstable_ln_iterator.h"
+#include "db/tropodb/table/tropodb_prefix_filter.h"
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/utils/tropodb_logger.h"
@@ -47,101 +49,142 @@ TropoVersion::~TropoVersion() {
 void TropoVersion::Clear() {}
 
 Status TropoVersion::Get(const ReadOptions& options, const LookupKey& lkey,
-                         std::string* value) {
+                         PinnableSlice* value,
+                         SequenceNumber max_covering_tombstone_seq,
+                         MergeContext* merge_context, bool do_merge) {
   Status call_status;
   EntryStatus entry_status;
+  MergeContext local_merge_context;
+  if (merge_context == nullptr) {
+    merge_context = &local_merge_context;
+  }
   const Comparator* ucmp = vset_->icmp_.user_comparator();
   TropoSSTableManager* znssstable = vset_->znssstable_;
   znssstable->Ref();
   Slice key = lkey.user_key();
   Slice internal_key = lkey.internal_key();
+  const SequenceNumber snapshot = GetInternalKeySeqno(internal_key);
 
-  // Look in L0
-  {
-    // For some reason SSTables are not always sorted correctly.
-    // Solve by finding all SSTables in range and then sorting them on recency.
-    // TODO: ensure it is already in order elsewhere
-    std::vector<SSZoneMetaData*> tmp;
-    tmp.reserve(ss_[0].size());
-    for (size_t i = ss_[0].size(); i != 0; --i) {
-      SSZoneMetaData* z = ss_[0][i - 1];
-      if (ucmp->Compare(key, z->smallest.user_key()) >= 0 &&
-          ucmp->Compare(key, z->largest.user_key()) <= 0) {
-        tmp.push_back(z);
-      }
+  // Gather all tables that can hold the key, newest first. Range tombstones
+  // live in the metadata, so the newest covering tombstone is known before
+  // any table is read. L0 tables come from the interval index in order of
+  // recency, followed by at most one table for each LN level.
+  TropoL0Index::Tables l0;
+  if (l0_index_ != nullptr) {
+    l0_index_->Overlapping(key, &l0);
+  }
+  std::array<SSZoneMetaData*, TropoDBConfig::level_count> ln{};
+  for (uint8_t level = 1; level < TropoDBConfig::level_count; ++level) {
+    size_t sstable_nrs = ss_[level].size();
+    // level is empty
+    if (sstable_nrs == 0) continue;
+
+    // In LN only ONE table can overlap for each level, find this table
+    uint32_t index = TropoSSTableManager::FindSSTableIndex(
+        vset_->icmp_.user_comparator(), ss_[level], internal_key);
+    // No SSTable in range
+    if (index >= sstable_nrs) {
+      continue;
     }
-    if (!tmp.empty()) {
-      std::sort(tmp.begin(), tmp.end(),
-                [](SSZoneMetaData* a, SSZoneMetaData* b) {
-                  if (a->L0.number > b->L0.number) {
-                    return true;
-                  } else if (a->L0.number < b->L0.number) {
-                    return false;
-                  } else {
-                    return a->number > b->number;
-                  }
-                });
-      // Look for entry in sorted entries
-      for (uint32_t i = 0; i < tmp.size(); i++) {
-        // Look for value in L0 SSTable (table will get cached)
-        call_status = vset_->table_cache_->Get(
-            options, *tmp[i], 0, internal_key, value, &entry_status);
-        if (call_status.ok()) {
-          // Not in this SSTable, move on
-          if (entry_status == EntryStatus::notfound) {
-            continue;
-          }
-          // Entry found, clean and return
-          znssstable->Unref();
-          return entry_status == EntryStatus::found
-                     ? call_status
-                     : Status::NotFound("Entry deleted");
-        }
-      }
+    SSZoneMetaData* m = ss_[level][index];
+    if (ucmp->Compare(key, m->smallest.user_key()) >= 0 &&
+        ucmp->Compare(key, m->largest.user_key()) <= 0) {
+      ln[level] = m;
+    }
+  }
+  const size_t candidates = l0.size() + TropoDBConfig::level_count - 1;
+  for (size_t i = 0; i < candidates; i++) {
+    const SSZoneMetaData* m = i < l0.size() ? l0[i] : ln[i - l0.size() + 1];
+    if (m != nullptr) {
+      max_covering_tombstone_seq =
+          std::max(max_covering_tombstone_seq,
+                   MaxCoveringTombstoneSeq(ucmp, *m, key, snapshot));
     }
   }
 
-  // Look in LN
-  {
-    for (uint8_t level = 1; level < TropoDBConfig::level_count; ++level) {
-      size_t sstable_nrs = ss_[level].size();
-      // level is empty
-      if (sstable_nrs == 0) continue;
-
-      // In LN only ONE table can overlap for each level, find this table
-      uint32_t index = TropoSSTableManager::FindSSTableIndex(
-          vset_->icmp_.user_comparator(), ss_[level], internal_key);
-      // No SSTable in range
-      if (index >= sstable_nrs) {
-        continue;
-      }
-
-      // Look if entry is in this SSTable (table will get cached)
-      const SSZoneMetaData& m = *ss_[level][index];
-      if (ucmp->Compare(key, m.smallest.user_key()) >= 0 &&
-          ucmp->Compare(key, m.largest.user_key()) <= 0) {
-        call_status = vset_->table_cache_->Get(options, m, level, internal_key,
-                                               value, &entry_status);
-        if (call_status.ok()) {
-          // Key is not in this SSTable, move on
-          if (entry_status == EntryStatus::notfound) {
-            continue;
+  // Look for entry in sorted entries. Tables whose prefix filter excludes the
+  // key are not read, their tombstones have already been applied above.
+  const SliceTransform* prefix_extractor = znssstable->GetPrefixExtractor();
+  bool prefetched = !TropoDBConfig::get_read_tables_concurrently;
+  for (size_t i = 0; i < candidates; i++) {
+    const uint8_t level = i < l0.size() ? 0 : i - l0.size() + 1;
+    const SSZoneMetaData* m = level == 0 ? l0[i] : ln[level];
+    if (m == nullptr || !PrefixMayMatch(prefix_extractor, m->prefix_filter,
+                                        key)) {
+      continue;
+    }
+    // Look for value in SSTable (table will get cached)
+    call_status = vset_->table_cache_->Get(
+        options, *m, level, internal_key, value, &entry_status, nullptr,
+        merge_context, max_covering_tombstone_seq);
+    if (call_status.ok()) {
+      // Not in this SSTable, move on
+      if (entry_status == EntryStatus::notfound) {
+        if (!prefetched) {
+          // Only the remaining L0 tables are read ahead, LN tables are
+          // too large to read when the key may be found before them.
+          prefetched = true;
+          std::vector<std::pair<uint8_t, const SSZoneMetaData*>> tables;
+          for (size_t j = i + 1; j < l0.size(); j++) {
+            if (PrefixMayMatch(prefix_extractor, l0[j]->prefix_filter, key)) {
+              tables.push_back(std::make_pair(0, l0[j]));
+            }
           }
-          // Entry found, clean and return
-          znssstable->Unref();
-          return entry_status == EntryStatus::found
-                     ? call_status
-                     : Status::NotFound("Entry deleted");
+          vset_->table_cache_->Prefetch(tables);
         }
+        continue;
       }
+      // Entry found, clean and return
+      znssstable->Unref();
+      if (merge_context->GetNumOperands() > 0) {
+        // The pinned base stays valid until the result is in value's buffer
+        const Slice base = *value;
+        Status s = FinishMerge(
+            key, entry_status == EntryStatus::found ? &base : nullptr,
+            merge_context, value->GetSelf(), do_merge);
+        value->Reset();
+        value->PinSelf();
+        return s;
+      }
+      if (entry_status == EntryStatus::found && !do_merge) {
+        merge_context->PushOperand(*value);
+      }
+      return entry_status == EntryStatus::found
+                 ? call_status
+                 : Status::NotFound("Entry deleted");
     }
   }
 
-  // Entry has not been found
+  // Entry has not been found, but there can be operands without base value
   znssstable->Unref();
+  if (merge_context->GetNumOperands() > 0) {
+    Status s = FinishMerge(key, nullptr, merge_context, value->GetSelf(),
+                           do_merge);
+    value->PinSelf();
+    return s;
+  }
   return Status::NotFound("No matching table");
 }
 
+Status TropoVersion::FinishMerge(const Slice& user_key, const Slice* base,
+                                 MergeContext* merge_context,
+                                 std::string* value, bool do_merge) {
+  if (!do_merge) {
+    // The base value is the oldest operand
+    if (base != nullptr) {
+      merge_context->PushOperand(*base);
+    }
+    return Status::OK();
+  }
+  if (vset_->merge_operator_ == nullptr) {
+    TROPO_LOG_ERROR("ERROR: Get: merge operands without merge_operator\n");
+    return Status::InvalidArgument("merge_operator is not set");
+  }
+  return MergeHelper::TimedFullMerge(
+      vset_->merge_operator_, user_key, base, merge_context->GetOperands(),
+      value, nullptr, nullptr, SystemClock::Default().get());
+}
+
 Iterator* TropoVersion::GetLNIterator(void* arg, const Slice& file_value,
                                       const Comparator* cmp) {
   return reinterpret_cast<TropoSSTableManager*>(arg)->GetLNIterator(file_value,
@@ -6,9 +6,13 @@
 #ifndef TROPODB_VERSION_H
 #define TROPODB_VERSION_H
 
+#include <memory>
+
 #include "db/dbformat.h"
 #include "db/lookup_key.h"
+#include "db/merge_context.h"
 #include "db/tropodb/tropodb_config.h"
+#include "db/tropodb/index/tropodb_l0_index.h"
 #include "db/tropodb/io/szd_port.h"
 #include "db/tropodb/persistence/tropodb_manifest.h"
 #include "db/tropodb/ref_counter.h"
@@ -37,7 +41,12 @@ enum class TropoVersionTag : uint32_t {
   /* what = 8,*/
   kPrevLogNumber = 9,
   kDeletedRange = 0xa,
-  kFragmentedData = 0xb
+  kFragmentedData = 0xb,
+  kRangeTombstone = 0xc,
+  kPrefixFilter = 0xd,
+  kLNDevice = 0xe,
+  kColumnFamily = 0xf,
+  kNextColumnFamily = 0x10
 };
 
 /**
@@ -46,14 +55,25 @@ enum class TropoVersionTag : uint32_t {
 class TropoVersion : public RefCounter {
  public:
   void Clear();
+  // Entries older than max_covering_tombstone_seq (e.g. a range tombstone
+  // found in a memtable) are treated as deleted. Merge operands are gathered
+  // in merge_context (which may already hold operands from the memtables) and
+  // merged with the merge_operator, unless do_merge is false.
   Status Get(const ReadOptions& options, const LookupKey& key,
-             std::string* value);
+             PinnableSlice* value,
+             SequenceNumber max_covering_tombstone_seq = 0,
+             MergeContext* merge_context = nullptr, bool do_merge = true);
   void GetOverlappingInputs(uint8_t level, const InternalKey* begin,
                             const InternalKey* end,
                             std::vector<SSZoneMetaData*>* inputs);
   static Iterator* GetLNIterator(void* arg, const Slice& file_value,
                                  const Comparator* cmp);
   inline uint8_t CompactionLevel() const { return compaction_level_; }
+  inline const std::vector<SSZoneMetaData*>& LevelSSTables(
+      uint8_t level) const {
+    assert(level < TropoDBConfig::level_count);
+    return ss_[level];
+  }
 
  private:
   friend class TropoVersionSet;
@@ -64,12 +84,18 @@ class TropoVersion : public RefCounter {
   explicit TropoVersion(TropoVersionSet* vset);
   ~TropoVersion();
 
+  Status FinishMerge(const Slice& user_key, const Slice* base,
+                     MergeContext* merge_context, std::string* value,
+                     bool do_merge);
+
   // FIXME: Do not use this function! It is broken and will not be maintained
   void AddIterators(const ReadOptions& options, std::vector<Iterator*>* iters);
 
   // Version specific
   std::array<std::vector<SSZoneMetaData*>, TropoDBConfig::level_count> ss_;
   std::array<std::vector<SSZoneMetaData*>, TropoDBConfig::level_count> ss_d_;
+  // Set by the builder, shared with newer versions while L0 does not change
+  std::shared_ptr<const TropoL0Index> l0_index_;
   std::pair<uint64_t, uint64_t> ss_deleted_range_;
   // Parent
   TropoVersionSet* vset_;
@@ -28,6 +28,9 @@ void TropoVersionEdit::Clear() {
   comparator_.clear();
   has_next_ss_number = false;
   ss_number = 0;
+  column_families_.clear();
+  next_column_family_ = 0;
+  has_next_column_family_ = false;
 }
 
 void TropoVersionEdit::AddSSDefinition(const uint8_t level,
@@ -38,8 +41,10 @@ void TropoVersionEdit::AddSSDefinition(const uint8_t level,
     f.L0.lba = meta.L0.lba;
     f.L0.log_number = meta.L0.log_number;
     f.L0.number = meta.L0.number;
-  } else {
+  }
+  if (level != 0 || IsBorrowedL0(meta)) {
     f.LN.lba_regions = meta.LN.lba_regions;
+    f.LN.device = meta.LN.device;
     std::copy(meta.LN.lbas, meta.LN.lbas + f.LN.lba_regions, f.LN.lbas);
     std::copy(meta.LN.lba_region_sizes,
               meta.LN.lba_region_sizes + f.LN.lba_regions,
@@ -49,6 +54,8 @@ void TropoVersionEdit::AddSSDefinition(const uint8_t level,
   f.lba_count = meta.lba_count;
   f.smallest = meta.smallest;
   f.largest = meta.largest;
+  f.range_tombstones = meta.range_tombstones;
+  f.prefix_filter = meta.prefix_filter;
   TROPO_LOG_DEBUG("DEBUG: Adding SSTable %lu %lu %lu \n", f.number, f.L0.lba,
                   f.lba_count);
   new_ss_.push_back(std::make_pair(level, f));
@@ -69,6 +76,18 @@ void TropoVersionEdit::RemoveSSDefinitionOnlyMeta(const uint8_t level,
 // #define VERSION_LEAK 1
 // #define VERSION_LEAK_SS 1
 
+// Tables on the first device carry no device tag.
+static void EncodeLNDevice(std::string* dst, uint8_t level,
+                           const SSZoneMetaData& m) {
+  if (m.LN.device == 0 || (level == 0 && !IsBorrowedL0(m))) {
+    return;
+  }
+  PutVarint32(dst, static_cast<uint32_t>(TropoVersionTag::kLNDevice));
+  PutFixed8(dst, level);  // level
+  PutVarint64(dst, m.number);
+  PutFixed8(dst, m.LN.device);
+}
+
 void TropoVersionEdit::EncodeTo(std::string* dst) const {
 #ifdef VERSION_LEAK
   uint64_t debug_version_leak_ = 0;
@@ -79,6 +98,17 @@ void TropoVersionEdit::EncodeTo(std::string* dst) const {
     PutVarint32(dst, static_cast<uint32_t>(TropoVersionTag::kComparator));
     PutLengthPrefixedSlice(dst, comparator_);
   }
+  // column families
+  for (const auto& cf : column_families_) {
+    PutVarint32(dst, static_cast<uint32_t>(TropoVersionTag::kColumnFamily));
+    PutVarint32(dst, cf.first);
+    PutLengthPrefixedSlice(dst, cf.second);
+  }
+  if (has_next_column_family_) {
+    PutVarint32(dst,
+                static_cast<uint32_t>(TropoVersionTag::kNextColumnFamily));
+    PutVarint32(dst, next_column_family_);
+  }
   // last sequence
   if (has_last_sequence_) {
     PutVarint32(dst, static_cast<uint32_t>(TropoVersionTag::kLastSequence));
@@ -132,7 +162,8 @@ void TropoVersionEdit::EncodeTo(std::string* dst) const {
       PutVarint64(dst, m.L0.lba);
       PutFixed8(dst, m.L0.log_number);
       PutVarint64(dst, m.L0.number);
-    } else {
+    }
+    if (level != 0 || IsBorrowedL0(m)) {
       PutFixed8(dst, m.LN.lba_regions);
       for (size_t j = 0; j < m.LN.lba_regions; j++) {
         PutVarint64(dst, m.LN.lbas[j]);
@@ -143,6 +174,7 @@ void TropoVersionEdit::EncodeTo(std::string* dst) const {
     PutVarint64(dst, m.lba_count);
     PutLengthPrefixedSlice(dst, m.smallest.Encode());
     PutLengthPrefixedSlice(dst, m.largest.Encode());
+    EncodeLNDevice(dst, level, m);
   }
 
 #ifdef VERSION_LEAK
@@ -168,7 +200,8 @@ void TropoVersionEdit::EncodeTo(std::string* dst) const {
       PutVarint64(dst, m.L0.lba);
       PutFixed8(dst, m.L0.log_number);
       PutVarint64(dst, m.L0.number);
-    } else {
+    }
+    if (new_ss_[i].first != 0 || IsBorrowedL0(m)) {
       PutFixed8(dst, m.LN.lba_regions);
       for (size_t j = 0; j < m.LN.lba_regions; j++) {
         PutVarint64(dst, m.LN.lbas[j]);
@@ -179,6 +212,22 @@ void TropoVersionEdit::EncodeTo(std::string* dst) const {
     PutVarint64(dst, m.lba_count);
     PutLengthPrefixedSlice(dst, m.smallest.Encode());
     PutLengthPrefixedSlice(dst, m.largest.Encode());
+    EncodeLNDevice(dst, level, m);
+    // Range tombstones are stored directly after the table they belong to
+    for (const auto& t : m.range_tombstones) {
+      PutVarint32(dst, static_cast<uint32_t>(TropoVersionTag::kRangeTombstone));
+      PutFixed8(dst, level);  // level
+      PutVarint64(dst, m.number);
+      PutLengthPrefixedSlice(dst, t.start);
+      PutLengthPrefixedSlice(dst, t.end);
+      PutVarint64(dst, t.seq);
+    }
+    if (!m.prefix_filter.empty()) {
+      PutVarint32(dst, static_cast<uint32_t>(TropoVersionTag::kPrefixFilter));
+      PutFixed8(dst, level);  // level
+      PutVarint64(dst, m.number);
+      PutLengthPrefixedSlice(dst, m.prefix_filter);
+    }
 #ifdef VERSION_LEAK_SS
     debug_ss_leak_ = dst->size() - debug_ss_leak_;
     printf("DEBUG LEAK file  %lu \n", debug_ss_leak_);
@@ -222,29 +271,33 @@ static bool GetLevel(Slice* input, uint8_t* level) {
   }
 }
 
+static bool DecodeRegions(Slice* input, SSZoneMetaData* m) {
+  bool s = GetFixed8(input, &m->LN.lba_regions) && m->LN.lba_regions <= 8;
+  for (size_t i = 0; s && i < m->LN.lba_regions; i++) {
+    s = GetVarint64(input, &m->LN.lbas[i]) &&
+        GetVarint64(input, &m->LN.lba_region_sizes[i]);
+  }
+  return s;
+}
+
 static bool DecodeL0(Slice* input, SSZoneMetaData* m) {
-  return GetVarint64(input, &m->number) && GetVarint64(input, &m->L0.lba) &&
-         GetFixed8(input, &m->L0.log_number) &&
-         GetVarint64(input, &m->L0.number) && GetVarint64(input, &m->numbers) &&
+  bool s = GetVarint64(input, &m->number) && GetVarint64(input, &m->L0.lba) &&
+           GetFixed8(input, &m->L0.log_number) &&
+           GetVarint64(input, &m->L0.number);
+  // Borrowed tables also carry their LN regions
+  if (s && IsBorrowedL0(*m)) {
+    s = DecodeRegions(input, m);
+  }
+  return s && GetVarint64(input, &m->numbers) &&
          GetVarint64(input, &m->lba_count) &&
          GetInternalKey(input, &m->smallest) &&
          GetInternalKey(input, &m->largest);
 }
 
 static bool DecodeLN(Slice* input, SSZoneMetaData* m) {
-  bool s = GetVarint64(input, &m->number) &&
-           GetFixed8(input, &m->LN.lba_regions) && m->LN.lba_regions <= 8;
-  if (!s) {
-    return s;
-  }
-  for (size_t i = 0; i < m->LN.lba_regions; i++) {
-    s = GetVarint64(input, &m->LN.lbas[i]) &&
-        GetVarint64(input, &m->LN.lba_region_sizes[i]);
-    if (!s) {
-      return s;
-    }
-  }
-  s = GetVarint64(input, &m->numbers) && GetVarint64(input, &m->lba_count) &&
+  bool s = GetVarint64(input, &m->number) && DecodeRegions(input, m);
+  s = s && GetVarint64(input, &m->numbers) &&
+      GetVarint64(input, &m->lba_count) &&
       GetInternalKey(input, &m->smallest) && GetInternalKey(input, &m->largest);
   return s;
 }
@@ -269,6 +322,14 @@ Status TropoVersionEdit::DecodeFrom(const Slice& src) {
   Slice frag;
   SSZoneMetaData m;
   InternalKey key;
+  Slice tombstone_start;
+  Slice tombstone_end;
+  uint64_t tombstone_seq;
+  Slice prefix_filter;
+  uint8_t device;
+  uint32_t cf_id;
+  // Last decoded table entry, a device tag directly follows it
+  SSZoneMetaData* last_ss = nullptr;
 
   while (msg == nullptr && GetVarint32(&input, &tag)) {
     versiontag = static_cast<TropoVersionTag>(tag);
@@ -281,6 +342,21 @@ Status TropoVersionEdit::DecodeFrom(const Slice& src) {
           msg = "comparator name";
         }
         break;
+      case TropoVersionTag::kColumnFamily:
+        if (GetVarint32(&input, &cf_id) &&
+            GetLengthPrefixedSlice(&input, &str)) {
+          column_families_.emplace_back(cf_id, str.ToString());
+        } else {
+          msg = "column family";
+        }
+        break;
+      case TropoVersionTag::kNextColumnFamily:
+        if (GetVarint32(&input, &next_column_family_)) {
+          has_next_column_family_ = true;
+        } else {
+          msg = "next column family";
+        }
+        break;
       case TropoVersionTag::kLastSequence:
         if (GetVarint64(&input, &last_sequence_)) {
           has_last_sequence_ = true;
@@ -305,19 +381,60 @@ Status TropoVersionEdit::DecodeFrom(const Slice& src) {
         }
         break;
       case TropoVersionTag::kDeletedSSTable:
+        m.range_tombstones.clear();
+        m.prefix_filter.clear();
+        m.LN.device = 0;
         if (GetLevel(&input, &level) && DecodeLevel(&input, level, &m)) {
           deleted_ss_pers_.push_back(std::make_pair(level, m));
+          last_ss = &deleted_ss_pers_.back().second;
         } else {
           msg = "deleted sstable entry";
         }
         break;
       case TropoVersionTag::kNewSSTable:
+        m.range_tombstones.clear();
+        m.prefix_filter.clear();
+        m.LN.device = 0;
         if (GetLevel(&input, &level) && DecodeLevel(&input, level, &m)) {
           new_ss_.push_back(std::make_pair(level, m));
+          last_ss = &new_ss_.back().second;
         } else {
           msg = "new sstable entry";
         }
         break;
+      case TropoVersionTag::kRangeTombstone:
+        if (GetLevel(&input, &level) && GetVarint64(&input, &number) &&
+            GetLengthPrefixedSlice(&input, &tombstone_start) &&
+            GetLengthPrefixedSlice(&input, &tombstone_end) &&
+            GetVarint64(&input, &tombstone_seq) && !new_ss_.empty() &&
+            new_ss_.back().first == level &&
+            new_ss_.back().second.number == number) {
+          new_ss_.back().second.range_tombstones.emplace_back(
+              tombstone_start, tombstone_end, tombstone_seq);
+        } else {
+          msg = "range tombstone";
+        }
+        break;
+      case TropoVersionTag::kPrefixFilter:
+        if (GetLevel(&input, &level) && GetVarint64(&input, &number) &&
+            GetLengthPrefixedSlice(&input, &prefix_filter) &&
+            !new_ss_.empty() && new_ss_.back().first == level &&
+            new_ss_.back().second.number == number) {
+          new_ss_.back().second.prefix_filter = prefix_filter.ToString();
+        } else {
+          msg = "prefix filter";
+        }
+        break;
+      case TropoVersionTag::kLNDevice:
+        if (GetLevel(&input, &level) && GetVarint64(&input, &number) &&
+            GetFixed8(&input, &device) &&
+            device < TropoDBConfig::max_devices && last_ss != nullptr &&
+            last_ss->number == number) {
+          last_ss->LN.device = device;
+        } else {
+          msg = "LN device";
+        }
+        break;
       case TropoVersionTag::kCompactPointer:
         if (GetLevel(&input, &level) && GetInternalKey(&input, &key)) {
           compact_pointers_.push_back(std::make_pair(level, key));
@@ -68,6 +68,13 @@ class TropoVersionEdit {
   void AddDeletedSSTable(uint8_t level, const SSZoneMetaData& meta) {
     deleted_ss_pers_.push_back(std::make_pair(level, meta));
   }
+  void AddColumnFamily(uint32_t id, const Slice& name) {
+    column_families_.emplace_back(id, name.ToString());
+  }
+  void SetNextColumnFamily(uint32_t id) {
+    has_next_column_family_ = true;
+    next_column_family_ = id;
+  }
 
  private:
   friend class TropoVersionSet;
@@ -89,6 +96,9 @@ class TropoVersionEdit {
   bool has_comparator_;
   uint64_t ss_number;
   bool has_next_ss_number;
+  std::vector<std::pair<uint32_t, std::string>> column_families_;
+  uint32_t next_column_family_;
+  bool has_next_column_family_;
 };
 }  // namespace ROCKSDB_NAMESPACE
 
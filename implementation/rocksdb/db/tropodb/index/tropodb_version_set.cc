@@ -12,15 +12,19 @@
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/utils/tropodb_logger.h"
 #include "port/port.h"
+#include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
+#include "test_util/sync_point.h"
 
 namespace ROCKSDB_NAMESPACE {
 TropoVersionSet::TropoVersionSet(const InternalKeyComparator& icmp,
                                  TropoSSTableManager* znssstable,
                                  TropoManifest* manifest,
                                  const uint64_t lba_size, uint64_t zone_cap,
-                                 TropoTableCache* table_cache, Env* env)
+                                 TropoTableCache* table_cache, Env* env,
+                                 const MergeOperator* merge_operator,
+                                 bool tiered)
     : dummy_versions_(this),
       current_(nullptr),
       icmp_(icmp),
@@ -31,7 +35,9 @@ TropoVersionSet::TropoVersionSet(const InternalKeyComparator& icmp,
       ss_number_(0),
       logged_(false),
       table_cache_(table_cache),
-      env_(env) {
+      env_(env),
+      merge_operator_(merge_operator),
+      tiered_(tiered) {
   AppendVersion(new TropoVersion(this));
 };
 
@@ -182,6 +188,12 @@ Status TropoVersionSet::WriteSnapshot(std::string* snapshot_dst,
                                       TropoVersion* version) {
   TropoVersionEdit edit;
   edit.SetComparatorName(icmp_.user_comparator()->Name());
+  for (const auto& cf : column_families_) {
+    edit.AddColumnFamily(cf.first, cf.second);
+  }
+  if (!column_families_.empty()) {
+    edit.SetNextColumnFamily(next_column_family_);
+  }
   // compaction stuff
   for (uint8_t level = 0; level < TropoDBConfig::level_count; level++) {
     const std::vector<SSZoneMetaData*>& ss = version->ss_[level];
@@ -238,6 +250,16 @@ void TropoVersionSet::RecalculateScore() {
   uint8_t best_level = TropoDBConfig::level_count + 1;
   double best_score = -1;
   double score = 0;
+  if (tiered_) {
+    uint8_t from, to;
+    if (PickTieredStep(&from, &to)) {
+      best_level = from;
+      best_score = 1;
+    }
+    v->compaction_level_ = best_level;
+    v->compaction_score_ = best_score;
+    return;
+  }
   // TODO: This is probably a design flaw. This is uninformed and might cause
   // all sorts of holes and early compactions.
   for (size_t i = 1; i < TropoDBConfig::level_count - 1; i++) {
@@ -276,6 +298,7 @@ Status TropoVersionSet::CommitVersion(TropoVersion* v,
   uint64_t current_lba;
   s = manifest_->NewManifest(result);
   if (s.ok()) {
+    TEST_SYNC_POINT("TropoVersionSet::CommitVersion:BeforeSetCurrent");
     s = manifest_->SetCurrent();
   } else {
     TROPO_LOG_ERROR("ERROR: Version set commit: Failed setting manifest\n");
@@ -451,6 +474,9 @@ void TropoVersionSet::SetupOtherInputs(TropoCompaction* c, uint64_t max_lba_c) {
 
   compact_pointer_[level] = largest.Encode().ToString();
   c->edit_.SetCompactPointer(level, largest);
+
+  // Tables that are entirely deleted by a range delete need no merging
+  c->DropCoveredTables();
 }
 
 bool TropoVersionSet::OnlyNeedDeletes(uint8_t level) {
@@ -463,8 +489,28 @@ bool TropoVersionSet::OnlyNeedDeletes(uint8_t level) {
   return only_need;
 }
 
+bool TropoVersionSet::CanBorrowForL0(uint64_t size) const {
+  // Dead tables still hold on to their zones
+  uint64_t borrowed = 0;
+  for (const auto* ss : {&current_->ss_[0], &current_->ss_d_[0]}) {
+    for (const auto& m : *ss) {
+      borrowed += IsBorrowedL0(*m) ? m->lba_count : 0;
+    }
+  }
+  // Each table claims at least one zone. LN must not be starved.
+  uint64_t needed = (size + lba_size_ - 1) / lba_size_;
+  needed = ((needed + zone_cap_ - 1) / zone_cap_ + 1) * zone_cap_;
+  return borrowed + needed <= TropoDBConfig::L0_borrow_zones * zone_cap_ &&
+         needed < znssstable_->SpaceRemainingLN() &&
+         znssstable_->GetFractionFilled(1) <
+             TropoDBConfig::ss_compact_treshold_force[1];
+}
+
 TropoCompaction* TropoVersionSet::PickCompaction(
     uint8_t level, const std::vector<SSZoneMetaData*>& busy) {
+  if (tiered_ && level > 0) {
+    return PickTieredCompaction(busy);
+  }
   TropoCompaction* c;
 
   c = new TropoCompaction(this, level, env_);
@@ -618,6 +664,135 @@ TropoCompaction* TropoVersionSet::PickCompaction(
   return c;
 }
 
+bool TropoVersionSet::PickTieredStep(uint8_t* from, uint8_t* to) const {
+  std::vector<uint8_t> runs;
+  std::array<uint64_t, TropoDBConfig::level_count> bytes;
+  for (uint8_t i = 1; i < TropoDBConfig::level_count; i++) {
+    if (!current_->ss_[i].empty()) {
+      runs.push_back(i);
+      bytes[i] = znssstable_->GetBytesInLevel(current_->ss_[i]);
+    }
+  }
+  if (runs.empty()) {
+    return false;
+  }
+  // L1 receives all L0 compactions, so its run is always vacated first. It
+  // moves to the free level just above the next run and is only merged if
+  // there is no free level left.
+  if (runs[0] == 1) {
+    *from = 1;
+    if (runs.size() == 1) {
+      *to = TropoDBConfig::level_count - 1;
+    } else {
+      *to = runs[1] == 2 ? 2 : runs[1] - 1;
+    }
+    return true;
+  }
+  // Merge the newest pair of runs of similar size. If there is a free level
+  // in between, the newer run is first moved next to the older run.
+  for (size_t i = 0; i + 1 < runs.size(); i++) {
+    if (bytes[runs[i + 1]] <=
+        TropoDBConfig::tiered_size_ratio * bytes[runs[i]]) {
+      *from = runs[i];
+      *to = runs[i + 1] == runs[i] + 1 ? runs[i + 1] : runs[i + 1] - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+TropoCompaction* TropoVersionSet::PickTieredCompaction(
+    const std::vector<SSZoneMetaData*>& busy) {
+  uint8_t from, to;
+  if (!PickTieredStep(&from, &to)) {
+    TropoCompaction* c = new TropoCompaction(this, 1, env_);
+    c->busy_ = true;
+    return c;
+  }
+  TropoCompaction* c = new TropoCompaction(this, from, env_);
+  c->busy_ = false;
+  const bool move = to != from + 1;
+
+  // Merges must fit in LN, moves only change the index.
+  uint64_t max_lba_c = znssstable_->SpaceRemainingLN();
+  max_lba_c = max_lba_c > TropoDBConfig::max_lbas_compaction_l0
+                  ? TropoDBConfig::max_lbas_compaction_l0
+                  : max_lba_c;
+  for (SSZoneMetaData* m : current_->ss_[from]) {
+    bool skip = false;
+    for (const auto& m2 : busy) {
+      if (m2->number == m->number) {
+        skip = true;
+        break;
+      }
+    }
+    if (skip) {
+      continue;
+    }
+    if (!move) {
+      if (!c->targets_[0].empty() && m->lba_count > max_lba_c) {
+        break;
+      }
+      max_lba_c -= std::min(max_lba_c, m->lba_count);
+    }
+    c->targets_[0].push_back(m);
+  }
+  if (c->targets_[0].empty()) {
+    c->busy_ = true;
+    return c;
+  }
+
+  c->version_ = current_;
+  c->version_->Ref();
+  if (move) {
+    c->move_level_ = to;
+  } else {
+    SetupOtherInputs(c, max_lba_c);
+  }
+  TROPO_LOG_INFO(
+      "INFO: Pick Tiered Compaction: %s %lu tables from %u to %u, %lu "
+      "overlapping\n",
+      move ? "move" : "merge", c->targets_[0].size(), from, to,
+      c->targets_[1].size());
+  return c;
+}
+
+TropoCompaction* TropoVersionSet::CompactRange(uint8_t level,
+                                              const InternalKey* begin,
+                                              const InternalKey* end) {
+  std::vector<SSZoneMetaData*> inputs;
+  current_->GetOverlappingInputs(level, begin, end, &inputs);
+  if (inputs.empty()) {
+    return nullptr;
+  }
+
+  // Same bound as PickCompaction, the rest of the range is picked next time.
+  uint64_t max_lba_c = znssstable_->SpaceRemainingLN();
+  max_lba_c = max_lba_c > TropoDBConfig::max_lbas_compaction_l0
+                  ? TropoDBConfig::max_lbas_compaction_l0
+                  : max_lba_c;
+  TropoCompaction* c = new TropoCompaction(this, level, env_);
+  c->busy_ = false;
+  for (auto target : inputs) {
+    // Always take one table to make progress
+    if (!c->targets_[0].empty() && target->lba_count > max_lba_c) {
+      break;
+    }
+    c->targets_[0].push_back(target);
+    max_lba_c =
+        target->lba_count > max_lba_c ? 0 : max_lba_c - target->lba_count;
+  }
+  c->version_ = current_;
+  c->version_->Ref();
+
+  SetupOtherInputs(c, max_lba_c);
+  TROPO_LOG_INFO(
+      "INFO: Manual Compaction: from %u, with size %lu/%lu %lu/%lu\n", level,
+      c->targets_[0].size(), current_->ss_[level].size(),
+      c->targets_[1].size(), current_->ss_[level + 1].size());
+  return c;
+}
+
 Status TropoVersionSet::RemoveObsoleteZones(TropoVersionEdit* edit) {
   Status s = Status::OK();
   for (const auto& deleted : edit->deleted_ss_) {
@@ -694,6 +869,14 @@ Status TropoVersionSet::Recover() {
     s = znssstable_->Recover("");
   }
 
+  // Column families are part of the snapshot written by LogAndApply
+  column_families_.clear();
+  for (const auto& cf : edit.column_families_) {
+    column_families_.insert(cf);
+  }
+  next_column_family_ =
+      edit.has_next_column_family_ ? edit.next_column_family_ : 0;
+
   // Install recovered edit
   if (s.ok()) {
     s = LogAndApply(&edit);
@@ -740,6 +923,49 @@ Status TropoVersionSet::Recover() {
   return Status::OK();
 }
 
+void TropoVersionSet::InitColumnFamilies() {
+  column_families_.clear();
+  column_families_[0] = kDefaultColumnFamilyName;
+  next_column_family_ = 1;
+}
+
+Status TropoVersionSet::AddColumnFamily(const std::string& name,
+                                        uint32_t* id) {
+  for (const auto& cf : column_families_) {
+    if (cf.second == name) {
+      return Status::InvalidArgument("Column family already exists", name);
+    }
+  }
+  if (next_column_family_ == UINT32_MAX) {
+    return Status::NoSpace("Out of column family ids");
+  }
+  *id = next_column_family_++;
+  column_families_[*id] = name;
+  TropoVersionEdit edit;
+  Status s = LogAndApply(&edit);
+  if (!s.ok()) {
+    TROPO_LOG_ERROR("ERROR: VersionSet: Could not add column family\n");
+    column_families_.erase(*id);
+  }
+  return s;
+}
+
+Status TropoVersionSet::DropColumnFamily(uint32_t id) {
+  auto it = column_families_.find(id);
+  if (it == column_families_.end()) {
+    return Status::InvalidArgument("Column family does not exist");
+  }
+  const std::string name = it->second;
+  column_families_.erase(it);
+  TropoVersionEdit edit;
+  Status s = LogAndApply(&edit);
+  if (!s.ok()) {
+    TROPO_LOG_ERROR("ERROR: VersionSet: Could not drop column family\n");
+    column_families_[id] = name;
+  }
+  return s;
+}
+
 std::string TropoVersionSet::DebugString() {
   std::ostringstream result;
   for (uint8_t i = 0; i < TropoDBConfig::level_count; i++) {
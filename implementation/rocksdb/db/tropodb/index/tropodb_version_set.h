@@ -6,6 +6,9 @@
 #ifndef TROPODB_VERSION_SET_H
 #define TROPODB_VERSION_SET_H
 
+#include <map>
+#include <string>
+
 #include "db/dbformat.h"
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/index/tropodb_version.h"
@@ -17,6 +20,7 @@
 #include "db/tropodb/table/tropodb_table_cache.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
 #include "port/port.h"
+#include "rocksdb/merge_operator.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 
@@ -31,7 +35,9 @@ class TropoVersionSet {
   TropoVersionSet(const InternalKeyComparator& icmp,
                 TropoSSTableManager* znssstable, TropoManifest* manifest,
                 const uint64_t lba_size, const uint64_t zone_cap,
-                TropoTableCache* table_cache, Env* env);
+                TropoTableCache* table_cache, Env* env,
+                const MergeOperator* merge_operator = nullptr,
+                bool tiered = false);
   TropoVersionSet(const TropoVersionSet&) = delete;
   TropoVersionSet& operator=(const TropoVersionSet&) = delete;
   ~TropoVersionSet();
@@ -60,6 +66,10 @@ class TropoVersionSet {
     assert(level < TropoDBConfig::level_count);
     return current_->ss_[level].size();
   }
+  inline size_t NumDeadLevelZones(uint8_t level) const {
+    assert(level < TropoDBConfig::level_count);
+    return current_->ss_d_[level].size();
+  }
   inline int NumLevelBytes(uint8_t level) const {
     const std::vector<SSZoneMetaData*>& ss = current_->ss_[level];
     int64_t sum = 0;
@@ -69,6 +79,18 @@ class TropoVersionSet {
     return sum;
   }
 
+  // LN tables claim whole zones, so their maximum size is rounded to the
+  // nearest number of zones.
+  inline uint64_t MaxLNTableLbas() const {
+    uint64_t lbas =
+        (TropoDBConfig::max_bytes_sstable_ + lba_size_ - 1) / lba_size_;
+    uint64_t zones = (lbas + zone_cap_ / 2) / zone_cap_;
+    return (zones > 0 ? zones : 1) * zone_cap_;
+  }
+  inline uint64_t MaxLNTableBytes() const {
+    return MaxLNTableLbas() * lba_size_;
+  }
+
   bool NeedsCompaction() const {
     // printf("Score %f \n", current_->compaction_score_);
     return current_->compaction_score_ >= 1 &&
@@ -95,6 +117,9 @@ class TropoVersionSet {
            1;
   }
 
+  // If a flush of size bytes can go to zones borrowed from LN.
+  bool CanBorrowForL0(uint64_t size) const;
+
   bool NeedsL0CompactionForceParallel(uint8_t parallel_number) const {
     return znssstable_->GetFractionFilledL0(parallel_number) /
                TropoDBConfig::ss_compact_treshold_force[0] >=
@@ -110,9 +135,24 @@ class TropoVersionSet {
   bool OnlyNeedDeletes(uint8_t level);
   TropoCompaction* PickCompaction(uint8_t level,
                                 const std::vector<SSZoneMetaData*>& busy);
+  inline bool IsTiered() const { return tiered_; }
+  // Compaction of the tables in level that overlap [begin, end], nullptr if
+  // there are none. Null keys are before/after all keys.
+  TropoCompaction* CompactRange(uint8_t level, const InternalKey* begin,
+                                const InternalKey* end);
   // ONLY call on startup or recovery, this is not thread safe and drops current
   // data.
   Status Recover();
+
+  // Column families by id, empty for databases that predate them.
+  inline const std::map<uint32_t, std::string>& ColumnFamilies() const {
+    return column_families_;
+  }
+  // A new database starts with only the default family.
+  void InitColumnFamilies();
+  // Ids are never reused, dropped families can still have (hidden) data.
+  Status AddColumnFamily(const std::string& name, uint32_t* id);
+  Status DropColumnFamily(uint32_t id);
   std::string DebugString();
 
  private:
@@ -125,6 +165,13 @@ class TropoVersionSet {
   Status CommitVersion(TropoVersion* v, TropoSSTableManager* man);
   Status DecodeFrom(const Slice& input, TropoVersionEdit* edit);
 
+  // Tiered compaction, every LN level holds one sorted run and lower levels
+  // hold newer runs. Picks the next step: the run in from is merged into to
+  // (to == from + 1) or moved to the empty level to.
+  bool PickTieredStep(uint8_t* from, uint8_t* to) const;
+  TropoCompaction* PickTieredCompaction(
+      const std::vector<SSZoneMetaData*>& busy);
+
   TropoVersion dummy_versions_;
   TropoVersion* current_;
   const InternalKeyComparator icmp_;
@@ -138,10 +185,15 @@ class TropoVersionSet {
   bool logged_;
   TropoTableCache* table_cache_;
   Env* env_;
+  const MergeOperator* merge_operator_;
+  const bool tiered_;
 
   // Per-level key at which the next compaction at that level should start.
   // Either an empty string, or a valid InternalKey.
   std::array<std::string, TropoDBConfig::level_count> compact_pointer_;
+
+  std::map<uint32_t, std::string> column_families_;
+  uint32_t next_column_family_{0};
 };
 
 class TropoVersionSet::Builder {
@@ -140,6 +140,16 @@ void TropoVersionSet::Builder::SaveTo(TropoVersion* v) {
       v->ss_d_[level].push_back(d);
     }
   }
+  // L0 tables overlap, Get finds them with an interval index. It is immutable,
+  // so it can be shared with the base as long as L0 does not change.
+  if (base_->l0_index_ != nullptr && levels_[0].added_ss->empty() &&
+      levels_[0].deleted_ss.empty()) {
+    v->l0_index_ = base_->l0_index_;
+  } else {
+    v->l0_index_ = std::make_shared<const TropoL0Index>(
+        vset_->icmp_.user_comparator(), v->ss_[0]);
+  }
+
   // Add ranges to delete.
   v->ss_deleted_range_ = ss_deleted_range_;
 }
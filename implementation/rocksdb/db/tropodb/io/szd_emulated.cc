@@ -0,0 +1,1018 @@
+#ifdef TROPODB_EMULATED_ZNS
+#include "db/tropodb/io/szd_emulated.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+
+namespace SZD {
+namespace {
+std::mutex emulated_devices_mutex;
+std::map<std::string, std::unique_ptr<DeviceManager>> emulated_devices;
+
+bool ParseOption(const std::string& option, EmulatedGeometry* geometry) {
+  const size_t eq = option.find('=');
+  if (eq == std::string::npos || eq + 1 == option.size()) {
+    return false;
+  }
+  const std::string key = option.substr(0, eq);
+  const std::string value = option.substr(eq + 1);
+  char* end = nullptr;
+  const uint64_t number = std::strtoull(value.c_str(), &end, 10);
+  if (end == nullptr || *end != '\0') {
+    return false;
+  }
+  if (key == "zones") {
+    geometry->zones = number;
+  } else if (key == "zone_cap") {
+    geometry->zone_cap = number;
+  } else if (key == "lba_size") {
+    geometry->lba_size = number;
+  } else if (key == "max_active") {
+    geometry->max_active_zones = number;
+  } else if (key == "write_us") {
+    geometry->write_latency_us = number;
+  } else if (key == "read_us") {
+    geometry->read_latency_us = number;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline void Delay(uint64_t us) {
+  if (us > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  }
+}
+}  // namespace
+
+bool EmulatedGeometry::Parse(const std::string& name,
+                             EmulatedGeometry* geometry) {
+  size_t pos = name.find(':');
+  while (pos != std::string::npos) {
+    const size_t next = name.find(',', pos + 1);
+    const std::string option =
+        name.substr(pos + 1, next == std::string::npos ? next : next - pos - 1);
+    if (!ParseOption(option, geometry)) {
+      return false;
+    }
+    pos = next;
+  }
+  return geometry->lba_size > 0 && geometry->zone_cap > 0 &&
+         geometry->zones > 0;
+}
+
+DeviceManager::DeviceManager(const std::string& name,
+                             const EmulatedGeometry& geometry)
+    : geometry_(geometry), zones_(geometry.zones) {
+  info_.lba_size = geometry.lba_size;
+  info_.zone_size = geometry.zone_cap;
+  info_.zone_cap = geometry.zone_cap;
+  info_.mdts = geometry.lba_size * 32;
+  info_.zasl = geometry.lba_size * 32;
+  info_.lba_cap = geometry.zones * geometry.zone_cap;
+  info_.min_lba = 0;
+  info_.max_lba = info_.lba_cap;
+  info_.name = name;
+}
+
+SZDStatus DeviceManager::Write(uint64_t slba, const char* data,
+                               uint64_t blocks) {
+  const uint64_t zone = slba / info_.zone_cap;
+  const uint64_t offset = slba % info_.zone_cap;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (zone >= zones_.size()) {
+      return SZDStatus::InvalidArguments;
+    }
+    Zone& z = zones_[zone];
+    // Zones are append-only and writes can not cross the zone capacity
+    if (offset != z.wp || blocks > info_.zone_cap - z.wp) {
+      return SZDStatus::InvalidArguments;
+    }
+    if (blocks == 0) {
+      return SZDStatus::Success;
+    }
+    if (z.wp == 0) {
+      if (geometry_.max_active_zones != 0 &&
+          active_zones_ >= geometry_.max_active_zones) {
+        return SZDStatus::DeviceError;
+      }
+      active_zones_++;
+      z.data.reset(new char[info_.zone_cap * info_.lba_size]);
+    }
+    memcpy(z.data.get() + z.wp * info_.lba_size, data,
+           blocks * info_.lba_size);
+    z.wp += blocks;
+    // Full zones are no longer active
+    if (z.wp == info_.zone_cap) {
+      active_zones_--;
+    }
+  }
+  Delay(geometry_.write_latency_us);
+  return SZDStatus::Success;
+}
+
+SZDStatus DeviceManager::Read(uint64_t slba, char* data,
+                              uint64_t blocks) const {
+  if (slba > info_.lba_cap || blocks > info_.lba_cap - slba) {
+    return SZDStatus::InvalidArguments;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (blocks > 0) {
+      const Zone& z = zones_[slba / info_.zone_cap];
+      const uint64_t offset = slba % info_.zone_cap;
+      const uint64_t step = std::min(blocks, info_.zone_cap - offset);
+      const uint64_t written =
+          z.wp > offset ? std::min(step, z.wp - offset) : 0;
+      if (written > 0) {
+        memcpy(data, z.data.get() + offset * info_.lba_size,
+               written * info_.lba_size);
+      }
+      memset(data + written * info_.lba_size, 0,
+             (step - written) * info_.lba_size);
+      data += step * info_.lba_size;
+      slba += step;
+      blocks -= step;
+    }
+  }
+  Delay(geometry_.read_latency_us);
+  return SZDStatus::Success;
+}
+
+SZDStatus DeviceManager::ResetZone(uint64_t zone) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (zone >= zones_.size()) {
+    return SZDStatus::InvalidArguments;
+  }
+  Zone& z = zones_[zone];
+  if (z.wp > 0 && z.wp < info_.zone_cap) {
+    active_zones_--;
+  }
+  z.wp = 0;
+  z.data.reset();
+  return SZDStatus::Success;
+}
+
+uint64_t DeviceManager::WritePointer(uint64_t zone) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return zone < zones_.size() ? zones_[zone].wp : 0;
+}
+
+SZDBuffer::SZDBuffer(size_t size, uint64_t lba_size)
+    : lba_size_(lba_size), size_(0) {
+  ReallocBuffer(size);
+}
+
+SZDStatus SZDBuffer::GetBuffer(void** buffer) const {
+  if (buffer_ == nullptr) {
+    return SZDStatus::MemoryError;
+  }
+  *buffer = buffer_.get();
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDBuffer::ReallocBuffer(uint64_t size) {
+  // Buffers hold whole blocks
+  size = ((size + lba_size_ - 1) / lba_size_) * lba_size_;
+  if (size == size_) {
+    return SZDStatus::Success;
+  }
+  std::unique_ptr<char[]> buffer(size > 0 ? new char[size] : nullptr);
+  if (buffer_ != nullptr && size > 0) {
+    memcpy(buffer.get(), buffer_.get(), std::min<uint64_t>(size, size_));
+  }
+  buffer_ = std::move(buffer);
+  size_ = size;
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDBuffer::FreeBuffer() {
+  buffer_.reset();
+  size_ = 0;
+  return SZDStatus::Success;
+}
+
+SZDChannel::SZDChannel(DeviceManager* device, uint64_t min_zone,
+                       uint64_t max_zone)
+    : device_(device),
+      lba_size_(device->Info().lba_size),
+      zone_cap_(device->Info().zone_cap),
+      min_lba_(min_zone * zone_cap_),
+      max_lba_(max_zone * zone_cap_),
+      zones_reset_(max_zone - min_zone, 0),
+      zone_appends_(max_zone - min_zone, 0) {}
+
+SZDStatus SZDChannel::DirectAppend(uint64_t* lba, const void* buffer,
+                                   uint64_t size, bool alligned) {
+  (void)alligned;
+  const uint64_t blocks = (size + lba_size_ - 1) / lba_size_;
+  if (!InRange(*lba, blocks)) {
+    return SZDStatus::InvalidArguments;
+  }
+  // The last block is padded
+  const char* data = static_cast<const char*>(buffer);
+  std::unique_ptr<char[]> padded;
+  if (size % lba_size_ != 0) {
+    padded.reset(new char[blocks * lba_size_]);
+    memcpy(padded.get(), data, size);
+    memset(padded.get() + size, 0, blocks * lba_size_ - size);
+    data = padded.get();
+  }
+  uint64_t left = blocks;
+  while (left > 0) {
+    const uint64_t step = std::min(left, zone_cap_ - *lba % zone_cap_);
+    SZDStatus s = device_->Write(*lba, data, step);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+    zone_appends_[(*lba - min_lba_) / zone_cap_]++;
+    append_operations_++;
+    bytes_written_ += step * lba_size_;
+    data += step * lba_size_;
+    *lba += step;
+    left -= step;
+  }
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDChannel::DirectRead(uint64_t lba, void* buffer, uint64_t size,
+                                 bool alligned) {
+  (void)alligned;
+  const uint64_t blocks = (size + lba_size_ - 1) / lba_size_;
+  if (!InRange(lba, blocks)) {
+    return SZDStatus::InvalidArguments;
+  }
+  SZDStatus s;
+  if (size % lba_size_ == 0) {
+    s = device_->Read(lba, static_cast<char*>(buffer), blocks);
+  } else {
+    std::unique_ptr<char[]> blocks_buffer(new char[blocks * lba_size_]);
+    s = device_->Read(lba, blocks_buffer.get(), blocks);
+    memcpy(buffer, blocks_buffer.get(), size);
+  }
+  read_operations_++;
+  bytes_read_ += blocks * lba_size_;
+  return s;
+}
+
+SZDStatus SZDChannel::ZoneHead(uint64_t slba, uint64_t* zone_head) {
+  if (!InRange(slba, 1) || slba % zone_cap_ != 0) {
+    return SZDStatus::InvalidArguments;
+  }
+  *zone_head = slba + device_->WritePointer(slba / zone_cap_);
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDChannel::ResetZone(uint64_t slba) {
+  if (!InRange(slba, 1) || slba % zone_cap_ != 0) {
+    return SZDStatus::InvalidArguments;
+  }
+  SZDStatus s = device_->ResetZone(slba / zone_cap_);
+  if (s == SZDStatus::Success) {
+    zones_reset_[(slba - min_lba_) / zone_cap_]++;
+    zones_reset_counter_++;
+  }
+  return s;
+}
+
+SZDStatus SZDChannel::ResetAllZones() {
+  for (uint64_t slba = min_lba_; slba < max_lba_; slba += zone_cap_) {
+    if (device_->WritePointer(slba / zone_cap_) == 0) {
+      continue;
+    }
+    SZDStatus s = ResetZone(slba);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+  }
+  return SZDStatus::Success;
+}
+
+SZDChannelFactory::SZDChannelFactory(DeviceManager* device,
+                                     const uint64_t max_channels)
+    : device_(device), max_channels_(max_channels) {}
+
+void SZDChannelFactory::Unref() {
+  if (--refs_ == 0) {
+    delete this;
+  }
+}
+
+SZDStatus SZDChannelFactory::register_channel(SZDChannel** channel,
+                                              uint64_t min_zone,
+                                              uint64_t max_zone,
+                                              bool preserve_async_buffer,
+                                              uint32_t queue_depth) {
+  (void)preserve_async_buffer;
+  (void)queue_depth;
+  const uint64_t zones = device_->Info().lba_cap / device_->Info().zone_cap;
+  if (min_zone >= max_zone || max_zone > zones) {
+    return SZDStatus::InvalidArguments;
+  }
+  if (++channels_ > max_channels_) {
+    channels_--;
+    return SZDStatus::MemoryError;
+  }
+  *channel = new SZDChannel(device_, min_zone, max_zone);
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDChannelFactory::register_channel(SZDChannel** channel) {
+  return register_channel(
+      channel, 0, device_->Info().lba_cap / device_->Info().zone_cap);
+}
+
+SZDStatus SZDChannelFactory::unregister_channel(SZDChannel* channel) {
+  if (channel == nullptr) {
+    return SZDStatus::InvalidArguments;
+  }
+  delete channel;
+  channels_--;
+  return SZDStatus::Success;
+}
+
+SZDDevice::SZDDevice(const std::string& application_name)
+    : application_name_(application_name),
+      device_(nullptr),
+      min_zone_(0),
+      max_zone_(0) {}
+
+SZDStatus SZDDevice::Init() { return SZDStatus::Success; }
+
+SZDStatus SZDDevice::Reinit() { return SZDStatus::Success; }
+
+SZDStatus SZDDevice::Open(const std::string& device_name, uint64_t min_zone,
+                          uint64_t max_zone) {
+  EmulatedGeometry geometry;
+  if (!EmulatedGeometry::Parse(device_name, &geometry)) {
+    return SZDStatus::InvalidArguments;
+  }
+  max_zone = max_zone == 0 ? geometry.zones : max_zone;
+  if (min_zone >= max_zone || max_zone > geometry.zones) {
+    return SZDStatus::InvalidArguments;
+  }
+  std::lock_guard<std::mutex> lock(emulated_devices_mutex);
+  auto it = emulated_devices.find(device_name);
+  if (it == emulated_devices.end()) {
+    it = emulated_devices
+             .emplace(device_name,
+                      new DeviceManager(device_name, geometry))
+             .first;
+  }
+  device_ = it->second.get();
+  min_zone_ = min_zone;
+  max_zone_ = max_zone;
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDDevice::Close() {
+  device_ = nullptr;
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDDevice::GetInfo(DeviceInfo* info) const {
+  if (device_ == nullptr) {
+    return SZDStatus::InvalidArguments;
+  }
+  *info = device_->Info();
+  info->min_lba = min_zone_ * info->zone_cap;
+  info->max_lba = max_zone_ * info->zone_cap;
+  return SZDStatus::Success;
+}
+
+void SZDDevice::DestroyEmulated(const std::string& device_name) {
+  std::lock_guard<std::mutex> lock(emulated_devices_mutex);
+  emulated_devices.erase(device_name);
+}
+
+SZDChannelLog::SZDChannelLog(SZDChannelFactory* channel_factory,
+                             const DeviceInfo& info, uint64_t min_zone,
+                             uint64_t max_zone, uint8_t readers,
+                             uint8_t writers,
+                             SZDChannel* borrowed_write_channel)
+    : channel_factory_(channel_factory),
+      lba_size_(info.lba_size),
+      zone_cap_(info.zone_cap),
+      min_zone_head_(min_zone * info.zone_cap),
+      max_zone_head_(max_zone * info.zone_cap),
+      readers_(readers) {
+  channel_factory_->Ref();
+  auto new_channel = [&]() {
+    SZDChannel* channel = nullptr;
+    SZDStatus s =
+        channel_factory_->register_channel(&channel, min_zone, max_zone);
+    (void)s;
+    assert(s == SZDStatus::Success);
+    owned_channels_.push_back(channel);
+    return channel;
+  };
+  if (borrowed_write_channel != nullptr) {
+    write_channels_.push_back(borrowed_write_channel);
+  } else {
+    for (uint8_t i = 0; i < writers; i++) {
+      write_channels_.push_back(new_channel());
+    }
+  }
+  for (uint8_t i = 0; i < readers; i++) {
+    read_channels_.push_back(new_channel());
+  }
+}
+
+SZDChannelLog::~SZDChannelLog() {
+  for (SZDChannel* channel : owned_channels_) {
+    channel_factory_->unregister_channel(channel);
+  }
+  channel_factory_->Unref();
+}
+
+uint64_t SZDChannelLog::GetBytesWritten() const {
+  uint64_t total = 0;
+  for (const SZDChannel* channel : owned_channels_) {
+    total += channel->GetBytesWritten();
+  }
+  return total;
+}
+
+uint64_t SZDChannelLog::GetAppendOperationsCounter() const {
+  uint64_t total = 0;
+  for (const SZDChannel* channel : owned_channels_) {
+    total += channel->GetAppendOperationsCounter();
+  }
+  return total;
+}
+
+uint64_t SZDChannelLog::GetBytesRead() const {
+  uint64_t total = 0;
+  for (const SZDChannel* channel : owned_channels_) {
+    total += channel->GetBytesRead();
+  }
+  return total;
+}
+
+uint64_t SZDChannelLog::GetReadOperationsCounter() const {
+  uint64_t total = 0;
+  for (const SZDChannel* channel : owned_channels_) {
+    total += channel->GetReadOperationsCounter();
+  }
+  return total;
+}
+
+uint64_t SZDChannelLog::GetZonesResetCounter() const {
+  uint64_t total = 0;
+  for (const SZDChannel* channel : owned_channels_) {
+    total += channel->GetZonesResetCounter();
+  }
+  return total;
+}
+
+std::vector<uint64_t> SZDChannelLog::GetZonesReset() const {
+  std::vector<uint64_t> total((max_zone_head_ - min_zone_head_) / zone_cap_);
+  for (const SZDChannel* channel : owned_channels_) {
+    const std::vector<uint64_t> zones = channel->GetZonesReset();
+    for (size_t i = 0; i < zones.size() && i < total.size(); i++) {
+      total[i] += zones[i];
+    }
+  }
+  return total;
+}
+
+std::vector<uint64_t> SZDChannelLog::GetAppendOperations() const {
+  std::vector<uint64_t> total((max_zone_head_ - min_zone_head_) / zone_cap_);
+  for (const SZDChannel* channel : owned_channels_) {
+    const std::vector<uint64_t> zones = channel->GetAppendOperations();
+    for (size_t i = 0; i < zones.size() && i < total.size(); i++) {
+      total[i] += zones[i];
+    }
+  }
+  return total;
+}
+
+uint64_t SZDLog::GetWriteHead() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_head_;
+}
+
+uint64_t SZDLog::GetWriteTail() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_tail_;
+}
+
+SZDOnceLog::SZDOnceLog(SZDChannelFactory* channel_factory,
+                       const DeviceInfo& info, uint64_t min_zone,
+                       uint64_t max_zone, SZDChannel* borrowed_write_channel,
+                       uint8_t number_of_readers)
+    : SZDLog(channel_factory, info, min_zone, max_zone, number_of_readers, 1,
+             borrowed_write_channel) {
+  write_head_ = write_tail_ = min_zone_head_;
+}
+
+SZDStatus SZDOnceLog::Append(const char* data, const size_t size,
+                             uint64_t* lbas, bool alligned) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t blocks = Blocks(size);
+  if (blocks > max_zone_head_ - write_head_) {
+    return SZDStatus::IOError;
+  }
+  SZDStatus s =
+      write_channels_[0]->DirectAppend(&write_head_, data, size, alligned);
+  if (lbas != nullptr) {
+    *lbas = blocks;
+  }
+  return s;
+}
+
+SZDStatus SZDOnceLog::Append(const SZDBuffer& buffer, size_t addr, size_t size,
+                             uint64_t* lbas, bool alligned) {
+  char* data;
+  if (buffer.GetBuffer((void**)&data) != SZDStatus::Success ||
+      addr + size > buffer.GetBufferSize()) {
+    return SZDStatus::InvalidArguments;
+  }
+  return Append(data + addr, size, lbas, alligned);
+}
+
+SZDStatus SZDOnceLog::AsyncAppend(const char* data, const size_t size,
+                                  uint64_t* lbas, bool alligned) {
+  return Append(data, size, lbas, alligned);
+}
+
+SZDStatus SZDOnceLog::Sync() { return SZDStatus::Success; }
+
+SZDStatus SZDOnceLog::Read(uint64_t lba, char* data, uint64_t size,
+                           bool alligned, uint8_t reader) {
+  if (reader >= readers_ || lba < min_zone_head_ ||
+      Blocks(size) > max_zone_head_ - lba) {
+    return SZDStatus::InvalidArguments;
+  }
+  return read_channels_[reader]->DirectRead(lba, data, size, alligned);
+}
+
+SZDStatus SZDOnceLog::Read(uint64_t lba, SZDBuffer* buffer, uint64_t addr,
+                           uint64_t size, bool alligned, uint8_t reader) {
+  char* data;
+  if (buffer->GetBuffer((void**)&data) != SZDStatus::Success ||
+      addr + size > buffer->GetBufferSize()) {
+    return SZDStatus::InvalidArguments;
+  }
+  return Read(lba, data + addr, size, alligned, reader);
+}
+
+SZDStatus SZDOnceLog::ReadAll(std::string& out) {
+  uint64_t head, tail;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    head = write_head_;
+    tail = write_tail_;
+  }
+  out.resize((head - tail) * lba_size_);
+  if (head == tail) {
+    return SZDStatus::Success;
+  }
+  return Read(tail, &out[0], out.size(), true, 0);
+}
+
+SZDStatus SZDOnceLog::ResetAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The write channel can be shared with other logs, only reset our zones
+  for (uint64_t slba = min_zone_head_; slba < write_head_; slba += zone_cap_) {
+    SZDStatus s = write_channels_[0]->ResetZone(slba);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+  }
+  write_head_ = write_tail_ = min_zone_head_;
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDOnceLog::RecoverPointers() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  write_tail_ = min_zone_head_;
+  write_head_ = max_zone_head_;
+  for (uint64_t slba = min_zone_head_; slba < max_zone_head_;
+       slba += zone_cap_) {
+    uint64_t zone_head;
+    SZDStatus s = read_channels_[0]->ZoneHead(slba, &zone_head);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+    if (zone_head < slba + zone_cap_) {
+      write_head_ = zone_head;
+      break;
+    }
+  }
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDOnceLog::MarkInactive() { return SZDStatus::Success; }
+
+bool SZDOnceLog::Empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_head_ == write_tail_;
+}
+
+bool SZDOnceLog::SpaceLeft(const size_t size, bool alligned) const {
+  (void)alligned;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Blocks(size) <= max_zone_head_ - write_head_;
+}
+
+uint64_t SZDOnceLog::SpaceAvailable() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (max_zone_head_ - write_head_) * lba_size_;
+}
+
+SZDCircularLog::SZDCircularLog(SZDChannelFactory* channel_factory,
+                               const DeviceInfo& info, uint64_t min_zone,
+                               uint64_t max_zone, uint8_t number_of_readers)
+    : SZDLog(channel_factory, info, min_zone, max_zone, number_of_readers, 1,
+             nullptr) {
+  write_head_ = write_tail_ = min_zone_head_;
+}
+
+SZDStatus SZDCircularLog::Append(const char* data, const size_t size,
+                                 uint64_t* lbas, bool alligned) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t blocks = Blocks(size);
+  if (blocks > Capacity() - zone_blocks_in_use_) {
+    return SZDStatus::IOError;
+  }
+  // Split at the end of the log, the first part is always whole blocks
+  const size_t first =
+      std::min<uint64_t>(size, (max_zone_head_ - write_head_) * lba_size_);
+  SZDStatus s =
+      write_channels_[0]->DirectAppend(&write_head_, data, first, alligned);
+  if (write_head_ == max_zone_head_) {
+    write_head_ = min_zone_head_;
+  }
+  if (s == SZDStatus::Success && first < size) {
+    s = write_channels_[0]->DirectAppend(&write_head_, data + first,
+                                         size - first, alligned);
+  }
+  if (s != SZDStatus::Success) {
+    return s;
+  }
+  zone_blocks_in_use_ += blocks;
+  if (lbas != nullptr) {
+    *lbas = blocks;
+  }
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDCircularLog::Append(const SZDBuffer& buffer, size_t addr,
+                                 size_t size, uint64_t* lbas, bool alligned) {
+  char* data;
+  if (buffer.GetBuffer((void**)&data) != SZDStatus::Success ||
+      addr + size > buffer.GetBufferSize()) {
+    return SZDStatus::InvalidArguments;
+  }
+  return Append(data + addr, size, lbas, alligned);
+}
+
+SZDStatus SZDCircularLog::Read(uint64_t lba, char* data, uint64_t size,
+                               bool alligned, uint8_t reader) {
+  if (reader >= readers_ || lba < min_zone_head_ || lba >= max_zone_head_ ||
+      Blocks(size) > Capacity()) {
+    return SZDStatus::InvalidArguments;
+  }
+  // Reads can wrap around as well
+  const uint64_t first =
+      std::min<uint64_t>(size, (max_zone_head_ - lba) * lba_size_);
+  SZDStatus s = read_channels_[reader]->DirectRead(lba, data, first, alligned);
+  if (s == SZDStatus::Success && first < size) {
+    s = read_channels_[reader]->DirectRead(min_zone_head_, data + first,
+                                           size - first, alligned);
+  }
+  return s;
+}
+
+SZDStatus SZDCircularLog::Read(uint64_t lba, SZDBuffer* buffer, uint64_t addr,
+                               uint64_t size, bool alligned, uint8_t reader) {
+  char* data;
+  if (buffer->GetBuffer((void**)&data) != SZDStatus::Success ||
+      addr + size > buffer->GetBufferSize()) {
+    return SZDStatus::InvalidArguments;
+  }
+  return Read(lba, data + addr, size, alligned, reader);
+}
+
+SZDStatus SZDCircularLog::ConsumeTail(uint64_t begin_lba, uint64_t end_lba) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (begin_lba != write_tail_) {
+    return SZDStatus::InvalidArguments;
+  }
+  // end_lba may be past the end of the log or already wrapped
+  uint64_t blocks = end_lba >= begin_lba ? end_lba - begin_lba
+                                         : end_lba + Capacity() - begin_lba;
+  const uint64_t tail_zone =
+      write_tail_ - (write_tail_ - min_zone_head_) % zone_cap_;
+  if (blocks > zone_blocks_in_use_ - (write_tail_ - tail_zone)) {
+    return SZDStatus::InvalidArguments;
+  }
+  while (blocks > 0) {
+    const uint64_t zone =
+        write_tail_ - (write_tail_ - min_zone_head_) % zone_cap_;
+    const uint64_t step = std::min(blocks, zone + zone_cap_ - write_tail_);
+    write_tail_ += step;
+    blocks -= step;
+    // Zones are only reset once the tail passed all of them
+    if (write_tail_ == zone + zone_cap_) {
+      SZDStatus s = write_channels_[0]->ResetZone(zone);
+      if (s != SZDStatus::Success) {
+        return s;
+      }
+      zone_blocks_in_use_ -= zone_cap_;
+      if (write_tail_ == max_zone_head_) {
+        write_tail_ = min_zone_head_;
+      }
+    }
+  }
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDCircularLog::ResetAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (uint64_t slba = min_zone_head_; slba < max_zone_head_;
+       slba += zone_cap_) {
+    uint64_t zone_head;
+    SZDStatus s = write_channels_[0]->ZoneHead(slba, &zone_head);
+    if (s == SZDStatus::Success && zone_head != slba) {
+      s = write_channels_[0]->ResetZone(slba);
+    }
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+  }
+  write_head_ = write_tail_ = min_zone_head_;
+  zone_blocks_in_use_ = 0;
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDCircularLog::RecoverPointers() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t zones = Capacity() / zone_cap_;
+  std::vector<uint64_t> written(zones);
+  for (uint64_t i = 0; i < zones; i++) {
+    const uint64_t slba = min_zone_head_ + i * zone_cap_;
+    uint64_t zone_head;
+    SZDStatus s = read_channels_[0]->ZoneHead(slba, &zone_head);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+    written[i] = zone_head - slba;
+  }
+  write_head_ = write_tail_ = min_zone_head_;
+  zone_blocks_in_use_ = 0;
+  // The tail zone follows an empty zone, or the head zone if none is empty
+  uint64_t tail = zones;
+  for (uint64_t i = 0; i < zones; i++) {
+    if (written[i] > 0 && written[(i + zones - 1) % zones] == 0) {
+      tail = i;
+      break;
+    }
+  }
+  if (tail == zones) {
+    tail = 0;
+    for (uint64_t i = 0; i < zones; i++) {
+      if (written[i] > 0 && written[i] < zone_cap_) {
+        tail = (i + 1) % zones;
+        break;
+      }
+    }
+  }
+  // The tail within its zone is lost, it is recovered at the zone start
+  write_tail_ = min_zone_head_ + tail * zone_cap_;
+  for (uint64_t n = 0; n < zones && written[(tail + n) % zones] > 0; n++) {
+    const uint64_t i = (tail + n) % zones;
+    zone_blocks_in_use_ += written[i];
+    write_head_ = wrapped_addr(min_zone_head_ + i * zone_cap_ + written[i]);
+    if (written[i] < zone_cap_) {
+      break;
+    }
+  }
+  return SZDStatus::Success;
+}
+
+bool SZDCircularLog::Empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return zone_blocks_in_use_ ==
+         (write_tail_ - min_zone_head_) % zone_cap_;
+}
+
+bool SZDCircularLog::SpaceLeft(const size_t size, bool alligned) const {
+  (void)alligned;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Blocks(size) <= Capacity() - zone_blocks_in_use_;
+}
+
+uint64_t SZDCircularLog::SpaceAvailable() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (Capacity() - zone_blocks_in_use_) * lba_size_;
+}
+
+uint64_t SZDCircularLog::wrapped_addr(uint64_t addr) const {
+  return addr >= max_zone_head_ ? addr - Capacity() : addr;
+}
+
+SZDFragmentedLog::SZDFragmentedLog(SZDChannelFactory* channel_factory,
+                                   const DeviceInfo& info, uint64_t min_zone,
+                                   uint64_t max_zone,
+                                   uint8_t number_of_readers,
+                                   uint8_t number_of_writers)
+    : SZDChannelLog(channel_factory, info, min_zone, max_zone,
+                    number_of_readers, number_of_writers, nullptr),
+      zone_used_(max_zone - min_zone, false),
+      zones_free_(max_zone - min_zone) {}
+
+SZDStatus SZDFragmentedLog::Append(
+    const char* data, const size_t size,
+    std::vector<std::pair<uint64_t, uint64_t>>& regions, bool alligned,
+    uint8_t writer) {
+  if (writer >= write_channels_.size()) {
+    return SZDStatus::InvalidArguments;
+  }
+  const uint64_t needed = (Blocks(size) + zone_cap_ - 1) / zone_cap_;
+  const uint64_t min_zone = min_zone_head_ / zone_cap_;
+  regions.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (needed > zones_free_) {
+      return SZDStatus::IOError;
+    }
+    // Runs of free zones, the first run that fits is used as is. Otherwise
+    // the largest runs are combined.
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    for (uint64_t i = 0; i < zone_used_.size(); i++) {
+      if (zone_used_[i]) {
+        continue;
+      }
+      if (runs.empty() || runs.back().first + runs.back().second != i) {
+        runs.emplace_back(i, 0);
+      }
+      runs.back().second++;
+    }
+    auto fit = std::find_if(runs.begin(), runs.end(),
+                            [needed](const std::pair<uint64_t, uint64_t>& r) {
+                              return r.second >= needed;
+                            });
+    if (fit != runs.end()) {
+      regions.emplace_back(fit->first, needed);
+    } else {
+      std::stable_sort(runs.begin(), runs.end(),
+                       [](const std::pair<uint64_t, uint64_t>& a,
+                          const std::pair<uint64_t, uint64_t>& b) {
+                         return a.second > b.second;
+                       });
+      uint64_t claimed = 0;
+      for (size_t i = 0; i < runs.size() && claimed < needed; i++) {
+        const uint64_t take = std::min(runs[i].second, needed - claimed);
+        regions.emplace_back(runs[i].first, take);
+        claimed += take;
+      }
+    }
+    if (regions.size() > kMaxRegions) {
+      regions.clear();
+      return SZDStatus::IOError;
+    }
+    for (auto& region : regions) {
+      for (uint64_t i = 0; i < region.second; i++) {
+        zone_used_[region.first + i] = true;
+      }
+      zones_free_ -= region.second;
+      region.first += min_zone;
+    }
+  }
+  // The zones are ours, write them without holding the lock
+  uint64_t written = 0;
+  for (const auto& region : regions) {
+    uint64_t lba = region.first * zone_cap_;
+    const uint64_t step = std::min<uint64_t>(
+        size - written, region.second * zone_cap_ * lba_size_);
+    SZDStatus s = write_channels_[writer]->DirectAppend(&lba, data + written,
+                                                        step, alligned);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+    written += step;
+  }
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDFragmentedLog::Read(
+    const std::vector<std::pair<uint64_t, uint64_t>>& regions, char* data,
+    uint64_t size, bool alligned, uint8_t reader) {
+  if (reader >= readers_) {
+    return SZDStatus::InvalidArguments;
+  }
+  uint64_t read = 0;
+  for (const auto& region : regions) {
+    if (read == size) {
+      break;
+    }
+    const uint64_t step =
+        std::min<uint64_t>(size - read, region.second * zone_cap_ * lba_size_);
+    SZDStatus s = read_channels_[reader]->DirectRead(
+        region.first * zone_cap_, data + read, step, alligned);
+    if (s != SZDStatus::Success) {
+      return s;
+    }
+    read += step;
+  }
+  return read == size ? SZDStatus::Success : SZDStatus::InvalidArguments;
+}
+
+SZDStatus SZDFragmentedLog::Reset(
+    const std::vector<std::pair<uint64_t, uint64_t>>& regions,
+    uint8_t writer) {
+  if (writer >= write_channels_.size()) {
+    return SZDStatus::InvalidArguments;
+  }
+  const uint64_t min_zone = min_zone_head_ / zone_cap_;
+  for (const auto& region : regions) {
+    if (region.first < min_zone ||
+        region.first + region.second > min_zone + zone_used_.size()) {
+      return SZDStatus::InvalidArguments;
+    }
+    for (uint64_t zone = region.first; zone < region.first + region.second;
+         zone++) {
+      SZDStatus s = write_channels_[writer]->ResetZone(zone * zone_cap_);
+      if (s != SZDStatus::Success) {
+        return s;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (zone_used_[zone - min_zone]) {
+        zone_used_[zone - min_zone] = false;
+        zones_free_++;
+      }
+    }
+  }
+  return SZDStatus::Success;
+}
+
+SZDStatus SZDFragmentedLog::ResetAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SZDStatus s = write_channels_[0]->ResetAllZones();
+  if (s != SZDStatus::Success) {
+    return s;
+  }
+  std::fill(zone_used_.begin(), zone_used_.end(), false);
+  zones_free_ = zone_used_.size();
+  return SZDStatus::Success;
+}
+
+bool SZDFragmentedLog::Empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return zones_free_ == zone_used_.size();
+}
+
+bool SZDFragmentedLog::SpaceLeft(const size_t size, bool alligned) const {
+  (void)alligned;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (Blocks(size) + zone_cap_ - 1) / zone_cap_ <= zones_free_;
+}
+
+uint64_t SZDFragmentedLog::SpaceAvailable() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return zones_free_ * zone_cap_ * lba_size_;
+}
+
+std::string SZDFragmentedLog::Encode() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Zone count followed by one bit for each zone
+  std::string out(sizeof(uint64_t) + (zone_used_.size() + 7) / 8, '\0');
+  const uint64_t zones = zone_used_.size();
+  memcpy(&out[0], &zones, sizeof(uint64_t));
+  for (uint64_t i = 0; i < zones; i++) {
+    if (zone_used_[i]) {
+      out[sizeof(uint64_t) + i / 8] |= static_cast<char>(1 << (i % 8));
+    }
+  }
+  return out;
+}
+
+SZDStatus SZDFragmentedLog::DecodeFrom(const char* data, const size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t zones;
+  if (size < sizeof(uint64_t)) {
+    return SZDStatus::InvalidArguments;
+  }
+  memcpy(&zones, data, sizeof(uint64_t));
+  if (zones != zone_used_.size() ||
+      size != sizeof(uint64_t) + (zones + 7) / 8) {
+    return SZDStatus::InvalidArguments;
+  }
+  zones_free_ = 0;
+  for (uint64_t i = 0; i < zones; i++) {
+    zone_used_[i] = (data[sizeof(uint64_t) + i / 8] >> (i % 8)) & 1;
+    zones_free_ += zone_used_[i] ? 0 : 1;
+  }
+  return SZDStatus::Success;
+}
+}  // namespace SZD
+#endif
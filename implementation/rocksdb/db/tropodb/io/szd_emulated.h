@@ -0,0 +1,398 @@
+// In-memory stand-in for the SZD (SimpleZNSDevice) API used by TropoDB. Built
+// instead of SZD with TROPODB_EMULATED_ZNS, so TropoDB and its tests run
+// without SPDK, root or ZNS hardware. Only the subset of SZD that TropoDB
+// calls is provided, with the same signatures.
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifdef TROPODB_EMULATED_ZNS
+#ifndef SZD_EMULATED_H
+#define SZD_EMULATED_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SZD {
+enum class SZDStatus {
+  Success,
+  InvalidArguments,
+  IOError,
+  DeviceError,
+  MemoryError,
+  Unknown
+};
+
+struct SZDStatusDetailed {
+  SZDStatus sc;
+  std::string msg;
+};
+
+struct DeviceInfo {
+  uint64_t lba_size;
+  uint64_t zone_size;
+  uint64_t zone_cap;
+  uint64_t mdts;
+  uint64_t zasl;
+  uint64_t lba_cap;
+  uint64_t min_lba;
+  uint64_t max_lba;
+  std::string name;
+};
+
+/**
+ * @brief Geometry of an emulated device. It is parsed from the device name,
+ * "name:zones=512,zone_cap=256,lba_size=4096,max_active=14,write_us=10,
+ * read_us=5", every option is optional. Zone size equals zone capacity.
+ */
+struct EmulatedGeometry {
+  uint64_t lba_size{4096};
+  uint64_t zone_cap{256};
+  uint64_t zones{1024};
+  uint64_t max_active_zones{0};  // 0 is unlimited
+  uint64_t write_latency_us{0};  // Added to each append
+  uint64_t read_latency_us{0};   // Added to each read
+
+  static bool Parse(const std::string& name, EmulatedGeometry* geometry);
+};
+
+/**
+ * @brief The zoned store of one emulated device. Zones are append-only: a
+ * write must start at the write pointer of its zone and can not cross the
+ * zone capacity, only a reset rewinds the write pointer. Unwritten blocks
+ * read as zeroes. Stores outlive their SZDDevice and are found again by name,
+ * so a database can be closed and reopened within the process. Thread-safe.
+ */
+class DeviceManager {
+ public:
+  DeviceManager(const std::string& name, const EmulatedGeometry& geometry);
+  DeviceManager(const DeviceManager&) = delete;
+  DeviceManager& operator=(const DeviceManager&) = delete;
+
+  const DeviceInfo& Info() const { return info_; }
+  SZDStatus Write(uint64_t slba, const char* data, uint64_t blocks);
+  SZDStatus Read(uint64_t slba, char* data, uint64_t blocks) const;
+  SZDStatus ResetZone(uint64_t zone);
+  // Blocks written to the zone
+  uint64_t WritePointer(uint64_t zone) const;
+
+ private:
+  struct Zone {
+    uint64_t wp{0};
+    std::unique_ptr<char[]> data;
+  };
+
+  const EmulatedGeometry geometry_;
+  DeviceInfo info_;
+  mutable std::mutex mutex_;
+  std::vector<Zone> zones_;
+  uint64_t active_zones_{0};
+};
+
+class SZDBuffer {
+ public:
+  SZDBuffer(size_t size, uint64_t lba_size);
+  SZDBuffer(const SZDBuffer&) = delete;
+  SZDBuffer& operator=(const SZDBuffer&) = delete;
+  ~SZDBuffer() = default;
+
+  SZDStatus GetBuffer(void** buffer) const;
+  SZDStatus ReallocBuffer(uint64_t size);
+  SZDStatus FreeBuffer();
+  size_t GetBufferSize() const { return size_; }
+
+ private:
+  const uint64_t lba_size_;
+  size_t size_;
+  std::unique_ptr<char[]> buffer_;
+};
+
+/**
+ * @brief Direct access to a zone range of the device. Appends continue in the
+ * next zone when a zone is full. Not thread-safe, like an SZD qpair.
+ */
+class SZDChannel {
+ public:
+  SZDChannel(DeviceManager* device, uint64_t min_zone, uint64_t max_zone);
+  SZDChannel(const SZDChannel&) = delete;
+  SZDChannel& operator=(const SZDChannel&) = delete;
+
+  // Writes size bytes at *lba, which is moved past the written blocks. The
+  // last block is padded with zeroes if size is not alligned.
+  SZDStatus DirectAppend(uint64_t* lba, const void* buffer, uint64_t size,
+                         bool alligned = true);
+  SZDStatus DirectRead(uint64_t lba, void* buffer, uint64_t size,
+                       bool alligned = true);
+  // Write pointer of the zone starting at slba, as an address.
+  SZDStatus ZoneHead(uint64_t slba, uint64_t* zone_head);
+  SZDStatus ResetZone(uint64_t slba);
+  SZDStatus ResetAllZones();
+
+  uint64_t GetLBASize() const { return lba_size_; }
+  uint64_t GetZoneCap() const { return zone_cap_; }
+  uint64_t GetZoneSize() const { return zone_cap_; }
+  uint64_t GetBytesWritten() const { return bytes_written_; }
+  uint64_t GetAppendOperationsCounter() const { return append_operations_; }
+  uint64_t GetBytesRead() const { return bytes_read_; }
+  uint64_t GetReadOperationsCounter() const { return read_operations_; }
+  uint64_t GetZonesResetCounter() const { return zones_reset_counter_; }
+  // Per zone of the channel range
+  std::vector<uint64_t> GetZonesReset() const { return zones_reset_; }
+  std::vector<uint64_t> GetAppendOperations() const { return zone_appends_; }
+
+ private:
+  bool InRange(uint64_t slba, uint64_t blocks) const {
+    return slba >= min_lba_ && blocks <= max_lba_ - slba;
+  }
+
+  DeviceManager* const device_;
+  const uint64_t lba_size_;
+  const uint64_t zone_cap_;
+  const uint64_t min_lba_;
+  const uint64_t max_lba_;
+  uint64_t bytes_written_{0};
+  uint64_t append_operations_{0};
+  uint64_t bytes_read_{0};
+  uint64_t read_operations_{0};
+  uint64_t zones_reset_counter_{0};
+  std::vector<uint64_t> zones_reset_;
+  std::vector<uint64_t> zone_appends_;
+};
+
+class SZDChannelFactory {
+ public:
+  SZDChannelFactory(DeviceManager* device, const uint64_t max_channels);
+  SZDChannelFactory(const SZDChannelFactory&) = delete;
+  SZDChannelFactory& operator=(const SZDChannelFactory&) = delete;
+
+  void Ref() { refs_++; }
+  // Deletes the factory when the last reference is dropped.
+  void Unref();
+  uint64_t GetRef() const { return refs_; }
+
+  SZDStatus register_channel(SZDChannel** channel, uint64_t min_zone,
+                             uint64_t max_zone,
+                             bool preserve_async_buffer = false,
+                             uint32_t queue_depth = 1);
+  SZDStatus register_channel(SZDChannel** channel);
+  SZDStatus unregister_channel(SZDChannel* channel);
+  uint64_t GetChannelCount() const { return channels_; }
+
+ private:
+  ~SZDChannelFactory() = default;
+
+  DeviceManager* const device_;
+  const uint64_t max_channels_;
+  std::atomic<uint64_t> channels_{0};
+  std::atomic<uint64_t> refs_{0};
+};
+
+class SZDDevice {
+ public:
+  explicit SZDDevice(const std::string& application_name);
+  SZDDevice(const SZDDevice&) = delete;
+  SZDDevice& operator=(const SZDDevice&) = delete;
+  ~SZDDevice() = default;
+
+  SZDStatus Init();
+  SZDStatus Reinit();
+  // Creates the store of device_name if it does not exist yet. max_zone of 0
+  // is the end of the device.
+  SZDStatus Open(const std::string& device_name, uint64_t min_zone = 0,
+                 uint64_t max_zone = 0);
+  SZDStatus Close();
+  SZDStatus GetInfo(DeviceInfo* info) const;
+  DeviceManager* GetDeviceManager() { return device_; }
+
+  // Drops the store of device_name, its data is lost. It must not be open.
+  static void DestroyEmulated(const std::string& device_name);
+
+ private:
+  const std::string application_name_;
+  DeviceManager* device_;
+  uint64_t min_zone_;
+  uint64_t max_zone_;
+};
+
+/**
+ * @brief Owns the channels of one log, one writer and one for each reader.
+ * I/O counters only count the owned channels.
+ */
+class SZDChannelLog {
+ public:
+  SZDChannelLog(SZDChannelFactory* channel_factory, const DeviceInfo& info,
+                uint64_t min_zone, uint64_t max_zone, uint8_t readers,
+                uint8_t writers, SZDChannel* borrowed_write_channel);
+  SZDChannelLog(const SZDChannelLog&) = delete;
+  SZDChannelLog& operator=(const SZDChannelLog&) = delete;
+  virtual ~SZDChannelLog();
+
+  uint8_t GetNumberOfReaders() const { return readers_; }
+  uint64_t GetBytesWritten() const;
+  uint64_t GetAppendOperationsCounter() const;
+  uint64_t GetBytesRead() const;
+  uint64_t GetReadOperationsCounter() const;
+  uint64_t GetZonesResetCounter() const;
+  std::vector<uint64_t> GetZonesReset() const;
+  std::vector<uint64_t> GetAppendOperations() const;
+
+ protected:
+  inline uint64_t Blocks(uint64_t size) const {
+    return (size + lba_size_ - 1) / lba_size_;
+  }
+
+  SZDChannelFactory* const channel_factory_;
+  const uint64_t lba_size_;
+  const uint64_t zone_cap_;
+  const uint64_t min_zone_head_;
+  const uint64_t max_zone_head_;
+  const uint8_t readers_;
+  std::vector<SZDChannel*> write_channels_;
+  std::vector<SZDChannel*> read_channels_;
+  std::vector<SZDChannel*> owned_channels_;
+  // Head and tail of the log
+  mutable std::mutex mutex_;
+};
+
+/**
+ * @brief Log interface used by the committer: an append at the head and reads
+ * by address.
+ */
+class SZDLog : public SZDChannelLog {
+ public:
+  using SZDChannelLog::SZDChannelLog;
+
+  virtual SZDStatus Append(const char* data, const size_t size,
+                           uint64_t* lbas = nullptr, bool alligned = true) = 0;
+  virtual SZDStatus Append(const SZDBuffer& buffer, size_t addr, size_t size,
+                           uint64_t* lbas = nullptr, bool alligned = true) = 0;
+  virtual SZDStatus Read(uint64_t lba, char* data, uint64_t size,
+                         bool alligned = true, uint8_t reader = 0) = 0;
+  virtual SZDStatus Read(uint64_t lba, SZDBuffer* buffer, uint64_t addr,
+                         uint64_t size, bool alligned = true,
+                         uint8_t reader = 0) = 0;
+  virtual SZDStatus ResetAll() = 0;
+  virtual SZDStatus RecoverPointers() = 0;
+  virtual bool Empty() const = 0;
+  virtual bool SpaceLeft(const size_t size, bool alligned = true) const = 0;
+  virtual uint64_t SpaceAvailable() const = 0;
+  uint64_t GetWriteHead() const;
+  uint64_t GetWriteTail() const;
+
+ protected:
+  uint64_t write_head_{0};
+  uint64_t write_tail_{0};
+};
+
+/**
+ * @brief Log that is written once from its first zone up to its last zone and
+ * then reset as a whole.
+ */
+class SZDOnceLog : public SZDLog {
+ public:
+  SZDOnceLog(SZDChannelFactory* channel_factory, const DeviceInfo& info,
+             uint64_t min_zone, uint64_t max_zone,
+             SZDChannel* borrowed_write_channel = nullptr,
+             uint8_t number_of_readers = 1);
+
+  SZDStatus Append(const char* data, const size_t size,
+                   uint64_t* lbas = nullptr, bool alligned = true) override;
+  SZDStatus Append(const SZDBuffer& buffer, size_t addr, size_t size,
+                   uint64_t* lbas = nullptr, bool alligned = true) override;
+  // Completes before returning, Sync has nothing left to wait for.
+  SZDStatus AsyncAppend(const char* data, const size_t size,
+                        uint64_t* lbas = nullptr, bool alligned = true);
+  SZDStatus Sync();
+  SZDStatus Read(uint64_t lba, char* data, uint64_t size,
+                 bool alligned = true, uint8_t reader = 0) override;
+  SZDStatus Read(uint64_t lba, SZDBuffer* buffer, uint64_t addr,
+                 uint64_t size, bool alligned = true,
+                 uint8_t reader = 0) override;
+  SZDStatus ReadAll(std::string& out);
+  SZDStatus ResetAll() override;
+  SZDStatus RecoverPointers() override;
+  SZDStatus MarkInactive();
+  bool Empty() const override;
+  bool SpaceLeft(const size_t size, bool alligned = true) const override;
+  uint64_t SpaceAvailable() const override;
+};
+
+/**
+ * @brief Log that wraps around its zones. The tail is consumed from the front
+ * and zones are reset once the tail passed them, so the head can only write
+ * zones that have been reset.
+ */
+class SZDCircularLog : public SZDLog {
+ public:
+  SZDCircularLog(SZDChannelFactory* channel_factory, const DeviceInfo& info,
+                 uint64_t min_zone, uint64_t max_zone,
+                 uint8_t number_of_readers = 1);
+
+  SZDStatus Append(const char* data, const size_t size,
+                   uint64_t* lbas = nullptr, bool alligned = true) override;
+  SZDStatus Append(const SZDBuffer& buffer, size_t addr, size_t size,
+                   uint64_t* lbas = nullptr, bool alligned = true) override;
+  SZDStatus Read(uint64_t lba, char* data, uint64_t size,
+                 bool alligned = true, uint8_t reader = 0) override;
+  SZDStatus Read(uint64_t lba, SZDBuffer* buffer, uint64_t addr,
+                 uint64_t size, bool alligned = true,
+                 uint8_t reader = 0) override;
+  // Moves the tail from begin_lba (the current tail) to end_lba.
+  SZDStatus ConsumeTail(uint64_t begin_lba, uint64_t end_lba);
+  SZDStatus ResetAll() override;
+  SZDStatus RecoverPointers() override;
+  bool Empty() const override;
+  bool SpaceLeft(const size_t size, bool alligned = true) const override;
+  uint64_t SpaceAvailable() const override;
+  uint64_t wrapped_addr(uint64_t addr) const;
+
+ private:
+  inline uint64_t Capacity() const { return max_zone_head_ - min_zone_head_; }
+  // Blocks from the start of the tail zone up to the head, these can not be
+  // written until the tail moves on.
+  uint64_t zone_blocks_in_use_{0};
+};
+
+/**
+ * @brief Log of whole zones. Each append claims free zones, possibly spread
+ * over multiple regions of adjacent zones, and each region is given back on
+ * reset. Regions are pairs of first zone and number of zones.
+ */
+class SZDFragmentedLog : public SZDChannelLog {
+ public:
+  SZDFragmentedLog(SZDChannelFactory* channel_factory, const DeviceInfo& info,
+                   uint64_t min_zone, uint64_t max_zone,
+                   uint8_t number_of_readers = 1,
+                   uint8_t number_of_writers = 1);
+
+  SZDStatus Append(const char* data, const size_t size,
+                   std::vector<std::pair<uint64_t, uint64_t>>& regions,
+                   bool alligned = true, uint8_t writer = 0);
+  SZDStatus Read(const std::vector<std::pair<uint64_t, uint64_t>>& regions,
+                 char* data, uint64_t size, bool alligned = true,
+                 uint8_t reader = 0);
+  SZDStatus Reset(const std::vector<std::pair<uint64_t, uint64_t>>& regions,
+                  uint8_t writer = 0);
+  SZDStatus ResetAll();
+  bool Empty() const;
+  bool SpaceLeft(const size_t size, bool alligned = true) const;
+  uint64_t SpaceAvailable() const;
+  // The free zones are persisted by the user of the log.
+  std::string Encode();
+  SZDStatus DecodeFrom(const char* data, const size_t size);
+
+ private:
+  static constexpr size_t kMaxRegions = 8;
+
+  std::vector<bool> zone_used_;
+  uint64_t zones_free_;
+};
+}  // namespace SZD
+
+#endif
+#endif
+#endif
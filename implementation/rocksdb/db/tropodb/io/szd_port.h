@@ -4,6 +4,9 @@
 #ifdef TROPODB_PLUGIN_ENABLED
 #ifndef SZD_PORT_H
 #define SZD_PORT_H
+#ifdef TROPODB_EMULATED_ZNS
+#include "db/tropodb/io/szd_emulated.h"
+#else
 #include <szd/datastructures/szd_buffer.hpp>
 #include <szd/datastructures/szd_circular_log.hpp>
 #include <szd/datastructures/szd_fragmented_log.hpp>
@@ -12,6 +15,7 @@
 #include <szd/szd_channel.hpp>
 #include <szd/szd_channel_factory.hpp>
 #include <szd/szd_device.hpp>
+#endif
 
 #include "rocksdb/status.h"
 
@@ -0,0 +1,67 @@
+#include "db/tropodb/io/szd_shared_device.h"
+
+#include <map>
+
+#include "db/tropodb/tropodb_config.h"
+#include "db/tropodb/utils/tropodb_logger.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+struct SharedDevice {
+  SZD::SZDDevice* device;
+  SZD::SZDChannelFactory* channel_factory;
+  size_t refs;
+};
+
+port::Mutex shared_devices_mutex;
+std::map<std::string, SharedDevice> shared_devices;
+}  // namespace
+
+Status OpenSharedZNSDevice(const std::string& application,
+                           const std::string& device_name,
+                           SZD::SZDDevice** device,
+                           SZD::SZDChannelFactory** channel_factory) {
+  MutexLock l(&shared_devices_mutex);
+  auto it = shared_devices.find(device_name);
+  if (it == shared_devices.end()) {
+    SZD::SZDDevice* zns_device = new SZD::SZDDevice(application);
+    Status s = FromStatus(zns_device->Init());
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: SPDK will not init. Are you root?\n");
+      delete zns_device;
+      return Status::IOError("Error opening SPDK");
+    }
+    s = FromStatus(zns_device->Open(device_name, TropoDBConfig::min_zone,
+                                    TropoDBConfig::max_zone));
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: SZD device %s does not open. Is it ZNS?\n",
+                      device_name.c_str());
+      delete zns_device;
+      return Status::IOError("Error opening ZNS device");
+    }
+    SZD::SZDChannelFactory* factory = new SZD::SZDChannelFactory(
+        zns_device->GetDeviceManager(), TropoDBConfig::max_channels);
+    factory->Ref();
+    it = shared_devices
+             .emplace(device_name, SharedDevice{zns_device, factory, 0})
+             .first;
+  }
+  it->second.refs++;
+  *device = it->second.device;
+  *channel_factory = it->second.channel_factory;
+  return Status::OK();
+}
+
+void CloseSharedZNSDevice(const std::string& device_name) {
+  MutexLock l(&shared_devices_mutex);
+  auto it = shared_devices.find(device_name);
+  if (it == shared_devices.end() || --it->second.refs > 0) {
+    return;
+  }
+  it->second.channel_factory->Unref();
+  delete it->second.device;
+  shared_devices.erase(it);
+}
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,25 @@
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef SZD_SHARED_DEVICE_H
+#define SZD_SHARED_DEVICE_H
+
+#include <string>
+
+#include "db/tropodb/io/szd_port.h"
+#include "rocksdb/status.h"
+
+namespace ROCKSDB_NAMESPACE {
+/**
+ * @brief Devices are opened (and SPDK initialised) once per process. All
+ * databases on a device share its SZDDevice and SZDChannelFactory, each
+ * database only uses its own zone range. Thread-safe.
+ */
+Status OpenSharedZNSDevice(const std::string& application,
+                           const std::string& device_name,
+                           SZD::SZDDevice** device,
+                           SZD::SZDChannelFactory** channel_factory);
+// Closes the device when the last database releases it.
+void CloseSharedZNSDevice(const std::string& device_name);
+}  // namespace ROCKSDB_NAMESPACE
+#endif
+#endif
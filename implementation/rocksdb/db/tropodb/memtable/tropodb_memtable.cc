@@ -3,15 +3,24 @@
 #include "db/column_family.h"
 #include "db/memtable.h"
 #include "db/merge_context.h"
+#include "db/range_tombstone_fragmenter.h"
 #include "db/tropodb/utils/tropodb_logger.h"
 #include "options/cf_options.h"
 #include "table/internal_iterator.h"
 
 namespace ROCKSDB_NAMESPACE {
+static ColumnFamilyOptions MemtableCFOptions(
+    std::shared_ptr<MergeOperator> merge_operator) {
+  ColumnFamilyOptions cf_options;
+  cf_options.merge_operator = merge_operator;
+  return cf_options;
+}
+
 TropoMemtable::TropoMemtable(const DBOptions& db_options,
                              const InternalKeyComparator& ikc,
-                             const size_t buffer_size)
-    : options_(db_options, ColumnFamilyOptions()),
+                             const size_t buffer_size,
+                             std::shared_ptr<MergeOperator> merge_operator)
+    : options_(db_options, MemtableCFOptions(merge_operator)),
       ioptions_(options_),
       write_buffer_size_(buffer_size),
       wb_(buffer_size),
@@ -35,13 +44,39 @@ Status TropoMemtable::Write(const WriteOptions& options, WriteBatch* updates) {
 }
 
 bool TropoMemtable::Get(const ReadOptions& options, const LookupKey& lkey,
-                        std::string* value, Status* s, SequenceNumber* seq) {
+                        std::string* value, Status* s, SequenceNumber* seq,
+                        SequenceNumber* max_covering_tombstone_seq,
+                        MergeContext* merge_context, bool do_merge) {
   ReadOptions roptions;
-  SequenceNumber max_covering_tombstone_seq = 0;
-  MergeContext merge_context;
-  return mem_->GetMemTable()->Get(lkey, value, /*timestamp=*/nullptr, s,
-                                  &merge_context, &max_covering_tombstone_seq,
-                                  seq, roptions);
+  SequenceNumber local_seq = kMaxSequenceNumber;
+  if (seq == nullptr) {
+    seq = &local_seq;
+  }
+  SequenceNumber local_max_covering_tombstone_seq = 0;
+  if (max_covering_tombstone_seq == nullptr) {
+    max_covering_tombstone_seq = &local_max_covering_tombstone_seq;
+  }
+  MergeContext local_merge_context;
+  if (merge_context == nullptr) {
+    merge_context = &local_merge_context;
+  }
+  return mem_->GetMemTable()->Get(
+      lkey, value, /*timestamp=*/nullptr, s, merge_context,
+      max_covering_tombstone_seq, seq, roptions, /*callback=*/nullptr,
+      /*is_blob_index=*/nullptr, do_merge);
+}
+
+void TropoMemtable::GetRangeTombstones(
+    std::vector<TropoRangeTombstone>* tombstones) {
+  std::unique_ptr<FragmentedRangeTombstoneIterator> it(
+      mem_->GetMemTable()->NewRangeTombstoneIterator(ReadOptions(),
+                                                     kMaxSequenceNumber));
+  if (it == nullptr) {
+    return;
+  }
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    tombstones->emplace_back(it->start_key(), it->end_key(), it->seq());
+  }
 }
 
 bool TropoMemtable::ShouldScheduleFlush() {
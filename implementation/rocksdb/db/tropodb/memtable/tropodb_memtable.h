@@ -4,8 +4,10 @@
 #define TROPODB_MEMTABLE_H
 
 #include "db/memtable.h"
+#include "db/merge_context.h"
 #include "db/write_batch_internal.h"
 #include "db/tropodb/ref_counter.h"
+#include "db/tropodb/table/tropodb_zonemetadata.h"
 #include "rocksdb/options.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
@@ -16,17 +18,34 @@ namespace ROCKSDB_NAMESPACE {
 class TropoMemtable : public RefCounter {
  public:
   TropoMemtable(const DBOptions& options, const InternalKeyComparator& ikc,
-              const size_t buffer_size);
+              const size_t buffer_size,
+              std::shared_ptr<MergeOperator> merge_operator = nullptr);
   ~TropoMemtable();
   Status Write(const WriteOptions& options, WriteBatch* updates);
+  // max_covering_tombstone_seq is raised to the newest range tombstone in this
+  // memtable that covers key, even when no entry is found. Merge operands are
+  // gathered in merge_context, pass *s = MergeInProgress to continue a chain
+  // from a newer memtable. Without do_merge the operands are not merged.
   bool Get(const ReadOptions& options, const LookupKey& key, std::string* value,
-           Status* s, SequenceNumber* seq = nullptr);
+           Status* s, SequenceNumber* seq = nullptr,
+           SequenceNumber* max_covering_tombstone_seq = nullptr,
+           MergeContext* merge_context = nullptr, bool do_merge = true);
   bool ShouldScheduleFlush();
   InternalIterator* NewIterator();
+  void GetRangeTombstones(std::vector<TropoRangeTombstone>* tombstones);
+  inline const InternalKeyComparator& GetInternalKeyComparator() {
+    return this->mem_->GetMemTable()->GetInternalKeyComparator();
+  }
   // not thread safe
   inline uint64_t GetInternalSize() {
     return this->mem_->GetMemTable()->get_data_size();
   }
+  inline uint64_t GetNumEntries() {
+    return this->mem_->GetMemTable()->num_entries();
+  }
+  inline size_t GetMemoryUsage() {
+    return this->mem_->GetMemTable()->ApproximateMemoryUsage();
+  }
 
  private:
   // Meta
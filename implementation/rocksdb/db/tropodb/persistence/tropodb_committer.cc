@@ -40,6 +40,18 @@ TropoCommitter::TropoCommitter(SZD::SZDLog* log, const SZD::DeviceInfo& info,
   }
 }
 
+TropoCommitter::TropoCommitter(const SZD::DeviceInfo& info)
+    : zone_cap_(info.zone_cap),
+      lba_size_(info.lba_size),
+      zasl_(info.zasl),
+      number_of_readers_(0),
+      log_(nullptr),
+      read_buffer_(nullptr),
+      write_buffer_(0, info.lba_size),
+      keep_buffer_(false) {
+  InitTypeCrc(type_crc_);
+}
+
 TropoCommitter::~TropoCommitter() {
   for (uint8_t i = 0; i < number_of_readers_; i++) {
     delete read_buffer_[i];
@@ -51,6 +51,8 @@ struct TropoCommitReaderString {
 class TropoCommitter {
  public:
   TropoCommitter(SZD::SZDLog* log, const SZD::DeviceInfo& info, bool keep_buffer);
+  // Without a log, only CommitToCharArray and the string readers can be used.
+  explicit TropoCommitter(const SZD::DeviceInfo& info);
   // No copying or implicits
   TropoCommitter(const TropoCommitter&) = delete;
   TropoCommitter& operator=(const TropoCommitter&) = delete;
@@ -17,6 +17,7 @@
 #include "rocksdb/status.h"
 #include "rocksdb/types.h"
 #include "rocksdb/write_batch.h"
+#include "test_util/sync_point.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 
@@ -203,6 +204,7 @@ Status TropoWAL::Append(const Slice& data, uint64_t seq, bool sync) {
     return s;
   }
   prepare_append_perf_counter_.AddTiming(clock_->NowMicros() - before);
+  TEST_SYNC_POINT("TropoWAL::Append:BeforeWrite");
 
   if (sync) {
     s = DirectAppend(Slice(out, space_needed));
@@ -363,6 +365,7 @@ Status TropoWAL::ReplayOrdered(TropoMemtable* mem, SequenceNumber* seq) {
 Status TropoWAL::Reset() {
   TROPO_LOG_DEBUG("DEBUG: WAL: Resetting WAL\n");
   uint64_t before = clock_->NowMicros();
+  TEST_SYNC_POINT("TropoWAL::Reset:BeforeReset");
   Status s = FromStatus(log_.ResetAll());
   sequence_nr_ = 0;
   reset_perf_counter_.AddTiming(clock_->NowMicros() - before);
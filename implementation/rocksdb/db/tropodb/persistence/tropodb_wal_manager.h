@@ -27,6 +27,11 @@ class TropoWALManager : public RefCounter {
   ~TropoWALManager();
 
   bool WALAvailable();
+  size_t FreeWALs();
+  // Same, for a given head and tail. The WAL right before the tail is never
+  // handed out, so that the head can not run into the tail.
+  static bool WALAvailable(const size_t head, const size_t tail);
+  static size_t FreeWALs(const size_t head, const size_t tail);
   TropoWAL* GetCurrentWAL(port::Mutex* mutex_);
   Status NewWAL(port::Mutex* mutex_, TropoWAL** wal);
   Status ResetOldWALs(port::Mutex* mutex_);
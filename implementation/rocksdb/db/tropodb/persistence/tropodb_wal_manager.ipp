@@ -70,16 +70,35 @@ TropoWALManager<N>::~TropoWALManager() {
 
 template <std::size_t N>
 bool TropoWALManager<N>::WALAvailable() {
+  return WALAvailable(wal_head_, wal_tail_);
+}
+
+template <std::size_t N>
+bool TropoWALManager<N>::WALAvailable(const size_t head, const size_t tail) {
   // not allowed to happen
-  if (wal_head_ == wal_tail_) {
+  if (head == tail) {
     assert(false);
     return false;
     // [vvT..Hvvvv]
-  } else if (wal_head_ > wal_tail_) {
-    return N > wal_head_ || wal_tail_ > 0;
+  } else if (head > tail) {
+    return N > head + 1 || tail > 0;
   } else {
-    return wal_tail_ > wal_head_ + 1;
+    return tail > head + 1;
+  }
+}
+
+template <std::size_t N>
+size_t TropoWALManager<N>::FreeWALs() {
+  return FreeWALs(wal_head_, wal_tail_);
+}
+
+template <std::size_t N>
+size_t TropoWALManager<N>::FreeWALs(const size_t head, const size_t tail) {
+  if (head == tail) {
+    return 0;
   }
+  // As in WALAvailable, the WAL right before the tail is never handed out
+  return (tail + N - head - 1) % N;
 }
 
 template <std::size_t N>
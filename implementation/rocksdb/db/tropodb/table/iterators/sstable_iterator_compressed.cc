@@ -44,8 +44,8 @@ void SSTableIteratorCompressed::Prev() {
   const uint64_t original = current_;
   while (GetRestartPoint(restart_index_) >= original) {
     if (restart_index_ == 0) {
-      // No more entries
-      current_ = kv_pairs_offset_;
+      // No more entries, mark as invalid
+      current_ = data_size_;
       restart_index_ = 0;
       return;
     }
@@ -70,7 +70,7 @@ void SSTableIteratorCompressed::SeekToFirst() {
 
 void SSTableIteratorCompressed::SeekToLast() {
   SeekToRestartPoint(num_restarts_ - 1);
-  while (ParseNextKey() && NextEntryOffset() <= data_size_) {
+  while (ParseNextKey() && NextEntryOffset() < data_size_) {
     // Keep skipping
   }
 }
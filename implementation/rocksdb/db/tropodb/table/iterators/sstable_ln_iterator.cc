@@ -1,5 +1,7 @@
 #include "db/tropodb/table/iterators/sstable_ln_iterator.h"
 
+#include <algorithm>
+
 #include "db/dbformat.h"
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/table/tropodb_sstable_manager.h"
@@ -30,6 +32,8 @@ std::pair<SSZoneMetaData, uint8_t> LNZoneIterator::DecodeLNIterator(
       DecodeFixed8(file_value.data() + 9 + 16 * meta.LN.lba_regions);
   uint64_t number =
       DecodeFixed64(file_value.data() + 10 + 16 * meta.LN.lba_regions);
+  meta.LN.device =
+      DecodeFixed8(file_value.data() + 18 + 16 * meta.LN.lba_regions);
   meta.lba_count = lba_count;
   meta.number = number;
   return {meta, level};
@@ -51,6 +55,8 @@ Slice LNZoneIterator::value() const {
   EncodeFixed8(value_buf_ + 9 + 16 * (*slist_)[index_]->LN.lba_regions, level_);
   EncodeFixed64(value_buf_ + 10 + 16 * (*slist_)[index_]->LN.lba_regions,
                 (*slist_)[index_]->number);
+  EncodeFixed8(value_buf_ + 18 + 16 * (*slist_)[index_]->LN.lba_regions,
+               (*slist_)[index_]->LN.device);
   // Note that there can be some padding of 0s at the end
   return Slice(value_buf_, sizeof(value_buf_));
 }
@@ -110,15 +116,34 @@ static void LNZonePrefetcher(void* prefetch) {
       break;
     }
 
-    // Get more iterators
+    // Get more iterators, in a batch the free prefetch slots are all read
+    // concurrently.
     {
-      std::string handle = zone_prefetcher->its[zone_prefetcher->index_].first;
+      const size_t from = zone_prefetcher->index_;
+      size_t to = from + 1;
+      if (zone_prefetcher->zonesfunc_ != nullptr) {
+        to = std::min(zone_prefetcher->its.size(),
+                      zone_prefetcher->tail_read_ +
+                          TropoDBConfig::compaction_maximum_prefetches + 1);
+      }
+      std::vector<std::string> handles;
+      for (size_t i = from; i < to; i++) {
+        handles.push_back(zone_prefetcher->its[i].first);
+      }
       zone_prefetcher->mut_.Unlock();
-      Iterator* iter = (*(zone_prefetcher->zonefunc_))(
-          zone_prefetcher->arg_, Slice(handle), zone_prefetcher->cmp_);
+      std::vector<Iterator*> iters;
+      if (zone_prefetcher->zonesfunc_ != nullptr) {
+        (*(zone_prefetcher->zonesfunc_))(zone_prefetcher->arg_, handles,
+                                         zone_prefetcher->cmp_, &iters);
+      } else {
+        iters.push_back((*(zone_prefetcher->zonefunc_))(
+            zone_prefetcher->arg_, Slice(handles[0]), zone_prefetcher->cmp_));
+      }
       zone_prefetcher->mut_.Lock();
-      zone_prefetcher->its[zone_prefetcher->index_].second = iter;
-      zone_prefetcher->index_++;
+      for (size_t i = 0; i < iters.size(); i++) {
+        zone_prefetcher->its[from + i].second = iters[i];
+      }
+      zone_prefetcher->index_ = to;
     }
 
     // Allow the prefetch boss to continue
@@ -134,7 +159,8 @@ static void LNZonePrefetcher(void* prefetch) {
 
 LNIterator::LNIterator(Iterator* ln_iterator,
                        NewZoneIteratorFunction zone_function, void* arg,
-                       const Comparator* cmp, Env* env)
+                       const Comparator* cmp, Env* env,
+                       NewZoneIteratorsFunction zones_function)
     : zone_function_(zone_function),
       arg_(arg),
       index_iter_(ln_iterator),
@@ -156,6 +182,7 @@ LNIterator::LNIterator(Iterator* ln_iterator,
       prefetcher_.arg_ = arg_;
       prefetcher_.cmp_ = cmp_;
       prefetcher_.zonefunc_ = zone_function_;
+      prefetcher_.zonesfunc_ = zones_function;
       env_->Schedule(&LNZonePrefetcher, &(this->prefetcher_),
                      rocksdb::Env::LOW);
       prefetching_ = true;
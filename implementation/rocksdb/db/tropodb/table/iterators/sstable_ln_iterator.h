@@ -54,6 +54,12 @@ class LNZoneIterator : public Iterator {
 
 typedef Iterator* (*NewZoneIteratorFunction)(void*, const Slice&,
                                              const Comparator*);
+// Creates the iterators of multiple zones at once, so they can be read
+// concurrently.
+typedef void (*NewZoneIteratorsFunction)(void*,
+                                         const std::vector<std::string>&,
+                                         const Comparator*,
+                                         std::vector<Iterator*>*);
 
 struct ZonePrefetcher {
   port::Mutex mut_;
@@ -67,13 +73,15 @@ struct ZonePrefetcher {
   void* arg_;
   const Comparator* cmp_;
   NewZoneIteratorFunction zonefunc_;
+  NewZoneIteratorsFunction zonesfunc_{nullptr};
   ZonePrefetcher() : waiting_(&mut_) {}
 };
 
 class LNIterator : public Iterator {
  public:
   LNIterator(Iterator* ln_iterator, NewZoneIteratorFunction zone_function,
-             void* arg, const Comparator* cmp, Env* env = nullptr);
+             void* arg, const Comparator* cmp, Env* env = nullptr,
+             NewZoneIteratorsFunction zones_function = nullptr);
   ~LNIterator() override;
   bool Valid() const override { return data_iter_.Valid(); }
   Slice key() const override {
@@ -1,5 +1,7 @@
 #include "db/tropodb/table/tropodb_l0_sstable.h"
 
+#include <algorithm>
+
 #include "db/tropodb/io/szd_port.h"
 #include "db/tropodb/table/iterators/sstable_iterator.h"
 #include "db/tropodb/table/iterators/sstable_iterator_compressed.h"
@@ -8,26 +10,23 @@
 #include "db/tropodb/table/tropodb_sstable_reader.h"
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/utils/tropodb_logger.h"
+#include "memory/arena.h"
+#include "table/merging_iterator.h"
 
 namespace ROCKSDB_NAMESPACE {
 
 TropoL0SSTable::TropoL0SSTable(SZD::SZDChannelFactory* channel_factory,
                                const SZD::DeviceInfo& info,
                                const uint64_t min_zone_nr,
-                               const uint64_t max_zone_nr)
-    : TropoSSTable(channel_factory, info, min_zone_nr, max_zone_nr),
-      log_(channel_factory_, info, min_zone_nr, max_zone_nr,
-           TropoDBConfig::number_of_concurrent_L0_readers),
+                               const uint64_t max_zone_nr,
+                               const uint8_t readers)
+    : TropoSSTable(channel_factory, info, min_zone_nr, max_zone_nr, readers),
+      log_(channel_factory_, info, min_zone_nr, max_zone_nr, readers),
       zasl_(info.zasl),
       lba_size_(info.lba_size),
       zone_size_(info.zone_size),
-      cv_(&mutex_),
-      clock_(SystemClock::Default().get()) {
-  // unset
-  for (uint8_t i = 0; i < TropoDBConfig::number_of_concurrent_L0_readers; i++) {
-    read_queue_[i] = 0;
-  }
-}
+      readers_(readers),
+      clock_(SystemClock::Default().get()) {}
 
 TropoL0SSTable::~TropoL0SSTable() = default;
 
@@ -35,7 +34,8 @@ Status TropoL0SSTable::Recover() { return FromStatus(log_.RecoverPointers()); }
 
 TropoSSTableBuilder* TropoL0SSTable::NewBuilder(SSZoneMetaData* meta) {
   return new TropoSSTableBuilder(this, meta,
-                                 TropoDBConfig::use_sstable_encoding);
+                                 TropoDBConfig::use_sstable_encoding, -1,
+                                 prefix_extractor_);
 }
 
 bool TropoL0SSTable::EnoughSpaceAvailable(const Slice& slice) const {
@@ -53,6 +53,8 @@ Status TropoL0SSTable::WriteSSTable(const Slice& content,
     TROPO_LOG_ERROR("ERROR: L0 SSTable: Out of space\n");
     return Status::IOError("Not enough space available for L0");
   }
+  // L0 is only written by flushes
+  ChargeWrite(content.size(), Env::IO_HIGH);
   meta->L0.lba = log_.GetWriteHead();
   Status s = FromStatus(
       log_.Append(content.data(), content.size(), &meta->lba_count, false));
@@ -131,7 +133,8 @@ Status TropoL0SSTable::FlushSSTable(TropoSSTableBuilder** builder,
 
     return s;
   } else {
-    // Flush manually
+    // Flush manually, ranges of the same flush share the log and metas
+    MutexLock l(&flush_write_mutex_);
     s = current_builder->Flush();
     if (!s.ok()) {
       TROPO_LOG_ERROR("ERROR: Compaction: Error writing table\n");
@@ -144,77 +147,235 @@ Status TropoL0SSTable::FlushSSTable(TropoSSTableBuilder** builder,
   }
 }
 
-Status TropoL0SSTable::FlushMemTable(TropoMemtable* mem,
-                                     std::vector<SSZoneMetaData>& metas,
-                                     uint8_t parallel_number, Env* env) {
+InternalIterator* TropoL0SSTable::NewFlushIterator(
+    const std::vector<TropoMemtable*>& mems, Arena* arena) {
+  std::vector<InternalIterator*> children;
+  for (auto mem : mems) {
+    children.push_back(mem->NewIterator());
+  }
+  return NewMergingIterator(&mems[0]->GetInternalKeyComparator(),
+                            children.data(),
+                            static_cast<int>(children.size()), arena);
+}
+
+void TropoL0SSTable::SplitMemTables(const std::vector<TropoMemtable*>& mems,
+                                    uint64_t size, size_t ranges, Arena* arena,
+                                    std::vector<std::string>* starts) {
+  const uint64_t target = size / ranges;
+  const Comparator* ucmp =
+      mems[0]->GetInternalKeyComparator().user_comparator();
+  uint64_t bytes = 0;
+  bool full = false;
+  std::string last_user_key;
+  InternalIterator* iter = NewFlushIterator(mems, arena);
+  for (iter->SeekToFirst(); iter->Valid() && starts->size() + 1 < ranges;
+       iter->Next()) {
+    const Slice key = iter->key();
+    if (full && ucmp->Compare(ExtractUserKey(key), last_user_key) != 0) {
+      starts->push_back(key.ToString());
+      bytes = 0;
+      full = false;
+    }
+    bytes += key.size() + iter->value().size();
+    if (!full && bytes >= target) {
+      last_user_key = ExtractUserKey(key).ToString();
+      full = true;
+    }
+  }
+  // Iterators live in arenas
+  iter->~InternalIterator();
+}
+
+void TropoL0SSTable::FlushRangeWork(void* arg) {
+  FlushRange* range = reinterpret_cast<FlushRange*>(arg);
+  Status s = range->sstable_->FlushRangeOf(range);
+  range->mutex_->Lock();
+  range->status_ = s;
+  range->done_ = true;
+  range->done_signal_->SignalAll();
+  range->mutex_->Unlock();
+}
+
+Status TropoL0SSTable::FlushRangeOf(FlushRange* range) {
   Status s = Status::OK();
-  std::vector<SSZoneMetaData*> new_metas;
+  std::vector<SSZoneMetaData*>& new_metas = range->new_metas_;
+  std::vector<SSZoneMetaData>& metas = *range->metas_;
   new_metas.push_back(new SSZoneMetaData);
-  TropoSSTableBuilder* builder;
+  TropoSSTableBuilder* builder = NewBuilder(new_metas[new_metas.size() - 1]);
 
   uint64_t before = clock_->NowMicros();
-  // Spawn worker threads if needed
-  if (TropoDBConfig::flushes_allow_deferring_writes) {
-    deferred_.metas_ = &metas;
-    deferred_.index_ = 0;
-    deferred_.last_ = false;
-    deferred_.done_ = false;
-    deferred_.deferred_builds_.clear();
-    env->Schedule(&TropoL0SSTable::DeferFlushWrite, &(this->deferred_),
-                  rocksdb::Env::LOW);
+  InternalIterator* iter = range->iter_;
+  if (range->begin_.empty()) {
+    iter->SeekToFirst();
+  } else {
+    iter->Seek(range->begin_);
   }
-  builder = NewBuilder(new_metas[new_metas.size() - 1]);
-
-  // Setup iterator
-  InternalIterator* iter = mem->NewIterator();
-  iter->SeekToFirst();
-  if (!iter->Valid()) {
-    TROPO_LOG_ERROR("ERROR: L0 SSTable: No valid iterator\n");
-    return Status::Corruption("No valid iterator in the memtable");
+  // Every table gets the part of the tombstones in [lower, upper) of its
+  // user keys, so tables of one flush do not overlap. A table ends where the
+  // next one starts, the first and last follow the range.
+  const Comparator* ucmp = range->icmp_->user_comparator();
+  std::string lower;
+  bool has_lower = !range->begin_.empty();
+  if (has_lower) {
+    lower = ExtractUserKey(range->begin_).ToString();
   }
-  flush_prepare_perf_counter_.AddTiming(clock_->NowMicros() - before);
-
-  before = clock_->NowMicros();
-  // Iterate over SSTable iterator, merge and write
+  auto add_tombstones = [&](const Slice* upper) {
+    if (range->tombstones_ == nullptr) {
+      return;
+    }
+    Slice lower_slice(lower);
+    std::vector<TropoRangeTombstone> clipped;
+    ClipRangeTombstones(ucmp, *range->tombstones_,
+                        has_lower ? &lower_slice : nullptr, upper, &clipped);
+    for (const auto& tombstone : clipped) {
+      builder->AddRangeTombstone(*range->icmp_, tombstone);
+    }
+  };
+  // Writes the current table and starts the next one at next_user_key
+  auto cut = [&](const Slice& next_user_key) -> Status {
+    add_tombstones(&next_user_key);
+    lower = next_user_key.ToString();
+    has_lower = true;
+    builder->Finalise();
+    flush_merge_perf_counter_.AddTiming(clock_->NowMicros() - before);
+    before = clock_->NowMicros();
+    Status fs = FlushSSTable(&builder, new_metas, metas);
+    // Create a new task to do in the main thread
+    new_metas.push_back(new SSZoneMetaData);
+    builder = NewBuilder(new_metas[new_metas.size() - 1]);
+    flush_write_perf_counter_.AddTiming(clock_->NowMicros() - before);
+    if (!fs.ok()) {
+      TROPO_LOG_ERROR("ERROR: L0 SSTable: Error flushing table\n");
+    }
+    before = clock_->NowMicros();
+    return fs;
+  };
+  // Iterate over SSTable iterator, merge and write. A full table is only cut
+  // once the next key is known, as that key bounds its tombstones.
+  bool full = false;
   for (; iter->Valid(); iter->Next()) {
     const Slice& key = iter->key();
     const Slice& value = iter->value();
-    s = builder->Apply(key, value);
-    // Swap if necessary, we do not want enormous L0 -> L1 compactions.
-    if ((builder->GetSize() + builder->EstimateSizeImpact(key, value) +
-         lba_size_ - 1) /
-            lba_size_ >=
-        (TropoDBConfig::max_bytes_sstable_l0 + lba_size_ - 1) / lba_size_) {
-      builder->Finalise();
-      flush_merge_perf_counter_.AddTiming(clock_->NowMicros() - before);
-      before = clock_->NowMicros();
-      s = FlushSSTable(&builder, new_metas, metas);
-      // Create a new task to do in the main thread
-      new_metas.push_back(new SSZoneMetaData);
-      builder = NewBuilder(new_metas[new_metas.size() - 1]);
-      flush_write_perf_counter_.AddTiming(clock_->NowMicros() - before);
+    if (!range->end_.empty() && range->icmp_->Compare(key, range->end_) >= 0) {
+      break;
+    }
+    if (full || builder->CrossesFamily(key)) {
+      s = cut(ExtractUserKey(key));
+      full = false;
       if (!s.ok()) {
-        TROPO_LOG_ERROR("ERROR: L0 SSTable: Error flushing table\n");
         break;
       }
-      before = clock_->NowMicros();
     }
+    s = builder->Apply(key, value);
+    // Swap if necessary, we do not want enormous L0 -> L1 compactions.
+    full = (builder->GetSize() + builder->EstimateSizeImpact(key, value) +
+            lba_size_ - 1) /
+               lba_size_ >=
+           (TropoDBConfig::max_bytes_sstable_l0 + lba_size_ - 1) / lba_size_;
   }
 
   // Now write the last remaining SSTable to storage
-  if (s.ok() && builder->GetSize() > 0) {
+  if (range->end_.empty()) {
+    add_tombstones(nullptr);
+  } else {
+    const Slice upper = ExtractUserKey(range->end_);
+    add_tombstones(&upper);
+  }
+  if (s.ok() && (builder->GetSize() > 0 || builder->HasRangeTombstones())) {
     s = builder->Finalise();
     flush_merge_perf_counter_.AddTiming(clock_->NowMicros() - before);
     before = clock_->NowMicros();
     s = FlushSSTable(&builder, new_metas, metas);
-    // Create a new task to do in the main thread
-    new_metas.push_back(new SSZoneMetaData);
-    builder = NewBuilder(new_metas[new_metas.size() - 1]);
     if (!s.ok()) {
       TROPO_LOG_ERROR("ERROR: L0 SSTable: Error flushing table\n");
     }
     flush_write_perf_counter_.AddTiming(clock_->NowMicros() - before);
+  } else {
+    delete builder;
   }
+  return s;
+}
+
+Status TropoL0SSTable::FlushMemTable(TropoMemtable* mem,
+                                     std::vector<SSZoneMetaData>& metas,
+                                     uint8_t parallel_number, Env* env) {
+  return FlushMemTables({mem}, metas, parallel_number, env);
+}
+
+Status TropoL0SSTable::FlushMemTables(const std::vector<TropoMemtable*>& mems,
+                                      std::vector<SSZoneMetaData>& metas,
+                                      uint8_t parallel_number, Env* env) {
+  Status s = Status::OK();
+
+  uint64_t before = clock_->NowMicros();
+  // Range tombstones are clipped to the tables of this flush
+  std::vector<TropoRangeTombstone> tombstones;
+  uint64_t entries = 0;
+  uint64_t size = 0;
+  for (auto mem : mems) {
+    mem->GetRangeTombstones(&tombstones);
+    entries += mem->GetNumEntries();
+    size += mem->GetInternalSize();
+  }
+  if (entries == 0 && tombstones.empty()) {
+    TROPO_LOG_ERROR("ERROR: L0 SSTable: No valid iterator\n");
+    return Status::Corruption("No valid iterator in the memtable");
+  }
+  // Split large memtables in ranges of at least one table each. Merging
+  // iterators are allocated in this arena.
+  Arena arena;
+  std::vector<std::string> starts;
+  const size_t ranges = std::min<size_t>(
+      TropoDBConfig::flush_ranges, size / TropoDBConfig::max_bytes_sstable_l0);
+  if (ranges > 1) {
+    SplitMemTables(mems, size, ranges, &arena, &starts);
+  }
+  // Spawn worker threads if needed
+  if (TropoDBConfig::flushes_allow_deferring_writes) {
+    deferred_.metas_ = &metas;
+    deferred_.index_ = 0;
+    deferred_.last_ = false;
+    deferred_.done_ = false;
+    deferred_.deferred_builds_.clear();
+    env->Schedule(&TropoL0SSTable::DeferFlushWrite, &(this->deferred_),
+                  rocksdb::Env::LOW);
+  }
+  // Iterators are created up front, the arena of the memtable is not
+  // thread-safe.
+  port::Mutex range_mutex;
+  port::CondVar range_done(&range_mutex);
+  std::vector<FlushRange> flush_ranges(starts.size() + 1);
+  for (size_t i = 0; i < flush_ranges.size(); i++) {
+    FlushRange& range = flush_ranges[i];
+    range.sstable_ = this;
+    range.iter_ = NewFlushIterator(mems, &arena);
+    range.begin_ = i == 0 ? "" : starts[i - 1];
+    range.end_ = i == starts.size() ? "" : starts[i];
+    range.tombstones_ = &tombstones;
+    range.icmp_ = &mems[0]->GetInternalKeyComparator();
+    range.metas_ = &metas;
+    range.done_ = false;
+    range.mutex_ = &range_mutex;
+    range.done_signal_ = &range_done;
+  }
+  flush_prepare_perf_counter_.AddTiming(clock_->NowMicros() - before);
+
+  // The first range is built by this thread, the others on HIGH threads
+  for (size_t i = 1; i < flush_ranges.size(); i++) {
+    env->Schedule(&TropoL0SSTable::FlushRangeWork, &flush_ranges[i],
+                  rocksdb::Env::HIGH);
+  }
+  FlushRangeWork(&flush_ranges[0]);
+  range_mutex.Lock();
+  for (auto& range : flush_ranges) {
+    while (!range.done_) {
+      range_done.Wait();
+    }
+    if (s.ok() && !range.status_.ok()) {
+      s = range.status_;
+    }
+  }
+  range_mutex.Unlock();
 
   before = clock_->NowMicros();
   // Teardown
@@ -229,53 +390,21 @@ Status TropoL0SSTable::FlushMemTable(TropoMemtable* mem,
     TROPO_LOG_DEBUG("Deferred flush quiting \n");
   }
   // Force log number of all created metas
-  for (auto nmeta : metas) {
+  for (auto& nmeta : metas) {
     nmeta.L0.log_number = parallel_number;
   }
   // Delete stuff
-  for (auto nmeta : new_metas) {
-    delete nmeta;
+  for (auto& range : flush_ranges) {
+    range.iter_->~InternalIterator();
+    for (auto nmeta : range.new_metas_) {
+      delete nmeta;
+    }
   }
   flush_finish_perf_counter_.AddTiming(clock_->NowMicros() - before);
 
   return s;
 }
 
-// TODO: this is better than locking around the entire read, but we have to
-// investigate the performance.
-uint8_t TropoL0SSTable::request_read_queue() {
-  uint8_t picked_reader = TropoDBConfig::number_of_concurrent_L0_readers;
-  mutex_.Lock();
-  for (uint8_t i = 0; i < TropoDBConfig::number_of_concurrent_L0_readers; i++) {
-    if (read_queue_[i] == 0) {
-      picked_reader = i;
-      break;
-    }
-  }
-  while (picked_reader >= TropoDBConfig::number_of_concurrent_L0_readers) {
-    cv_.Wait();
-    for (uint8_t i = 0; i < TropoDBConfig::number_of_concurrent_L0_readers;
-         i++) {
-      if (read_queue_[i] == 0) {
-        picked_reader = i;
-        break;
-      }
-    }
-  }
-  read_queue_[picked_reader] += 1;
-  mutex_.Unlock();
-  return picked_reader;
-}
-
-void TropoL0SSTable::release_read_queue(uint8_t reader) {
-  mutex_.Lock();
-  assert(reader < TropoDBConfig::number_of_concurrent_L0_readers &&
-         read_queue_[reader] != 0);
-  read_queue_[reader] = 0;
-  cv_.SignalAll();
-  mutex_.Unlock();
-}
-
 Status TropoL0SSTable::ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) {
   Status s = Status::OK();
   if (meta.L0.lba > max_zone_head_ || meta.L0.lba < min_zone_head_ ||
@@ -284,12 +413,11 @@ Status TropoL0SSTable::ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) {
     return Status::Corruption("Invalid metadata");
   }
   sstable->clear();
-  // mutex_.Lock();
-  uint8_t readernr = request_read_queue();
+  uint8_t readernr = readers_.Acquire();
   char* data = new char[meta.lba_count * lba_size_];
   s = FromStatus(
       log_.Read(meta.L0.lba, data, meta.lba_count * lba_size_, true, readernr));
-  release_read_queue(readernr);
+  readers_.Release(readernr);
   *sstable = Slice(data, meta.lba_count * lba_size_);
   if (!s.ok()) {
     TROPO_LOG_ERROR(
@@ -385,6 +513,11 @@ Iterator* TropoL0SSTable::NewIterator(const SSZoneMetaData& meta,
     TROPO_LOG_ERROR("ERROR: L0 SSTable: Failed reading L0\n");
     return nullptr;
   }
+  return NewIterator(sstable, cmp);
+}
+
+Iterator* TropoL0SSTable::NewIterator(const Slice& sstable,
+                                      const Comparator* cmp) {
   char* data = (char*)sstable.data();
   if (TropoDBConfig::use_sstable_encoding) {
     uint64_t size = DecodeFixed64(data);
@@ -6,6 +6,7 @@
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/memtable/tropodb_memtable.h"
 #include "db/tropodb/persistence/tropodb_committer.h"
+#include "db/tropodb/table/tropodb_reader_pool.h"
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/table/tropodb_sstable_builder.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
@@ -27,23 +28,48 @@ struct DeferredFlush {
   }
 };
 
+class TropoL0SSTable;
+
+// One key range of a memtable flush. Ranges are built concurrently and their
+// tables are all written through the deferred writer of the log.
+struct FlushRange {
+  TropoL0SSTable* sstable_;
+  InternalIterator* iter_;
+  std::string begin_;  // Internal key to start at, empty for the first range
+  std::string end_;    // Start of the next range, empty for the last range
+  // Tombstones of the flush, clipped to the tables of this range
+  const std::vector<TropoRangeTombstone>* tombstones_;
+  const InternalKeyComparator* icmp_;
+  std::vector<SSZoneMetaData>* metas_;
+  std::vector<SSZoneMetaData*> new_metas_;  // Owned, outlive the writer
+  Status status_;
+  bool done_;
+  port::Mutex* mutex_;
+  port::CondVar* done_signal_;
+};
+
 // Like a Oroborous, an entire circle without holes.
 class TropoL0SSTable : public TropoSSTable {
  public:
   TropoL0SSTable(SZD::SZDChannelFactory* channel_factory,
                const SZD::DeviceInfo& info, const uint64_t min_zone_nr,
-               const uint64_t max_zone_nr);
+               const uint64_t max_zone_nr, const uint8_t readers);
   ~TropoL0SSTable();
   bool EnoughSpaceAvailable(const Slice& slice) const override;
   uint64_t SpaceAvailable() const override;
   TropoSSTableBuilder* NewBuilder(SSZoneMetaData* meta) override;
   Iterator* NewIterator(const SSZoneMetaData& meta,
                         const Comparator* cmp) override;
+  Iterator* NewIterator(const Slice& sstable, const Comparator* cmp) override;
   Status Get(const InternalKeyComparator& icmp, const Slice& key,
              std::string* value, const SSZoneMetaData& meta,
              EntryStatus* entry) override;
   Status FlushMemTable(TropoMemtable* mem, std::vector<SSZoneMetaData>& metas,
                        uint8_t parallel_number, Env* env);
+  // Merges the memtables into one run of tables. The memtables may overlap.
+  Status FlushMemTables(const std::vector<TropoMemtable*>& mems,
+                        std::vector<SSZoneMetaData>& metas,
+                        uint8_t parallel_number, Env* env);
   Status ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) override;
   Status TryInvalidateSSZones(const std::vector<SSZoneMetaData*>& metas,
                               std::vector<SSZoneMetaData*>& remaining_metas);
@@ -75,22 +101,28 @@ class TropoL0SSTable : public TropoSSTable {
  private:
   friend class TropoSSTableManagerInternal;
   static void DeferFlushWrite(void* deferred_flush);
+  static void FlushRangeWork(void* range);
   Status FlushSSTable(TropoSSTableBuilder** builder, std::vector<SSZoneMetaData*>& new_metas, std::vector<SSZoneMetaData>& metas);
-
-  uint8_t request_read_queue();
-  void release_read_queue(uint8_t reader);
+  Status FlushRangeOf(FlushRange* range);
+  // Iterator over all memtables, it lives in arena.
+  static InternalIterator* NewFlushIterator(
+      const std::vector<TropoMemtable*>& mems, Arena* arena);
+  // Start keys of all but the first of at most ranges ranges of about equal
+  // size. Ranges are cut between user keys, so versions of a key stay
+  // together.
+  static void SplitMemTables(const std::vector<TropoMemtable*>& mems,
+                             uint64_t size, size_t ranges, Arena* arena,
+                             std::vector<std::string>* starts);
 
   SZD::SZDCircularLog log_;
   uint64_t zasl_;
   uint64_t lba_size_;
   uint64_t zone_size_;
-  // light queue inevitable as we can have ONE reader accesssed by ONE thread
-  // concurrently.
-  port::Mutex mutex_;
-  port::CondVar cv_;
-  std::array<uint8_t, TropoDBConfig::number_of_concurrent_L0_readers> read_queue_;
+  // A reader can only be used by ONE thread at a time.
+  TropoReaderPool readers_;
   // deferred
   DeferredFlush deferred_;
+  port::Mutex flush_write_mutex_;  // Writes of ranges without deferring
   // timing
   SystemClock* const clock_;
   TimingCounter flush_prepare_perf_counter_;
@@ -14,16 +14,13 @@ namespace ROCKSDB_NAMESPACE {
 TropoLNSSTable::TropoLNSSTable(SZD::SZDChannelFactory* channel_factory,
                                const SZD::DeviceInfo& info,
                                const uint64_t min_zone_nr,
-                               const uint64_t max_zone_nr)
-    : TropoSSTable(channel_factory, info, min_zone_nr, max_zone_nr),
-      log_(channel_factory_, info, min_zone_nr, max_zone_nr,
-           TropoDBConfig::number_of_concurrent_LN_readers, 2),
-      cv_(&mutex_) {
-  // unset
-  for (uint8_t i = 0; i < TropoDBConfig::number_of_concurrent_LN_readers; i++) {
-    read_queue_[i] = 0;
-  }
-}
+                               const uint64_t max_zone_nr,
+                               const uint8_t readers, const uint8_t device)
+    : TropoSSTable(channel_factory, info, min_zone_nr, max_zone_nr, readers),
+      log_(channel_factory_, info, min_zone_nr, max_zone_nr, readers,
+           kWriterCount),
+      device_(device),
+      readers_(readers) {}
 
 TropoLNSSTable::~TropoLNSSTable() = default;
 
@@ -37,12 +34,15 @@ std::string TropoLNSSTable::Encode() { return log_.Encode(); }
 
 TropoSSTableBuilder* TropoLNSSTable::NewBuilder(SSZoneMetaData* meta) {
   return new TropoSSTableBuilder(this, meta,
-                                 TropoDBConfig::use_sstable_encoding);
+                                 TropoDBConfig::use_sstable_encoding, -1,
+                                 prefix_extractor_);
 }
 
-TropoSSTableBuilder* TropoLNSSTable::NewLNBuilder(SSZoneMetaData* meta) {
+TropoSSTableBuilder* TropoLNSSTable::NewLNBuilder(SSZoneMetaData* meta,
+                                                  uint8_t writer) {
   return new TropoSSTableBuilder(this, meta,
-                                 TropoDBConfig::use_sstable_encoding, 1);
+                                 TropoDBConfig::use_sstable_encoding, writer,
+                                 prefix_extractor_);
 }
 
 bool TropoLNSSTable::EnoughSpaceAvailable(const Slice& slice) const {
@@ -63,6 +63,10 @@ Status TropoLNSSTable::WriteSSTable(const Slice& content, SSZoneMetaData* meta,
     return Status::IOError("Not enough space available for LN");
   }
 
+  // L0 compactions and borrowed flushes hold up foreground writes, LN
+  // compactions do not.
+  ChargeWrite(content.size(),
+              writer == kLongLived ? Env::IO_LOW : Env::IO_HIGH);
   std::vector<std::pair<uint64_t, uint64_t>> ptrs;
   if (!FromStatus(
            log_.Append(content.data(), content.size(), ptrs, false, writer))
@@ -72,6 +76,7 @@ Status TropoLNSSTable::WriteSSTable(const Slice& content, SSZoneMetaData* meta,
   }
   meta->lba_count = 0;
   meta->LN.lba_regions = 0;
+  meta->LN.device = device_;
   for (auto ptr : ptrs) {
     meta->LN.lbas[meta->LN.lba_regions] = ptr.first * zone_cap_;
     meta->LN.lba_region_sizes[meta->LN.lba_regions] = ptr.second * zone_cap_;
@@ -86,42 +91,7 @@ Status TropoLNSSTable::WriteSSTable(const Slice& content, SSZoneMetaData* meta,
 
 Status TropoLNSSTable::WriteSSTable(const Slice& content,
                                     SSZoneMetaData* meta) {
-  return WriteSSTable(content, meta, 0);
-}
-
-// TODO: this is better than locking around the entire read, but we have to
-// investigate the performance.
-uint8_t TropoLNSSTable::request_read_queue() {
-  uint8_t picked_reader = TropoDBConfig::number_of_concurrent_LN_readers;
-  mutex_.Lock();
-  for (uint8_t i = 0; i < TropoDBConfig::number_of_concurrent_LN_readers; i++) {
-    if (read_queue_[i] == 0) {
-      picked_reader = i;
-      break;
-    }
-  }
-  while (picked_reader >= TropoDBConfig::number_of_concurrent_LN_readers) {
-    cv_.Wait();
-    for (uint8_t i = 0; i < TropoDBConfig::number_of_concurrent_LN_readers;
-         i++) {
-      if (read_queue_[i] == 0) {
-        picked_reader = i;
-        break;
-      }
-    }
-  }
-  read_queue_[picked_reader] += 1;
-  mutex_.Unlock();
-  return picked_reader;
-}
-
-void TropoLNSSTable::release_read_queue(uint8_t reader) {
-  mutex_.Lock();
-  assert(reader < TropoDBConfig::number_of_concurrent_LN_readers &&
-         read_queue_[reader] != 0);
-  read_queue_[reader] = 0;
-  cv_.SignalAll();
-  mutex_.Unlock();
+  return WriteSSTable(content, meta, kShortLived);
 }
 
 Status TropoLNSSTable::ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) {
@@ -142,12 +112,10 @@ Status TropoLNSSTable::ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) {
   }
 
   char* buffer = new char[meta.lba_count * lba_size_];
-  // mutex_.Lock();
-  uint8_t readernr = request_read_queue();
+  uint8_t readernr = readers_.Acquire();
   s = FromStatus(
       log_.Read(ptrs, buffer, meta.lba_count * lba_size_, true, readernr));
-  release_read_queue(readernr);
-  // mutex_.Unlock();
+  readers_.Release(readernr);
   if (!s.ok()) {
     TROPO_LOG_ERROR("ERROR: LN SSTable: Failed reading\n");
     delete[] buffer;
@@ -158,6 +126,11 @@ Status TropoLNSSTable::ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) {
 }
 
 Status TropoLNSSTable::InvalidateSSZone(const SSZoneMetaData& meta) {
+  return InvalidateSSZone(meta, kLongLived);
+}
+
+Status TropoLNSSTable::InvalidateSSZone(const SSZoneMetaData& meta,
+                                        uint8_t writer) {
   std::vector<std::pair<uint64_t, uint64_t>> ptrs;
   for (size_t i = 0; i < meta.LN.lba_regions; i++) {
     uint64_t from = meta.LN.lbas[i];
@@ -168,7 +141,7 @@ Status TropoLNSSTable::InvalidateSSZone(const SSZoneMetaData& meta) {
     }
     ptrs.push_back(std::make_pair(from / zone_cap_, blocks / zone_cap_));
   }
-  return FromStatus(log_.Reset(ptrs, 1));
+  return FromStatus(log_.Reset(ptrs, writer));
 }
 
 Iterator* TropoLNSSTable::NewIterator(const SSZoneMetaData& meta,
@@ -179,6 +152,11 @@ Iterator* TropoLNSSTable::NewIterator(const SSZoneMetaData& meta,
   if (!s.ok()) {
     return nullptr;
   }
+  return NewIterator(sstable, cmp);
+}
+
+Iterator* TropoLNSSTable::NewIterator(const Slice& sstable,
+                                      const Comparator* cmp) {
   char* data = (char*)sstable.data();
   if (TropoDBConfig::use_sstable_encoding) {
     uint64_t size = DecodeFixed64(data);
@@ -5,6 +5,7 @@
 
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/memtable/tropodb_memtable.h"
+#include "db/tropodb/table/tropodb_reader_pool.h"
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/table/tropodb_sstable_builder.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
@@ -16,21 +17,39 @@ namespace ROCKSDB_NAMESPACE {
 
 class TropoLNSSTable : public TropoSSTable {
  public:
+  // Writer channels, one for each class of table lifetime. Tables never share
+  // zones, but this keeps streams with a different lifetime apart. A channel
+  // may only be used by one thread at a time.
+  enum LifetimeWriter : uint8_t {
+    kShortLived = 0,  // L1, rewritten by each L0 compaction (L0 thread)
+    kLongLived = 1,   // L2 and deeper, also resets LN (LN thread)
+    kBorrowed = 2,    // L0 tables in borrowed zones (flush threads)
+    kWriterCount = 3
+  };
+  static inline uint8_t WriterForLevel(uint8_t level) {
+    return level <= 1 ? kShortLived : kLongLived;
+  }
+
+  // Tables written to this log are tagged with device.
   TropoLNSSTable(SZD::SZDChannelFactory* channel_factory_,
                const SZD::DeviceInfo& info, const uint64_t min_zone_nr,
-               const uint64_t max_zone_nr);
+               const uint64_t max_zone_nr, const uint8_t readers,
+               const uint8_t device = 0);
   ~TropoLNSSTable();
   bool EnoughSpaceAvailable(const Slice& slice) const override;
   uint64_t SpaceAvailable() const override;
   TropoSSTableBuilder* NewBuilder(SSZoneMetaData* meta) override;
-  TropoSSTableBuilder* NewLNBuilder(SSZoneMetaData* meta);
+  TropoSSTableBuilder* NewLNBuilder(SSZoneMetaData* meta,
+                                    uint8_t writer = kLongLived);
   Iterator* NewIterator(const SSZoneMetaData& meta,
                         const Comparator* cmp) override;
+  Iterator* NewIterator(const Slice& sstable, const Comparator* cmp) override;
   Status Get(const InternalKeyComparator& icmp, const Slice& key,
              std::string* value, const SSZoneMetaData& meta,
              EntryStatus* entry) override;
   Status ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) override;
   Status InvalidateSSZone(const SSZoneMetaData& meta) override;
+  Status InvalidateSSZone(const SSZoneMetaData& meta, uint8_t writer);
   Status WriteSSTable(const Slice& content, SSZoneMetaData* meta) override;
   Status WriteSSTable(const Slice& content, SSZoneMetaData* meta,
                       uint8_t writer);
@@ -54,13 +73,9 @@ class TropoLNSSTable : public TropoSSTable {
   }
 
  private:
-  uint8_t request_read_queue();
-  void release_read_queue(uint8_t reader);
-
   SZD::SZDFragmentedLog log_;
-  port::Mutex mutex_;  // TODO: find a way to remove the mutex...
-  port::CondVar cv_;
-  std::array<uint8_t, TropoDBConfig::number_of_concurrent_LN_readers> read_queue_;
+  const uint8_t device_;
+  TropoReaderPool readers_;
 };
 }  // namespace ROCKSDB_NAMESPACE
 
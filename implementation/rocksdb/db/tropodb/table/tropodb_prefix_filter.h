@@ -0,0 +1,89 @@
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_PREFIX_FILTER_H
+#define TROPODB_PREFIX_FILTER_H
+
+#include <string>
+#include <vector>
+
+#include "db/tropodb/tropodb_config.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
+#include "util/bloom_impl.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace ROCKSDB_NAMESPACE {
+// Bloom filter over the key prefixes of a table. It lives in the table
+// metadata, so tables can be skipped without reading them. Layout:
+// [bits (multiple of 64 bytes)][num_probes: 1][extractor id: 4]
+constexpr size_t kPrefixFilterTrailer = 5;
+
+// Filters built with a different extractor can not be trusted.
+inline uint32_t PrefixExtractorId(const SliceTransform* extractor) {
+  return BloomHash(Slice(extractor->GetId()));
+}
+
+inline uint64_t PrefixHash(const Slice& prefix) {
+  return GetSliceHash64(prefix);
+}
+
+// Leaves dst empty (no filter) if there are no prefixes or if the filter would
+// be too big to keep in the manifest.
+inline void BuildPrefixFilter(const SliceTransform* extractor,
+                              const std::vector<uint64_t>& hashes,
+                              std::string* dst) {
+  dst->clear();
+  constexpr uint32_t bits_per_key = TropoDBConfig::prefix_filter_bits_per_key;
+  if (extractor == nullptr || hashes.empty() || bits_per_key == 0) {
+    return;
+  }
+  size_t bytes = (hashes.size() * bits_per_key + 7) / 8;
+  bytes = ((bytes + 63) / 64) * 64;
+  if (bytes > TropoDBConfig::prefix_filter_max_bytes) {
+    return;
+  }
+  const int num_probes =
+      FastLocalBloomImpl::ChooseNumProbes(bits_per_key * 1000);
+  dst->assign(bytes, '\0');
+  for (uint64_t h : hashes) {
+    FastLocalBloomImpl::AddHash(Lower32of64(h), Upper32of64(h),
+                                static_cast<uint32_t>(bytes), num_probes,
+                                &(*dst)[0]);
+  }
+  dst->push_back(static_cast<char>(num_probes));
+  PutFixed32(dst, PrefixExtractorId(extractor));
+}
+
+// False only if no key in the table has this prefix.
+inline bool PrefixFilterMayContain(const SliceTransform* extractor,
+                                   const std::string& filter,
+                                   const Slice& prefix) {
+  if (extractor == nullptr || filter.size() <= kPrefixFilterTrailer) {
+    return true;
+  }
+  const size_t bytes = filter.size() - kPrefixFilterTrailer;
+  if (DecodeFixed32(filter.data() + bytes + 1) !=
+      PrefixExtractorId(extractor)) {
+    return true;
+  }
+  const int num_probes = static_cast<uint8_t>(filter[bytes]);
+  const uint64_t h = PrefixHash(prefix);
+  return FastLocalBloomImpl::HashMayMatch(Lower32of64(h), Upper32of64(h),
+                                          static_cast<uint32_t>(bytes),
+                                          num_probes, filter.data());
+}
+
+// False only if no key in the table can have the prefix of user_key.
+inline bool PrefixMayMatch(const SliceTransform* extractor,
+                           const std::string& filter, const Slice& user_key) {
+  if (extractor == nullptr || !extractor->InDomain(user_key)) {
+    return true;
+  }
+  return PrefixFilterMayContain(extractor, filter,
+                                extractor->Transform(user_key));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif
+#endif
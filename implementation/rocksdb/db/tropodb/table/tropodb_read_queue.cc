@@ -0,0 +1,80 @@
+#include "db/tropodb/table/tropodb_read_queue.h"
+
+#include "db/tropodb/table/tropodb_sstable.h"
+#include "db/tropodb/utils/tropodb_logger.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+void TropoReadGroup::Wait(const TropoReadRequest& req) {
+  MutexLock l(&mutex_);
+  while (!req.done) {
+    cv_.Wait();
+  }
+}
+
+void TropoReadGroup::Complete(TropoReadRequest* req) {
+  MutexLock l(&mutex_);
+  req->done = true;
+  cv_.SignalAll();
+}
+
+TropoReadQueue::TropoReadQueue(TropoSSTable* table, const uint8_t depth)
+    : table_(table),
+      depth_(depth),
+      outstanding_(0),
+      cv_(&mutex_),
+      shutdown_(false) {
+  assert(depth_ > 0);
+}
+
+TropoReadQueue::~TropoReadQueue() {
+  {
+    MutexLock l(&mutex_);
+    shutdown_ = true;
+    cv_.SignalAll();
+  }
+  for (auto& poller : pollers_) {
+    poller.join();
+  }
+}
+
+void TropoReadQueue::Submit(TropoReadRequest* req) {
+  assert(req->meta != nullptr && req->group != nullptr);
+  req->done = false;
+  outstanding_.fetch_add(1);
+  MutexLock l(&mutex_);
+  if (pollers_.empty()) {
+    for (uint8_t i = 0; i < depth_; i++) {
+      pollers_.emplace_back(&TropoReadQueue::Poll, this);
+    }
+  }
+  queue_.push_back(req);
+  cv_.Signal();
+}
+
+void TropoReadQueue::Poll() {
+  while (true) {
+    TropoReadRequest* req;
+    {
+      MutexLock l(&mutex_);
+      while (queue_.empty() && !shutdown_) {
+        cv_.Wait();
+      }
+      // Submitters wait on their reads, so there is nothing left on shutdown
+      if (queue_.empty()) {
+        return;
+      }
+      req = queue_.front();
+      queue_.pop_front();
+    }
+    req->status = table_->ReadSSTable(&req->sstable, *req->meta);
+    if (!req->status.ok()) {
+      TROPO_LOG_ERROR("ERROR: Read queue: Failed reading table %lu\n",
+                      req->meta->number);
+    }
+    outstanding_.fetch_sub(1);
+    req->group->Complete(req);
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
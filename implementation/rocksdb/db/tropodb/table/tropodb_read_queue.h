@@ -0,0 +1,77 @@
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_READ_QUEUE_H
+#define TROPODB_READ_QUEUE_H
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "port/port.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+
+namespace ROCKSDB_NAMESPACE {
+class TropoSSTable;
+class TropoReadGroup;
+
+// One asynchronous SSTable read. On success sstable holds a heap buffer, just
+// as returned by TropoSSTable::ReadSSTable.
+struct TropoReadRequest {
+  const SSZoneMetaData* meta{nullptr};
+  Slice sstable;
+  Status status;
+  bool done{false};
+  TropoReadGroup* group{nullptr};
+};
+
+// Reads that a caller waits on together, pollers signal completions here.
+class TropoReadGroup {
+ public:
+  TropoReadGroup() : cv_(&mutex_) {}
+  TropoReadGroup(const TropoReadGroup&) = delete;
+  TropoReadGroup& operator=(const TropoReadGroup&) = delete;
+
+  void Wait(const TropoReadRequest& req);
+  void Complete(TropoReadRequest* req);
+
+ private:
+  port::Mutex mutex_;
+  port::CondVar cv_;
+};
+
+/**
+ * @brief Queue of asynchronous reads for one SSTable log. Reads are served
+ * by depth pollers, each keeping one read in flight on a reader channel of
+ * the log, so up to depth reads are outstanding on the device at a time.
+ * Pollers are started on the first submission.
+ */
+class TropoReadQueue {
+ public:
+  TropoReadQueue(TropoSSTable* table, const uint8_t depth);
+  TropoReadQueue(const TropoReadQueue&) = delete;
+  TropoReadQueue& operator=(const TropoReadQueue&) = delete;
+  ~TropoReadQueue();
+
+  void Submit(TropoReadRequest* req);
+  // True if a new read would have to wait for an earlier one.
+  bool Saturated() const { return outstanding_.load() >= depth_; }
+  uint64_t Outstanding() const { return outstanding_.load(); }
+
+ private:
+  void Poll();
+
+  TropoSSTable* const table_;
+  const uint8_t depth_;
+  std::atomic<uint64_t> outstanding_;
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::deque<TropoReadRequest*> queue_;
+  std::vector<port::Thread> pollers_;
+  bool shutdown_;
+};
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
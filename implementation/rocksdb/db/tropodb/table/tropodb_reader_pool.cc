@@ -0,0 +1,88 @@
+#include "db/tropodb/table/tropodb_reader_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <utility>
+
+#include "db/tropodb/tropodb_config.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+std::atomic<uint64_t> next_pool_id{1};
+std::atomic<uint32_t> next_thread_hint{0};
+
+// Last reader of a thread for a few pools, indexed by pool id.
+struct CachedReader {
+  uint64_t pool_id{0};
+  uint8_t reader{0};
+};
+thread_local std::array<CachedReader, 8> cached_readers;
+thread_local uint32_t thread_hint = next_thread_hint.fetch_add(1);
+}  // namespace
+
+TropoReaderPool::TropoReaderPool(const uint8_t readers)
+    : readers_(readers),
+      id_(next_pool_id.fetch_add(1)),
+      free_(readers >= kMaxReaders ? ~0ULL : (1ULL << readers) - 1),
+      waiters_(0),
+      cv_(&mutex_) {
+  assert(readers_ > 0 && readers_ <= kMaxReaders);
+}
+
+uint8_t TropoReaderPool::ReaderCount(const uint8_t max_readers,
+                                     const size_t logs) {
+  const size_t cores =
+      std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t share = std::max<size_t>(
+      1, TropoDBConfig::max_reader_channels / std::max<size_t>(1, logs));
+  return static_cast<uint8_t>(
+      std::min({cores, share, static_cast<size_t>(max_readers),
+                static_cast<size_t>(kMaxReaders)}));
+}
+
+bool TropoReaderPool::TryAcquire(const uint8_t preferred, uint8_t* reader) {
+  uint64_t free = free_.load();
+  while (free != 0) {
+    // First free reader from preferred onwards, so threads spread out
+    const uint64_t above = free >> preferred;
+    const uint8_t picked =
+        above != 0 ? preferred + __builtin_ctzll(above) : __builtin_ctzll(free);
+    if (free_.compare_exchange_weak(free, free & ~(1ULL << picked))) {
+      *reader = picked;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t TropoReaderPool::Acquire() {
+  CachedReader& cached = cached_readers[id_ % cached_readers.size()];
+  const uint8_t preferred =
+      cached.pool_id == id_ ? cached.reader : thread_hint % readers_;
+  uint8_t reader;
+  if (!TryAcquire(preferred, &reader)) {
+    // Slow path, the waiter count tells releasers that someone must be woken.
+    MutexLock l(&mutex_);
+    waiters_.fetch_add(1);
+    while (!TryAcquire(preferred, &reader)) {
+      cv_.Wait();
+    }
+    waiters_.fetch_sub(1);
+  }
+  cached.pool_id = id_;
+  cached.reader = reader;
+  return reader;
+}
+
+void TropoReaderPool::Release(const uint8_t reader) {
+  assert(reader < readers_ && (free_.load() & (1ULL << reader)) == 0);
+  free_.fetch_or(1ULL << reader);
+  if (waiters_.load() > 0) {
+    MutexLock l(&mutex_);
+    cv_.Signal();
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
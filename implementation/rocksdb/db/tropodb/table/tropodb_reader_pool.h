@@ -0,0 +1,47 @@
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_READER_POOL_H
+#define TROPODB_READER_POOL_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "port/port.h"
+
+namespace ROCKSDB_NAMESPACE {
+/**
+ * @brief Hands out the reader channels of one SZD log. A thread first tries
+ * the channel it used last on this pool, then claims any free channel from
+ * an atomic bitmap. Only when all channels are busy does it block, a release
+ * then wakes a single waiter.
+ */
+class TropoReaderPool {
+ public:
+  static constexpr uint8_t kMaxReaders = 64;
+
+  explicit TropoReaderPool(const uint8_t readers);
+  TropoReaderPool(const TropoReaderPool&) = delete;
+  TropoReaderPool& operator=(const TropoReaderPool&) = delete;
+
+  // Readers for one of logs logs on a device: one for each core, at most
+  // max_readers and together within the reader channels of the device.
+  static uint8_t ReaderCount(const uint8_t max_readers, const size_t logs);
+
+  uint8_t Acquire();
+  void Release(const uint8_t reader);
+  uint8_t Size() const { return readers_; }
+
+ private:
+  bool TryAcquire(const uint8_t preferred, uint8_t* reader);
+
+  const uint8_t readers_;
+  const uint64_t id_;  // Identifies the pool in the per-thread cache
+  std::atomic<uint64_t> free_;
+  std::atomic<uint32_t> waiters_;
+  port::Mutex mutex_;
+  port::CondVar cv_;
+};
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
@@ -0,0 +1,142 @@
+// Thread-safe (provides internal synchronization)
+
+#include "db/tropodb/table/tropodb_row_cache.h"
+
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+struct RowCacheEntry {
+  bool found;
+  std::string value;
+};
+
+void DeleteEntry(const Slice& key, void* value) {
+  delete reinterpret_cast<RowCacheEntry*>(value);
+}
+
+// Invalidates all keys of a batch
+class InvalidateHandler : public WriteBatch::Handler {
+ public:
+  InvalidateHandler(TropoRowCache* cache, SequenceNumber seq)
+      : cache_(cache), seq_(seq) {}
+  Status PutCF(uint32_t column_family_id, const Slice& key,
+               const Slice& value) override {
+    cache_->Invalidate(key, seq_);
+    return Status::OK();
+  }
+  Status DeleteCF(uint32_t column_family_id, const Slice& key) override {
+    cache_->Invalidate(key, seq_);
+    return Status::OK();
+  }
+  Status SingleDeleteCF(uint32_t column_family_id, const Slice& key) override {
+    cache_->Invalidate(key, seq_);
+    return Status::OK();
+  }
+  Status MergeCF(uint32_t column_family_id, const Slice& key,
+                 const Slice& value) override {
+    cache_->Invalidate(key, seq_);
+    return Status::OK();
+  }
+  Status DeleteRangeCF(uint32_t column_family_id, const Slice& begin_key,
+                       const Slice& end_key) override {
+    cache_->InvalidateAll();
+    return Status::OK();
+  }
+
+ private:
+  TropoRowCache* cache_;
+  SequenceNumber seq_;
+};
+}  // namespace
+
+TropoRowCache::TropoRowCache(std::shared_ptr<Cache> cache)
+    : cache_(cache), generation_(0) {
+  PutVarint64(&id_, cache_->NewId());
+  for (auto& stripe : invalidated_) {
+    stripe.store(0);
+  }
+}
+
+TropoRowCache::~TropoRowCache() = default;
+
+void TropoRowCache::EncodeKey(uint64_t generation, const Slice& user_key,
+                              std::string* dst) const {
+  dst->assign(id_);
+  PutVarint64(dst, generation);
+  dst->append(user_key.data(), user_key.size());
+}
+
+std::atomic<uint64_t>& TropoRowCache::Stripe(const Slice& user_key) {
+  return invalidated_[GetSliceHash64(user_key) % kStripes];
+}
+
+bool TropoRowCache::Lookup(const Slice& user_key, std::string* value,
+                           Status* s) {
+  std::string key;
+  EncodeKey(generation_.load(), user_key, &key);
+  Cache::Handle* handle = cache_->Lookup(key);
+  if (handle == nullptr) {
+    return false;
+  }
+  const RowCacheEntry* entry =
+      reinterpret_cast<RowCacheEntry*>(cache_->Value(handle));
+  if (entry->found) {
+    value->assign(entry->value);
+    *s = Status::OK();
+  } else {
+    value->clear();
+    *s = Status::NotFound("Entry deleted");
+  }
+  cache_->Release(handle);
+  return true;
+}
+
+void TropoRowCache::Insert(const Slice& user_key, SequenceNumber read_seq,
+                           uint64_t generation, const Status& s,
+                           const Slice& value) {
+  if (!s.ok() && !s.IsNotFound()) {
+    return;
+  }
+  std::atomic<uint64_t>& stripe = Stripe(user_key);
+  if (stripe.load() > read_seq) {
+    return;
+  }
+  RowCacheEntry* entry = new RowCacheEntry;
+  entry->found = s.ok();
+  if (entry->found) {
+    entry->value.assign(value.data(), value.size());
+  }
+  std::string key;
+  EncodeKey(generation, user_key, &key);
+  const size_t charge = key.size() + entry->value.size() + sizeof(*entry);
+  if (!cache_->Insert(key, entry, charge, &DeleteEntry).ok()) {
+    return;
+  }
+  // A write can have slipped in between the check and the insert, it might
+  // not have seen this entry.
+  if (stripe.load() > read_seq) {
+    cache_->Erase(key);
+  }
+}
+
+void TropoRowCache::Invalidate(const WriteBatch* batch, SequenceNumber seq) {
+  InvalidateHandler handler(this, seq);
+  batch->Iterate(&handler);
+}
+
+void TropoRowCache::Invalidate(const Slice& user_key, SequenceNumber seq) {
+  std::atomic<uint64_t>& stripe = Stripe(user_key);
+  uint64_t current = stripe.load();
+  while (current < seq && !stripe.compare_exchange_weak(current, seq)) {
+  }
+  std::string key;
+  EncodeKey(generation_.load(), user_key, &key);
+  cache_->Erase(key);
+}
+
+void TropoRowCache::InvalidateAll() { generation_.fetch_add(1); }
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,66 @@
+// Thread-safe (provides internal synchronization)
+
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_ROW_CACHE_H
+#define TROPODB_ROW_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "db/dbformat.h"
+#include "rocksdb/cache.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/write_batch.h"
+
+namespace ROCKSDB_NAMESPACE {
+/**
+ * @brief Caches the latest result of Get for user keys, so that hot keys are
+ * answered without touching memtables or SSTables. Entries are not tied to
+ * tables, compactions do not change the result of a key.
+ * Writers invalidate the keys they write. A read only inserts its result if
+ * no write to a key on the same stripe happened since the read started.
+ * Range deletes and ingestion invalidate all entries by bumping a generation
+ * that is part of each key.
+ */
+class TropoRowCache {
+ public:
+  explicit TropoRowCache(std::shared_ptr<Cache> cache);
+  TropoRowCache(const TropoRowCache&) = delete;
+  TropoRowCache& operator=(const TropoRowCache&) = delete;
+  ~TropoRowCache();
+
+  // Returns true on a hit, s is then either OK (value is set) or NotFound.
+  bool Lookup(const Slice& user_key, std::string* value, Status* s);
+  // Must be called before reading at read_seq, the result is passed to Insert.
+  inline uint64_t Generation() const { return generation_.load(); }
+  void Insert(const Slice& user_key, SequenceNumber read_seq,
+              uint64_t generation, const Status& s, const Slice& value);
+
+  // Writers call this after the batch is in the memtable with seq being the
+  // last sequence number of the batch.
+  void Invalidate(const WriteBatch* batch, SequenceNumber seq);
+  void Invalidate(const Slice& user_key, SequenceNumber seq);
+  void InvalidateAll();
+
+ private:
+  static constexpr size_t kStripes = 1024;
+
+  void EncodeKey(uint64_t generation, const Slice& user_key,
+                 std::string* dst) const;
+  std::atomic<uint64_t>& Stripe(const Slice& user_key);
+
+  std::shared_ptr<Cache> cache_;
+  // Allows sharing the cache with other users
+  std::string id_;
+  std::atomic<uint64_t> generation_;
+  // Last sequence number written to a key of the stripe
+  std::array<std::atomic<uint64_t>, kStripes> invalidated_;
+};
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
@@ -0,0 +1,197 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+#include "db/tropodb/table/tropodb_sst_file_writer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "db/tropodb/table/iterators/sstable_iterator.h"
+#include "db/tropodb/table/iterators/sstable_iterator_compressed.h"
+#include "db/tropodb/table/tropodb_sstable_reader.h"
+#include "db/tropodb/tropodb_config.h"
+#include "db/tropodb/utils/tropodb_logger.h"
+#include "rocksdb/comparator.h"
+#include "util/coding.h"
+
+namespace ROCKSDB_NAMESPACE {
+TropoSSTFileWriter::TropoSSTFileWriter(Env* env)
+    : env_(env), builder_(nullptr), entries_(0) {}
+
+TropoSSTFileWriter::~TropoSSTFileWriter() { delete builder_; }
+
+Status TropoSSTFileWriter::Open(const std::string& file_path) {
+  Status s = env_->NewWritableFile(file_path, &file_, EnvOptions());
+  if (!s.ok()) {
+    TROPO_LOG_ERROR("ERROR: SST file writer: Can not open %s\n",
+                    file_path.data());
+    return s;
+  }
+  std::string magic;
+  PutFixed64(&magic, kMagic);
+  s = file_->Append(magic);
+  // Tables are never flushed to a zone, only their content is used.
+  builder_ = new TropoSSTableBuilder(nullptr, &meta_,
+                                     TropoDBConfig::use_sstable_encoding);
+  entries_ = 0;
+  return s;
+}
+
+Status TropoSSTFileWriter::Put(const Slice& user_key, const Slice& value) {
+  if (file_ == nullptr) {
+    return Status::InvalidArgument("SST file writer is not opened");
+  }
+  if (entries_ > 0 && BytewiseComparator()->Compare(user_key, last_key_) <= 0) {
+    return Status::InvalidArgument("Keys must be added in increasing order");
+  }
+  InternalKey ikey(user_key, 0, kTypeValue);
+  if (builder_->GetSize() > 0 &&
+      builder_->GetSize() + builder_->EstimateSizeImpact(ikey.Encode(), value) >
+          TropoDBConfig::max_bytes_sstable_) {
+    Status s = FlushTable();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  last_key_.assign(user_key.data(), user_key.size());
+  entries_++;
+  return builder_->Apply(ikey.Encode(), value);
+}
+
+Status TropoSSTFileWriter::FlushTable() {
+  Status s = builder_->Finalise();
+  if (!s.ok()) {
+    return s;
+  }
+  Slice content = builder_->GetContent();
+  std::string record;
+  PutFixed64(&record, content.size());
+  s = file_->Append(record);
+  s = s.ok() ? file_->Append(content) : s;
+  record.clear();
+  Slice smallest = meta_.smallest.Encode();
+  Slice largest = meta_.largest.Encode();
+  PutFixed32(&record, smallest.size());
+  record.append(smallest.data(), smallest.size());
+  PutFixed32(&record, largest.size());
+  record.append(largest.data(), largest.size());
+  PutFixed64(&record, meta_.numbers);
+  s = s.ok() ? file_->Append(record) : s;
+  if (!s.ok()) {
+    TROPO_LOG_ERROR("ERROR: SST file writer: Can not append table\n");
+  }
+  delete builder_;
+  builder_ = new TropoSSTableBuilder(nullptr, &meta_,
+                                     TropoDBConfig::use_sstable_encoding);
+  return s;
+}
+
+Status TropoSSTFileWriter::Finish() {
+  if (file_ == nullptr) {
+    return Status::InvalidArgument("SST file writer is not opened");
+  }
+  Status s;
+  if (builder_->GetSize() > 0) {
+    s = FlushTable();
+  }
+  s = s.ok() ? file_->Sync() : s;
+  s = s.ok() ? file_->Close() : s;
+  file_.reset();
+  return s;
+}
+
+TropoSSTFileReader::TropoSSTFileReader(Env* env) : env_(env) {}
+
+TropoSSTFileReader::~TropoSSTFileReader() {}
+
+Status TropoSSTFileReader::Open(const std::string& file_path) {
+  Status s = env_->NewSequentialFile(file_path, &file_, EnvOptions());
+  if (!s.ok()) {
+    return s;
+  }
+  std::string magic;
+  s = ReadExact(sizeof(uint64_t), &magic);
+  if (!s.ok() || DecodeFixed64(magic.data()) != TropoSSTFileWriter::kMagic) {
+    return Status::Corruption("Not a TropoDB SST file", file_path);
+  }
+  return Status::OK();
+}
+
+Status TropoSSTFileReader::ReadExact(size_t n, std::string* dst) {
+  dst->resize(n);
+  Slice result;
+  Status s = file_->Read(n, &result, &(*dst)[0]);
+  if (!s.ok()) {
+    return s;
+  }
+  if (result.size() != n) {
+    return Status::Corruption("Truncated TropoDB SST file");
+  }
+  if (result.data() != dst->data()) {
+    memmove(&(*dst)[0], result.data(), n);
+  }
+  return Status::OK();
+}
+
+Status TropoSSTFileReader::Next(std::string* table, SSZoneMetaData* meta,
+                                bool* done) {
+  *done = false;
+  // The end of the file can only be at a table boundary
+  scratch_.resize(sizeof(uint64_t));
+  Slice result;
+  Status s = file_->Read(sizeof(uint64_t), &result, &scratch_[0]);
+  if (!s.ok()) {
+    return s;
+  }
+  if (result.size() == 0) {
+    *done = true;
+    return Status::OK();
+  } else if (result.size() != sizeof(uint64_t)) {
+    return Status::Corruption("Truncated TropoDB SST file");
+  }
+  uint64_t size = DecodeFixed64(result.data());
+  if (table != nullptr) {
+    s = ReadExact(size, table);
+  } else {
+    s = file_->Skip(size);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  for (InternalKey* key : {&meta->smallest, &meta->largest}) {
+    s = ReadExact(sizeof(uint32_t), &scratch_);
+    if (!s.ok()) {
+      return s;
+    }
+    s = ReadExact(DecodeFixed32(scratch_.data()), &scratch_);
+    if (!s.ok()) {
+      return s;
+    }
+    key->DecodeFrom(scratch_);
+    if (!key->Valid()) {
+      return Status::Corruption("Invalid key in TropoDB SST file");
+    }
+  }
+  s = ReadExact(sizeof(uint64_t), &scratch_);
+  if (s.ok()) {
+    meta->numbers = DecodeFixed64(scratch_.data());
+  }
+  return s;
+}
+
+Iterator* TropoSSTFileReader::NewTableIterator(const Slice& table,
+                                               const Comparator* cmp) {
+  // Iterators take ownership of (and free) their data
+  char* data = static_cast<char*>(malloc(table.size()));
+  memcpy(data, table.data(), table.size());
+  if (TropoDBConfig::use_sstable_encoding) {
+    uint64_t size = DecodeFixed64(data);
+    uint64_t count = DecodeFixed64(data + sizeof(uint64_t));
+    return new SSTableIteratorCompressed(cmp, data, size, count);
+  } else {
+    uint64_t count = DecodeFixed64(data);
+    return new SSTableIterator(data, table.size(), (size_t)count,
+                               &TropoEncoding::ParseNextNonEncoded, cmp);
+  }
+}
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,83 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Writer and reader for external files that hold TropoDB-format SSTables.
+// Such files are built offline and bulk loaded with IngestExternalFile,
+// the tables are then appended to LN as is.
+
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_SST_FILE_WRITER_H
+#define TROPODB_SST_FILE_WRITER_H
+
+#include <memory>
+#include <string>
+
+#include "db/dbformat.h"
+#include "db/tropodb/table/tropodb_sstable_builder.h"
+#include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "rocksdb/env.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+
+namespace ROCKSDB_NAMESPACE {
+/**
+ * @brief Builds an external file of TropoDB SSTables from a sorted key/value
+ * stream. Keys are stored with sequence number 0.
+ * File layout: magic, then per table <size><table><smallest><largest><count>.
+ */
+class TropoSSTFileWriter {
+ public:
+  explicit TropoSSTFileWriter(Env* env);
+  TropoSSTFileWriter(const TropoSSTFileWriter&) = delete;
+  TropoSSTFileWriter& operator=(const TropoSSTFileWriter&) = delete;
+  ~TropoSSTFileWriter();
+
+  Status Open(const std::string& file_path);
+  // Keys must be added in strictly increasing (bytewise) order.
+  Status Put(const Slice& user_key, const Slice& value);
+  Status Finish();
+  inline uint64_t NumEntries() const { return entries_; }
+
+  static constexpr uint64_t kMagic = 0x5453534f504f5254ull;  // "TROPOSST"
+
+ private:
+  Status FlushTable();
+
+  Env* env_;
+  std::unique_ptr<WritableFile> file_;
+  TropoSSTableBuilder* builder_;
+  SSZoneMetaData meta_;
+  std::string last_key_;
+  uint64_t entries_;
+};
+
+/**
+ * @brief Reads the tables of an external file one by one.
+ */
+class TropoSSTFileReader {
+ public:
+  explicit TropoSSTFileReader(Env* env);
+  TropoSSTFileReader(const TropoSSTFileReader&) = delete;
+  TropoSSTFileReader& operator=(const TropoSSTFileReader&) = delete;
+  ~TropoSSTFileReader();
+
+  Status Open(const std::string& file_path);
+  // Reads the next table, table is only filled if it is not nullptr (the
+  // table is skipped otherwise). Sets done when the file is exhausted.
+  Status Next(std::string* table, SSZoneMetaData* meta, bool* done);
+  // Iterator over the internal keys of a table read with Next.
+  static Iterator* NewTableIterator(const Slice& table, const Comparator* cmp);
+
+ private:
+  Status ReadExact(size_t n, std::string* dst);
+
+  Env* env_;
+  std::unique_ptr<SequentialFile> file_;
+  std::string scratch_;
+};
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
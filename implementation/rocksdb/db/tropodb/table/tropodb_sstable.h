@@ -3,13 +3,19 @@
 #ifndef TROPODB_SSTABLE_H
 #define TROPODB_SSTABLE_H
 
+#include <algorithm>
+
 #include "db/tropodb/utils/tropodb_diagnostics.h"
 #include "db/tropodb/io/szd_port.h"
 #include "db/tropodb/memtable/tropodb_memtable.h"
 #include "db/tropodb/ref_counter.h"
+#include "db/tropodb/table/tropodb_read_queue.h"
 #include "db/tropodb/table/tropodb_sstable_builder.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "rocksdb/env.h"
 #include "rocksdb/iterator.h"
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/slice_transform.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 
@@ -18,19 +24,24 @@ enum class EntryStatus { found, deleted, notfound };
 
 class TropoSSTableManager;
 class TropoSSTableBuilder;
+class TropoColumnFamilySet;
 
 class TropoSSTable {
  public:
   TropoSSTable(SZD::SZDChannelFactory* channel_factory,
              const SZD::DeviceInfo& info, const uint64_t min_zone_nr,
-             const uint64_t max_zone_nr)
+             const uint64_t max_zone_nr, const uint8_t read_queue_depth)
       : min_zone_head_(min_zone_nr * info.zone_cap),
         max_zone_head_(max_zone_nr * info.zone_cap),
         zone_cap_(info.zone_cap),
         lba_size_(info.lba_size),
         mdts_(info.mdts),
         channel_factory_(channel_factory),
-        buffer_(0, lba_size_) {
+        buffer_(0, lba_size_),
+        prefix_extractor_(nullptr),
+        rate_limiter_(nullptr),
+        column_families_(nullptr),
+        read_pollers_(this, read_queue_depth) {
     assert(channel_factory_ != nullptr);
     channel_factory_->Ref();
   }
@@ -39,6 +50,9 @@ class TropoSSTable {
     channel_factory_ = nullptr;
   }
   virtual Status ReadSSTable(Slice* sstable, const SSZoneMetaData& meta) = 0;
+  // Queues a read of req->meta, req->group is signalled once it is done.
+  void ReadSSTableAsync(TropoReadRequest* req) { read_pollers_.Submit(req); }
+  bool ReadQueueSaturated() const { return read_pollers_.Saturated(); }
   virtual Status Get(const InternalKeyComparator& icmp, const Slice& key,
                      std::string* value, const SSZoneMetaData& meta,
                      EntryStatus* entry) = 0;
@@ -49,13 +63,47 @@ class TropoSSTable {
   virtual Status WriteSSTable(const Slice& content, SSZoneMetaData* meta) = 0;
   virtual Iterator* NewIterator(const SSZoneMetaData& meta,
                                 const Comparator* cmp) = 0;
+  // Iterates over a table that is already read, takes ownership of its data.
+  virtual Iterator* NewIterator(const Slice& sstable,
+                                const Comparator* cmp) = 0;
   virtual Status Recover() = 0;
   virtual uint64_t GetTail() const = 0;
   virtual uint64_t GetHead() const = 0;
 
   virtual TropoDiagnostics GetDiagnostics() const = 0;
 
+  // Builders of this table emit prefix filters with this extractor.
+  void SetPrefixExtractor(const SliceTransform* prefix_extractor) {
+    prefix_extractor_ = prefix_extractor;
+  }
+  // Writes to this table are paced by rate_limiter, if not nullptr.
+  void SetRateLimiter(RateLimiter* rate_limiter) {
+    rate_limiter_ = rate_limiter;
+  }
+  // Builders of this table do not let a table span column families.
+  void SetColumnFamilies(const TropoColumnFamilySet* column_families) {
+    column_families_ = column_families;
+  }
+  const TropoColumnFamilySet* GetColumnFamilies() const {
+    return column_families_;
+  }
+
  protected:
+  // Blocks until the rate limiter admits bytes, call before each append.
+  void ChargeWrite(uint64_t bytes, Env::IOPriority pri) const {
+    if (rate_limiter_ == nullptr) {
+      return;
+    }
+    // A single request can not exceed the burst size
+    const uint64_t burst = rate_limiter_->GetSingleBurstBytes();
+    while (bytes > 0) {
+      const uint64_t request = std::min(bytes, burst);
+      rate_limiter_->Request(request, pri, nullptr,
+                             RateLimiter::OpType::kWrite);
+      bytes -= request;
+    }
+  }
+
   // const after init
   const uint64_t min_zone_head_;
   const uint64_t max_zone_head_;
@@ -65,6 +113,10 @@ class TropoSSTable {
   // references
   SZD::SZDChannelFactory* channel_factory_;
   SZD::SZDBuffer buffer_;
+  const SliceTransform* prefix_extractor_;
+  RateLimiter* rate_limiter_;
+  const TropoColumnFamilySet* column_families_;
+  TropoReadQueue read_pollers_;
 };
 
 }  // namespace ROCKSDB_NAMESPACE
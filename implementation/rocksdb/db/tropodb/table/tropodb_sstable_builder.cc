@@ -1,6 +1,8 @@
 #include "db/tropodb/table/tropodb_sstable_builder.h"
 
+#include "db/tropodb/index/tropodb_column_family.h"
 #include "db/tropodb/table/tropodb_ln_sstable.h"
+#include "db/tropodb/table/tropodb_prefix_filter.h"
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/utils/tropodb_logger.h"
 
@@ -8,11 +10,15 @@ namespace ROCKSDB_NAMESPACE {
 
 TropoSSTableBuilder::TropoSSTableBuilder(TropoSSTable* table,
                                          SSZoneMetaData* meta,
-                                         bool use_encoding, int8_t writer)
+                                         bool use_encoding, int8_t writer,
+                                         const SliceTransform* prefix_extractor)
     : started_(false),
       kv_numbers_(0),
       counter_(0),
       use_encoding_(use_encoding),
+      icmp_(nullptr),
+      prefix_extractor_(prefix_extractor),
+      family_(0),
       table_(table),
       meta_(meta),
       writer_(writer) {
@@ -34,10 +40,27 @@ uint64_t TropoSSTableBuilder::EstimateSizeImpact(const Slice& key,
   return key.size() + value.size() + 5 * sizeof(uint32_t);
 }
 
+bool TropoSSTableBuilder::CrossesFamily(const Slice& key) const {
+  const TropoColumnFamilySet* families = table_->GetColumnFamilies();
+  if (!started_ || families == nullptr || !families->Keyed()) {
+    return false;
+  }
+  uint32_t family;
+  Slice user_key;
+  return families->ParseKey(ExtractUserKey(key), &family, &user_key) &&
+         family != family_;
+}
+
 Status TropoSSTableBuilder::Apply(const Slice& key, const Slice& value) {
   if (!started_) {
     meta_->smallest.DecodeFrom(key);
     started_ = true;
+    const TropoColumnFamilySet* families = table_->GetColumnFamilies();
+    Slice user_key;
+    if (families != nullptr &&
+        !families->ParseKey(ExtractUserKey(key), &family_, &user_key)) {
+      family_ = 0;
+    }
   }
 
   if (use_encoding_) {
@@ -77,11 +100,47 @@ Status TropoSSTableBuilder::Apply(const Slice& key, const Slice& value) {
   }
   meta_->largest.DecodeFrom(key);
   kv_numbers_++;
+  // Keys are sorted, so equal prefixes are adjacent
+  if (prefix_extractor_ != nullptr) {
+    const Slice user_key = ExtractUserKey(key);
+    if (prefix_extractor_->InDomain(user_key)) {
+      const Slice prefix = prefix_extractor_->Transform(user_key);
+      if (prefix_hashes_.empty() || prefix != Slice(last_prefix_)) {
+        prefix_hashes_.push_back(PrefixHash(prefix));
+        last_prefix_.assign(prefix.data(), prefix.size());
+      }
+    }
+  }
   return Status::OK();
 }
 
+void TropoSSTableBuilder::AddRangeTombstone(
+    const InternalKeyComparator& icmp, const TropoRangeTombstone& tombstone) {
+  InternalKey start(tombstone.start, kMaxSequenceNumber, kTypeRangeDeletion);
+  InternalKey end(tombstone.end, kMaxSequenceNumber, kTypeRangeDeletion);
+  if (tombstones_.empty() || icmp.Compare(start, tombstones_smallest_) < 0) {
+    tombstones_smallest_ = start;
+  }
+  if (tombstones_.empty() || icmp.Compare(end, tombstones_largest_) > 0) {
+    tombstones_largest_ = end;
+  }
+  icmp_ = &icmp;
+  tombstones_.push_back(tombstone);
+}
+
 Status TropoSSTableBuilder::Finalise() {
   meta_->numbers = kv_numbers_;
+  meta_->range_tombstones = tombstones_;
+  BuildPrefixFilter(prefix_extractor_, prefix_hashes_, &meta_->prefix_filter);
+  if (!tombstones_.empty()) {
+    if (!started_ ||
+        icmp_->Compare(tombstones_smallest_, meta_->smallest) < 0) {
+      meta_->smallest = tombstones_smallest_;
+    }
+    if (!started_ || icmp_->Compare(tombstones_largest_, meta_->largest) > 0) {
+      meta_->largest = tombstones_largest_;
+    }
+  }
   // TODO: this is not a bottleneck, but it is ugly...
   std::string preamble;
   uint64_t expect_size =
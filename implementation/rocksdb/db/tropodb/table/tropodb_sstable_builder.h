@@ -6,19 +6,35 @@
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
 #include "rocksdb/rocksdb_namespace.h"
+#include "rocksdb/slice_transform.h"
 
 namespace ROCKSDB_NAMESPACE {
 class TropoSSTable;
 class TropoSSTableBuilder {
  public:
   TropoSSTableBuilder(TropoSSTable* table, SSZoneMetaData* meta, bool use_encoding,
-                 int8_t writer = -1);
+                 int8_t writer = -1,
+                 const SliceTransform* prefix_extractor = nullptr);
   ~TropoSSTableBuilder();
   uint64_t EstimateSizeImpact(const Slice& key, const Slice& value) const;
   Status Apply(const Slice& key, const Slice& value);
+  // Range tombstones are only stored in the metadata, but they do widen the
+  // key range of the table.
+  void AddRangeTombstone(const InternalKeyComparator& icmp,
+                         const TropoRangeTombstone& tombstone);
+  bool HasRangeTombstones() const { return !tombstones_.empty(); }
+  // True if key is in another column family than the keys added so far.
+  // Tables never span families, so a family has tables of its own.
+  bool CrossesFamily(const Slice& key) const;
   Status Finalise();
   Status Flush();
   uint64_t GetSize() const { return (uint64_t)buffer_.size(); }
+  // Size after Finalise, including the offsets in front of the table.
+  uint64_t GetFinalSize() const {
+    return buffer_.size() + (kv_pair_offsets_.size() + 2) * sizeof(uint64_t);
+  }
+  // Table as written by Flush, only complete after Finalise.
+  Slice GetContent() const { return Slice(buffer_); }
   SSZoneMetaData* GetMeta() { return meta_; }
 
  private:
@@ -31,6 +47,17 @@ class TropoSSTableBuilder {
   // Used when encoding is used
   bool use_encoding_;
   std::string last_key_;
+  // Range tombstones and the key range they cover
+  std::vector<TropoRangeTombstone> tombstones_;
+  InternalKey tombstones_smallest_;
+  InternalKey tombstones_largest_;
+  const InternalKeyComparator* icmp_;
+  // Prefix filter, hashes of all distinct prefixes
+  const SliceTransform* prefix_extractor_;
+  std::string last_prefix_;
+  std::vector<uint64_t> prefix_hashes_;
+  // Column family of the keys, if the database has families
+  uint32_t family_;
   // References
   TropoSSTable* table_;
   SSZoneMetaData* meta_;
@@ -1,5 +1,6 @@
 #include "db/tropodb/table/tropodb_sstable_manager.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
@@ -15,43 +16,74 @@
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 #include "table/internal_iterator.h"
+#include "util/coding.h"
 
 namespace ROCKSDB_NAMESPACE {
 TropoSSTableManager::TropoSSTableManager(
-    SZD::SZDChannelFactory* channel_factory, const SZD::DeviceInfo& info,
-    const RangeArray& ranges)
-    : zone_cap_(info.zone_cap),
-      lba_size_(info.lba_size),
+    const std::vector<DeviceRegion>& devices, const RangeArray& ranges)
+    : zone_cap_(devices[0].info.zone_cap),
+      lba_size_(devices[0].info.lba_size),
       ranges_(ranges),
-      channel_factory_(channel_factory) {
-  assert(channel_factory_ != nullptr);
-  channel_factory_->Ref();
+      device_count_(devices.size()) {
   // Create tables
-  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
-    sstable_level_[i] = new TropoL0SSTable(channel_factory_, info,
-                                           ranges[i].first, ranges[i].second);
+  for (uint8_t d = 0; d < device_count_; d++) {
+    const DeviceRegion& device = devices[d];
+    device.channel_factory->Ref();
+    channel_factories_.push_back(device.channel_factory);
+    // The L0 logs and the LN log of the device share its reader channels
+    const size_t logs = device.l0_stripes.size() + 1;
+    const uint8_t l0_readers = TropoReaderPool::ReaderCount(
+        TropoDBConfig::number_of_concurrent_L0_readers, logs);
+    const uint8_t ln_readers = TropoReaderPool::ReaderCount(
+        TropoDBConfig::number_of_concurrent_LN_readers, logs);
+    for (uint8_t i : device.l0_stripes) {
+      sstable_level_[i] = new TropoL0SSTable(
+          device.channel_factory, device.info, ranges[i].first,
+          ranges[i].second, l0_readers);
+      l0_device_[i] = d;
+    }
+    const size_t ln = TropoDBConfig::lower_concurrency + d;
+    sstable_level_[ln] =
+        new TropoLNSSTable(device.channel_factory, device.info,
+                           ranges[ln].first, ranges[ln].second, ln_readers, d);
+    TROPO_LOG_INFO("INFO: SSTable manager: %u L0 and %u LN readers on %u\n",
+                   l0_readers, ln_readers, d);
   }
-  sstable_level_[TropoDBConfig::lower_concurrency] = new TropoLNSSTable(
-      channel_factory_, info, ranges[TropoDBConfig::lower_concurrency].first,
-      ranges[TropoDBConfig::lower_concurrency].second);
 
   // Move from zone regions to block ranges
-  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
-    ranges_[i] = std::make_pair(ranges_[i].first * info.zone_cap,
-                                ranges_[i].second * info.zone_cap);
+  for (auto& range : ranges_) {
+    range = std::make_pair(range.first * zone_cap_, range.second * zone_cap_);
   }
-  ranges_[TropoDBConfig::lower_concurrency] = std::make_pair(
-      ranges_[TropoDBConfig::lower_concurrency].first * info.zone_cap,
-      ranges_[TropoDBConfig::lower_concurrency].second * info.zone_cap);
 }
 
 TropoSSTableManager::~TropoSSTableManager() {
   TROPO_LOG_DEBUG("Deleting SSTable manager\n");
-  for (size_t i = 0; i < 1 + TropoDBConfig::lower_concurrency; i++) {
-    if (sstable_level_[i] != nullptr) delete sstable_level_[i];
+  for (auto table : sstable_level_) {
+    if (table != nullptr) delete table;
   }
-  channel_factory_->Unref();
-  channel_factory_ = nullptr;
+  for (auto channel_factory : channel_factories_) {
+    channel_factory->Unref();
+  }
+  channel_factories_.clear();
+}
+
+TropoSSTable* TropoSSTableManager::LogOf(const uint8_t level,
+                                         const SSZoneMetaData& meta) const {
+  assert(level < TropoDBConfig::level_count);
+  if (level == 0 && !IsBorrowedL0(meta)) {
+    return sstable_level_[meta.L0.log_number];
+  }
+  return LNLog(meta.LN.device);
+}
+
+TropoLNSSTable* TropoSSTableManager::LNLogForWrite() const {
+  TropoLNSSTable* log = LNLog(0);
+  for (uint8_t d = 1; d < device_count_; d++) {
+    if (LNLog(d)->SpaceAvailable() > log->SpaceAvailable()) {
+      log = LNLog(d);
+    }
+  }
+  return log;
 }
 
 Status TropoSSTableManager::Get(const uint8_t level,
@@ -59,25 +91,12 @@ Status TropoSSTableManager::Get(const uint8_t level,
                                 const Slice& key_ptr, std::string* value_ptr,
                                 const SSZoneMetaData& meta,
                                 EntryStatus* status) const {
-  assert(level < TropoDBConfig::level_count);
-  if (level == 0) {
-    return sstable_level_[meta.L0.log_number]->Get(icmp, key_ptr, value_ptr,
-                                                   meta, status);
-  } else {
-    return sstable_level_[TropoDBConfig::lower_concurrency]->Get(
-        icmp, key_ptr, value_ptr, meta, status);
-  }
+  return LogOf(level, meta)->Get(icmp, key_ptr, value_ptr, meta, status);
 }
 
 Status TropoSSTableManager::ReadSSTable(const uint8_t level, Slice* sstable,
                                         const SSZoneMetaData& meta) const {
-  assert(level < TropoDBConfig::level_count);
-  if (level == 0) {
-    return sstable_level_[meta.L0.log_number]->ReadSSTable(sstable, meta);
-  } else {
-    return sstable_level_[TropoDBConfig::lower_concurrency]->ReadSSTable(
-        sstable, meta);
-  }
+  return LogOf(level, meta)->ReadSSTable(sstable, meta);
 }
 
 Iterator* TropoSSTableManager::GetLNIterator(const Slice& file_value,
@@ -90,15 +109,49 @@ Iterator* TropoSSTableManager::GetLNIterator(const Slice& file_value,
 Iterator* TropoSSTableManager::NewIterator(const uint8_t level,
                                            const SSZoneMetaData& meta,
                                            const Comparator* cmp) const {
-  assert(level < TropoDBConfig::level_count);
-  if (level == 0) {
-    return sstable_level_[meta.L0.log_number]->NewIterator(meta, cmp);
-  } else {
-    return sstable_level_[TropoDBConfig::lower_concurrency]->NewIterator(meta,
-                                                                         cmp);
+  return LogOf(level, meta)->NewIterator(meta, cmp);
+}
+
+void TropoSSTableManager::NewIterators(
+    const std::vector<std::pair<uint8_t, const SSZoneMetaData*>>& tables,
+    const Comparator* cmp, std::vector<Iterator*>* iterators) const {
+  TropoReadGroup group;
+  std::vector<TropoReadRequest> reads(tables.size());
+  for (size_t i = 0; i < tables.size(); i++) {
+    reads[i].meta = tables[i].second;
+    reads[i].group = &group;
+    LogOf(tables[i].first, *tables[i].second)->ReadSSTableAsync(&reads[i]);
+  }
+  iterators->clear();
+  for (size_t i = 0; i < tables.size(); i++) {
+    group.Wait(reads[i]);
+    iterators->push_back(
+        reads[i].status.ok()
+            ? LogOf(tables[i].first, *tables[i].second)
+                  ->NewIterator(reads[i].sstable, cmp)
+            : nullptr);
   }
 }
 
+bool TropoSSTableManager::ReadQueueSaturated(
+    const uint8_t level, const SSZoneMetaData& meta) const {
+  return LogOf(level, meta)->ReadQueueSaturated();
+}
+
+void TropoSSTableManager::GetLNIterators(
+    const std::vector<std::string>& file_values, const Comparator* cmp,
+    std::vector<Iterator*>* iterators) const {
+  std::vector<std::pair<SSZoneMetaData, uint8_t>> decoded;
+  for (const std::string& file_value : file_values) {
+    decoded.push_back(LNZoneIterator::DecodeLNIterator(Slice(file_value)));
+  }
+  std::vector<std::pair<uint8_t, const SSZoneMetaData*>> tables;
+  for (const auto& table : decoded) {
+    tables.push_back(std::make_pair(table.second, &table.first));
+  }
+  NewIterators(tables, cmp, iterators);
+}
+
 Status TropoSSTableManager::RecoverL0() {
   Status s = Status::OK();
   // Recover L0
@@ -116,9 +169,19 @@ Status TropoSSTableManager::RecoverLN(const std::string& recovery_data) {
   if (recovery_data == "") {
     return Status::OK();
   }
-  Status s = static_cast<TropoLNSSTable*>(
-                 sstable_level_[TropoDBConfig::lower_concurrency])
-                 ->Recover(recovery_data);
+  Status s;
+  if (device_count_ == 1) {
+    s = LNLog(0)->Recover(recovery_data);
+  } else {
+    // One length prefixed state for each device
+    Slice input(recovery_data);
+    Slice device_data;
+    for (uint8_t d = 0; d < device_count_ && s.ok(); d++) {
+      s = GetLengthPrefixedSlice(&input, &device_data)
+              ? LNLog(d)->Recover(device_data.ToString())
+              : Status::Corruption("LN recovery data");
+    }
+  }
   if (!s.ok()) {
     TROPO_LOG_ERROR("ERROR: SSTable recovery: Can not recover LN\n");
   }
@@ -133,9 +196,14 @@ Status TropoSSTableManager::Recover(const std::string& recovery_data) {
 }
 
 std::string TropoSSTableManager::GetRecoveryData() {
-  TropoLNSSTable* table = static_cast<TropoLNSSTable*>(
-      sstable_level_[TropoDBConfig::lower_concurrency]);
-  return table->Encode();
+  if (device_count_ == 1) {
+    return LNLog(0)->Encode();
+  }
+  std::string data;
+  for (uint8_t d = 0; d < device_count_; d++) {
+    PutLengthPrefixedSlice(&data, LNLog(d)->Encode());
+  }
+  return data;
 }
 
 TropoSSTableBuilder* TropoSSTableManager::NewTropoSSTableBuilder(
@@ -143,15 +211,20 @@ TropoSSTableBuilder* TropoSSTableManager::NewTropoSSTableBuilder(
   assert(level < TropoDBConfig::level_count);
   if (level == 0) {
     return sstable_level_[meta->L0.log_number]->NewBuilder(meta);
-  } else if (level == 1) {
-    return sstable_level_[TropoDBConfig::lower_concurrency]->NewBuilder(meta);
   } else {
-    return static_cast<TropoLNSSTable*>(
-               sstable_level_[TropoDBConfig::lower_concurrency])
-        ->NewLNBuilder(meta);
+    return LNLogForWrite()->NewLNBuilder(meta,
+                                         TropoLNSSTable::WriterForLevel(level));
   }
 }
 
+Status TropoSSTableManager::WriteSSTable(const uint8_t level,
+                                         const Slice& content,
+                                         SSZoneMetaData* meta) const {
+  assert(level > 0 && level < TropoDBConfig::level_count);
+  return LNLogForWrite()->WriteSSTable(content, meta,
+                                       TropoLNSSTable::WriterForLevel(level));
+}
+
 Status TropoSSTableManager::CopySSTable(const uint8_t level1,
                                         const uint8_t level2,
                                         const SSZoneMetaData& meta,
@@ -175,7 +248,8 @@ Status TropoSSTableManager::CopySSTable(const uint8_t level1,
     }
     *new_meta = SSZoneMetaData::copy(meta);
 
-    s = sstable_level_[level2]->WriteSSTable(original, new_meta);
+    s = LNLogForWrite()->WriteSSTable(original, new_meta,
+                                      TropoLNSSTable::WriterForLevel(level2));
     delete[] original.data();
     return s;
   }
@@ -191,11 +265,11 @@ double TropoSSTableManager::GetFractionFilled(const uint8_t level) const {
       total_space += ranges_[i].second - ranges_[i].first;
     }
   } else {
-    space_available =
-        sstable_level_[TropoDBConfig::lower_concurrency]->SpaceAvailable() /
-        lba_size_;
-    total_space = ranges_[TropoDBConfig::lower_concurrency].second -
-                  ranges_[TropoDBConfig::lower_concurrency].first;
+    for (size_t i = TropoDBConfig::lower_concurrency;
+         i < TropoDBConfig::lower_concurrency + device_count_; i++) {
+      space_available += sstable_level_[i]->SpaceAvailable() / lba_size_;
+      total_space += ranges_[i].second - ranges_[i].first;
+    }
   }
   return (double)(total_space - space_available) / (double)total_space;
 }
@@ -212,8 +286,7 @@ bool TropoSSTableManager::EnoughSpaceAvailable(const uint8_t level,
     }
     return true;
   } else {
-    return sstable_level_[TropoDBConfig::lower_concurrency]
-        ->EnoughSpaceAvailable(slice);
+    return LNLogForWrite()->EnoughSpaceAvailable(slice);
   }
 }
 
@@ -232,10 +305,100 @@ Status TropoSSTableManager::FlushMemTable(TropoMemtable* mem,
       ->FlushMemTable(mem, metas, parallel_number, env);
 }
 
+Status TropoSSTableManager::FlushMemTables(
+    const std::vector<TropoMemtable*>& mems, std::vector<SSZoneMetaData>& metas,
+    uint8_t parallel_number, Env* env) const {
+  assert(parallel_number < TropoDBConfig::lower_concurrency);
+  return GetL0SSTableLog(parallel_number)
+      ->FlushMemTables(mems, metas, parallel_number, env);
+}
+
+Status TropoSSTableManager::FlushMemTableBorrowed(
+    TropoMemtable* mem, std::vector<SSZoneMetaData>& metas) const {
+  MutexLock l(&borrow_mutex_);
+  TropoLNSSTable* ln = LNLogForWrite();
+  SSZoneMetaData meta;
+  TropoSSTableBuilder* builder =
+      ln->NewLNBuilder(&meta, TropoLNSSTable::kBorrowed);
+  // Tables get the part of the tombstones in [lower, upper) of their keys
+  const InternalKeyComparator& icmp = mem->GetInternalKeyComparator();
+  std::vector<TropoRangeTombstone> tombstones;
+  mem->GetRangeTombstones(&tombstones);
+  std::string lower;
+  bool has_lower = false;
+  auto add_tombstones = [&](const Slice* upper) {
+    Slice lower_slice(lower);
+    std::vector<TropoRangeTombstone> clipped;
+    ClipRangeTombstones(icmp.user_comparator(), tombstones,
+                        has_lower ? &lower_slice : nullptr, upper, &clipped);
+    for (const auto& tombstone : clipped) {
+      builder->AddRangeTombstone(icmp, tombstone);
+    }
+  };
+  auto flush = [&]() -> Status {
+    Status fs = builder->Finalise();
+    fs = fs.ok() ? builder->Flush() : fs;
+    delete builder;
+    if (fs.ok()) {
+      meta.L0.log_number = kL0BorrowedLog;
+      metas.push_back(SSZoneMetaData::copy(meta));
+    } else {
+      TROPO_LOG_ERROR("ERROR: L0 SSTable: Error flushing to borrowed zones\n");
+    }
+    meta = SSZoneMetaData();
+    builder = ln->NewLNBuilder(&meta, TropoLNSSTable::kBorrowed);
+    return fs;
+  };
+
+  Status s = Status::OK();
+  InternalIterator* iter = mem->NewIterator();
+  for (iter->SeekToFirst(); iter->Valid() && s.ok(); iter->Next()) {
+    const Slice& key = iter->key();
+    const Slice& value = iter->value();
+    if (builder->CrossesFamily(key) ||
+        (builder->GetSize() > 0 &&
+         builder->GetSize() + builder->EstimateSizeImpact(key, value) >
+             TropoDBConfig::max_bytes_sstable_l0)) {
+      const Slice upper = ExtractUserKey(key);
+      add_tombstones(&upper);
+      lower = upper.ToString();
+      has_lower = true;
+      s = flush();
+    }
+    s = s.ok() ? builder->Apply(key, value) : s;
+  }
+  // Iterator lives in the arena of the memtable
+  iter->~InternalIterator();
+  add_tombstones(nullptr);
+  if (s.ok() && (builder->GetSize() > 0 || builder->HasRangeTombstones())) {
+    s = flush();
+  }
+  delete builder;
+  return s;
+}
+
 Status TropoSSTableManager::DeleteL0Table(
-    const std::vector<SSZoneMetaData*>& metas_to_delete,
+    const std::vector<SSZoneMetaData*>& all_metas_to_delete,
     std::vector<SSZoneMetaData*>& remaining_metas) const {
   Status s = Status::OK();
+  // Borrowed zones go back to LN directly, they are not bound to a tail. This
+  // runs in the L0 thread, so it uses the channel of that thread.
+  std::vector<SSZoneMetaData*> metas_to_delete;
+  for (auto& m : all_metas_to_delete) {
+    if (!IsBorrowedL0(*m)) {
+      metas_to_delete.push_back(m);
+      continue;
+    }
+    s = LNLog(m->LN.device)
+            ->InvalidateSSZone(*m, TropoLNSSTable::kShortLived);
+    if (!s.ok()) {
+      TROPO_LOG_ERROR("ERROR: Resetting borrowed SSTables from L0\n");
+      return s;
+    }
+  }
+  if (metas_to_delete.empty()) {
+    return s;
+  }
   // Nothing to distribute
   if (TropoDBConfig::lower_concurrency == 1) {
     s = static_cast<TropoL0SSTable*>(sstable_level_[0])
@@ -296,18 +459,42 @@ Status TropoSSTableManager::DeleteLNTable(const uint8_t level,
     TROPO_LOG_ERROR("Error: %s : Invalid level for LN delete\n", __func__);
     return Status::InvalidArgument();
   }
-  return sstable_level_[TropoDBConfig::lower_concurrency]->InvalidateSSZone(
-      meta);
+  return LNLog(meta.LN.device)->InvalidateSSZone(meta);
 }
 
 uint64_t TropoSSTableManager::SpaceRemainingInBytesLN() const {
-  return sstable_level_[TropoDBConfig::lower_concurrency]->SpaceAvailable();
+  uint64_t space = 0;
+  for (uint8_t d = 0; d < device_count_; d++) {
+    space += LNLog(d)->SpaceAvailable();
+  }
+  return space;
 }
 
 uint64_t TropoSSTableManager::SpaceRemainingLN() const {
   return SpaceRemainingInBytesLN() / lba_size_;
 }
 
+void TropoSSTableManager::SetPrefixExtractor(
+    const SliceTransform* prefix_extractor) {
+  prefix_extractor_ = prefix_extractor;
+  for (auto table : sstable_level_) {
+    if (table != nullptr) table->SetPrefixExtractor(prefix_extractor);
+  }
+}
+
+void TropoSSTableManager::SetRateLimiter(RateLimiter* rate_limiter) {
+  for (auto table : sstable_level_) {
+    if (table != nullptr) table->SetRateLimiter(rate_limiter);
+  }
+}
+
+void TropoSSTableManager::SetColumnFamilies(
+    const TropoColumnFamilySet* column_families) {
+  for (auto table : sstable_level_) {
+    if (table != nullptr) table->SetColumnFamilies(column_families);
+  }
+}
+
 uint64_t TropoSSTableManager::GetBytesInLevel(
     const std::vector<SSZoneMetaData*>& metas) {
   // Bytes is equal to all used lbas and the lba size
@@ -323,30 +510,42 @@ std::vector<TropoDiagnostics> TropoSSTableManager::IODiagnostics() {
   // L0 diagnostics
   for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
     TropoDiagnostics diag = sstable_level_[i]->GetDiagnostics();
-    diag.name_ = "L0-" + std::to_string(i);
+    diag.name_ = LogName(i);
     diags.push_back(diag);
   }
   // LN diagnostics
-  {
-    TropoDiagnostics diag =
-        sstable_level_[TropoDBConfig::lower_concurrency]->GetDiagnostics();
-    diag.name_ = "LN";
+  for (size_t i = TropoDBConfig::lower_concurrency;
+       i < TropoDBConfig::lower_concurrency + device_count_; i++) {
+    TropoDiagnostics diag = sstable_level_[i]->GetDiagnostics();
+    diag.name_ = LogName(i);
     diags.push_back(diag);
   }
   return diags;
 }
 
+std::string TropoSSTableManager::LogName(const size_t index) const {
+  const bool l0 = index < TropoDBConfig::lower_concurrency;
+  std::string name = l0 ? "L0-" + std::to_string(index) : "LN";
+  // With multiple devices, the device is appended
+  if (device_count_ > 1) {
+    name += "@" + std::to_string(
+                      l0 ? l0_device_[index]
+                         : index - TropoDBConfig::lower_concurrency);
+  }
+  return name;
+}
+
 std::string TropoSSTableManager::LayoutDivisionString() {
   std::ostringstream div;
-  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
-    div << std::left << ("L0-" + std::to_string(i)) << std::setw(13) << ""
-        << std::right << std::setw(25) << (ranges_[i].first / zone_cap_)
-        << std::setw(25) << (ranges_[i].second / zone_cap_) << "\n";
-  }
-  div << std::left << "LN" << std::setw(13) << "" << std::right << std::setw(25)
-      << (ranges_[TropoDBConfig::lower_concurrency].first / zone_cap_)
-      << std::setw(25)
-      << (ranges_[TropoDBConfig::lower_concurrency].second / zone_cap_) << "\n";
+  for (size_t i = 0; i < TropoDBConfig::lower_concurrency + device_count_;
+       i++) {
+    div << std::left << std::setw(15) << LogName(i) << std::right
+        << std::setw(25) << (ranges_[i].first / zone_cap_) << std::setw(25)
+        << (ranges_[i].second / zone_cap_) << "\n";
+  }
+  div << std::left << "L0-borrowed" << std::setw(4) << "" << std::right
+      << std::setw(25) << "up to" << std::setw(25)
+      << TropoDBConfig::L0_borrow_zones << "\n";
   return div.str();
 }
 
@@ -402,47 +601,65 @@ size_t TropoSSTableManager::FindSSTableIndex(
 
 std::optional<TropoSSTableManager*>
 TropoSSTableManager::NewTropoDBSSTableManager(
-    SZD::SZDChannelFactory* channel_factory, const SZD::DeviceInfo& info,
-    const uint64_t min_zone, const uint64_t max_zone) {
-  uint64_t num_zones = max_zone - min_zone;
-  RangeArray ranges;
-  // Validate
-  if (min_zone > max_zone ||
-      num_zones <
-          TropoDBConfig::level_count * TropoDBConfig::min_ss_zone_count ||
-      channel_factory == nullptr) {
-    TROPO_LOG_ERROR(
-        "ERROR: Creating SSTable division: not enough zones assigned "
-        "%lu\\%lu\n",
-        num_zones,
-        TropoDBConfig::level_count * TropoDBConfig::min_ss_zone_count);
+    const std::vector<DeviceRegion>& devices) {
+  RangeArray ranges{};
+  if (devices.empty() || devices.size() > TropoDBConfig::max_devices) {
+    TROPO_LOG_ERROR("ERROR: Creating SSTable division: %lu devices\n",
+                    devices.size());
     return {};
   }
-  // Distribute for L0
-  uint64_t zone_head = min_zone;
-  uint64_t zone_step = TropoDBConfig::L0_zones;
-  zone_step = zone_step < TropoDBConfig::min_ss_zone_count
-                  ? TropoDBConfig::min_ss_zone_count
-                  : zone_step;
-  zone_step /= TropoDBConfig::lower_concurrency;
-  for (size_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
-    ranges[i] = std::make_pair(zone_head, zone_head + zone_step);
-    zone_head += zone_step;
-  }
-  // LN will get the remainder
-  zone_step = max_zone - zone_head;
-  ranges[TropoDBConfig::lower_concurrency] =
-      std::make_pair(zone_head, zone_head + zone_step);
-  // Verify that no rounding errors occurred
-  zone_head += zone_step;
-  if (zone_head != max_zone) {
-    TROPO_LOG_ERROR(
-        "ERROR: Creating SSTable division: Rounding error %lu != %lu \n",
-        zone_head, max_zone);
+  uint64_t l0_step = TropoDBConfig::L0_zones;
+  l0_step = l0_step < TropoDBConfig::min_ss_zone_count
+                ? TropoDBConfig::min_ss_zone_count
+                : l0_step;
+  l0_step /= TropoDBConfig::lower_concurrency;
+  std::array<bool, TropoDBConfig::lower_concurrency> placed{};
+  for (size_t d = 0; d < devices.size(); d++) {
+    const DeviceRegion& device = devices[d];
+    uint64_t num_zones = device.max_zone - device.min_zone;
+    // Validate
+    if (device.min_zone > device.max_zone ||
+        num_zones <
+            TropoDBConfig::level_count * TropoDBConfig::min_ss_zone_count ||
+        device.channel_factory == nullptr) {
+      TROPO_LOG_ERROR(
+          "ERROR: Creating SSTable division: not enough zones assigned "
+          "%lu\\%lu on device %lu\n",
+          num_zones,
+          TropoDBConfig::level_count * TropoDBConfig::min_ss_zone_count, d);
+      return {};
+    }
+    // Tables are addressed in zones, so the geometry must be equal
+    if (device.info.zone_cap != devices[0].info.zone_cap ||
+        device.info.lba_size != devices[0].info.lba_size) {
+      TROPO_LOG_ERROR(
+          "ERROR: Creating SSTable division: device %lu has another zone "
+          "layout than device 0\n",
+          d);
+      return {};
+    }
+    // Distribute for L0
+    uint64_t zone_head = device.min_zone;
+    for (uint8_t i : device.l0_stripes) {
+      if (i >= TropoDBConfig::lower_concurrency || placed[i]) {
+        TROPO_LOG_ERROR("ERROR: Creating SSTable division: invalid L0-%u\n",
+                        i);
+        return {};
+      }
+      placed[i] = true;
+      ranges[i] = std::make_pair(zone_head, zone_head + l0_step);
+      zone_head += l0_step;
+    }
+    // LN will get the remainder
+    ranges[TropoDBConfig::lower_concurrency + d] =
+        std::make_pair(zone_head, device.max_zone);
+  }
+  if (std::find(placed.begin(), placed.end(), false) != placed.end()) {
+    TROPO_LOG_ERROR("ERROR: Creating SSTable division: L0 log not placed\n");
     return {};
   }
   // Now create
-  return new TropoSSTableManager(channel_factory, info, ranges);
+  return new TropoSSTableManager(devices, ranges);
 }
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -4,6 +4,7 @@
 #define TROPODB_SSTABLE_MANAGER_H
 
 #include <optional>
+#include <vector>
 
 #include "db/tropodb/tropodb_config.h"
 #include "db/tropodb/utils/tropodb_diagnostics.h"
@@ -14,16 +15,26 @@
 #include "db/tropodb/table/tropodb_ln_sstable.h"
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "port/port.h"
 #include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
 #include "rocksdb/status.h"
 
 namespace ROCKSDB_NAMESPACE {
 class TropoSSTableManagerInternal;
 class TropoSSTableManager : public RefCounter {
  public:
+  // Zones of one device given to SSTables. The L0 logs of l0_stripes are
+  // placed first, the remainder is the LN log of the device.
+  struct DeviceRegion {
+    SZD::SZDChannelFactory* channel_factory;
+    SZD::DeviceInfo info;
+    uint64_t min_zone;
+    uint64_t max_zone;
+    std::vector<uint8_t> l0_stripes;
+  };
   static std::optional<TropoSSTableManager*> NewTropoDBSSTableManager(
-      SZD::SZDChannelFactory* channel_factory, const SZD::DeviceInfo& info,
-      const uint64_t min_zone, const uint64_t max_zone);
+      const std::vector<DeviceRegion>& devices);
   static size_t FindSSTableIndex(const Comparator* cmp,
                                  const std::vector<SSZoneMetaData*>& ss,
                                  const Slice& key);
@@ -35,6 +46,14 @@ class TropoSSTableManager : public RefCounter {
              EntryStatus* entry) const;
   Iterator* NewIterator(const uint8_t level, const SSZoneMetaData& meta,
                         const Comparator* cmp) const;
+  // Reads the tables concurrently through the read queues of their logs.
+  // Iterators of tables that could not be read are nullptr.
+  void NewIterators(
+      const std::vector<std::pair<uint8_t, const SSZoneMetaData*>>& tables,
+      const Comparator* cmp, std::vector<Iterator*>* iterators) const;
+  // True if a read of the table would wait for earlier asynchronous reads.
+  bool ReadQueueSaturated(const uint8_t level,
+                          const SSZoneMetaData& meta) const;
  
   // Used for persistency
   Status Recover(const std::string& recovery_data);
@@ -45,6 +64,9 @@ class TropoSSTableManager : public RefCounter {
   Status CopySSTable(const uint8_t level1, const uint8_t level2,
                      const SSZoneMetaData& meta,
                      SSZoneMetaData* new_meta) const;
+  // Appends a complete table (e.g. from an external file) to LN.
+  Status WriteSSTable(const uint8_t level, const Slice& content,
+                      SSZoneMetaData* meta) const;
   double GetFractionFilled(const uint8_t level) const;
   bool EnoughSpaceAvailable(const uint8_t level, const Slice& slice) const;
 
@@ -52,6 +74,14 @@ class TropoSSTableManager : public RefCounter {
   TropoL0SSTable* GetL0SSTableLog(uint8_t parallel_number) const;
   Status FlushMemTable(TropoMemtable* mem, std::vector<SSZoneMetaData>& metas,
                        uint8_t parallel_number, Env* env) const;
+  // Flushes memtables of several stripes as one run to the L0 log of
+  // parallel_number.
+  Status FlushMemTables(const std::vector<TropoMemtable*>& mems,
+                        std::vector<SSZoneMetaData>& metas,
+                        uint8_t parallel_number, Env* env) const;
+  // Flushes to zones borrowed from LN, used when the L0 log is full.
+  Status FlushMemTableBorrowed(TropoMemtable* mem,
+                               std::vector<SSZoneMetaData>& metas) const;
   Status DeleteL0Table(const std::vector<SSZoneMetaData*>& metas_to_delete,
                        std::vector<SSZoneMetaData*>& remaining_metas) const;
   double GetFractionFilledL0(const uint8_t parallel_number) const;
@@ -61,10 +91,21 @@ class TropoSSTableManager : public RefCounter {
   // LN specific
   Iterator* GetLNIterator(const Slice& file_value,
                                        const Comparator* cmp);
+  void GetLNIterators(const std::vector<std::string>& file_values,
+                      const Comparator* cmp,
+                      std::vector<Iterator*>* iterators) const;
   Status DeleteLNTable(const uint8_t level, const SSZoneMetaData& meta) const;
   uint64_t SpaceRemainingLN() const;
   uint64_t SpaceRemainingInBytesLN() const;
   
+  // Prefix filters, set once before any table is built
+  void SetPrefixExtractor(const SliceTransform* prefix_extractor);
+  // Paces all flush and compaction writes, tenants of a device can share it.
+  void SetRateLimiter(RateLimiter* rate_limiter);
+  // Tables are cut where the column family of the keys changes.
+  void SetColumnFamilies(const TropoColumnFamilySet* column_families);
+  const SliceTransform* GetPrefixExtractor() const { return prefix_extractor_; }
+
   // util
   uint64_t GetBytesInLevel(const std::vector<SSZoneMetaData*>& metas);
   std::vector<TropoDiagnostics> IODiagnostics();
@@ -74,13 +115,27 @@ class TropoSSTableManager : public RefCounter {
   TimingCounter GetFlushWritePerfCounter();
   TimingCounter GetFlushFinishPerfCounter();
  private:
-  using RangeArray = std::array<std::pair<uint64_t, uint64_t>,
-                                1 + TropoDBConfig::lower_concurrency>;
+  // L0 logs first, followed by the LN log of each device
+  using RangeArray =
+      std::array<std::pair<uint64_t, uint64_t>,
+                 TropoDBConfig::lower_concurrency + TropoDBConfig::max_devices>;
   using SSTableArray =
-      std::array<TropoSSTable*, 1 + TropoDBConfig::lower_concurrency>;
+      std::array<TropoSSTable*,
+                 TropoDBConfig::lower_concurrency + TropoDBConfig::max_devices>;
+
+  TropoSSTableManager(const std::vector<DeviceRegion>& devices,
+                      const RangeArray& ranges);
 
-  TropoSSTableManager(SZD::SZDChannelFactory* channel_factory,
-                    const SZD::DeviceInfo& info, const RangeArray& ranges);
+  inline TropoLNSSTable* LNLog(const uint8_t device) const {
+    assert(device < device_count_);
+    return static_cast<TropoLNSSTable*>(
+        sstable_level_[TropoDBConfig::lower_concurrency + device]);
+  }
+  // Log holding meta, borrowed L0 tables are in LN
+  TropoSSTable* LogOf(const uint8_t level, const SSZoneMetaData& meta) const;
+  // New LN tables go to the device with the most free space
+  TropoLNSSTable* LNLogForWrite() const;
+  std::string LogName(const size_t index) const;
 
    // Recovery
    Status RecoverL0();
@@ -94,9 +149,14 @@ class TropoSSTableManager : public RefCounter {
   const uint64_t lba_size_;
   // sstables
   RangeArray ranges_;
-  SSTableArray sstable_level_;
+  SSTableArray sstable_level_{};
+  std::array<uint8_t, TropoDBConfig::lower_concurrency> l0_device_{};
+  const uint8_t device_count_;
   // references
-  SZD::SZDChannelFactory* channel_factory_;
+  std::vector<SZD::SZDChannelFactory*> channel_factories_;
+  const SliceTransform* prefix_extractor_{nullptr};
+  // Only one flush can use the borrow writer of LN at a time
+  mutable port::Mutex borrow_mutex_;
 };
 }  // namespace ROCKSDB_NAMESPACE
 #endif
@@ -26,11 +26,11 @@ static void DeleteEntry(const Slice& key, void* value) {
   delete it;
 }
 
-// static void UnrefEntry(void* arg1, void* arg2) {
-//   Cache* cache = reinterpret_cast<Cache*>(arg1);
-//   Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
-//   cache->Release(h);
-// }
+static void UnrefEntry(void* arg1, void* arg2) {
+  Cache* cache = reinterpret_cast<Cache*>(arg1);
+  Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
+  cache->Release(h);
+}
 
 TropoTableCache::TropoTableCache(const Options& options,
                                  const InternalKeyComparator& icmp,
@@ -84,8 +84,10 @@ Iterator* TropoTableCache::NewIterator(const ReadOptions& options,
 
 Status TropoTableCache::Get(const ReadOptions& options,
                             const SSZoneMetaData& meta, const uint8_t level,
-                            const Slice& key, std::string* value,
-                            EntryStatus* status) {
+                            const Slice& key, PinnableSlice* value,
+                            EntryStatus* status, SequenceNumber* seq,
+                            MergeContext* merge_context,
+                            SequenceNumber max_covering_tombstone_seq) {
   Cache::Handle* handle = nullptr;
   Status s = FindSSZone(meta, level, &handle);
   if (s.ok()) {
@@ -93,31 +95,83 @@ Status TropoTableCache::Get(const ReadOptions& options,
         reinterpret_cast<LockedIterator*>(cache_->Value(handle));
     lit->mutex_.Lock();
     Iterator* it = lit->it;
-    it->Seek(key);
-    if (it->Valid()) {
+    const Slice user_key = ExtractUserKey(key);
+    *status = EntryStatus::notfound;
+    // Merge operands are gathered until a value or deletion is found.
+    for (it->Seek(key); it->Valid(); it->Next()) {
       ParsedInternalKey parsed_key;
       if (!ParseInternalKey(it->key(), &parsed_key, false).ok()) {
-        *status = EntryStatus::notfound;
         TROPO_LOG_ERROR(
             "ERROR: SSTable cache: corrupt key in table cache, for level %u "
             "and table %lu, str %s\n",
             level, meta.number, it->key().ToString().data());
-      } else if (parsed_key.type == kTypeDeletion) {
+        break;
+      }
+      if (icmp_.user_comparator()->Compare(parsed_key.user_key, user_key) !=
+          0) {
+        break;
+      }
+      if (seq != nullptr) {
+        *seq = parsed_key.sequence;
+      }
+      if (parsed_key.sequence < max_covering_tombstone_seq ||
+          parsed_key.type == kTypeDeletion) {
+        // Deleted by a key or range tombstone
         *status = EntryStatus::deleted;
-        value->clear();
+        break;
+      } else if (parsed_key.type == kTypeMerge && merge_context != nullptr) {
+        merge_context->PushOperand(it->value());
       } else {
         *status = EntryStatus::found;
-        *value = it->value().ToString();
+        // The value lives in the table data, which is only freed once the
+        // cache entry is released.
+        value->PinSlice(it->value(), &UnrefEntry, cache_.get(), handle);
+        handle = nullptr;
+        break;
       }
-    } else {
-      *status = EntryStatus::notfound;
     }
     lit->mutex_.Unlock();
-    cache_->Release(handle);
+    if (handle != nullptr) {
+      cache_->Release(handle);
+    }
   }
   return s;
 }
 
+Status TropoTableCache::Insert(const SSZoneMetaData& meta, Iterator* it) {
+  char buf[sizeof(meta.number)];
+  EncodeFixed64(buf, meta.number);
+  LockedIterator* lit = new LockedIterator;
+  lit->it = it;
+  return cache_->Insert(Slice(buf, sizeof(buf)), lit, 1, &DeleteEntry);
+}
+
+void TropoTableCache::Prefetch(
+    const std::vector<std::pair<uint8_t, const SSZoneMetaData*>>& tables) {
+  std::vector<std::pair<uint8_t, const SSZoneMetaData*>> missing;
+  for (const auto& table : tables) {
+    char buf[sizeof(table.second->number)];
+    EncodeFixed64(buf, table.second->number);
+    Cache::Handle* handle = cache_->Lookup(Slice(buf, sizeof(buf)));
+    if (handle != nullptr) {
+      cache_->Release(handle);
+    } else if (!ssmanager_->ReadQueueSaturated(table.first, *table.second)) {
+      missing.push_back(table);
+    }
+  }
+  // A single table is read just as fast on demand
+  if (missing.size() < 2) {
+    return;
+  }
+  std::vector<Iterator*> iterators;
+  ssmanager_->NewIterators(missing, icmp_.user_comparator(), &iterators);
+  for (size_t i = 0; i < iterators.size(); i++) {
+    if (iterators[i] != nullptr) {
+      Insert(*missing[i].second, iterators[i]);
+    }
+  }
+}
+
 void TropoTableCache::Evict(const uint64_t ss_number) {
   char buf[sizeof(ss_number)];
   EncodeFixed64(buf, ss_number);
@@ -12,6 +12,7 @@
 #include <memory>
 
 #include "db/dbformat.h"
+#include "db/merge_context.h"
 #include "db/tropodb/table/tropodb_sstable.h"
 #include "db/tropodb/table/tropodb_sstable_manager.h"
 #include "rocksdb/cache.h"
@@ -30,10 +31,23 @@ class TropoTableCache {
   Iterator* NewIterator(const ReadOptions& options, const SSZoneMetaData& meta,
                         const uint8_t level, TropoSSTable** tableptr = nullptr);
 
+  // Entries older than max_covering_tombstone_seq are reported as deleted.
+  // With a merge_context, merge operands are pushed to it until a value or
+  // deletion is found for the key. A found value is not copied, value pins
+  // the cached table until it is reset.
   Status Get(const ReadOptions& options, const SSZoneMetaData& meta,
-             const uint8_t level, const Slice& key, std::string* value,
-             EntryStatus* status);
+             const uint8_t level, const Slice& key, PinnableSlice* value,
+             EntryStatus* status, SequenceNumber* seq = nullptr,
+             MergeContext* merge_context = nullptr,
+             SequenceNumber max_covering_tombstone_seq = 0);
 
+  // Caches an iterator over a table that is already in memory, the cache
+  // takes ownership of it.
+  Status Insert(const SSZoneMetaData& meta, Iterator* it);
+  // Reads the tables that are not cached yet concurrently and caches them.
+  // Tables whose read queue is saturated are left to be read on demand.
+  void Prefetch(
+      const std::vector<std::pair<uint8_t, const SSZoneMetaData*>>& tables);
   void Evict(const uint64_t ss_number);
 
  private:
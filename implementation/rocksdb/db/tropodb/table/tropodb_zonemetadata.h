@@ -3,9 +3,24 @@
 #ifndef TROPODB_ZONEMETADATA_H
 #define TROPODB_ZONEMETADATA_H
 
+#include <string>
+#include <vector>
+
 #include "db/dbformat.h"
+#include "db/tropodb/tropodb_config.h"
+#include "rocksdb/comparator.h"
 
 namespace ROCKSDB_NAMESPACE {
+// Deletes all user keys in [start, end) with a sequence number below seq.
+struct TropoRangeTombstone {
+  TropoRangeTombstone() : seq(0) {}
+  TropoRangeTombstone(const Slice& s, const Slice& e, SequenceNumber sq)
+      : start(s.ToString()), end(e.ToString()), seq(sq) {}
+  std::string start;
+  std::string end;
+  SequenceNumber seq;
+};
+
 struct SSZoneMetaData {
   SSZoneMetaData()
       : refs(0), allowed_seeks(1 << 30), number(0), numbers(0), lba_count(0) {}
@@ -15,11 +30,13 @@ struct SSZoneMetaData {
     mnew.allowed_seeks = m.allowed_seeks;
     mnew.number = m.number;
     mnew.L0 = {.lba = m.L0.lba, .log_number = m.L0.log_number};
-    mnew.LN = {.lba_regions = m.LN.lba_regions};
+    mnew.LN = {.lba_regions = m.LN.lba_regions, .device = m.LN.device};
     mnew.numbers = m.numbers;
     mnew.lba_count = m.lba_count;
     mnew.smallest = m.smallest;
     mnew.largest = m.largest;
+    mnew.range_tombstones = m.range_tombstones;
+    mnew.prefix_filter = m.prefix_filter;
     for (size_t i = 0; i < m.LN.lba_regions; i++) {
       mnew.LN.lbas[i] = m.LN.lbas[i];
       mnew.LN.lba_region_sizes[i] = m.LN.lba_region_sizes[i];
@@ -38,13 +55,76 @@ struct SSZoneMetaData {
     uint8_t lba_regions{0};        // Number of start lbas (legal from 1 to 8)
     uint64_t lbas[8];              // start lbas (can be multiple, up to 8)
     uint64_t lba_region_sizes[8];  // Size in zones of an lbas region
+    uint8_t device{0};             // Device holding the lba regions
   } LN;
   uint64_t numbers;      // number of kv pairs
   uint64_t lba_count;    // data size in lbas
   InternalKey smallest;  // Smallest internal key served by table
   InternalKey largest;   // Largest internal key served by table
+  std::vector<TropoRangeTombstone> range_tombstones;  // DeleteRange's in table
+  std::string prefix_filter;  // Bloom filter over key prefixes, can be empty
 };
 
+// L0 tables with this log number are not stored in an L0 circular log, but in
+// zones borrowed from LN. They use the LN lba regions.
+constexpr uint8_t kL0BorrowedLog = TropoDBConfig::lower_concurrency;
+
+inline bool IsBorrowedL0(const SSZoneMetaData& meta) {
+  return meta.L0.log_number == kL0BorrowedLog;
+}
+
+// Highest sequence number (<= snapshot) of a tombstone in meta covering key.
+inline SequenceNumber MaxCoveringTombstoneSeq(const Comparator* ucmp,
+                                              const SSZoneMetaData& meta,
+                                              const Slice& user_key,
+                                              SequenceNumber snapshot) {
+  SequenceNumber max_seq = 0;
+  for (const auto& t : meta.range_tombstones) {
+    if (t.seq > max_seq && t.seq <= snapshot &&
+        ucmp->Compare(user_key, t.start) >= 0 &&
+        ucmp->Compare(user_key, t.end) < 0) {
+      max_seq = t.seq;
+    }
+  }
+  return max_seq;
+}
+
+// Whether a single tombstone of upper covers all of table and is newer than it.
+inline bool CoveredByRangeTombstone(const Comparator* ucmp,
+                                    const SSZoneMetaData& table,
+                                    const SSZoneMetaData& upper) {
+  for (const auto& t : upper.range_tombstones) {
+    if (ucmp->Compare(table.smallest.user_key(), t.start) >= 0 &&
+        ucmp->Compare(table.largest.user_key(), t.end) < 0 &&
+        GetInternalKeySeqno(table.smallest.Encode()) < t.seq &&
+        GetInternalKeySeqno(table.largest.Encode()) < t.seq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Appends the part of each tombstone that lies in [lower, upper) to clipped.
+// A null bound is unbounded, empty remainders are skipped.
+inline void ClipRangeTombstones(
+    const Comparator* ucmp, const std::vector<TropoRangeTombstone>& tombstones,
+    const Slice* lower, const Slice* upper,
+    std::vector<TropoRangeTombstone>* clipped) {
+  for (const auto& t : tombstones) {
+    Slice start(t.start);
+    Slice end(t.end);
+    if (lower != nullptr && ucmp->Compare(start, *lower) < 0) {
+      start = *lower;
+    }
+    if (upper != nullptr && ucmp->Compare(end, *upper) > 0) {
+      end = *upper;
+    }
+    if (ucmp->Compare(start, end) < 0) {
+      clipped->emplace_back(start, end, t.seq);
+    }
+  }
+}
+
 }  // namespace ROCKSDB_NAMESPACE
 #endif
 #endif
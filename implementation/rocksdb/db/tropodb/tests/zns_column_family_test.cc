@@ -0,0 +1,164 @@
+#include "db/tropodb/index/tropodb_column_family.h"
+#include "test_util/testharness.h"
+#include "utilities/merge_operators.h"
+
+namespace ROCKSDB_NAMESPACE {
+class ColumnFamilyTest : public testing::Test {};
+
+// Records all operations of a batch as "<op>:<cf>:<key>[:<value>]"
+class RecordHandler : public WriteBatch::Handler {
+ public:
+  Status PutCF(uint32_t column_family_id, const Slice& key,
+               const Slice& value) override {
+    Record("put", column_family_id, key, value);
+    return Status::OK();
+  }
+  Status DeleteCF(uint32_t column_family_id, const Slice& key) override {
+    Record("delete", column_family_id, key, Slice());
+    return Status::OK();
+  }
+  Status MergeCF(uint32_t column_family_id, const Slice& key,
+                 const Slice& value) override {
+    Record("merge", column_family_id, key, value);
+    return Status::OK();
+  }
+  Status DeleteRangeCF(uint32_t column_family_id, const Slice& begin_key,
+                       const Slice& end_key) override {
+    Record("delete_range", column_family_id, begin_key, end_key);
+    return Status::OK();
+  }
+  std::vector<std::string> ops;
+
+ private:
+  void Record(const char* op, uint32_t column_family_id, const Slice& key,
+              const Slice& value) {
+    std::string record = op;
+    record += ":" + std::to_string(column_family_id) + ":" + key.ToString();
+    if (!value.empty()) {
+      record += ":" + value.ToString();
+    }
+    ops.push_back(record);
+  }
+};
+
+static std::string FamilyKey(const TropoColumnFamilySet& families,
+                             uint32_t id, const Slice& user_key) {
+  std::string key;
+  families.AppendKey(id, user_key, &key);
+  return key;
+}
+
+TEST_F(ColumnFamilyTest, UnkeyedKeys) {
+  // Databases from before column families store plain keys
+  TropoColumnFamilySet families;
+  families.Add(0, nullptr);
+  ASSERT_EQ(FamilyKey(families, 0, "key"), "key");
+  uint32_t id = 7;
+  Slice user_key;
+  ASSERT_TRUE(families.ParseKey("key", &id, &user_key));
+  ASSERT_EQ(id, 0U);
+  ASSERT_EQ(user_key, "key");
+}
+
+TEST_F(ColumnFamilyTest, KeyedKeys) {
+  const Comparator* ucmp = BytewiseComparator();
+  TropoColumnFamilySet families;
+  families.SetKeyed(true);
+  const std::vector<uint32_t> ids = {0, 1, 2, 127, 128, 255, 300, 1 << 21};
+  for (uint32_t id : ids) {
+    const std::string key = FamilyKey(families, id, "key");
+    uint32_t parsed_id;
+    Slice user_key;
+    ASSERT_TRUE(families.ParseKey(key, &parsed_id, &user_key));
+    ASSERT_EQ(parsed_id, id);
+    ASSERT_EQ(user_key, "key");
+  }
+  // Every family is one contiguous key range, that holds no other family.
+  const std::vector<std::string> user_keys = {"", "a", "\xff\xff", "zz"};
+  for (uint32_t id : ids) {
+    std::string begin;
+    std::string end;
+    TropoColumnFamilySet::KeyRange(id, &begin, &end);
+    ASSERT_LT(ucmp->Compare(begin, end), 0);
+    for (uint32_t other : ids) {
+      for (const std::string& user_key : user_keys) {
+        const std::string key = FamilyKey(families, other, user_key);
+        const bool in_range = ucmp->Compare(key, begin) >= 0 &&
+                              ucmp->Compare(key, end) < 0;
+        ASSERT_EQ(in_range, id == other) << id << " " << other;
+      }
+    }
+  }
+  uint32_t id;
+  Slice user_key;
+  ASSERT_FALSE(families.ParseKey("\x80", &id, &user_key));
+}
+
+TEST_F(ColumnFamilyTest, EncodeBatch) {
+  TropoColumnFamilySet families;
+  families.SetKeyed(true);
+  families.Add(0, nullptr);
+  families.Add(1, nullptr);
+  TropoColumnFamilyHandle one(1, "one", ColumnFamilyOptions());
+  TropoColumnFamilyHandle two(2, "two", ColumnFamilyOptions());
+
+  WriteBatch src;
+  ASSERT_OK(src.Put("a", "1"));
+  ASSERT_OK(src.Put(&one, "a", "2"));
+  ASSERT_OK(src.Delete(&one, "b"));
+  ASSERT_OK(src.Merge(&one, "c", "3"));
+  ASSERT_OK(src.DeleteRange(&one, "d", "e"));
+  WriteBatch dst;
+  ASSERT_OK(families.EncodeBatch(&src, &dst));
+  ASSERT_EQ(dst.Count(), src.Count());
+  RecordHandler handler;
+  ASSERT_OK(dst.Iterate(&handler));
+  // Everything ends up in the default family, with the family in the key
+  const std::string a0 = FamilyKey(families, 0, "a");
+  const std::string a1 = FamilyKey(families, 1, "a");
+  ASSERT_EQ(handler.ops,
+            std::vector<std::string>(
+                {"put:0:" + a0 + ":1", "put:0:" + a1 + ":2",
+                 "delete:0:" + FamilyKey(families, 1, "b"),
+                 "merge:0:" + FamilyKey(families, 1, "c") + ":3",
+                 "delete_range:0:" + FamilyKey(families, 1, "d") + ":" +
+                     FamilyKey(families, 1, "e")}));
+
+  // Writes to families that do not exist are rejected
+  WriteBatch bad;
+  ASSERT_OK(bad.Put("a", "1"));
+  ASSERT_OK(bad.Put(&two, "a", "1"));
+  WriteBatch bad_dst;
+  ASSERT_TRUE(families.EncodeBatch(&bad, &bad_dst).IsInvalidArgument());
+  families.Remove(1);
+  WriteBatch dropped_dst;
+  ASSERT_TRUE(families.EncodeBatch(&src, &dropped_dst).IsInvalidArgument());
+}
+
+TEST_F(ColumnFamilyTest, CheckOptions) {
+  ColumnFamilyOptions default_options;
+  ColumnFamilyOptions options;
+  ASSERT_OK(TropoColumnFamilySet::CheckOptions(options, default_options));
+  // Merge operators are per family
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  ASSERT_OK(TropoColumnFamilySet::CheckOptions(options, default_options));
+  // Table sizes and compactions are shared by all families
+  options = ColumnFamilyOptions();
+  options.target_file_size_base *= 2;
+  ASSERT_TRUE(TropoColumnFamilySet::CheckOptions(options, default_options)
+                  .IsNotSupported());
+  options = ColumnFamilyOptions();
+  options.level0_file_num_compaction_trigger++;
+  ASSERT_TRUE(TropoColumnFamilySet::CheckOptions(options, default_options)
+                  .IsNotSupported());
+  options = ColumnFamilyOptions();
+  options.write_buffer_size *= 2;
+  ASSERT_TRUE(TropoColumnFamilySet::CheckOptions(options, default_options)
+                  .IsNotSupported());
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,107 @@
+#include "db/tropodb/tests/zns_test_utils.h"
+#include "db/tropodb/tropodb_impl.h"
+#include "rocksdb/metadata.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class CompactFilesTest : public testing::Test {};
+
+// A whole database needs more than the zones of kTestDevice
+#ifdef TROPODB_EMULATED_ZNS
+static const char* kDB = "tropodb_compact_files_test";
+#else
+static const char* kDB = kTestDevice;
+#endif
+
+static DB* OpenDB(std::vector<ColumnFamilyHandle*>* handles) {
+  Options options;
+  options.use_tropodb_impl = true;
+  options.create_if_missing = true;
+  EXPECT_OK(TropoDBImpl::DestroyDB(kDB, options));
+  std::vector<ColumnFamilyDescriptor> column_families = {
+      ColumnFamilyDescriptor(kDefaultColumnFamilyName, ColumnFamilyOptions())};
+  DB* db = nullptr;
+  EXPECT_OK(TropoDBImpl::Open(options, kDB, column_families, handles, &db,
+                              false, true));
+  return db;
+}
+
+static void CloseDB(DB* db, std::vector<ColumnFamilyHandle*>* handles) {
+  for (auto handle : *handles) {
+    delete handle;
+  }
+  handles->clear();
+  delete db;
+}
+
+// Writes keys [begin, end) with a step and flushes them to one L0 table
+static void FlushKeys(DB* db, int begin, int end, int step) {
+  for (int i = begin; i < end; i += step) {
+    ASSERT_OK(db->Put(WriteOptions(), "key" + std::to_string(1000 + i),
+                      std::to_string(i)));
+  }
+  ASSERT_OK(db->Flush(FlushOptions()));
+}
+
+static std::vector<std::string> TablesAtLevel(DB* db, int level) {
+  ColumnFamilyMetaData metadata;
+  db->GetColumnFamilyMetaData(&metadata);
+  std::vector<std::string> names;
+  for (const auto& file : metadata.levels[level].files) {
+    names.push_back(file.relative_filename);
+  }
+  return names;
+}
+
+TEST_F(CompactFilesTest, InvalidInputs) {
+  std::vector<ColumnFamilyHandle*> handles;
+  DB* db = OpenDB(&handles);
+  ASSERT_NE(db, nullptr);
+  FlushKeys(db, 0, 100, 1);
+  const std::vector<std::string> l0 = TablesAtLevel(db, 0);
+  ASSERT_EQ(l0.size(), 1U);
+  ASSERT_TRUE(db->CompactFiles(CompactionOptions(), {"table"}, 1)
+                  .IsInvalidArgument());
+  ASSERT_TRUE(db->CompactFiles(CompactionOptions(), {"123456"}, 1)
+                  .IsInvalidArgument());
+  ASSERT_TRUE(db->CompactFiles(CompactionOptions(), {}, 1)
+                  .IsInvalidArgument());
+  ASSERT_TRUE(db->CompactFiles(CompactionOptions(), l0, 0)
+                  .IsInvalidArgument());
+  CloseDB(db, &handles);
+}
+
+TEST_F(CompactFilesTest, CompactsKeyRangeOfInputs) {
+  std::vector<ColumnFamilyHandle*> handles;
+  DB* db = OpenDB(&handles);
+  ASSERT_NE(db, nullptr);
+  // Oldest table spans all keys, the newer one only the middle
+  FlushKeys(db, 0, 100, 1);
+  const std::vector<std::string> wide = TablesAtLevel(db, 0);
+  ASSERT_EQ(wide.size(), 1U);
+  FlushKeys(db, 40, 60, 2);
+  std::vector<std::string> l0 = TablesAtLevel(db, 0);
+  ASSERT_EQ(l0.size(), 2U);
+  const std::string narrow = l0[0] == wide[0] ? l0[1] : l0[0];
+
+  // Only the newer table is named, the older overlapping one is compacted too
+  std::vector<std::string> outputs;
+  ASSERT_OK(db->CompactFiles(CompactionOptions(), {narrow}, 1, -1, &outputs));
+  ASSERT_TRUE(TablesAtLevel(db, 0).empty());
+  ASSERT_FALSE(outputs.empty());
+  ASSERT_EQ(TablesAtLevel(db, 1), outputs);
+
+  // Keys outside of the range of the inputs moved as well
+  std::string value;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(db->Get(ReadOptions(), "key" + std::to_string(1000 + i), &value));
+    ASSERT_EQ(value, std::to_string(i));
+  }
+  CloseDB(db, &handles);
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
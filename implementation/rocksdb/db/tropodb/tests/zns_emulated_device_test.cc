@@ -0,0 +1,259 @@
+#include "db/tropodb/io/szd_emulated.h"
+
+#include "db/tropodb/tropodb_impl.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class EmulatedDeviceTest : public testing::Test {};
+
+static const char* kDevice = "emulated_test:zones=16,zone_cap=4,lba_size=512";
+
+struct EmulatedDevice {
+  EmulatedDevice() : device("emulated_test") {
+    SZD::SZDDevice::DestroyEmulated(kDevice);
+    EXPECT_EQ(device.Init(), SZD::SZDStatus::Success);
+    EXPECT_EQ(device.Open(kDevice), SZD::SZDStatus::Success);
+    EXPECT_EQ(device.GetInfo(&info), SZD::SZDStatus::Success);
+    factory = new SZD::SZDChannelFactory(device.GetDeviceManager(), 16);
+    factory->Ref();
+  }
+  ~EmulatedDevice() {
+    factory->Unref();
+    device.Close();
+  }
+  SZD::SZDDevice device;
+  SZD::DeviceInfo info;
+  SZD::SZDChannelFactory* factory;
+};
+
+TEST_F(EmulatedDeviceTest, Geometry) {
+  SZD::EmulatedGeometry geometry;
+  ASSERT_TRUE(SZD::EmulatedGeometry::Parse("name", &geometry));
+  ASSERT_EQ(geometry.zones, 1024U);
+  ASSERT_TRUE(SZD::EmulatedGeometry::Parse(
+      "name:zones=8,zone_cap=2,lba_size=512,max_active=1", &geometry));
+  ASSERT_EQ(geometry.zones, 8U);
+  ASSERT_EQ(geometry.zone_cap, 2U);
+  ASSERT_EQ(geometry.lba_size, 512U);
+  ASSERT_EQ(geometry.max_active_zones, 1U);
+  ASSERT_FALSE(SZD::EmulatedGeometry::Parse("name:zones=x", &geometry));
+  ASSERT_FALSE(SZD::EmulatedGeometry::Parse("name:color=1", &geometry));
+  ASSERT_FALSE(SZD::EmulatedGeometry::Parse("name:zones=0", &geometry));
+
+  EmulatedDevice dev;
+  ASSERT_EQ(dev.info.lba_size, 512U);
+  ASSERT_EQ(dev.info.zone_cap, 4U);
+  ASSERT_EQ(dev.info.lba_cap, 64U);
+  SZD::SZDDevice ranged("emulated_test");
+  ASSERT_EQ(ranged.Open(kDevice, 2, 6), SZD::SZDStatus::Success);
+  SZD::DeviceInfo info;
+  ASSERT_EQ(ranged.GetInfo(&info), SZD::SZDStatus::Success);
+  ASSERT_EQ(info.min_lba, 8U);
+  ASSERT_EQ(info.max_lba, 24U);
+  ASSERT_EQ(ranged.Open(kDevice, 6, 17), SZD::SZDStatus::InvalidArguments);
+}
+
+TEST_F(EmulatedDeviceTest, AppendOnlyZones) {
+  EmulatedDevice dev;
+  SZD::SZDChannel* channel;
+  ASSERT_EQ(dev.factory->register_channel(&channel, 0, 4),
+            SZD::SZDStatus::Success);
+  std::string data(512 * 6, 'a');
+  data[512 * 5] = 'b';
+  // Appends continue in the next zone
+  uint64_t lba = 0;
+  ASSERT_EQ(channel->DirectAppend(&lba, data.data(), data.size()),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(lba, 6U);
+  uint64_t head;
+  ASSERT_EQ(channel->ZoneHead(4, &head), SZD::SZDStatus::Success);
+  ASSERT_EQ(head, 6U);
+  // Only at the write pointer
+  lba = 2;
+  ASSERT_EQ(channel->DirectAppend(&lba, data.data(), 512),
+            SZD::SZDStatus::InvalidArguments);
+  lba = 16;
+  ASSERT_EQ(channel->DirectAppend(&lba, data.data(), 512),
+            SZD::SZDStatus::InvalidArguments);
+  // Unwritten blocks read as zeroes, the last block is padded
+  lba = 6;
+  ASSERT_EQ(channel->DirectAppend(&lba, "xyz", 3), SZD::SZDStatus::Success);
+  std::string read(512 * 3, '\0');
+  ASSERT_EQ(channel->DirectRead(5, &read[0], read.size()),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(read[0], 'b');
+  ASSERT_EQ(read.substr(512, 4), std::string("xyz\0", 4));
+  ASSERT_EQ(read.substr(1024), std::string(512, '\0'));
+  // A reset rewinds one zone
+  ASSERT_EQ(channel->ResetZone(4), SZD::SZDStatus::Success);
+  ASSERT_EQ(channel->ZoneHead(4, &head), SZD::SZDStatus::Success);
+  ASSERT_EQ(head, 4U);
+  ASSERT_EQ(channel->ZoneHead(0, &head), SZD::SZDStatus::Success);
+  ASSERT_EQ(head, 4U);
+  ASSERT_EQ(channel->GetZonesResetCounter(), 1U);
+  ASSERT_EQ(channel->GetZonesReset()[1], 1U);
+  ASSERT_EQ(dev.factory->unregister_channel(channel), SZD::SZDStatus::Success);
+}
+
+TEST_F(EmulatedDeviceTest, MaxActiveZones) {
+  const char* name = "emulated_active:zones=4,zone_cap=2,max_active=1";
+  SZD::SZDDevice::DestroyEmulated(name);
+  SZD::SZDDevice device("emulated_test");
+  ASSERT_EQ(device.Open(name), SZD::SZDStatus::Success);
+  SZD::DeviceManager* manager = device.GetDeviceManager();
+  std::string block(4096, 'a');
+  ASSERT_EQ(manager->Write(0, block.data(), 1), SZD::SZDStatus::Success);
+  ASSERT_EQ(manager->Write(2, block.data(), 1), SZD::SZDStatus::DeviceError);
+  // Full zones are no longer active
+  ASSERT_EQ(manager->Write(1, block.data(), 1), SZD::SZDStatus::Success);
+  ASSERT_EQ(manager->Write(2, block.data(), 1), SZD::SZDStatus::Success);
+  SZD::SZDDevice::DestroyEmulated(name);
+}
+
+TEST_F(EmulatedDeviceTest, CircularLog) {
+  EmulatedDevice dev;
+  SZD::SZDCircularLog log(dev.factory, dev.info, 4, 8, 1);
+  ASSERT_TRUE(log.Empty());
+  ASSERT_EQ(log.SpaceAvailable(), 16U * 512);
+  std::string data(512 * 6, 'a');
+  uint64_t lbas;
+  ASSERT_EQ(log.Append(data.data(), data.size(), &lbas),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(lbas, 6U);
+  ASSERT_EQ(log.Append(data.data(), data.size(), &lbas),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(log.GetWriteHead(), 28U);
+  // Space is given back in zones
+  ASSERT_EQ(log.ConsumeTail(16, 19), SZD::SZDStatus::Success);
+  ASSERT_EQ(log.SpaceAvailable(), 4U * 512);
+  ASSERT_EQ(log.ConsumeTail(16, 20), SZD::SZDStatus::InvalidArguments);
+  ASSERT_EQ(log.ConsumeTail(19, 25), SZD::SZDStatus::Success);
+  ASSERT_EQ(log.GetWriteTail(), 25U);
+  ASSERT_EQ(log.SpaceAvailable(), 12U * 512);
+  ASSERT_FALSE(log.SpaceLeft(512 * 13));
+  // Appends and reads wrap around
+  std::string wrapped(512 * 6, 'b');
+  wrapped[512 * 5] = 'c';
+  ASSERT_EQ(log.Append(wrapped.data(), wrapped.size(), &lbas),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(log.GetWriteHead(), 18U);
+  ASSERT_EQ(log.wrapped_addr(28 + 6), 18U);
+  std::string read(wrapped.size(), '\0');
+  ASSERT_EQ(log.Read(28, &read[0], read.size(), true, 0),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(read, wrapped);
+
+  // Recovery finds the tail zone and the head
+  SZD::SZDCircularLog recovered(dev.factory, dev.info, 4, 8, 1);
+  ASSERT_EQ(recovered.RecoverPointers(), SZD::SZDStatus::Success);
+  ASSERT_EQ(recovered.GetWriteTail(), 24U);
+  ASSERT_EQ(recovered.GetWriteHead(), 18U);
+  ASSERT_EQ(recovered.SpaceAvailable(), log.SpaceAvailable());
+  ASSERT_EQ(log.ResetAll(), SZD::SZDStatus::Success);
+  ASSERT_TRUE(log.Empty());
+  ASSERT_EQ(log.SpaceAvailable(), 16U * 512);
+}
+
+TEST_F(EmulatedDeviceTest, OnceLog) {
+  EmulatedDevice dev;
+  SZD::SZDOnceLog log(dev.factory, dev.info, 1, 3);
+  std::string data(512 * 3, 'a');
+  ASSERT_EQ(log.AsyncAppend(data.data(), data.size(), nullptr, true),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(log.Sync(), SZD::SZDStatus::Success);
+  ASSERT_EQ(log.SpaceAvailable(), 5U * 512);
+  std::string all;
+  ASSERT_EQ(log.ReadAll(all), SZD::SZDStatus::Success);
+  ASSERT_EQ(all, data);
+  ASSERT_FALSE(log.SpaceLeft(512 * 6));
+
+  SZD::SZDOnceLog recovered(dev.factory, dev.info, 1, 3);
+  ASSERT_EQ(recovered.RecoverPointers(), SZD::SZDStatus::Success);
+  ASSERT_EQ(recovered.GetWriteHead(), 7U);
+  ASSERT_EQ(log.ResetAll(), SZD::SZDStatus::Success);
+  ASSERT_TRUE(log.Empty());
+}
+
+TEST_F(EmulatedDeviceTest, FragmentedLog) {
+  EmulatedDevice dev;
+  SZD::SZDFragmentedLog log(dev.factory, dev.info, 8, 16, 1, 1);
+  std::vector<std::pair<uint64_t, uint64_t>> first, second, third;
+  std::string data(512 * 12, 'a');
+  ASSERT_EQ(log.Append(data.data(), data.size(), first),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(first.size(), 1U);
+  ASSERT_EQ(first[0], std::make_pair(uint64_t{8}, uint64_t{3}));
+  std::string small(512, 'b');
+  ASSERT_EQ(log.Append(small.data(), small.size(), second),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(second[0], std::make_pair(uint64_t{11}, uint64_t{1}));
+  ASSERT_EQ(log.Reset(first), SZD::SZDStatus::Success);
+  // Free zones are 8-10 and 12-15, larger tables are spread over both
+  std::string large(512 * 4 * 6, 'c');
+  large[512 * 4 * 4] = 'd';
+  ASSERT_EQ(log.Append(large.data(), large.size(), third),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(third.size(), 2U);
+  std::string read(large.size(), '\0');
+  ASSERT_EQ(log.Read(third, &read[0], read.size()), SZD::SZDStatus::Success);
+  ASSERT_EQ(read, large);
+  ASSERT_FALSE(log.SpaceLeft(512 * 4 * 2));
+
+  // The used zones are persisted by the user
+  std::string encoded = log.Encode();
+  SZD::SZDFragmentedLog decoded(dev.factory, dev.info, 8, 16, 1, 1);
+  ASSERT_EQ(decoded.DecodeFrom(encoded.data(), encoded.size()),
+            SZD::SZDStatus::Success);
+  ASSERT_EQ(decoded.SpaceAvailable(), log.SpaceAvailable());
+  ASSERT_EQ(log.ResetAll(), SZD::SZDStatus::Success);
+  ASSERT_TRUE(log.Empty());
+}
+
+static Status OpenDB(const std::string& name, DB** db,
+                     std::vector<ColumnFamilyHandle*>* handles) {
+  DBOptions options;
+  options.use_tropodb_impl = true;
+  options.create_if_missing = true;
+  std::vector<ColumnFamilyDescriptor> column_families = {
+      ColumnFamilyDescriptor(kDefaultColumnFamilyName, ColumnFamilyOptions())};
+  return TropoDBImpl::Open(options, name, column_families, handles, db, false,
+                           true);
+}
+
+static void CloseDB(DB* db, std::vector<ColumnFamilyHandle*>* handles) {
+  for (auto handle : *handles) {
+    delete handle;
+  }
+  handles->clear();
+  delete db;
+}
+
+TEST_F(EmulatedDeviceTest, ReopenDatabase) {
+  const char* name = "emulated_db";
+  SZD::SZDDevice::DestroyEmulated(name);
+  DB* db;
+  std::vector<ColumnFamilyHandle*> handles;
+  ASSERT_OK(OpenDB(name, &db, &handles));
+  // Enough to flush and compact
+  const int n = 100000;
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(db->Put(WriteOptions(), "key" + std::to_string(i),
+                      std::string(100, 'a' + i % 26)));
+  }
+  CloseDB(db, &handles);
+  // Recovered from the manifest, tables and WALs of the device
+  ASSERT_OK(OpenDB(name, &db, &handles));
+  std::string value;
+  for (int i = 0; i < n; i += 97) {
+    ASSERT_OK(db->Get(ReadOptions(), "key" + std::to_string(i), &value));
+    ASSERT_EQ(value, std::string(100, 'a' + i % 26));
+  }
+  CloseDB(db, &handles);
+  SZD::SZDDevice::DestroyEmulated(name);
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
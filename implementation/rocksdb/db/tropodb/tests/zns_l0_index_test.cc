@@ -0,0 +1,148 @@
+#include "db/tropodb/index/tropodb_l0_index.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "test_util/testharness.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+class L0IndexTest : public testing::Test {};
+
+static SSZoneMetaData* NewTable(uint64_t l0_number, uint64_t number,
+                                const std::string& smallest,
+                                const std::string& largest) {
+  SSZoneMetaData* meta = new SSZoneMetaData;
+  meta->number = number;
+  meta->L0.number = l0_number;
+  meta->smallest = InternalKey(smallest, 1, kTypeValue);
+  meta->largest = InternalKey(largest, 1, kTypeValue);
+  return meta;
+}
+
+// Numbers of the tables overlapping user_key, newest first
+static std::vector<uint64_t> Numbers(const TropoL0Index& index,
+                                     const std::string& user_key) {
+  TropoL0Index::Tables tables;
+  index.Overlapping(user_key, &tables);
+  std::vector<uint64_t> numbers;
+  for (const SSZoneMetaData* m : tables) {
+    numbers.push_back(m->number);
+  }
+  return numbers;
+}
+
+TEST_F(L0IndexTest, Empty) {
+  TropoL0Index index(BytewiseComparator(), {});
+  ASSERT_TRUE(Numbers(index, "a").empty());
+  ASSERT_EQ(index.NumEntries(), 0U);
+}
+
+TEST_F(L0IndexTest, Overlapping) {
+  std::vector<std::unique_ptr<SSZoneMetaData>> owned;
+  owned.emplace_back(NewTable(1, 1, "a", "c"));
+  owned.emplace_back(NewTable(2, 2, "b", "d"));
+  owned.emplace_back(NewTable(3, 3, "e", "f"));
+  owned.emplace_back(NewTable(4, 4, "c", "c"));
+  // Same L0 number, the higher table number is newer
+  owned.emplace_back(NewTable(4, 5, "ea", "eb"));
+  std::vector<SSZoneMetaData*> tables;
+  for (const auto& m : owned) {
+    tables.push_back(m.get());
+  }
+  // Order of the input does not matter
+  std::reverse(tables.begin(), tables.end());
+  TropoL0Index index(BytewiseComparator(), tables);
+
+  ASSERT_EQ(Numbers(index, "0"), std::vector<uint64_t>());
+  ASSERT_EQ(Numbers(index, "a"), std::vector<uint64_t>({1}));
+  ASSERT_EQ(Numbers(index, "b"), std::vector<uint64_t>({2, 1}));
+  ASSERT_EQ(Numbers(index, "c"),
+            std::vector<uint64_t>({4, 2, 1}));
+  ASSERT_EQ(Numbers(index, "ca"), std::vector<uint64_t>({2}));
+  ASSERT_EQ(Numbers(index, "d"), std::vector<uint64_t>({2}));
+  // Gap between two tables
+  ASSERT_EQ(Numbers(index, "da"), std::vector<uint64_t>());
+  ASSERT_EQ(Numbers(index, "e"), std::vector<uint64_t>({3}));
+  ASSERT_EQ(Numbers(index, "ea"), std::vector<uint64_t>({5, 3}));
+  ASSERT_EQ(Numbers(index, "eaa"),
+            std::vector<uint64_t>({5, 3}));
+  ASSERT_EQ(Numbers(index, "f"), std::vector<uint64_t>({3}));
+  ASSERT_EQ(Numbers(index, "g"), std::vector<uint64_t>());
+}
+
+TEST_F(L0IndexTest, MatchesLinearScan) {
+  const Comparator* ucmp = BytewiseComparator();
+  Random rnd(301);
+  for (int round = 0; round < 20; round++) {
+    std::vector<std::unique_ptr<SSZoneMetaData>> owned;
+    std::vector<SSZoneMetaData*> tables;
+    const int count = 1 + rnd.Uniform(30);
+    for (int i = 0; i < count; i++) {
+      std::string a = std::to_string(rnd.Uniform(100));
+      std::string b = std::to_string(rnd.Uniform(100));
+      if (ucmp->Compare(a, b) > 0) {
+        std::swap(a, b);
+      }
+      owned.emplace_back(NewTable(rnd.Uniform(8), i, a, b));
+      tables.push_back(owned.back().get());
+    }
+    TropoL0Index index(ucmp, tables);
+
+    std::vector<SSZoneMetaData*> by_recency(tables);
+    std::sort(by_recency.begin(), by_recency.end(), &TropoL0Index::IsNewer);
+    for (int k = 0; k < 120; k++) {
+      // Also probe keys between the table bounds
+      std::string key = std::to_string(k / 2);
+      if (k % 2 == 1) {
+        key.push_back('5');
+      }
+      std::vector<uint64_t> expected;
+      for (const SSZoneMetaData* m : by_recency) {
+        if (ucmp->Compare(m->smallest.user_key(), key) <= 0 &&
+            ucmp->Compare(m->largest.user_key(), key) >= 0) {
+          expected.push_back(m->number);
+        }
+      }
+      ASSERT_EQ(Numbers(index, key), expected) << key;
+    }
+  }
+}
+
+TEST_F(L0IndexTest, FullyOverlappingTables) {
+  // Nested tables all cover the middle, a list of tables for each segment
+  // would hold n^2 / 2 entries.
+  const int n = 1000;
+  std::vector<std::unique_ptr<SSZoneMetaData>> owned;
+  std::vector<SSZoneMetaData*> tables;
+  char buf[16];
+  for (int i = 0; i < n; i++) {
+    snprintf(buf, sizeof(buf), "%06d", i);
+    const std::string smallest(buf);
+    snprintf(buf, sizeof(buf), "%06d", 2 * n - i);
+    owned.emplace_back(NewTable(i, i, smallest, buf));
+    tables.push_back(owned.back().get());
+  }
+  TropoL0Index index(BytewiseComparator(), tables);
+  // At most two nodes for each level of a tree with 4n leaves
+  ASSERT_LE(index.NumEntries(), static_cast<size_t>(2 * n * 12));
+
+  std::vector<uint64_t> all;
+  for (int i = n - 1; i >= 0; i--) {
+    all.push_back(i);
+  }
+  snprintf(buf, sizeof(buf), "%06d", n);
+  ASSERT_EQ(Numbers(index, buf), all);
+  // Only the outer half of the tables cover the key
+  snprintf(buf, sizeof(buf), "%06d", n / 2);
+  const std::vector<uint64_t> outer(all.begin() + n / 2 - 1, all.end());
+  ASSERT_EQ(Numbers(index, buf), outer);
+  ASSERT_EQ(Numbers(index, "000000"), std::vector<uint64_t>({0}));
+  ASSERT_EQ(Numbers(index, "1"), std::vector<uint64_t>());
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,240 @@
+#include "db/tropodb/index/tropodb_compaction.h"
+#include "db/tropodb/memtable/tropodb_memtable.h"
+#include "test_util/testharness.h"
+#include "utilities/merge_operators.h"
+
+namespace ROCKSDB_NAMESPACE {
+class MergeTest : public testing::Test {};
+
+// Iterator over sorted internal keys, as the compaction merger would give.
+class VectorIterator : public Iterator {
+ public:
+  explicit VectorIterator(
+      const std::vector<std::pair<std::string, std::string>>& entries)
+      : entries_(entries), pos_(0) {}
+  bool Valid() const override { return pos_ < entries_.size(); }
+  void SeekToFirst() override { pos_ = 0; }
+  void SeekToLast() override { pos_ = entries_.size() - 1; }
+  void Seek(const Slice& target) override {}
+  void SeekForPrev(const Slice& target) override {}
+  void Next() override { pos_++; }
+  void Prev() override { pos_--; }
+  Slice key() const override { return entries_[pos_].first; }
+  Slice value() const override { return entries_[pos_].second; }
+  Status status() const override { return Status::OK(); }
+
+ private:
+  std::vector<std::pair<std::string, std::string>> entries_;
+  size_t pos_;
+};
+
+struct MergeEntry {
+  std::string key;
+  SequenceNumber seq;
+  ValueType type;
+  std::string value;
+};
+
+static std::vector<MergeEntry> MergeOperands(
+    const std::vector<MergeEntry>& input, bool base_level,
+    const std::vector<const TropoRangeTombstone*>& active,
+    SequenceNumber* last_sequence_for_key, std::string* next_key) {
+  std::vector<std::pair<std::string, std::string>> entries;
+  for (const auto& e : input) {
+    entries.emplace_back(InternalKey(e.key, e.seq, e.type).Encode().ToString(),
+                         e.value);
+  }
+  VectorIterator merger(entries);
+  std::shared_ptr<MergeOperator> merge_operator =
+      MergeOperators::CreateStringAppendOperator();
+  std::vector<MergeEntry> output;
+  TropoCompaction::TableAdder add_to_table =
+      [&](const Slice& key, const Slice& value, const Slice& user_key) {
+        ParsedInternalKey ikey;
+        Status s = ParseInternalKey(key, &ikey, false);
+        if (s.ok()) {
+          EXPECT_EQ(ikey.user_key, user_key);
+          output.push_back({ikey.user_key.ToString(), ikey.sequence, ikey.type,
+                            value.ToString()});
+        }
+        return s;
+      };
+  merger.SeekToFirst();
+  EXPECT_OK(TropoCompaction::MergeOperands(
+      &merger, BytewiseComparator(), merge_operator.get(), active,
+      kMaxSequenceNumber, base_level, add_to_table, last_sequence_for_key,
+      SystemClock::Default().get()));
+  *next_key = merger.Valid() ? ExtractUserKey(merger.key()).ToString() : "";
+  return output;
+}
+
+TEST_F(MergeTest, MemtableOperands) {
+  DBOptions options;
+  WriteOptions woptions;
+  ReadOptions roptions;
+  InternalKeyComparator icmp = InternalKeyComparator(BytewiseComparator());
+  TropoMemtable* mem = new TropoMemtable(
+      options, icmp, 1 << 20, MergeOperators::CreateStringAppendOperator());
+  mem->Ref();
+  WriteBatch batch;
+  ASSERT_OK(batch.Put("a", "1"));
+  ASSERT_OK(batch.Merge("a", "2"));
+  ASSERT_OK(batch.Merge("a", "3"));
+  ASSERT_OK(batch.Merge("b", "1"));
+  ASSERT_OK(batch.Merge("b", "2"));
+  WriteBatchInternal::SetSequence(&batch, 1);
+  ASSERT_OK(mem->Write(woptions, &batch));
+
+  // A base value ends the chain
+  std::string value;
+  Status s;
+  MergeContext merge_context;
+  ASSERT_TRUE(mem->Get(roptions, LookupKey("a", kMaxSequenceNumber), &value,
+                       &s, nullptr, nullptr, &merge_context));
+  ASSERT_OK(s);
+  ASSERT_EQ(value, "1,2,3");
+  // Snapshots only see older operands
+  s = Status::OK();
+  merge_context.Clear();
+  ASSERT_TRUE(mem->Get(roptions, LookupKey("a", 2), &value, &s, nullptr,
+                       nullptr, &merge_context));
+  ASSERT_OK(s);
+  ASSERT_EQ(value, "1,2");
+  // Without a base the operands are handed to older tables
+  s = Status::OK();
+  merge_context.Clear();
+  ASSERT_FALSE(mem->Get(roptions, LookupKey("b", kMaxSequenceNumber), &value,
+                        &s, nullptr, nullptr, &merge_context));
+  ASSERT_TRUE(s.IsMergeInProgress());
+  ASSERT_EQ(merge_context.GetNumOperands(), 2U);
+  ASSERT_EQ(merge_context.GetOperand(0), "1");
+  ASSERT_EQ(merge_context.GetOperand(1), "2");
+  mem->Unref();
+}
+
+TEST_F(MergeTest, MemtableContinuesChain) {
+  DBOptions options;
+  WriteOptions woptions;
+  ReadOptions roptions;
+  InternalKeyComparator icmp = InternalKeyComparator(BytewiseComparator());
+  std::shared_ptr<MergeOperator> merge_operator =
+      MergeOperators::CreateStringAppendOperator();
+  TropoMemtable* older = new TropoMemtable(options, icmp, 1 << 20,
+                                           merge_operator);
+  TropoMemtable* newer = new TropoMemtable(options, icmp, 1 << 20,
+                                           merge_operator);
+  older->Ref();
+  newer->Ref();
+  WriteBatch batch;
+  ASSERT_OK(batch.Put("a", "1"));
+  ASSERT_OK(batch.Merge("a", "2"));
+  WriteBatchInternal::SetSequence(&batch, 1);
+  ASSERT_OK(older->Write(woptions, &batch));
+  batch.Clear();
+  ASSERT_OK(batch.Merge("a", "3"));
+  WriteBatchInternal::SetSequence(&batch, 3);
+  ASSERT_OK(newer->Write(woptions, &batch));
+
+  std::string value;
+  Status s;
+  MergeContext merge_context;
+  ASSERT_FALSE(newer->Get(roptions, LookupKey("a", kMaxSequenceNumber),
+                          &value, &s, nullptr, nullptr, &merge_context));
+  ASSERT_TRUE(s.IsMergeInProgress());
+  ASSERT_TRUE(older->Get(roptions, LookupKey("a", kMaxSequenceNumber),
+                         &value, &s, nullptr, nullptr, &merge_context));
+  ASSERT_OK(s);
+  ASSERT_EQ(value, "1,2,3");
+  older->Unref();
+  newer->Unref();
+}
+
+TEST_F(MergeTest, CompactionFullMerge) {
+  SequenceNumber last_sequence_for_key;
+  std::string next_key;
+  std::vector<MergeEntry> output =
+      MergeOperands({{"a", 4, kTypeMerge, "3"},
+                     {"a", 3, kTypeMerge, "2"},
+                     {"a", 2, kTypeValue, "1"},
+                     {"a", 1, kTypeValue, "0"},
+                     {"b", 5, kTypeValue, "1"}},
+                    false, {}, &last_sequence_for_key, &next_key);
+  ASSERT_EQ(output.size(), 1U);
+  ASSERT_EQ(output[0].key, "a");
+  ASSERT_EQ(output[0].seq, 4U);
+  ASSERT_EQ(output[0].type, kTypeValue);
+  ASSERT_EQ(output[0].value, "1,2,3");
+  // Older entries of the key are shadowed and left for the caller to drop
+  ASSERT_EQ(last_sequence_for_key, 4U);
+  ASSERT_EQ(next_key, "a");
+
+  // A deletion ends the chain as well
+  output = MergeOperands({{"a", 4, kTypeMerge, "3"},
+                          {"a", 3, kTypeDeletion, ""},
+                          {"b", 5, kTypeValue, "1"}},
+                         false, {}, &last_sequence_for_key, &next_key);
+  ASSERT_EQ(output.size(), 1U);
+  ASSERT_EQ(output[0].type, kTypeValue);
+  ASSERT_EQ(output[0].value, "3");
+  ASSERT_EQ(next_key, "b");
+
+  // Nothing older can exist below the base level
+  output = MergeOperands({{"a", 4, kTypeMerge, "3"},
+                          {"a", 3, kTypeMerge, "2"}},
+                         true, {}, &last_sequence_for_key, &next_key);
+  ASSERT_EQ(output.size(), 1U);
+  ASSERT_EQ(output[0].type, kTypeValue);
+  ASSERT_EQ(output[0].value, "2,3");
+  ASSERT_EQ(last_sequence_for_key, kMaxSequenceNumber);
+  ASSERT_EQ(next_key, "");
+}
+
+TEST_F(MergeTest, CompactionPartialMerge) {
+  SequenceNumber last_sequence_for_key;
+  std::string next_key;
+  // Older values can be in lower levels, operands are only combined
+  std::vector<MergeEntry> output =
+      MergeOperands({{"a", 4, kTypeMerge, "3"},
+                     {"a", 3, kTypeMerge, "2"},
+                     {"b", 5, kTypeValue, "1"}},
+                    false, {}, &last_sequence_for_key, &next_key);
+  ASSERT_EQ(output.size(), 1U);
+  ASSERT_EQ(output[0].seq, 4U);
+  ASSERT_EQ(output[0].type, kTypeMerge);
+  ASSERT_EQ(output[0].value, "2,3");
+  ASSERT_EQ(last_sequence_for_key, kMaxSequenceNumber);
+  ASSERT_EQ(next_key, "b");
+
+  // A single operand is kept as is
+  output = MergeOperands({{"a", 4, kTypeMerge, "3"}}, false, {},
+                         &last_sequence_for_key, &next_key);
+  ASSERT_EQ(output.size(), 1U);
+  ASSERT_EQ(output[0].seq, 4U);
+  ASSERT_EQ(output[0].type, kTypeMerge);
+  ASSERT_EQ(output[0].value, "3");
+}
+
+TEST_F(MergeTest, CompactionRangeTombstone) {
+  SequenceNumber last_sequence_for_key;
+  std::string next_key;
+  // The value is older than the range delete, so the chain starts empty
+  TropoRangeTombstone tombstone("a", "b", 3);
+  std::vector<MergeEntry> output =
+      MergeOperands({{"a", 4, kTypeMerge, "3"},
+                     {"a", 2, kTypeMerge, "2"},
+                     {"a", 1, kTypeValue, "1"}},
+                    false, {&tombstone}, &last_sequence_for_key, &next_key);
+  ASSERT_EQ(output.size(), 1U);
+  ASSERT_EQ(output[0].seq, 4U);
+  ASSERT_EQ(output[0].type, kTypeValue);
+  ASSERT_EQ(output[0].value, "3");
+  ASSERT_EQ(last_sequence_for_key, 4U);
+  // Covered entries are left for the caller to drop
+  ASSERT_EQ(next_key, "a");
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
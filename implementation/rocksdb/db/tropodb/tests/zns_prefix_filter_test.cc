@@ -0,0 +1,77 @@
+#include "db/tropodb/table/tropodb_prefix_filter.h"
+
+#include <memory>
+
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class PrefixFilterTest : public testing::Test {};
+
+static std::string Prefix(int i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "p%05d", i);
+  return buf;
+}
+
+TEST_F(PrefixFilterTest, NoFilter) {
+  std::unique_ptr<const SliceTransform> extractor(NewFixedPrefixTransform(6));
+  std::string filter = "stale";
+  // Nothing to filter on, every table must be read
+  BuildPrefixFilter(extractor.get(), {}, &filter);
+  ASSERT_TRUE(filter.empty());
+  BuildPrefixFilter(nullptr, {PrefixHash("p00001")}, &filter);
+  ASSERT_TRUE(filter.empty());
+  ASSERT_TRUE(PrefixMayMatch(extractor.get(), filter, "p00001key"));
+  ASSERT_TRUE(PrefixMayMatch(nullptr, "garbage", "p00001key"));
+  // Too big to keep in the manifest
+  std::vector<uint64_t> hashes;
+  const size_t too_many =
+      TropoDBConfig::prefix_filter_max_bytes * 8 /
+          std::max<uint32_t>(1, TropoDBConfig::prefix_filter_bits_per_key) +
+      64;
+  for (size_t i = 0; i < too_many; i++) {
+    hashes.push_back(PrefixHash(Prefix(i)));
+  }
+  BuildPrefixFilter(extractor.get(), hashes, &filter);
+  ASSERT_TRUE(filter.empty());
+}
+
+TEST_F(PrefixFilterTest, MayMatch) {
+  if (TropoDBConfig::prefix_filter_bits_per_key == 0) {
+    return;
+  }
+  std::unique_ptr<const SliceTransform> extractor(NewFixedPrefixTransform(6));
+  std::vector<uint64_t> hashes;
+  for (int i = 0; i < 200; i += 2) {
+    hashes.push_back(PrefixHash(Prefix(i)));
+  }
+  std::string filter;
+  BuildPrefixFilter(extractor.get(), hashes, &filter);
+  ASSERT_GT(filter.size(), kPrefixFilterTrailer);
+  ASSERT_LE(filter.size(),
+            TropoDBConfig::prefix_filter_max_bytes + kPrefixFilterTrailer);
+
+  // No false negatives
+  for (int i = 0; i < 200; i += 2) {
+    ASSERT_TRUE(PrefixMayMatch(extractor.get(), filter, Prefix(i) + "key"));
+  }
+  // Few false positives
+  int false_positives = 0;
+  for (int i = 1; i < 20000; i += 2) {
+    if (PrefixMayMatch(extractor.get(), filter, Prefix(i) + "key")) {
+      false_positives++;
+    }
+  }
+  ASSERT_LT(false_positives, 10000 / 20);
+  // Keys outside of the domain of the extractor can not be filtered
+  ASSERT_TRUE(PrefixMayMatch(extractor.get(), filter, "p0"));
+  // Filters of another extractor are not trusted
+  std::unique_ptr<const SliceTransform> other(NewFixedPrefixTransform(5));
+  ASSERT_TRUE(PrefixMayMatch(other.get(), filter, "p00001key"));
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
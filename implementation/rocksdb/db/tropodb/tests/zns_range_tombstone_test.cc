@@ -0,0 +1,153 @@
+#include "db/tropodb/memtable/tropodb_memtable.h"
+#include "db/tropodb/table/tropodb_zonemetadata.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class RangeTombstoneTest : public testing::Test {};
+
+static SSZoneMetaData TableWithRange(const std::string& smallest,
+                                     SequenceNumber smallest_seq,
+                                     const std::string& largest,
+                                     SequenceNumber largest_seq) {
+  SSZoneMetaData meta;
+  meta.smallest = InternalKey(smallest, smallest_seq, kTypeValue);
+  meta.largest = InternalKey(largest, largest_seq, kTypeValue);
+  return meta;
+}
+
+TEST_F(RangeTombstoneTest, MaxCoveringTombstoneSeq) {
+  const Comparator* ucmp = BytewiseComparator();
+  SSZoneMetaData meta;
+  meta.range_tombstones.emplace_back("b", "d", 10);
+  meta.range_tombstones.emplace_back("c", "f", 20);
+  meta.range_tombstones.emplace_back("a", "z", 30);
+  // Newest tombstone visible to the snapshot wins
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "c", kMaxSequenceNumber), 30U);
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "c", 25), 20U);
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "c", 15), 10U);
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "c", 5), 0U);
+  // The end key is exclusive
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "d", 25), 20U);
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "f", 25), 0U);
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "z", kMaxSequenceNumber), 0U);
+  // The start key is inclusive
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, meta, "b", 15), 10U);
+  SSZoneMetaData empty;
+  ASSERT_EQ(MaxCoveringTombstoneSeq(ucmp, empty, "c", kMaxSequenceNumber), 0U);
+}
+
+TEST_F(RangeTombstoneTest, CoveredByRangeTombstone) {
+  const Comparator* ucmp = BytewiseComparator();
+  SSZoneMetaData table = TableWithRange("c", 5, "e", 7);
+  SSZoneMetaData upper;
+  ASSERT_FALSE(CoveredByRangeTombstone(ucmp, table, upper));
+  // Covers the whole table, but is older than its newest entry
+  upper.range_tombstones.emplace_back("b", "f", 6);
+  ASSERT_FALSE(CoveredByRangeTombstone(ucmp, table, upper));
+  // Ends at the largest key, which is exclusive
+  upper.range_tombstones.emplace_back("c", "e", 10);
+  ASSERT_FALSE(CoveredByRangeTombstone(ucmp, table, upper));
+  // Two tombstones together cover the table, but neither does on its own
+  upper.range_tombstones.emplace_back("d", "z", 10);
+  ASSERT_FALSE(CoveredByRangeTombstone(ucmp, table, upper));
+  upper.range_tombstones.emplace_back("c", "e\xff", 8);
+  ASSERT_TRUE(CoveredByRangeTombstone(ucmp, table, upper));
+}
+
+TEST_F(RangeTombstoneTest, ClipRangeTombstones) {
+  const Comparator* ucmp = BytewiseComparator();
+  std::vector<TropoRangeTombstone> tombstones;
+  tombstones.emplace_back("a", "m", 5);
+  tombstones.emplace_back("d", "f", 6);
+  tombstones.emplace_back("k", "z", 7);
+  tombstones.emplace_back("a", "c", 8);
+  // Unbounded keeps all tombstones as is
+  std::vector<TropoRangeTombstone> clipped;
+  ClipRangeTombstones(ucmp, tombstones, nullptr, nullptr, &clipped);
+  ASSERT_EQ(clipped.size(), 4U);
+  for (size_t i = 0; i < clipped.size(); i++) {
+    ASSERT_EQ(clipped[i].start, tombstones[i].start);
+    ASSERT_EQ(clipped[i].end, tombstones[i].end);
+    ASSERT_EQ(clipped[i].seq, tombstones[i].seq);
+  }
+  // [c, k), the tombstone ending at the lower bound is dropped
+  Slice lower("c");
+  Slice upper("k");
+  clipped.clear();
+  ClipRangeTombstones(ucmp, tombstones, &lower, &upper, &clipped);
+  ASSERT_EQ(clipped.size(), 2U);
+  ASSERT_EQ(clipped[0].start, "c");
+  ASSERT_EQ(clipped[0].end, "k");
+  ASSERT_EQ(clipped[0].seq, 5U);
+  ASSERT_EQ(clipped[1].start, "d");
+  ASSERT_EQ(clipped[1].end, "f");
+  ASSERT_EQ(clipped[1].seq, 6U);
+  // Only a lower bound
+  clipped.clear();
+  Slice high("n");
+  ClipRangeTombstones(ucmp, tombstones, &high, nullptr, &clipped);
+  ASSERT_EQ(clipped.size(), 1U);
+  ASSERT_EQ(clipped[0].start, "n");
+  ASSERT_EQ(clipped[0].end, "z");
+  ASSERT_EQ(clipped[0].seq, 7U);
+}
+
+TEST_F(RangeTombstoneTest, Memtable) {
+  DBOptions options;
+  WriteOptions woptions;
+  ReadOptions roptions;
+  InternalKeyComparator icmp = InternalKeyComparator(BytewiseComparator());
+  TropoMemtable* mem = new TropoMemtable(options, icmp, 1 << 20);
+  mem->Ref();
+  WriteBatch batch;
+  ASSERT_OK(batch.Put("a", "1"));
+  ASSERT_OK(batch.Put("c", "2"));
+  ASSERT_OK(batch.DeleteRange("b", "d"));
+  ASSERT_OK(batch.Put("c", "3"));
+  WriteBatchInternal::SetSequence(&batch, 1);
+  ASSERT_OK(mem->Write(woptions, &batch));
+
+  std::vector<TropoRangeTombstone> tombstones;
+  mem->GetRangeTombstones(&tombstones);
+  ASSERT_EQ(tombstones.size(), 1U);
+  ASSERT_EQ(tombstones[0].start, "b");
+  ASSERT_EQ(tombstones[0].end, "d");
+  ASSERT_EQ(tombstones[0].seq, 3U);
+
+  std::string value;
+  Status s;
+  SequenceNumber max_covering = 0;
+  // Put after the range delete is visible
+  ASSERT_TRUE(mem->Get(roptions, LookupKey("c", kMaxSequenceNumber), &value,
+                       &s, nullptr, &max_covering));
+  ASSERT_OK(s);
+  ASSERT_EQ(value, "3");
+  // Before that, the value is deleted
+  max_covering = 0;
+  s = Status::OK();
+  ASSERT_TRUE(mem->Get(roptions, LookupKey("c", 3), &value, &s, nullptr,
+                       &max_covering));
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(max_covering, 3U);
+  // Keys that are not in the memtable still report the tombstone, so older
+  // tables are not consulted.
+  max_covering = 0;
+  s = Status::OK();
+  ASSERT_FALSE(mem->Get(roptions, LookupKey("bb", kMaxSequenceNumber), &value,
+                        &s, nullptr, &max_covering));
+  ASSERT_EQ(max_covering, 3U);
+  max_covering = 0;
+  s = Status::OK();
+  ASSERT_TRUE(mem->Get(roptions, LookupKey("a", kMaxSequenceNumber), &value,
+                       &s, nullptr, &max_covering));
+  ASSERT_OK(s);
+  ASSERT_EQ(value, "1");
+  ASSERT_EQ(max_covering, 0U);
+  mem->Unref();
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
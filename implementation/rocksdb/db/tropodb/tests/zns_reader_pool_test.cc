@@ -0,0 +1,96 @@
+#include "db/tropodb/table/tropodb_reader_pool.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "db/tropodb/tropodb_config.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class ReaderPoolTest : public testing::Test {};
+
+TEST_F(ReaderPoolTest, AcquireAll) {
+  for (uint8_t readers : {1, 3, 63, 64}) {
+    TropoReaderPool pool(readers);
+    ASSERT_EQ(pool.Size(), readers);
+    // Every reader is handed out exactly once
+    std::set<uint8_t> acquired;
+    for (uint8_t i = 0; i < readers; i++) {
+      const uint8_t reader = pool.Acquire();
+      ASSERT_LT(reader, readers);
+      ASSERT_TRUE(acquired.insert(reader).second);
+    }
+    for (uint8_t reader : acquired) {
+      pool.Release(reader);
+    }
+    // A released reader is preferred by the same thread
+    const uint8_t reader = pool.Acquire();
+    pool.Release(reader);
+    ASSERT_EQ(pool.Acquire(), reader);
+    pool.Release(reader);
+  }
+}
+
+TEST_F(ReaderPoolTest, BlocksWhenExhausted) {
+  TropoReaderPool pool(1);
+  const uint8_t reader = pool.Acquire();
+  std::atomic<bool> acquired{false};
+  std::thread waiter([&] {
+    pool.Release(pool.Acquire());
+    acquired.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(acquired.load());
+  pool.Release(reader);
+  waiter.join();
+  ASSERT_TRUE(acquired.load());
+}
+
+TEST_F(ReaderPoolTest, Exclusive) {
+  constexpr uint8_t kReaders = 4;
+  TropoReaderPool pool(kReaders);
+  std::atomic<int> in_use[kReaders];
+  for (auto& count : in_use) {
+    count.store(0);
+  }
+  std::atomic<bool> shared{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 16; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 10000; i++) {
+        const uint8_t reader = pool.Acquire();
+        if (in_use[reader].fetch_add(1) != 0) {
+          shared.store(true);
+        }
+        in_use[reader].fetch_sub(1);
+        pool.Release(reader);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_FALSE(shared.load());
+}
+
+TEST_F(ReaderPoolTest, ReaderCount) {
+  for (size_t logs : {1, 2, 4, 1000}) {
+    const uint8_t count = TropoReaderPool::ReaderCount(16, logs);
+    ASSERT_GE(count, 1);
+    ASSERT_LE(count, 16);
+    // All logs of a device together stay within the reader channels
+    if (logs <= TropoDBConfig::max_reader_channels) {
+      ASSERT_LE(count * logs, TropoDBConfig::max_reader_channels);
+    }
+  }
+  ASSERT_LE(TropoReaderPool::ReaderCount(255, 1),
+            TropoReaderPool::kMaxReaders);
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
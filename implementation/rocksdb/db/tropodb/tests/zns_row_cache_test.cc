@@ -0,0 +1,96 @@
+#include "db/tropodb/table/tropodb_row_cache.h"
+
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class RowCacheTest : public testing::Test {};
+
+TEST_F(RowCacheTest, LookupInsert) {
+  TropoRowCache cache(NewLRUCache(1 << 20));
+  std::string value;
+  Status s;
+  ASSERT_FALSE(cache.Lookup("a", &value, &s));
+  cache.Insert("a", 10, cache.Generation(), Status::OK(), "1");
+  ASSERT_TRUE(cache.Lookup("a", &value, &s));
+  ASSERT_OK(s);
+  ASSERT_EQ(value, "1");
+  // Misses are cached as well
+  cache.Insert("b", 10, cache.Generation(), Status::NotFound(), Slice());
+  ASSERT_TRUE(cache.Lookup("b", &value, &s));
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_TRUE(value.empty());
+  // Errors are not
+  cache.Insert("c", 10, cache.Generation(), Status::IOError(), Slice());
+  ASSERT_FALSE(cache.Lookup("c", &value, &s));
+}
+
+TEST_F(RowCacheTest, Invalidate) {
+  TropoRowCache cache(NewLRUCache(1 << 20));
+  std::string value;
+  Status s;
+  cache.Insert("a", 10, cache.Generation(), Status::OK(), "1");
+  cache.Insert("b", 10, cache.Generation(), Status::OK(), "2");
+  cache.Invalidate("a", 11);
+  ASSERT_FALSE(cache.Lookup("a", &value, &s));
+  ASSERT_TRUE(cache.Lookup("b", &value, &s));
+  // A read that started before the write must not fill the cache
+  cache.Insert("a", 10, cache.Generation(), Status::OK(), "1");
+  ASSERT_FALSE(cache.Lookup("a", &value, &s));
+  cache.Insert("a", 11, cache.Generation(), Status::OK(), "3");
+  ASSERT_TRUE(cache.Lookup("a", &value, &s));
+  ASSERT_EQ(value, "3");
+}
+
+TEST_F(RowCacheTest, InvalidateBatch) {
+  TropoRowCache cache(NewLRUCache(1 << 20));
+  std::string value;
+  Status s;
+  for (const char* key : {"a", "b", "c", "d"}) {
+    cache.Insert(key, 10, cache.Generation(), Status::OK(), "v");
+  }
+  WriteBatch batch;
+  ASSERT_OK(batch.Put("a", "1"));
+  ASSERT_OK(batch.Delete("b"));
+  ASSERT_OK(batch.Merge("c", "1"));
+  cache.Invalidate(&batch, 13);
+  ASSERT_FALSE(cache.Lookup("a", &value, &s));
+  ASSERT_FALSE(cache.Lookup("b", &value, &s));
+  ASSERT_FALSE(cache.Lookup("c", &value, &s));
+  ASSERT_TRUE(cache.Lookup("d", &value, &s));
+  // Range deletes drop everything
+  batch.Clear();
+  ASSERT_OK(batch.DeleteRange("x", "y"));
+  cache.Invalidate(&batch, 14);
+  ASSERT_FALSE(cache.Lookup("d", &value, &s));
+}
+
+TEST_F(RowCacheTest, InvalidateAll) {
+  TropoRowCache cache(NewLRUCache(1 << 20));
+  std::string value;
+  Status s;
+  const uint64_t generation = cache.Generation();
+  cache.Insert("a", 10, generation, Status::OK(), "1");
+  cache.InvalidateAll();
+  ASSERT_NE(cache.Generation(), generation);
+  ASSERT_FALSE(cache.Lookup("a", &value, &s));
+  // Reads that started before are inserted in the old generation
+  cache.Insert("a", 10, generation, Status::OK(), "1");
+  ASSERT_FALSE(cache.Lookup("a", &value, &s));
+}
+
+TEST_F(RowCacheTest, SharedCache) {
+  std::shared_ptr<Cache> shared = NewLRUCache(1 << 20);
+  TropoRowCache first(shared);
+  TropoRowCache second(shared);
+  std::string value;
+  Status s;
+  first.Insert("a", 10, first.Generation(), Status::OK(), "1");
+  ASSERT_FALSE(second.Lookup("a", &value, &s));
+  ASSERT_TRUE(first.Lookup("a", &value, &s));
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -6,130 +6,112 @@
 namespace ROCKSDB_NAMESPACE {
 class SSTableTest : public testing::Test {};
 
-static std::vector<Slice> in_order_search(InternalKeyComparator ucmp, int begin,
-                                          int end) {
-  std::vector<Slice> slices;
+static std::vector<std::string> in_order_search(int begin, int end) {
+  std::vector<std::string> keys;
   for (int i = begin; i < end; i++) {
-    std::string str = std::to_string(i);
-    char* c = new char[str.length() + 1];
-    memcpy(c, str.c_str(), str.length() + 1);
-    Slice s = Slice(c, str.length() + 1);
-    slices.push_back(s);
+    keys.push_back(std::to_string(i));
   }
-
-  const Comparator* icmp = ucmp.user_comparator();
-  std::sort(slices.begin(), slices.end(),
-            [icmp](const Slice& s1, const Slice& s2) -> bool {
-              return icmp->Compare(s1, s2) < 0;
+  std::sort(keys.begin(), keys.end(),
+            [](const std::string& s1, const std::string& s2) -> bool {
+              return BytewiseComparator()->Compare(s1, s2) < 0;
             });
-  return slices;
+  return keys;
 }
 
-// no idea what on earth memtable is doing with Slices that length decreases,
-// but this workaround is needed.
-void safe_check(Slice l, Slice r) {
-  ASSERT_TRUE(l.size() <= r.size());
-  ASSERT_TRUE(memcmp(l.data(), r.data(), l.size()) == 0);
+// Tables hold internal keys, values equal their user keys.
+static void check(Iterator* it, const std::string& key) {
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(ExtractUserKey(it->key()).ToString(), key);
+  ASSERT_EQ(it->value().ToString(), key);
 }
 
 TEST_F(SSTableTest, ITER) {
   Device dev;
-  DBOptions options;
-  WriteOptions woptions;
   InternalKeyComparator icmp = InternalKeyComparator(BytewiseComparator());
-  Status s;
-  uint64_t begin = 3;
-  uint64_t end = 5;
-  // Initial
-  SetupDev(&dev, begin, end, false);
-  ZnsDevice::DeviceInfo info = (*dev.device_manager)->info;
-  ValidateMeta(&dev, begin, end);
-  TropoMemtable* mem = new TropoMemtable(options, icmp);
-  SSZoneMetaData meta;
+  uint64_t begin = 10;
+  uint64_t end = 200;
+  SetupDev(&dev, begin, end);
+  ValidateMeta(&dev, begin);
   // write 1000 pairs (enough to cause multiple lbas for 4kb lbasize)
-  mem->Ref();
-  WriteBatch batch = WriteBatch();
+  std::vector<SSZoneMetaData> metas;
+  WriteBatch batch;
   for (int i = 0; i < 1000; i++) {
-    batch.Put(Slice(std::to_string(i)), Slice(std::to_string(i)));
+    ASSERT_OK(batch.Put(std::to_string(i), std::to_string(i)));
   }
-  mem->Write(woptions, &batch);
-  ASSERT_TRUE(mem->GetInternalSize() > info.lba_size);
-  dev.ss_manager->FlushMemTable(mem, &meta);
+  FlushBatch(&dev, &batch, 1, &metas);
+  ASSERT_EQ(metas.size(), 1U);
+  ASSERT_GT(metas[0].lba_count, 1U);
   // Iterator test
-  Iterator* it = dev.ss_manager->NewIterator(0, &meta);
+  const Comparator* ucmp = icmp.user_comparator();
+  Iterator* it = dev.ss_manager->NewIterator(0, metas[0], ucmp);
   it->SeekToFirst();
-  ASSERT_TRUE(it->Valid());
-  ASSERT_TRUE(it->value() == Slice("0"));
-  std::vector<Slice> slices_ordered = in_order_search(icmp, 0, 1000);
+  std::vector<std::string> ordered = in_order_search(0, 1000);
+  check(it, ordered[0]);
   for (int i = 1; i < 200; i++) {
-    ASSERT_TRUE(it->Valid());
     it->Next();
-    safe_check(it->key(), slices_ordered[i]);
-    safe_check(it->value(), slices_ordered[i]);
+    check(it, ordered[i]);
   }
-  it->Seek(Slice("300"));
-  ASSERT_TRUE(it->value() == Slice("300"));
-  it->Seek(Slice("257"));
-  ASSERT_TRUE(it->value() == Slice("257"));
+  it->Seek(InternalKey("300", kMaxSequenceNumber, kValueTypeForSeek).Encode());
+  check(it, "300");
+  it->Seek(InternalKey("257", kMaxSequenceNumber, kValueTypeForSeek).Encode());
+  check(it, "257");
+  size_t pos = std::find(ordered.begin(), ordered.end(), "257") -
+               ordered.begin();
   it->Prev();
-  safe_check(it->value(), slices_ordered[175]);
+  check(it, ordered[pos - 1]);
   it->Next();
-  safe_check(it->value(), slices_ordered[176]);
+  check(it, ordered[pos]);
   it->Prev();
   it->Prev();
   it->Prev();
   it->Next();
-  safe_check(it->value(), slices_ordered[174]);
-  for (int i = 0; i < 826; i++) {
+  check(it, ordered[pos - 2]);
+  for (size_t i = pos - 2; i < ordered.size(); i++) {
     ASSERT_TRUE(it->Valid());
     it->Next();
   }
-  ASSERT_TRUE(!it->Valid());
-  it->Prev();
-  safe_check(it->value(), slices_ordered[999]);
-  for (int i = 0; i < 999; i++) {
+  ASSERT_FALSE(it->Valid());
+  it->SeekToLast();
+  check(it, ordered[999]);
+  for (int i = 0; i < 1000; i++) {
     ASSERT_TRUE(it->Valid());
     it->Prev();
   }
-  ASSERT_TRUE(!it->Valid());
+  ASSERT_FALSE(it->Valid());
   it->SeekToFirst();
-  safe_check(it->value(), slices_ordered[0]);
+  check(it, ordered[0]);
   it->SeekToLast();
-  safe_check(it->value(), slices_ordered[999]);
-  mem->Unref();
+  check(it, ordered[999]);
+  delete it;
 
   // merge iterators
-  mem = new TropoMemtable(options, icmp);
-  mem->Ref();
-  batch = WriteBatch();
+  SSZoneMetaData meta_m1;
+  SSZoneMetaData meta_m2;
+  batch.Clear();
   for (int i = 0; i < 1000; i += 2) {
-    batch.Put(Slice(std::to_string(i)), Slice(std::to_string(i)));
+    ASSERT_OK(batch.Put(std::to_string(i), std::to_string(i)));
   }
-  mem->Write(woptions, &batch);
-  SSZoneMetaData meta_m1;
-  dev.ss_manager->FlushMemTable(mem, &meta_m1);
-  mem->Unref();
-  mem = new TropoMemtable(options, icmp);
-  mem->Ref();
-  batch = WriteBatch();
+  FlushBatch(&dev, &batch, 1001, &metas);
+  ASSERT_EQ(metas.size(), 1U);
+  meta_m1 = metas[0];
+  batch.Clear();
   for (int i = 1; i < 1000; i += 2) {
-    batch.Put(Slice(std::to_string(i)), Slice(std::to_string(i)));
+    ASSERT_OK(batch.Put(std::to_string(i), std::to_string(i)));
   }
-  mem->Write(woptions, &batch);
-  SSZoneMetaData meta_m2;
-  dev.ss_manager->FlushMemTable(mem, &meta_m2);
-  mem->Unref();
-  Iterator* m1 = dev.ss_manager->NewIterator(0, &meta_m1);
-  Iterator* m2 = dev.ss_manager->NewIterator(0, &meta_m2);
-  Iterator** m12 = new Iterator* [2] { m1, m2 };
-  Iterator* merged = NewMergingIterator(icmp.user_comparator(), m12, 2);
+  FlushBatch(&dev, &batch, 2001, &metas);
+  ASSERT_EQ(metas.size(), 1U);
+  meta_m2 = metas[0];
+  Iterator* m1 = dev.ss_manager->NewIterator(0, meta_m1, ucmp);
+  Iterator* m2 = dev.ss_manager->NewIterator(0, meta_m2, ucmp);
+  Iterator* m12[2] = {m1, m2};
+  Iterator* merged = NewMergingIterator(&icmp, m12, 2);
   merged->SeekToFirst();
-  ASSERT_TRUE(merged->Valid());
-  for (int i = 1; i <= 1000; i++) {
-    safe_check(merged->key(), slices_ordered[i - 1]);
+  for (int i = 0; i < 1000; i++) {
+    check(merged, ordered[i]);
     merged->Next();
   }
-  ASSERT_TRUE(!merged->Valid());
+  ASSERT_FALSE(merged->Valid());
+  delete merged;
   TearDownDev(&dev);
 }
 }  // namespace ROCKSDB_NAMESPACE
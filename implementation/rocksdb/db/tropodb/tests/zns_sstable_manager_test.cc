@@ -1,146 +1,154 @@
-
 #include "db/tropodb/table/tropodb_sstable_manager.h"
 
+#include "db/tropodb/index/tropodb_column_family.h"
 #include "db/tropodb/tests/zns_test_utils.h"
 #include "test_util/testharness.h"
 
 namespace ROCKSDB_NAMESPACE {
 class SSTableTest : public testing::Test {};
 
-static void WasteLba(Device* device) {
-  DBOptions options;
-  WriteOptions woptions;
-  InternalKeyComparator icmp = InternalKeyComparator(BytewiseComparator());
-  SSZoneMetaData meta;
-  TropoMemtable* mem = new TropoMemtable(options, icmp);
-  mem->Ref();
-  WriteBatch batch = WriteBatch();
-  batch.Put(Slice("123"), Slice("456"));
-  mem->Write(woptions, &batch);
-  device->ss_manager->FlushMemTable(mem, &meta);
-  mem->Unref();
+static void GetAll(Device* device, const SSZoneMetaData& meta, int count,
+                   int modulo) {
+  InternalKeyComparator icmp(BytewiseComparator());
+  for (int i = 0; i < count; i++) {
+    std::string value;
+    EntryStatus entry;
+    LookupKey key(std::to_string(i), kMaxSequenceNumber);
+    ASSERT_OK(device->ss_manager->Get(0, icmp, key.internal_key(), &value,
+                                      meta, &entry));
+    ASSERT_TRUE(entry == EntryStatus::found);
+    ASSERT_EQ(value, std::to_string(i % modulo));
+  }
 }
 
 TEST_F(SSTableTest, TESTFILL) {
   Device dev;
-  DBOptions options;
-  WriteOptions woptions;
-  InternalKeyComparator icmp = InternalKeyComparator(BytewiseComparator());
-  Status s;
-  uint64_t begin = 3;
-  uint64_t end = 5;
-  // Initial
-  SetupDev(&dev, begin, end, false);
-  ZnsDevice::DeviceInfo info = (*dev.device_manager)->info;
-  ValidateMeta(&dev, begin, end);
-  TropoL0SSTable* sstable = dev.ss_manager->GetL0SSTableLog();
-  ASSERT_EQ(TropoSSTableManagerInternal::GetZoneHead(sstable),
-            info.zone_size * begin);
-  ASSERT_EQ(TropoSSTableManagerInternal::GetWriteHead(sstable),
-            info.zone_size * begin);
+  uint64_t begin = 10;
+  uint64_t end = 200;
+  SetupDev(&dev, begin, end);
+  ValidateMeta(&dev, begin);
+  TropoL0SSTable* sstable = dev.ss_manager->GetL0SSTableLog(0);
+  const uint64_t min_head = begin * dev.info.zone_cap;
+  ASSERT_EQ(sstable->GetHead(), min_head);
+  ASSERT_EQ(sstable->GetTail(), min_head);
+
   // 1 pair
-  TropoMemtable* mem = new TropoMemtable(options, icmp);
-  mem->Ref();
-  ASSERT_EQ(mem->GetInternalSize(), 0);
+  std::vector<SSZoneMetaData> metas;
   WriteBatch batch;
-  batch.Put(Slice("123"), Slice("456"));
-  mem->Write(woptions, &batch);
-  SSZoneMetaData meta;
-  dev.ss_manager->FlushMemTable(mem, &meta);
-  std::string value;
-  EntryStatus stata;
-  s = dev.ss_manager->Get(0, Slice("123"), &value, &meta, &stata);
-  ASSERT_TRUE(s.ok());
-  ASSERT_TRUE(Slice(value) == Slice("456"));
-  ASSERT_EQ(meta.lba, info.zone_size * begin);
-  ASSERT_EQ(meta.numbers, 1);
-  ASSERT_EQ(meta.lba_count, 1);
-  ASSERT_TRUE(meta.smallest.Encode() == meta.largest.Encode());
+  ASSERT_OK(batch.Put("0", "0"));
+  FlushBatch(&dev, &batch, 1, &metas);
+  ASSERT_EQ(metas.size(), 1U);
+  ASSERT_EQ(metas[0].L0.lba, min_head);
+  ASSERT_EQ(metas[0].numbers, 1U);
+  ASSERT_GE(metas[0].lba_count, 1U);
+  ASSERT_TRUE(metas[0].smallest.Encode() == metas[0].largest.Encode());
+  GetAll(&dev, metas[0], 1, 1);
+  ASSERT_EQ(sstable->GetHead(), min_head + metas[0].lba_count);
+  std::vector<SSZoneMetaData*> live;
+  metas[0].number = 1;
+  live.push_back(new SSZoneMetaData(metas[0]));
+
   // 1000 pairs (enough to cause multiple lbas for 4kb lbasize)
-  mem->Unref();
-  mem = new TropoMemtable(options, icmp);
-  mem->Ref();
-  batch = WriteBatch();
+  const uint64_t next = metas[0].L0.lba + metas[0].lba_count;
+  batch.Clear();
   for (int i = 0; i < 1000; i++) {
-    batch.Put(Slice(std::to_string(i)), Slice(std::to_string(i % 20)));
+    ASSERT_OK(batch.Put(std::to_string(i), std::to_string(i % 20)));
   }
-  mem->Write(woptions, &batch);
-  ASSERT_TRUE(mem->GetInternalSize() > info.lba_size);
-  dev.ss_manager->FlushMemTable(mem, &meta);
-  uint64_t lbas = (mem->GetInternalSize() + info.lba_size - 1) / info.lba_size;
-  ASSERT_EQ(meta.lba, info.zone_size * begin + 1);
-  ASSERT_EQ(meta.numbers, 1000);
-  ASSERT_TRUE(meta.lba_count <= lbas);
-  ASSERT_TRUE(meta.smallest.user_key() ==
-              InternalKey(Slice("0"), 0, kTypeValue).user_key());
-  ASSERT_TRUE(meta.largest.user_key() ==
-              InternalKey(Slice("999"), 0, kTypeValue).user_key());
-  for (int i = 0; i < 1000; i++) {
-    value.clear();
-    s = dev.ss_manager->Get(0, Slice(std::to_string(i)), &value, &meta, &stata);
-    ASSERT_TRUE(s.ok());
-    ASSERT_TRUE(stata == EntryStatus::found);
-    ASSERT_TRUE(Slice(std::to_string(i % 20)) == Slice(value));
-  }
-  // Try to stop just before a zone
-  for (uint64_t i = meta.lba + lbas; i < (begin + 1) * info.zone_size - 1;
-       i++) {
-    WasteLba(&dev);
+  FlushBatch(&dev, &batch, 2, &metas);
+  ASSERT_EQ(metas.size(), 1U);
+  ASSERT_EQ(metas[0].L0.lba, next);
+  ASSERT_EQ(metas[0].numbers, 1000U);
+  ASSERT_GT(metas[0].lba_count, 1U);
+  ASSERT_EQ(metas[0].smallest.user_key(), Slice("0"));
+  ASSERT_EQ(metas[0].largest.user_key(), Slice("999"));
+  GetAll(&dev, metas[0], 1000, 20);
+  metas[0].number = 2;
+  live.push_back(new SSZoneMetaData(metas[0]));
+
+  // Fill the log until a flush no longer fits
+  SequenceNumber seq = 1002;
+  auto flush_round = [&](int modulo) {
+    batch.Clear();
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_OK(batch.Put(std::to_string(i), std::to_string(i % modulo)));
+    }
+    FlushBatch(&dev, &batch, seq, &metas);
+    seq += 1000;
+    ASSERT_EQ(metas.size(), 1U);
+    metas[0].number = live.size() + 1;
+    live.push_back(new SSZoneMetaData(metas[0]));
+  };
+  const uint64_t table_bytes = metas[0].lba_count * dev.info.lba_size;
+  while (dev.ss_manager->SpaceRemainingInBytesL0(0) > 2 * table_bytes) {
+    flush_round(7);
   }
-  // Now do a multiple zone SSTable...
-  mem->Unref();
-  mem = new TropoMemtable(options, icmp);
-  mem->Ref();
-  batch = WriteBatch();
-  for (int i = 0; i < 1000; i++) {
-    batch.Put(Slice(std::to_string(i)), Slice(std::to_string(i)));
+  ASSERT_GT(live.size(), 10U);
+  GetAll(&dev, *live.back(), 1000, 7);
+
+  // Freeing the tail gives whole zones back, the log wraps around
+  std::vector<SSZoneMetaData*> remaining;
+  ASSERT_OK(dev.ss_manager->DeleteL0Table(live, remaining));
+  ASSERT_GT(sstable->GetTail(), min_head);
+  const uint64_t head = sstable->GetHead();
+  for (int i = 0; i < 100 && sstable->GetHead() >= head; i++) {
+    flush_round(3);
   }
-  mem->Write(woptions, &batch);
-  ASSERT_TRUE(mem->GetInternalSize() > info.lba_size);
-  SSZoneMetaData meta_border;
-  s = dev.ss_manager->FlushMemTable(mem, &meta_border);
-  ASSERT_TRUE(s.ok());
-  lbas = (mem->GetInternalSize() + info.lba_size - 1) / info.lba_size;
-  mem->Unref();
-  ASSERT_TRUE(meta_border.lba <= info.zone_size * (begin + 1) - 1);
-  ASSERT_EQ(meta_border.numbers, 1000);
-  ASSERT_TRUE(meta_border.lba_count <= lbas);
-  ASSERT_TRUE(meta_border.smallest.user_key() ==
-              InternalKey(Slice("0"), 0, kTypeValue).user_key());
-  ASSERT_TRUE(meta_border.largest.user_key() ==
-              InternalKey(Slice("999"), 0, kTypeValue).user_key());
-  for (int i = 0; i < 1000; i++) {
-    value.clear();
-    s = dev.ss_manager->Get(0, Slice(std::to_string(i)), &value, &meta_border,
-                            &stata);
-    ASSERT_TRUE(s.ok());
-    ASSERT_TRUE(stata == EntryStatus::found);
-    ASSERT_TRUE(Slice(std::to_string(i)) == Slice(value));
+  ASSERT_LT(sstable->GetHead(), head);
+  GetAll(&dev, *live.back(), 1000, 3);
+  GetAll(&dev, *live[live.size() - 2], 1000, 3);
+  for (auto m : live) {
+    delete m;
   }
-  // fill
-  for (uint64_t i = TropoSSTableManagerInternal::GetWriteHead(sstable);
-       i < TropoSSTableManagerInternal::GetMaxZoneHead(sstable); i++) {
-    WasteLba(&dev);
+  TearDownDev(&dev);
+}
+
+TEST_F(SSTableTest, FlushClipsRangeTombstones) {
+  // Families are never in one table, so one flush gives a table per family
+  TropoColumnFamilySet families;
+  families.SetKeyed(true);
+  auto key = [&](uint32_t id, const std::string& user_key) {
+    std::string stored;
+    families.AppendKey(id, user_key, &stored);
+    return stored;
+  };
+  Device dev;
+  InternalKeyComparator icmp(BytewiseComparator());
+  const Comparator* ucmp = icmp.user_comparator();
+  SetupDev(&dev, 10, 200);
+  dev.ss_manager->SetColumnFamilies(&families);
+  WriteBatch batch;
+  for (uint32_t id = 0; id < 3; id++) {
+    ASSERT_OK(batch.Put(key(id, "a"), "a"));
+    ASSERT_OK(batch.Put(key(id, "z"), "z"));
   }
-  // check what happens when no space.
-  {
-    mem = new TropoMemtable(options, icmp);
-    mem->Ref();
-    batch = WriteBatch();
-    batch.Put(Slice("break"), Slice("down"));
-    mem->Write(woptions, &batch);
-    s = dev.ss_manager->FlushMemTable(mem, &meta);
-    ASSERT_FALSE(s.ok());
-    // try to eat parts of the tail
-    s = TropoSSTableManagerInternal::ConsumeTail(sstable, begin * info.zone_size,
-                                               begin * info.zone_size + 3);
-    ASSERT_TRUE(s.ok());
-    s = TropoSSTableManagerInternal::ConsumeTail(
-        sstable, begin * info.zone_size + 3, (begin + 1) * info.zone_size);
-    ASSERT_TRUE(s.ok());
-    s = TropoSSTableManagerInternal::ConsumeTail(
-        sstable, (begin + 1) * info.zone_size, info.zone_size * end);
-    ASSERT_TRUE(s.ok());
+  ASSERT_OK(batch.DeleteRange(key(0, "m"), key(2, "c")));
+  std::vector<SSZoneMetaData> metas;
+  FlushBatch(&dev, &batch, 1, &metas);
+  ASSERT_EQ(metas.size(), 3U);
+
+  // Each table holds the part of the tombstone up to the next table
+  const std::vector<std::pair<std::string, std::string>> expected = {
+      {key(0, "m"), key(1, "a")},
+      {key(1, "a"), key(2, "a")},
+      {key(2, "a"), key(2, "c")}};
+  for (size_t i = 0; i < metas.size(); i++) {
+    const SSZoneMetaData& m = metas[i];
+    ASSERT_EQ(m.range_tombstones.size(), 1U);
+    ASSERT_EQ(m.range_tombstones[0].start, expected[i].first);
+    ASSERT_EQ(m.range_tombstones[0].end, expected[i].second);
+    ASSERT_EQ(m.range_tombstones[0].seq, 7U);
+    ASSERT_GE(ucmp->Compare(m.range_tombstones[0].start,
+                            m.smallest.user_key()), 0);
+    ASSERT_LE(ucmp->Compare(m.range_tombstones[0].end, m.largest.user_key()),
+              0);
+    // Tables only meet at the exclusive tombstone end, which sorts before
+    // all entries of that key.
+    if (i > 0) {
+      ASSERT_LE(icmp.Compare(metas[i - 1].largest, m.smallest), 0);
+      ASSERT_LT(icmp.Compare(metas[i - 1].largest,
+                             InternalKey(key(i, "a"), 1, kTypeValue)),
+                0);
+    }
   }
   TearDownDev(&dev);
 }
@@ -1,67 +1,89 @@
 #include "db/tropodb/table/tropodb_sstable_manager.h"
-#include "test_util/testharness.h"
 #include "db/tropodb/tropodb_config.h"
+#include "db/write_batch_internal.h"
+#include "test_util/testharness.h"
 
 namespace ROCKSDB_NAMESPACE {
+// Without ZNS hardware the tests run on the in-memory device, build with
+// TROPODB_EMULATED_ZNS.
+#ifdef TROPODB_EMULATED_ZNS
+static const char* kTestDevice = "tropodb_test:zones=256,zone_cap=64";
+#else
+static const char* kTestDevice = "0000:00:04.0";
+#endif
+
 struct Device {
-  ZnsDevice::DeviceManager** device_manager = nullptr;
-  ZnsDevice::QPair** qpair = nullptr;
-  QPairFactory* qpair_factory = nullptr;
+  SZD::SZDDevice* device = nullptr;
+  SZD::SZDChannelFactory* channel_factory = nullptr;
+  SZD::DeviceInfo info;
   TropoSSTableManager* ss_manager = nullptr;
 };
 
-static void SetupDev(Device* device, int first_zone, int last_zone,
-                     bool reinit) {
-  device->device_manager = new ZnsDevice::DeviceManager*;
-  int rc = reinit ? ZnsDevice::z_reinit(device->device_manager)
-                  : ZnsDevice::z_init(device->device_manager);
-  ASSERT_EQ(rc, 0);
-  rc = ZnsDevice::z_open(*(device->device_manager), "0000:00:04.0");
-  ASSERT_EQ(rc, 0);
-  device->qpair = (ZnsDevice::QPair**)calloc(1, sizeof(ZnsDevice::QPair*));
-  rc = ZnsDevice::z_create_qpair(*(device->device_manager), (device->qpair));
-  ASSERT_EQ(rc, 0);
-  rc = ZnsDevice::z_reset(*device->qpair, 0, true);
-  ASSERT_EQ(rc, 0);
-  device->qpair_factory = new QPairFactory(*(device->device_manager));
-  device->qpair_factory->Ref();
-  ASSERT_EQ(device->qpair_factory->Getref(), 1);
-  uint64_t zsize = (*device->device_manager)->info.zone_size;
-  std::pair<uint64_t, uint64_t> ranges[TropoDBConfig::level_count] = {
-      std::make_pair(zsize * first_zone, zsize * last_zone),
-      std::make_pair(zsize * last_zone, zsize * (last_zone + 5)),
-      std::make_pair(zsize * (last_zone + 5), zsize * (last_zone + 10)),
-      std::make_pair(zsize * (last_zone + 10), zsize * (last_zone + 15)),
-      std::make_pair(zsize * (last_zone + 15), zsize * (last_zone + 20)),
-      std::make_pair(zsize * (last_zone + 20), zsize * (last_zone + 25)),
-      std::make_pair(zsize * (last_zone + 25), zsize * (last_zone + 30))};
-  device->ss_manager = new TropoSSTableManager(
-      device->qpair_factory, (*device->device_manager)->info, ranges);
-  ASSERT_EQ(device->qpair_factory->Getref(), 2 + 7);
+// Opens zones [first_zone, last_zone) of the test device with every L0 log
+// on it. All zones of the region are reset first.
+static void SetupDev(Device* device, uint64_t first_zone, uint64_t last_zone) {
+  device->device = new SZD::SZDDevice("tropodb_test");
+  ASSERT_OK(FromStatus(device->device->Init()));
+  ASSERT_OK(FromStatus(
+      device->device->Open(kTestDevice, first_zone, last_zone)));
+  ASSERT_OK(FromStatus(device->device->GetInfo(&device->info)));
+  device->channel_factory = new SZD::SZDChannelFactory(
+      device->device->GetDeviceManager(), TropoDBConfig::max_channels);
+  device->channel_factory->Ref();
+  SZD::SZDChannel* channel;
+  ASSERT_OK(FromStatus(device->channel_factory->register_channel(
+      &channel, first_zone, last_zone)));
+  ASSERT_OK(FromStatus(channel->ResetAllZones()));
+  ASSERT_OK(
+      FromStatus(device->channel_factory->unregister_channel(channel)));
+
+  TropoSSTableManager::DeviceRegion region{
+      device->channel_factory, device->info, first_zone, last_zone, {}};
+  for (uint8_t i = 0; i < TropoDBConfig::lower_concurrency; i++) {
+    region.l0_stripes.push_back(i);
+  }
+  std::optional<TropoSSTableManager*> ss_manager =
+      TropoSSTableManager::NewTropoDBSSTableManager({region});
+  ASSERT_TRUE(ss_manager.has_value());
+  device->ss_manager = *ss_manager;
   device->ss_manager->Ref();
   ASSERT_EQ(device->ss_manager->Getref(), 1);
+  // Flushes defer their writes to a LOW thread
+  Env::Default()->IncBackgroundThreadsIfNeeded(1, Env::LOW);
 }
 
 static void TearDownDev(Device* device) {
   ASSERT_EQ(device->ss_manager->Getref(), 1);
   device->ss_manager->Unref();
-  ASSERT_EQ(device->qpair_factory->Getref(), 1);
-  device->qpair_factory->Unref();
-  int rc = ZnsDevice::z_destroy_qpair(*device->qpair);
-  ASSERT_EQ(rc, 0);
-  rc = ZnsDevice::z_shutdown(*device->device_manager);
-  if (device->qpair != nullptr) delete device->qpair;
+  ASSERT_EQ(device->channel_factory->GetRef(), 1U);
+  device->channel_factory->Unref();
+  device->device->Close();
+  delete device->device;
 }
 
-static void ValidateMeta(Device* device, int first_zone, int last_zone) {
-  ZnsDevice::DeviceInfo info = (*device->device_manager)->info;
-  TropoL0SSTable* sstable = device->ss_manager->GetL0SSTableLog();
+static void ValidateMeta(Device* device, uint64_t first_zone) {
+  TropoL0SSTable* sstable = device->ss_manager->GetL0SSTableLog(0);
   ASSERT_EQ(TropoSSTableManagerInternal::GetMinZoneHead(sstable),
-            info.zone_size * first_zone);
-  ASSERT_EQ(TropoSSTableManagerInternal::GetMaxZoneHead(sstable),
-            info.zone_size * last_zone);
-  ASSERT_EQ(TropoSSTableManagerInternal::GetZoneSize(sstable), info.zone_size);
-  ASSERT_EQ(TropoSSTableManagerInternal::GetLbaSize(sstable), info.lba_size);
+            device->info.zone_cap * first_zone);
+  ASSERT_GT(TropoSSTableManagerInternal::GetMaxZoneHead(sstable),
+            device->info.zone_cap * first_zone);
+  ASSERT_EQ(TropoSSTableManagerInternal::GetZoneSize(sstable),
+            device->info.zone_cap);
+  ASSERT_EQ(TropoSSTableManagerInternal::GetLbaSize(sstable),
+            device->info.lba_size);
 }
 
+// Flushes the batch to L0-0 as tables starting at sequence number seq.
+static void FlushBatch(Device* device, WriteBatch* batch, SequenceNumber seq,
+                       std::vector<SSZoneMetaData>* metas) {
+  DBOptions options;
+  InternalKeyComparator icmp(BytewiseComparator());
+  TropoMemtable* mem = new TropoMemtable(options, icmp, 1 << 20);
+  mem->Ref();
+  WriteBatchInternal::SetSequence(batch, seq);
+  ASSERT_OK(mem->Write(WriteOptions(), batch));
+  metas->clear();
+  ASSERT_OK(device->ss_manager->FlushMemTable(mem, *metas, 0, Env::Default()));
+  mem->Unref();
+}
 }  // namespace ROCKSDB_NAMESPACE
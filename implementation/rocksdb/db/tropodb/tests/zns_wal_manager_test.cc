@@ -0,0 +1,45 @@
+#include "db/tropodb/persistence/tropodb_wal_manager.h"
+
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+class WALManagerTest : public testing::Test {};
+
+template <std::size_t N>
+static void CheckFreeWALs() {
+  typedef TropoWALManager<N> Manager;
+  for (size_t tail = 0; tail < N; tail++) {
+    for (size_t head = 0; head < N; head++) {
+      if (head == tail) {
+        ASSERT_EQ(Manager::FreeWALs(head, tail), 0U);
+        continue;
+      }
+      // Handing out WALs as NewWAL does, until none are available. The head
+      // must never run into the tail.
+      size_t free = Manager::FreeWALs(head, tail);
+      size_t h = head;
+      while (Manager::WALAvailable(h, tail)) {
+        ASSERT_GT(free, 0U) << head << " " << tail;
+        h = h + 1 == N ? 0 : h + 1;
+        ASSERT_NE(h, tail) << head << " " << tail;
+        ASSERT_EQ(Manager::FreeWALs(h, tail), free - 1);
+        free--;
+      }
+      ASSERT_EQ(free, 0U) << head << " " << tail;
+    }
+  }
+}
+
+TEST_F(WALManagerTest, FreeWALs) {
+  CheckFreeWALs<3>();
+  CheckFreeWALs<4>();
+  CheckFreeWALs<TropoDBConfig::wal_manager_zone_count>();
+  // Fresh manager: head 0, tail N - 1
+  ASSERT_EQ((TropoWALManager<4>::FreeWALs(0, 3)), 2U);
+}
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -53,6 +53,10 @@ constexpr static uint8_t level_count =
     6; /**< Amount of LSM-tree levels L0 up to LN */
 constexpr static size_t L0_zones =
     100; /**< amount of zones to reserve for each L0 circular log */
+constexpr static size_t L0_borrow_zones =
+    0; /**< Amount of LN zones a flush may borrow when its L0 circular log is
+          full, instead of stalling clients. Only L0 borrows and only from
+          LN; WAL, L0 and LN keep their own zone regions. 0 disables it. */
 constexpr static uint8_t lower_concurrency =
     1; /**< Number of L0 circular logs. Increases parallelism. */
 constexpr static size_t wal_manager_zone_count = wal_count / lower_concurrency;
@@ -61,9 +65,16 @@ constexpr static int L0_slow_down =
            stabilise latency. Setting this too high can cause some clients to
            wait for minutes during heavy background I/O.*/
 static constexpr uint8_t number_of_concurrent_L0_readers =
-    4;  // Maximum number of concurrent reader threads reading from L0.
+    16;  // Maximum number of concurrent reader threads reading from L0.
 static constexpr uint8_t number_of_concurrent_LN_readers =
-    4;  // Maximum number of concurrent reader threads reading from LN.
+    16;  // Maximum number of concurrent reader threads reading from LN.
+         // The number used is picked at open, one for each core within
+         // max_reader_channels.
+constexpr static bool get_read_tables_concurrently =
+    false; /**< If a Get that misses its first table reads the remaining
+              uncached L0 tables that can hold the key at once through the
+              asynchronous read queues, instead of one by one. Off by
+              default, prefetching reads tables the Get may not need. */
 constexpr static size_t min_ss_zone_count =
     5; /**< Minimum amount of zones for L0 and LN each*/
 constexpr static double ss_compact_treshold[level_count]{
@@ -94,10 +105,14 @@ constexpr static uint64_t max_bytes_sstable_l0 =
 constexpr static uint64_t max_bytes_sstable_ =
     (uint64_t)(1073741824. * 2. *
                0.95); /**< Maximum size of SSTables in LN. LN tables
-                         reserve entire zones, therefore, please set
-                         to a multitude of approximately n zones */
+                         reserve entire zones, therefore, TropoDB rounds this
+                         to the nearest number of zones of the device. */
 constexpr static uint64_t max_lbas_compaction_l0 = 2097152 * 12; /**< Maximum
 amount of LBAS that can be considered for L0 to LN compaction. Prevents OOM.*/
+constexpr static double tiered_size_ratio =
+    2.; /**< Only used with tiered compaction (compaction_style is universal).
+           Each LN level then holds one sorted run and a run is merged into the
+           next older run if that run is at most this many times bigger. */
 
 // Flushes
 constexpr static bool flushes_allow_deferring_writes =
@@ -107,6 +122,17 @@ constexpr static bool flushes_allow_deferring_writes =
 constexpr static uint8_t flushing_maximum_deferred_writes =
     4; /**< How many SSTables can be deferred at most. Be careful, setting
 this too high can cause OOM.*/
+constexpr static uint8_t flush_ranges =
+    1; /**< Large memtables are split in up to this many key ranges during a
+             flush. Their tables are built concurrently on HIGH threads and
+             all written by the deferred writer. 1 flushes on one thread.
+             Each stripe reserves this many HIGH threads, only raise it when
+             flush throughput is measured to improve. */
+constexpr static bool flush_merge_stripes =
+    false; /**< A flush also takes the immutable memtables of other stripes
+                that are not flushing yet and fit in its L0 log. Stripes share
+                the key space, merging them gives one run of non-overlapping
+                L0 tables instead of one run per stripe. */
 
 // Compaction
 constexpr static bool compaction_allow_prefetching =
@@ -130,6 +156,9 @@ constexpr static uint64_t compaction_max_grandparents_overlapping_tables =
 constexpr static uint64_t min_zone = 0; /**< Minimum zone to use for database.*/
 constexpr static uint64_t max_zone =
     0x0; /**< Maximum zone to use for database. Set to 0 for full region*/
+constexpr static uint8_t max_devices =
+    4; /**< Maximum number of ZNS devices one database can stripe over. The
+          devices are named by db_paths and need equal zone and lba sizes. */
 
 // MISC
 constexpr static TropoLogLevel default_log_level =
@@ -137,9 +166,18 @@ constexpr static TropoLogLevel default_log_level =
 constexpr static size_t max_channels =
     0x100; /**< Maximum amount of channels that can be live. Used to ensure
               that there is no channel leak. */
+constexpr static size_t max_reader_channels =
+    max_channels / 2; /**< Reader channels that the SSTable logs of one
+                         device can use together. */
 constexpr static bool use_sstable_encoding =
     true; /**< If RLE should be used for SSTables. */
 constexpr static uint32_t max_sstable_encoding = 16; /**< RLE max size. */
+constexpr static uint32_t prefix_filter_bits_per_key =
+    10; /**< Bits per distinct prefix in the prefix bloom filter of a table.
+           Only used when a prefix_extractor is set. Set to 0 to disable. */
+constexpr static size_t prefix_filter_max_bytes =
+    8192; /**< Prefix filters are stored in the manifest. Tables whose filter
+             would be larger than this get none (every lookup reads them). */
 constexpr static const char* deadbeef =
     "\xaf\xeb\xad\xde"; /**< Used for placeholder strings*/
 
@@ -161,6 +199,8 @@ static_assert(wal_unordered || wal_iodepth == 1,
 static_assert(L0_slow_down > 0);
 static_assert(number_of_concurrent_L0_readers > 0);
 static_assert(number_of_concurrent_LN_readers > 0);
+static_assert(number_of_concurrent_L0_readers <= 64 &&
+              number_of_concurrent_LN_readers <= 64);
 static_assert(min_ss_zone_count > 1);
 static_assert(sizeof(ss_compact_treshold) == level_count * sizeof(double));
 static_assert(sizeof(ss_compact_treshold_force) ==
@@ -185,7 +225,11 @@ static_assert((!compaction_allow_deferring_writes &&
               (compaction_allow_deferring_writes &&
                compaction_maximum_deferred_writes > 0));
 static_assert(max_lbas_compaction_l0 > 0);
+static_assert(flush_ranges > 0);
+static_assert(tiered_size_ratio > 0);
 static_assert(max_channels > 0);
+static_assert(max_reader_channels > 0 && max_reader_channels < max_channels);
+static_assert(max_devices > 0);
 static_assert(!use_sstable_encoding || max_sstable_encoding > 0);
 #ifndef TROPICAL_DEBUG
 static_assert(default_log_level > TropoLogLevel::TROPO_DEBUG_LEVEL,
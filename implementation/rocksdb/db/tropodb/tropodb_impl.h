@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "db/tropodb/tropodb_config.h"
+#include "db/tropodb/index/tropodb_column_family.h"
 #include "db/tropodb/index/tropodb_version.h"
 #include "db/tropodb/index/tropodb_version_set.h"
 #include "db/tropodb/io/szd_port.h"
@@ -30,6 +31,7 @@
 #include "db/tropodb/persistence/tropodb_manifest.h"
 #include "db/tropodb/persistence/tropodb_wal.h"
 #include "db/tropodb/persistence/tropodb_wal_manager.h"
+#include "db/tropodb/table/tropodb_row_cache.h"
 #include "db/tropodb/table/tropodb_sstable_manager.h"
 #include "db/tropodb/table/tropodb_zonemetadata.h"
 #include "options/cf_options.h"
@@ -86,8 +88,9 @@ class TropoDBImpl : public DB {
 
   static Status DestroyDB(const std::string& dbname, const Options& options);
 
-  Status OpenZNSDevice(const std::string dbname);
-  Status ResetZNSDevice();
+  // Opens every device of the database, see DeviceOfStripe.
+  Status OpenZNSDevices(const std::string dbname);
+  Status ResetZNSDevices();
 
   Status InitDB(const DBOptions& options, const size_t max_write_buffer_size);
   void RecoverBackgroundFlow();
@@ -110,6 +113,11 @@ class TropoDBImpl : public DB {
   Status Delete(const WriteOptions& options, ColumnFamilyHandle* column_family,
                 const Slice& key, const Slice& ts) override;
 
+  using DB::DeleteRange;
+  Status DeleteRange(const WriteOptions& options,
+                     ColumnFamilyHandle* column_family, const Slice& begin_key,
+                     const Slice& end_key) override;
+
   using DB::SingleDelete;
   Status SingleDelete(const WriteOptions& options,
                       ColumnFamilyHandle* column_family,
@@ -176,6 +184,11 @@ class TropoDBImpl : public DB {
   virtual bool GetAggregatedIntProperty(const Slice& property,
                                         uint64_t* aggregated_value) override;
 
+  using DB::GetColumnFamilyMetaData;
+  // Tables are named by their number, as CompactFiles expects them.
+  virtual void GetColumnFamilyMetaData(ColumnFamilyHandle* column_family,
+                                       ColumnFamilyMetaData* metadata) override;
+
   using DB::GetApproximateSizes;
   virtual Status GetApproximateSizes(const SizeApproximationOptions& options,
                                      ColumnFamilyHandle* column_family,
@@ -194,6 +207,14 @@ class TropoDBImpl : public DB {
   virtual Status SetDBOptions(
       const std::unordered_map<std::string, std::string>& options_map) override;
 
+  // Inputs are SSTable numbers of one level, see GetColumnFamilyMetaData.
+  // This is a manual compaction of the key range of the inputs, so it can
+  // compact more than the inputs:
+  // - L0 is compacted from the tail of its log until no table overlaps the
+  //   range, older L0 tables are compacted first.
+  // - LN tables between and next to the inputs that overlap the range.
+  // - Tables of the levels below, up to output_level, that overlap the range.
+  // output_file_names are the tables of output_level in the range afterwards.
   using DB::CompactFiles;
   virtual Status CompactFiles(
       const CompactionOptions& compact_options,
@@ -203,9 +224,12 @@ class TropoDBImpl : public DB {
       std::vector<std::string>* const output_file_names = nullptr,
       CompactionJobInfo* compaction_job_info = nullptr) override;
 
-  Status MakeRoomForWrite(size_t size, uint8_t parallel_number);
+  // With force, the memtable is switched even if it has space left.
+  Status MakeRoomForWrite(size_t size, uint8_t parallel_number,
+                          bool force = false);
   void MaybeScheduleFlush(uint8_t parallel_number);
   bool AnyFlushScheduled();
+  bool AnyImmutable();
   void MaybeScheduleCompaction(bool force);
   void MaybeScheduleCompactionL0();
   static void BGFlushWork(void* db);
@@ -213,13 +237,24 @@ class TropoDBImpl : public DB {
   static void BGCompactionL0Work(void* db);
   void BackgroundFlushCall(uint8_t parallel_number);
   void BackgroundFlush(uint8_t parallel_number);
+  // Memtables of the stripes in merged are flushed along with
+  // parallel_number.
   Status FlushL0SSTables(std::vector<SSZoneMetaData>& metas,
-                         uint8_t parallel_number);
+                         uint8_t parallel_number, bool borrow,
+                         const std::vector<uint8_t>& merged);
+  // Claims the immutable memtables of other stripes that fit in the L0 log
+  // of parallel_number after its own memtable.
+  void ClaimMergedFlush(uint8_t parallel_number, std::vector<uint8_t>* merged);
   Status CompactMemtable(uint8_t parallel_number);
   void BackgroundCompactionCall();
   void BackgroundCompaction();
   void BackgroundCompactionL0Call();
   void BackgroundCompactionL0();
+  // Compacts all tables overlapping [begin, end] from first_level down to
+  // last_level and waits till done.
+  Status RunManualCompaction(uint8_t first_level, uint8_t last_level,
+                             const InternalKey* begin, const InternalKey* end,
+                             bool exclusive, std::atomic<bool>* canceled);
 
   virtual Status PauseBackgroundWork() override;
   virtual Status ContinueBackgroundWork() override;
@@ -298,6 +333,29 @@ class TropoDBImpl : public DB {
   using DB::IngestExternalFiles;
   virtual Status IngestExternalFiles(
       const std::vector<IngestExternalFileArg>& args) override;
+  // Bulk loads user keys in strictly increasing order straight into LN, like
+  // IngestExternalFile but without building a file first.
+  Status IngestSortedStream(Iterator* input, bool allow_blocking_flush = true);
+
+  // Column families are key ranges in the shared memtables and SSTables, see
+  // TropoColumnFamilySet.
+  using DB::CreateColumnFamily;
+  Status CreateColumnFamily(const ColumnFamilyOptions& options,
+                            const std::string& column_family_name,
+                            ColumnFamilyHandle** handle) override;
+  using DB::CreateColumnFamilies;
+  Status CreateColumnFamilies(
+      const ColumnFamilyOptions& options,
+      const std::vector<std::string>& column_family_names,
+      std::vector<ColumnFamilyHandle*>* handles) override;
+  Status CreateColumnFamilies(
+      const std::vector<ColumnFamilyDescriptor>& column_families,
+      std::vector<ColumnFamilyHandle*>* handles) override;
+  using DB::DropColumnFamily;
+  Status DropColumnFamily(ColumnFamilyHandle* column_family) override;
+  using DB::DropColumnFamilies;
+  Status DropColumnFamilies(
+      const std::vector<ColumnFamilyHandle*>& column_families) override;
 
   using DB::CreateColumnFamilyWithImport;
   virtual Status CreateColumnFamilyWithImport(
@@ -328,10 +386,58 @@ class TropoDBImpl : public DB {
 
  private:
   struct Writer;
+  struct PropertySnapshot;
+  // Information for a manual compaction
+  struct ManualCompaction {
+    uint8_t level;
+    bool done;
+    bool exclusive;            // Hold back automatic compactions
+    const InternalKey* begin;  // null means beginning of key range
+    const InternalKey* end;    // null means end of key range
+    uint64_t compactions;      // Finished compactions, for progress
+  };
   Status Recover();
+  // Creates the handles of all families on open, mutex held. Missing
+  // families are created with create_missing_column_families.
+  Status OpenColumnFamilies(
+      const std::vector<ColumnFamilyDescriptor>& column_families,
+      std::vector<ColumnFamilyHandle*>* handles);
+  // Stored form of key in the family, buf holds the data if needed.
+  Slice FamilyKey(ColumnFamilyHandle* column_family, const Slice& key,
+                  std::string* buf) const;
+  // Writes to the given stripe, or round-robin when parallel_number < 0.
+  // Without updates, either the memtable is switched (force_flush) or the WAL
+  // is synced (options.sync).
+  Status WriteImpl(const WriteOptions& options, WriteBatch* updates,
+                   int parallel_number, bool force_flush);
+  // Without a merge_operands context, operands are merged into value. Values
+  // read from SSTables are pinned in the table cache instead of copied.
+  Status GetImpl(const ReadOptions& options, ColumnFamilyHandle* column_family,
+                 const Slice& user_key, PinnableSlice* value,
+                 MergeContext* merge_operands = nullptr);
   Status RemoveObsoleteZonesL0();
   Status RemoveObsoleteZonesLN();
 
+  // Bulk loading. Prepare picks the LN level and sequence number for the
+  // range and pauses compactions till FinishIngestion.
+  Status PrepareIngestion(const Slice& smallest, const Slice& largest,
+                          bool allow_blocking_flush, uint8_t* level,
+                          SequenceNumber* seq);
+  Status FinishIngestion(uint8_t level,
+                         const std::vector<SSZoneMetaData>& tables, Status s);
+  // Keys of input get the family prefix, see FamilyKey.
+  Status IngestIterator(Iterator* input, bool internal_keys,
+                        const std::string& prefix, uint8_t level,
+                        SequenceNumber seq,
+                        std::vector<SSZoneMetaData>* tables);
+  bool MemtablesOverlap(const Slice& smallest, const Slice& largest);
+  // CompactRange on stored keys
+  Status CompactRangeImpl(const CompactRangeOptions& options,
+                          const Slice* begin, const Slice* end);
+  // Waits till no write is in flight and keeps new writes out.
+  void BlockWriters(std::vector<Writer*>* blockers);
+  void UnblockWriters(std::vector<Writer*>* blockers);
+
   WriteBatch* BuildBatchGroup(Writer** last_writer, uint8_t parallel_number);
 
   void PrintCompactionStats();
@@ -339,6 +445,10 @@ class TropoDBImpl : public DB {
   void PrintWALStats();
   void PrintIODistrStats();
 
+  void TakePropertySnapshot(PropertySnapshot* snapshot);
+  void ReleasePropertySnapshot(PropertySnapshot* snapshot);
+  std::vector<TropoDiagnostics> GetZoneRegionDiagnostics();
+
   // Should remain constant after construction
   const DBOptions options_;
   const std::string name_;
@@ -347,16 +457,31 @@ class TropoDBImpl : public DB {
 
   // Should be "constant" after SPDK is initialised.
   std::string layout_string_;
-  SZD::SZDDevice* zns_device_;
-  SZD::SZDChannelFactory* channel_factory_;
+  // One for each device, stripe i (WAL manager and L0 log) lives on device
+  // i % device count. The manifest is on device 0, each device has an LN log.
+  // Devices are shared with other databases in the process, this database
+  // only uses the zones in device_zones_.
+  std::vector<std::string> device_names_;
+  std::vector<SZD::SZDDevice*> zns_devices_;
+  std::vector<SZD::SZDChannelFactory*> channel_factories_;
+  std::vector<std::pair<uint64_t, uint64_t>> device_zones_;
   TropoSSTableManager* ss_manager_;
   TropoManifest* manifest_;
   TropoTableCache* table_cache_;
+  // Optional (row_cache option)
+  TropoRowCache* row_cache_{nullptr};
   std::array<TropoWALManager<TropoDBConfig::wal_manager_zone_count>*,
              TropoDBConfig::lower_concurrency>
       wal_man_;
   TropoVersionSet* versions_;
   size_t max_write_buffer_size_;
+  std::shared_ptr<TropoColumnFamilySet> column_families_;
+  TropoColumnFamilyHandle* default_cf_handle_;
+  // Dispatches to the merge operators of the families
+  std::shared_ptr<MergeOperator> merge_operator_;
+  std::shared_ptr<const SliceTransform> prefix_extractor_;
+  // LN uses tiered instead of leveled compaction (universal compaction style)
+  bool tiered_compaction_{false};
 
   // Dynamic data objects, protected by mutex
   std::array<TropoWAL*, TropoDBConfig::lower_concurrency> wal_;
@@ -377,10 +502,14 @@ class TropoDBImpl : public DB {
   bool bg_compaction_l0_scheduled_;
   bool bg_compaction_scheduled_;
   std::array<bool, TropoDBConfig::lower_concurrency> bg_flush_scheduled_;
+  // Immutable memtable is being flushed, by its own or another stripe.
+  std::array<bool, TropoDBConfig::lower_concurrency> flush_claimed_;
   bool shutdown_;
   Status bg_error_;
   bool forced_schedule_;
   std::array<std::vector<SSZoneMetaData*>, 2> reserved_comp_;
+  ManualCompaction* manual_compaction_{nullptr};
+  int bg_work_paused_{0};
   int reserve_claimed_ = -1;
   std::array<size_t, TropoDBConfig::lower_concurrency> wal_reserved_;
 
@@ -426,6 +555,11 @@ class TropoDBImpl : public DB {
   TimingCounter compaction_k_merge_perf_counter_;
   TimingCounter compaction_flush_perf_counter_;
   TimingCounter compaction_breakdown_perf_counter_;
+  // Diag recovery
+  TimingCounter recovery_total_counter_;
+  TimingCounter recovery_manifest_counter_;
+  TimingCounter recovery_wal_counter_;
+  TimingCounter recovery_background_counter_;
 };
 
 struct FlushData {
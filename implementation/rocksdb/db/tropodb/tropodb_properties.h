@@ -0,0 +1,70 @@
+#pragma once
+#ifdef TROPODB_PLUGIN_ENABLED
+#ifndef TROPODB_PROPERTIES_H
+#define TROPODB_PROPERTIES_H
+
+#include "rocksdb/rocksdb_namespace.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// TropoDB specific properties that can be retrieved with GetProperty,
+// GetIntProperty or GetMapProperty. All properties only hold the DB mutex for
+// a short snapshot, so they are cheap enough to poll periodically.
+// Next to these, the following RocksDB properties are supported:
+// "rocksdb.num-files-at-level<N>", "rocksdb.estimate-num-keys",
+// "rocksdb.cur-size-all-mem-tables" and "rocksdb.stats".
+namespace TropoDBProperties {
+constexpr static const char* kStats =
+    "tropodb.stats"; /**< Human readable summary of all properties below */
+constexpr static const char* kNumTablesAtLevelPrefix =
+    "tropodb.num-tables-at-level"; /**< Live SSTables at level N (int)*/
+constexpr static const char* kBytesAtLevelPrefix =
+    "tropodb.bytes-at-level"; /**< Bytes used by live SSTables at level N
+                                 (int)*/
+constexpr static const char* kDeadTablesAtLevelPrefix =
+    "tropodb.dead-tables-at-level"; /**< SSTables at level N that are dead,
+                                       but not reclaimed yet (int)*/
+constexpr static const char* kLevelZoneUsage =
+    "tropodb.level-zone-usage"; /**< Tables, bytes and dead tables for each
+                                   level and fill of L0/LN (map)*/
+constexpr static const char* kL0Fill =
+    "tropodb.l0-fill"; /**< Fill percentage of each L0 circular log (map)*/
+constexpr static const char* kFreeWALs =
+    "tropodb.free-wals"; /**< Free WALs for each WAL manager (map) or in total
+                            (int)*/
+constexpr static const char* kDeadTables =
+    "tropodb.dead-tables"; /**< Dead tables (ss_d_) for each level (map) or in
+                              total (int)*/
+constexpr static const char* kZoneResets =
+    "tropodb.zone-resets"; /**< Zone resets for each zone region (map) or in
+                              total (int)*/
+constexpr static const char* kIOStats =
+    "tropodb.io-stats"; /**< Bytes and operations read and written by this
+                           database for each zone region and in total (map)
+                           or bytes written in total (int). Databases sharing
+                           a device are accounted separately.*/
+constexpr static const char* kFlushStats =
+    "tropodb.flush-stats"; /**< Flush counts and latencies (map)*/
+constexpr static const char* kCompactionStats =
+    "tropodb.compaction-stats"; /**< Compaction counts and latencies (map)*/
+constexpr static const char* kWriteStallStats =
+    "tropodb.write-stall-stats"; /**< Put latencies and the time puts waited
+                                    on flushes, L0 and WALs (map)*/
+constexpr static const char* kWALStats =
+    "tropodb.wal-stats"; /**< Append, sync, replay and reset latencies for
+                            each WAL manager (map)*/
+constexpr static const char* kHotZones =
+    "tropodb.hot-zones"; /**< Resets and appends of each zone, as a comma
+                            separated list for each zone region (map)*/
+constexpr static const char* kRecoveryStats =
+    "tropodb.recovery-stats"; /**< Time spent in the last open on the
+                                 manifest, WAL pointers, WAL replay and
+                                 restarting background work (map)*/
+constexpr static const char* kManualCompaction =
+    "tropodb.manual-compaction"; /**< Progress of a running CompactRange
+                                    (map)*/
+}  // namespace TropoDBProperties
+}  // namespace ROCKSDB_NAMESPACE
+
+#endif
+#endif
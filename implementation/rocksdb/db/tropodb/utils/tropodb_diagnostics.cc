@@ -1,87 +1,294 @@
 #include "db/tropodb/utils/tropodb_diagnostics.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
 namespace ROCKSDB_NAMESPACE {
-TimingCounter::TimingCounter()
+
+// Each thread sticks to one shard, threads are spread round-robin.
+static uint32_t ThreadShardIndex() {
+  static std::atomic<uint32_t> next_shard{0};
+  thread_local uint32_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) %
+      TimingCounter::kShards;
+  return shard;
+}
+
+static void AtomicMin(std::atomic<uint64_t>& target, uint64_t value) {
+  uint64_t cur = target.load(std::memory_order_relaxed);
+  while (value < cur && !target.compare_exchange_weak(
+                            cur, value, std::memory_order_relaxed)) {
+  }
+}
+
+static void AtomicMax(std::atomic<uint64_t>& target, uint64_t value) {
+  uint64_t cur = target.load(std::memory_order_relaxed);
+  while (value > cur && !target.compare_exchange_weak(
+                            cur, value, std::memory_order_relaxed)) {
+  }
+}
+
+TimingCounter::Shard::Shard()
     : num_(0),
       sum_(0),
       sum_squared_(0),
       min_(std::numeric_limits<uint64_t>::max()),
-      max_(0) {}
-
-TimingCounter::~TimingCounter() {}
-
-TimingCounter TimingCounter::operator+(TimingCounter const &tc) {
-  TimingCounter tc_new;
-  tc_new.num_ = num_ + tc.num_;
-  tc_new.sum_ = sum_ + tc.sum_;
-  tc_new.sum_squared_ = sum_squared_ + tc.sum_squared_;
-  if (num_ == 0) {
-    tc_new.min_ = tc.min_;
-    tc_new.max_ = tc.max_;
-  } else if (tc.num_ == 0) {
-    tc_new.min_ = min_;
-    tc_new.max_ = max_;
-  } else {
-    tc_new.min_ = std::min(min_, tc.min_);
-    tc_new.max_ = std::max(max_, tc.max_);
+      max_(0) {
+  for (uint32_t i = 0; i < kBuckets; i++) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+TimingCounter::TimingCounter() {
+  for (uint32_t i = 0; i < kShards; i++) {
+    shards_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+TimingCounter::TimingCounter(TimingCounter const& tc) : TimingCounter() {
+  *this += tc;
+}
+
+TimingCounter::~TimingCounter() {
+  for (uint32_t i = 0; i < kShards; i++) {
+    delete shards_[i].load(std::memory_order_relaxed);
+  }
+}
+
+TimingCounter& TimingCounter::operator=(TimingCounter const& tc) {
+  if (this != &tc) {
+    Clear();
+    *this += tc;
+  }
+  return *this;
+}
+
+TimingCounter::Shard* TimingCounter::GetOrCreateShard(uint32_t index) {
+  Shard* shard = shards_[index].load(std::memory_order_acquire);
+  if (shard != nullptr) {
+    return shard;
+  }
+  Shard* fresh = new Shard();
+  if (shards_[index].compare_exchange_strong(shard, fresh,
+                                             std::memory_order_acq_rel)) {
+    return fresh;
+  }
+  // Another thread won the race, shard now holds its pointer.
+  delete fresh;
+  return shard;
+}
+
+void TimingCounter::MergeShard(Shard* dst, const Shard* src) {
+  uint64_t num = src->num_.load(std::memory_order_relaxed);
+  if (num == 0) {
+    return;
   }
+  dst->num_.fetch_add(num, std::memory_order_relaxed);
+  dst->sum_.fetch_add(src->sum_.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+  dst->sum_squared_.fetch_add(
+      src->sum_squared_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  AtomicMin(dst->min_, src->min_.load(std::memory_order_relaxed));
+  AtomicMax(dst->max_, src->max_.load(std::memory_order_relaxed));
+  for (uint32_t i = 0; i < kBuckets; i++) {
+    uint64_t count = src->buckets_[i].load(std::memory_order_relaxed);
+    if (count != 0) {
+      dst->buckets_[i].fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+}
+
+TimingCounter TimingCounter::operator+(TimingCounter const& tc) const {
+  TimingCounter tc_new(*this);
+  tc_new += tc;
   return tc_new;
 }
 
-void TimingCounter::operator+=(TimingCounter const &tc) {
-  num_ += tc.num_;
-  sum_ += tc.sum_;
-  sum_squared_ += tc.sum_squared_;
-  if (num_ == 0) {
-    min_ = tc.min_;
-    max_ = tc.max_;
-  } else if (tc.num_ == 0) {
-    // nothing to do
-  } else {
-    min_ = std::min(min_, tc.min_);
-    max_ = std::max(max_, tc.max_);
+void TimingCounter::operator+=(TimingCounter const& tc) {
+  Shard* dst = nullptr;
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* src = tc.shards_[i].load(std::memory_order_acquire);
+    if (src == nullptr || src->num_.load(std::memory_order_relaxed) == 0) {
+      continue;
+    }
+    if (dst == nullptr) {
+      dst = GetOrCreateShard(ThreadShardIndex());
+    }
+    MergeShard(dst, src);
   }
 }
 
 void TimingCounter::AddTiming(uint64_t time) {
-  if (time > max_) {
-    max_ = time;
+  Shard* shard = GetOrCreateShard(ThreadShardIndex());
+  AtomicMin(shard->min_, time);
+  AtomicMax(shard->max_, time);
+  shard->buckets_[BucketIndex(time)].fetch_add(1, std::memory_order_relaxed);
+  shard->sum_.fetch_add(time, std::memory_order_relaxed);
+  shard->sum_squared_.fetch_add(time * time, std::memory_order_relaxed);
+  shard->num_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TimingCounter::Clear() {
+  for (uint32_t i = 0; i < kShards; i++) {
+    Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    shard->num_.store(0, std::memory_order_relaxed);
+    shard->sum_.store(0, std::memory_order_relaxed);
+    shard->sum_squared_.store(0, std::memory_order_relaxed);
+    shard->min_.store(std::numeric_limits<uint64_t>::max(),
+                      std::memory_order_relaxed);
+    shard->max_.store(0, std::memory_order_relaxed);
+    for (uint32_t j = 0; j < kBuckets; j++) {
+      shard->buckets_[j].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+uint32_t TimingCounter::BucketIndex(uint64_t value) {
+  if (value < kLinearBuckets) {
+    return static_cast<uint32_t>(value);
   }
-  if (time < min_) {
-    min_ = time;
+  uint32_t exponent = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+  uint32_t shift = exponent - kSubBucketBits;
+  uint32_t mantissa =
+      static_cast<uint32_t>(value >> shift) & (kLinearBuckets - 1);
+  return kLinearBuckets + shift * kLinearBuckets + mantissa;
+}
+
+uint64_t TimingCounter::BucketLowerBound(uint32_t index) {
+  if (index < kLinearBuckets) {
+    return index;
   }
-  num_++;
-  sum_ += time;
-  sum_squared_ += time * time;
+  uint32_t shift = (index - kLinearBuckets) / kLinearBuckets;
+  uint64_t mantissa = (index - kLinearBuckets) % kLinearBuckets;
+  return (kLinearBuckets + mantissa) << shift;
 }
 
-uint64_t TimingCounter::GetNum() const { return num_; }
+uint64_t TimingCounter::BucketUpperBound(uint32_t index) {
+  if (index + 1 >= kBuckets) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return BucketLowerBound(index + 1) - 1;
+}
 
-double TimingCounter::GetSum() const { return static_cast<double>(sum_); }
+uint64_t TimingCounter::GetNum() const {
+  uint64_t num = 0;
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      num += shard->num_.load(std::memory_order_relaxed);
+    }
+  }
+  return num;
+}
+
+double TimingCounter::GetSum() const {
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      sum += shard->sum_.load(std::memory_order_relaxed);
+    }
+  }
+  return static_cast<double>(sum);
+}
 
 double TimingCounter::GetMin() const {
-  return min_ == std::numeric_limits<uint64_t>::max()
+  uint64_t min = std::numeric_limits<uint64_t>::max();
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      min = std::min(min, shard->min_.load(std::memory_order_relaxed));
+    }
+  }
+  return min == std::numeric_limits<uint64_t>::max()
              ? -1.
-             : static_cast<double>(min_);
+             : static_cast<double>(min);
 }
 
 double TimingCounter::GetMax() const {
-  return max_ == 0 ? -1. : static_cast<double>(max_);
+  if (GetNum() == 0) {
+    return -1.;
+  }
+  uint64_t max = 0;
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      max = std::max(max, shard->max_.load(std::memory_order_relaxed));
+    }
+  }
+  return static_cast<double>(max);
 }
 
 double TimingCounter::GetAvg() const {
-  return num_ == 0 ? -1.
-                   : static_cast<double>(sum_) / static_cast<double>(num_);
+  uint64_t num = GetNum();
+  return num == 0 ? -1. : GetSum() / static_cast<double>(num);
 }
 
 double TimingCounter::GetStandardDeviation() const {
   // See util/histogram.cc from LevelDB. However, we use -1 for none, not 0.
-  return num_ == 0 ? -1.
-                   : std::sqrt(static_cast<double>(sum_squared_ * num_ -
-                                                   sum_ * sum_) /
-                               static_cast<double>(num_ * num_));
+  uint64_t num = GetNum();
+  if (num == 0) {
+    return -1.;
+  }
+  double sum = GetSum();
+  double sum_squared = 0;
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard != nullptr) {
+      sum_squared += static_cast<double>(
+          shard->sum_squared_.load(std::memory_order_relaxed));
+    }
+  }
+  double n = static_cast<double>(num);
+  double variance = (sum_squared * n - sum * sum) / (n * n);
+  return variance > 0 ? std::sqrt(variance) : 0.;
+}
+
+double TimingCounter::GetPercentile(double p) const {
+  // Merge all shards on read
+  std::vector<uint64_t> buckets(kBuckets, 0);
+  uint64_t num = 0;
+  for (uint32_t i = 0; i < kShards; i++) {
+    const Shard* shard = shards_[i].load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    for (uint32_t j = 0; j < kBuckets; j++) {
+      uint64_t count = shard->buckets_[j].load(std::memory_order_relaxed);
+      buckets[j] += count;
+      num += count;
+    }
+  }
+  if (num == 0) {
+    return -1.;
+  }
+  // See util/histogram.cc from RocksDB
+  double threshold = static_cast<double>(num) * (p / 100.0);
+  uint64_t cumulative = 0;
+  for (uint32_t b = 0; b < kBuckets; b++) {
+    uint64_t count = buckets[b];
+    cumulative += count;
+    if (static_cast<double>(cumulative) >= threshold && count != 0) {
+      uint64_t left_point = BucketLowerBound(b);
+      uint64_t right_point = BucketUpperBound(b);
+      uint64_t left_sum = cumulative - count;
+      double pos = (threshold - static_cast<double>(left_sum)) /
+                   static_cast<double>(count);
+      pos = std::max(0., std::min(1., pos));
+      double r = static_cast<double>(left_point) +
+                 static_cast<double>(right_point - left_point) * pos;
+      double min = GetMin();
+      double max = GetMax();
+      r = std::max(r, min);
+      r = std::min(r, max);
+      return r;
+    }
+  }
+  return GetMax();
 }
 }  // namespace ROCKSDB_NAMESPACE
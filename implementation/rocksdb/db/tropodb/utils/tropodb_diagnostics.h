@@ -3,6 +3,9 @@
 #ifndef TROPODB_DIAGNOSTICS_H
 #define TROPODB_DIAGNOSTICS_H
 
+#include <atomic>
+#include <cstdint>
+#include <string>
 #include <vector>
 
 #include "rocksdb/rocksdb_namespace.h"
@@ -10,27 +13,60 @@
 
 namespace ROCKSDB_NAMESPACE {
 
-// NOT thread-safe
+/**
+ * @brief Latency histogram that is safe to update from multiple threads.
+ * Timings are recorded lock-free in one of kShards shards (picked per thread)
+ * with log-linear buckets, so percentiles can be retrieved. Shards are only
+ * allocated on first use and merged on read. Reads are not atomic with
+ * respect to concurrent writes, they give a (slightly stale) snapshot.
+ */
 struct TimingCounter {
-  uint64_t num_;
-  uint64_t sum_;
-  uint64_t sum_squared_;
-  uint64_t min_;
-  uint64_t max_;
-  
+  // Values below kLinearBuckets get their own bucket, above that each power
+  // of two is split in kLinearBuckets equal sub-buckets (~12.5% error).
+  static constexpr uint32_t kSubBucketBits = 3;
+  static constexpr uint32_t kLinearBuckets = 1U << kSubBucketBits;
+  static constexpr uint32_t kBuckets =
+      kLinearBuckets + (64 - kSubBucketBits) * kLinearBuckets;
+  static constexpr uint32_t kShards = 8;
+
   TimingCounter();
+  TimingCounter(TimingCounter const &tc);
   ~TimingCounter();
 
-  TimingCounter operator + (TimingCounter const &tc);
-  void operator += (TimingCounter const &tc);
+  TimingCounter &operator=(TimingCounter const &tc);
+  TimingCounter operator+(TimingCounter const &tc) const;
+  void operator+=(TimingCounter const &tc);
   void AddTiming(uint64_t time);
+  void Clear();
 
   uint64_t GetNum() const;
   double GetSum() const;
   double GetMin() const;
   double GetMax() const;
   double GetAvg() const;
-  double GetStandardDeviation() const; 
+  double GetStandardDeviation() const;
+  // p in [0,100]; interpolated within the bucket and clamped to [min,max].
+  double GetPercentile(double p) const;
+
+  static uint32_t BucketIndex(uint64_t value);
+  static uint64_t BucketLowerBound(uint32_t index);
+  static uint64_t BucketUpperBound(uint32_t index);
+
+ private:
+  struct Shard {
+    Shard();
+    std::atomic<uint64_t> num_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> sum_squared_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> buckets_[kBuckets];
+  };
+
+  Shard *GetOrCreateShard(uint32_t index);
+  void MergeShard(Shard *dst, const Shard *src);
+
+  std::atomic<Shard *> shards_[kShards];
 };
 
 // NOT thread-safe
@@ -459,6 +459,11 @@ struct DBOptions {
 #ifdef TROPODB_PLUGIN_ENABLED
   // Set to true if the goal is to use impl_zns
   bool use_tropodb_impl = false;
+  // Zones [tropodb_min_zone, tropodb_max_zone) of each device are used by
+  // this database, so that databases in one process can share a device. Set
+  // tropodb_max_zone to 0 to use the entire device.
+  uint64_t tropodb_min_zone = 0;
+  uint64_t tropodb_max_zone = 0;
 #endif
   // If true, the database will be created if it is missing.
   // Default: false
@@ -0,0 +1,415 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+// Micro-benchmarks for the CPU side of the TropoDB hot paths. Everything runs
+// on in-memory buffers, so no ZNS device (or SPDK) is needed. Tables are built
+// with the real builder and read with the iterators the device path uses.
+#include "benchmark/benchmark.h"
+
+#ifdef TROPODB_PLUGIN_ENABLED
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/lookup_key.h"
+#include "db/tropodb/index/tropodb_l0_index.h"
+#include "db/tropodb/memtable/tropodb_memtable.h"
+#include "db/tropodb/persistence/tropodb_committer.h"
+#include "db/tropodb/table/iterators/merging_iterator.h"
+#include "db/tropodb/table/tropodb_sst_file_writer.h"
+#include "db/tropodb/table/tropodb_sstable_builder.h"
+#include "db/tropodb/table/tropodb_sstable_manager.h"
+#include "db/tropodb/table/tropodb_table_cache.h"
+#include "db/tropodb/tropodb_config.h"
+#include "db/write_batch_internal.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/options.h"
+#include "util/coding.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+constexpr uint64_t kLbaSize = 4096;
+constexpr size_t kValueSize = 100;
+
+SZD::DeviceInfo BenchDeviceInfo() {
+  SZD::DeviceInfo info{};
+  info.lba_size = kLbaSize;
+  info.zone_size = 1 << 19;
+  info.zone_cap = 1 << 19;
+  info.zasl = 1 << 17;
+  return info;
+}
+
+std::string UserKey(uint64_t i) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "key%016" PRIu64, i);
+  return buf;
+}
+
+const InternalKeyComparator& BenchComparator() {
+  static const InternalKeyComparator icmp(BytewiseComparator());
+  return icmp;
+}
+
+// Builds a table with keys first, first + stride, ... in memory.
+std::string BuildTable(uint64_t first, uint64_t count, uint64_t stride,
+                       SequenceNumber seq, SSZoneMetaData* meta) {
+  const std::string value(kValueSize, 'v');
+  TropoSSTableBuilder builder(nullptr, meta,
+                              TropoDBConfig::use_sstable_encoding);
+  for (uint64_t i = 0; i < count; i++) {
+    InternalKey key(UserKey(first + i * stride), seq, kTypeValue);
+    builder.Apply(key.Encode(), value);
+  }
+  builder.Finalise();
+  return builder.GetContent().ToString();
+}
+
+Iterator* NewTableIterator(const std::string& table) {
+  return TropoSSTFileReader::NewTableIterator(table, BytewiseComparator());
+}
+
+std::string SeekKey(uint64_t i) {
+  return InternalKey(UserKey(i), kMaxSequenceNumber, kValueTypeForSeek)
+      .Encode()
+      .ToString();
+}
+
+// Batches in the unordered group commit format of TropoWAL: a "group" tag,
+// the batch size, the WAL sequence number and the batch itself.
+std::string EncodeWALGroup(uint64_t batches, uint64_t first_key) {
+  const std::string value(kValueSize, 'v');
+  std::string group;
+  for (uint64_t i = 0; i < batches; i++) {
+    WriteBatch batch;
+    batch.Put(UserKey(first_key + i), value);
+    WriteBatchInternal::SetSequence(&batch, first_key + i + 1);
+    const Slice data = WriteBatchInternal::Contents(&batch);
+    group.append("group", sizeof("group"));
+    PutFixed64(&group, data.size());
+    PutFixed64(&group, i);
+    group.append(data.data(), data.size());
+  }
+  return group;
+}
+}  // namespace
+
+static void CommitToCharArray(benchmark::State& state) {
+  TropoCommitter committer(BenchDeviceInfo());
+  const std::string data(state.range(0), 'd');
+  for (auto _ : state) {
+    char* out;
+    committer.CommitToCharArray(data, &out);
+    benchmark::DoNotOptimize(out);
+    delete[] out;
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(CommitToCharArray)->Range(128, 1 << 20);
+
+static void SeekCommitReaderString(benchmark::State& state) {
+  TropoCommitter committer(BenchDeviceInfo());
+  const std::string data(state.range(0), 'd');
+  char* out;
+  committer.CommitToCharArray(data, &out);
+  std::string commit(out, committer.SpaceNeeded(data.size()));
+  delete[] out;
+  for (auto _ : state) {
+    TropoCommitReaderString reader;
+    committer.GetCommitReaderString(&commit, &reader);
+    Slice record;
+    while (committer.SeekCommitReaderString(reader, &record)) {
+      benchmark::DoNotOptimize(record.data());
+    }
+    committer.CloseCommitString(reader);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(SeekCommitReaderString)->Range(128, 1 << 20);
+
+static void SSTableBuilderApply(benchmark::State& state) {
+  const uint64_t entries = state.range(0);
+  std::vector<std::string> keys;
+  for (uint64_t i = 0; i < entries; i++) {
+    keys.push_back(InternalKey(UserKey(i), 1, kTypeValue).Encode().ToString());
+  }
+  const std::string value(kValueSize, 'v');
+  for (auto _ : state) {
+    SSZoneMetaData meta;
+    TropoSSTableBuilder builder(nullptr, &meta,
+                                TropoDBConfig::use_sstable_encoding);
+    for (const auto& key : keys) {
+      builder.Apply(key, value);
+    }
+    builder.Finalise();
+    benchmark::DoNotOptimize(builder.GetFinalSize());
+  }
+  state.SetItemsProcessed(state.iterations() * entries);
+}
+BENCHMARK(SSTableBuilderApply)->Range(1 << 10, 1 << 16);
+
+static void SSTableIteratorSeek(benchmark::State& state) {
+  const uint64_t entries = state.range(0);
+  SSZoneMetaData meta;
+  std::unique_ptr<Iterator> it(
+      NewTableIterator(BuildTable(0, entries, 1, 1, &meta)));
+  std::vector<std::string> targets;
+  Random rnd(301);
+  for (size_t i = 0; i < 1024; i++) {
+    targets.push_back(SeekKey(rnd.Uniform(static_cast<int>(entries))));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    it->Seek(targets[i++ % targets.size()]);
+    benchmark::DoNotOptimize(it->Valid());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(SSTableIteratorSeek)->Range(1 << 10, 1 << 16);
+
+static void SSTableIteratorNext(benchmark::State& state) {
+  const uint64_t entries = state.range(0);
+  SSZoneMetaData meta;
+  std::unique_ptr<Iterator> it(
+      NewTableIterator(BuildTable(0, entries, 1, 1, &meta)));
+  for (auto _ : state) {
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      benchmark::DoNotOptimize(it->value().data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * entries);
+}
+BENCHMARK(SSTableIteratorNext)->Range(1 << 10, 1 << 16);
+
+// Merges k interleaved tables, as a compaction over k inputs does.
+static void MergingIteratorScan(benchmark::State& state) {
+  const int children = static_cast<int>(state.range(0));
+  const uint64_t entries = 1 << 16;
+  std::vector<std::string> tables;
+  for (int c = 0; c < children; c++) {
+    SSZoneMetaData meta;
+    tables.push_back(
+        BuildTable(c, entries / children, children, c + 1, &meta));
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<Iterator*> iters;
+    for (const auto& table : tables) {
+      iters.push_back(NewTableIterator(table));
+    }
+    state.ResumeTiming();
+    std::unique_ptr<Iterator> merged(
+        NewMergingIterator(&BenchComparator(), iters.data(), children));
+    for (merged->SeekToFirst(); merged->Valid(); merged->Next()) {
+      benchmark::DoNotOptimize(merged->value().data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * entries);
+}
+BENCHMARK(MergingIteratorScan)->RangeMultiplier(2)->Range(2, 32);
+
+namespace {
+// A version with overlapping L0 tables over the full key range and each LN
+// level split in disjoint tables, all cached in a table cache.
+class SyntheticVersion {
+ public:
+  static constexpr uint64_t kKeys = 1 << 16;
+  static constexpr uint64_t kL0Tables = 4;
+  static constexpr uint64_t kLNTables = 16;
+
+  SyntheticVersion()
+      : cache_(options_, BenchComparator(), 1 << 10, nullptr) {
+    uint64_t number = 1;
+    // L0 tables interleave their keys, so every lookup overlaps all of them.
+    for (uint64_t t = 0; t < kL0Tables; t++) {
+      SSZoneMetaData* meta = NewTable(0, t, kKeys / kL0Tables, kL0Tables,
+                                      kKeys * 4 + t, number++);
+      meta->L0.number = t;
+    }
+    // Every LN level holds all keys.
+    for (uint8_t level = 1; level < TropoDBConfig::level_count; level++) {
+      const uint64_t per_table = kKeys / kLNTables;
+      for (uint64_t t = 0; t < kLNTables; t++) {
+        NewTable(level, t * per_table, per_table, 1,
+                 kKeys * (TropoDBConfig::level_count - level), number++);
+      }
+    }
+    l0_index_.reset(new TropoL0Index(BytewiseComparator(), ss_[0]));
+  }
+
+  ~SyntheticVersion() {
+    for (auto& level : ss_) {
+      for (SSZoneMetaData* meta : level) {
+        delete meta;
+      }
+    }
+  }
+
+  // The lookup of TropoVersion::Get: L0 candidates from the interval index,
+  // one binary search for each LN level and a table cache Get per candidate.
+  Status Get(const LookupKey& lkey, PinnableSlice* value) {
+    const Comparator* ucmp = BytewiseComparator();
+    const Slice key = lkey.user_key();
+    const Slice internal_key = lkey.internal_key();
+    EntryStatus status;
+    for (SSZoneMetaData* m : l0_index_->Overlapping(key)) {
+      Status s = cache_.Get(ReadOptions(), *m, 0, internal_key, value,
+                            &status);
+      if (!s.ok() || status != EntryStatus::notfound) {
+        return s;
+      }
+    }
+    for (uint8_t level = 1; level < TropoDBConfig::level_count; level++) {
+      const size_t index =
+          TropoSSTableManager::FindSSTableIndex(ucmp, ss_[level], internal_key);
+      if (index >= ss_[level].size()) {
+        continue;
+      }
+      SSZoneMetaData* m = ss_[level][index];
+      if (ucmp->Compare(key, m->smallest.user_key()) < 0 ||
+          ucmp->Compare(key, m->largest.user_key()) > 0) {
+        continue;
+      }
+      Status s = cache_.Get(ReadOptions(), *m, level, internal_key, value,
+                            &status);
+      if (!s.ok() || status != EntryStatus::notfound) {
+        return s;
+      }
+    }
+    return Status::NotFound();
+  }
+
+  TropoTableCache* Cache() { return &cache_; }
+  SSZoneMetaData* Table(uint8_t level, size_t i) { return ss_[level][i]; }
+
+ private:
+  SSZoneMetaData* NewTable(uint8_t level, uint64_t first, uint64_t count,
+                           uint64_t stride, SequenceNumber seq,
+                           uint64_t number) {
+    SSZoneMetaData* meta = new SSZoneMetaData;
+    const std::string table = BuildTable(first, count, stride, seq, meta);
+    meta->number = number;
+    cache_.Insert(*meta, NewTableIterator(table));
+    ss_[level].push_back(meta);
+    return meta;
+  }
+
+  const Options options_;
+  TropoTableCache cache_;
+  std::array<std::vector<SSZoneMetaData*>, TropoDBConfig::level_count> ss_;
+  std::unique_ptr<TropoL0Index> l0_index_;
+};
+
+SyntheticVersion* GetSyntheticVersion() {
+  static SyntheticVersion version;
+  return &version;
+}
+}  // namespace
+
+static void VersionGet(benchmark::State& state) {
+  SyntheticVersion* version = GetSyntheticVersion();
+  Random rnd(301 + state.thread_index);
+  for (auto _ : state) {
+    const std::string key = UserKey(
+        rnd.Uniform(static_cast<int>(SyntheticVersion::kKeys)));
+    LookupKey lkey(key, kMaxSequenceNumber);
+    PinnableSlice value;
+    benchmark::DoNotOptimize(version->Get(lkey, &value));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(VersionGet)->ThreadRange(1, 16)->UseRealTime();
+
+// All threads read from the same table, so they contend on its iterator.
+static void TableCacheGet(benchmark::State& state) {
+  SyntheticVersion* version = GetSyntheticVersion();
+  const SSZoneMetaData* meta = version->Table(1, 0);
+  const uint64_t keys = SyntheticVersion::kKeys / SyntheticVersion::kLNTables;
+  Random rnd(301 + state.thread_index);
+  for (auto _ : state) {
+    LookupKey lkey(UserKey(rnd.Uniform(static_cast<int>(keys))),
+                   kMaxSequenceNumber);
+    PinnableSlice value;
+    EntryStatus status;
+    benchmark::DoNotOptimize(version->Cache()->Get(
+        ReadOptions(), *meta, 1, lkey.internal_key(), &value, &status));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(TableCacheGet)->ThreadRange(1, 16)->UseRealTime();
+
+// Encodes a group of batches as TropoWAL commits them.
+static void WALEncode(benchmark::State& state) {
+  TropoCommitter committer(BenchDeviceInfo());
+  const uint64_t batches = state.range(0);
+  for (auto _ : state) {
+    const std::string group = EncodeWALGroup(batches, 0);
+    char* out;
+    committer.CommitToCharArray(group, &out);
+    benchmark::DoNotOptimize(out);
+    delete[] out;
+  }
+  state.SetItemsProcessed(state.iterations() * batches);
+}
+BENCHMARK(WALEncode)->Range(1, 1 << 10);
+
+// Decodes a WAL commit and applies it to a memtable, as the unordered replay
+// of TropoWAL does.
+static void WALReplay(benchmark::State& state) {
+  TropoCommitter committer(BenchDeviceInfo());
+  const uint64_t batches = state.range(0);
+  const std::string group = EncodeWALGroup(batches, 0);
+  char* out;
+  committer.CommitToCharArray(group, &out);
+  std::string commit(out, committer.SpaceNeeded(group.size()));
+  delete[] out;
+  const DBOptions options;
+  for (auto _ : state) {
+    state.PauseTiming();
+    TropoMemtable* mem = new TropoMemtable(options, BenchComparator(),
+                                           TropoDBConfig::max_bytes_sstable_);
+    mem->Ref();
+    state.ResumeTiming();
+    TropoCommitReaderString reader;
+    committer.GetCommitReaderString(&commit, &reader);
+    std::vector<std::pair<uint64_t, std::string>> entries;
+    Slice record;
+    while (committer.SeekCommitReaderString(reader, &record)) {
+      size_t pos = 0;
+      while (record.size() >= pos + sizeof("group") &&
+             memcmp(record.data() + pos, "group", sizeof("group")) == 0) {
+        pos += sizeof("group");
+        const uint64_t size = DecodeFixed64(record.data() + pos);
+        const uint64_t seq = DecodeFixed64(record.data() + pos + 8);
+        pos += 2 * sizeof(uint64_t);
+        entries.emplace_back(seq, std::string(record.data() + pos, size));
+        pos += size;
+      }
+    }
+    committer.CloseCommitString(reader);
+    std::sort(entries.begin(), entries.end());
+    for (auto& entry : entries) {
+      WriteBatch batch;
+      WriteBatchInternal::SetContents(&batch, entry.second);
+      mem->Write(WriteOptions(), &batch);
+    }
+    state.PauseTiming();
+    mem->Unref();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * batches);
+}
+BENCHMARK(WALReplay)->Range(1, 1 << 10);
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif
+
+BENCHMARK_MAIN();
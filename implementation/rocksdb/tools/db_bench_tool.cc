@@ -39,6 +39,9 @@
 
 #include "db/db_impl/db_impl.h"
 #include "db/malloc_stats.h"
+#ifdef TROPODB_PLUGIN_ENABLED
+#include "db/tropodb/tropodb_properties.h"
+#endif
 #include "db/version_set.h"
 #include "monitoring/histogram.h"
 #include "monitoring/statistics.h"
@@ -232,6 +235,7 @@ IF_ROCKSDB_LITE("",
     "\twaitforcompaction - pause until compaction is (probably) done\n"
 )
     "\tflush - flush the memtable\n"
+    "\treopen      -- Close and reopen the DB, reports the recovery time\n"
     "\tstats       -- Print DB stats\n"
     "\tresetstats  -- Reset DB stats\n"
     "\tlevelstats  -- Print the number of files and bytes per level\n"
@@ -326,6 +330,15 @@ DEFINE_int64(batch_size, 1, "Batch size");
 
 #ifdef TROPODB_PLUGIN_ENABLED
 DEFINE_bool(use_tropodb, false, "use zns device implementation");
+
+DEFINE_string(tropodb_stats_file, "",
+              "If not empty, all TropoDB stats are written to this file as "
+              "JSON lines, every --tropodb_stats_interval_seconds while a "
+              "benchmark runs and once when it is done");
+
+DEFINE_int64(tropodb_stats_interval_seconds, 10,
+             "Interval between the lines in --tropodb_stats_file, 0 only "
+             "writes them when a benchmark is done");
 #endif
 
 static bool ValidateKeySize(const char* /*flagname*/, int32_t /*value*/) {
@@ -1977,6 +1990,145 @@ class ReporterAgent {
   bool stop_;
 };
 
+#ifdef TROPODB_PLUGIN_ENABLED
+// Numbers are written as is and comma separated lists of numbers (hot zones)
+// as arrays, everything else is a string.
+static std::string TropoStatsJSONValue(const std::string& value) {
+  auto numeric = [](const std::string& v) {
+    if (v.empty()) {
+      return false;
+    }
+    char* end;
+    strtod(v.c_str(), &end);
+    return *end == '\0';
+  };
+  if (numeric(value)) {
+    return value;
+  }
+  std::vector<std::string> parts = StringSplit(value, ',');
+  if (!value.empty() && std::all_of(parts.begin(), parts.end(), numeric)) {
+    return "[" + value + "]";
+  }
+  std::string quoted = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+// Appends one JSON line with all TropoDB map properties for each database.
+// fields (e.g. "\"benchmark\":\"fillrandom\"") are added to every line.
+static Status AppendTropoStats(Env* env, WritableFile* file,
+                               const std::string& fields,
+                               const std::vector<DB*>& dbs) {
+  static const char* const kProperties[] = {
+      TropoDBProperties::kLevelZoneUsage, TropoDBProperties::kL0Fill,
+      TropoDBProperties::kFreeWALs,       TropoDBProperties::kDeadTables,
+      TropoDBProperties::kZoneResets,     TropoDBProperties::kIOStats,
+      TropoDBProperties::kHotZones,       TropoDBProperties::kFlushStats,
+      TropoDBProperties::kCompactionStats,
+      TropoDBProperties::kWriteStallStats, TropoDBProperties::kWALStats};
+  Status s;
+  for (size_t i = 0; i < dbs.size() && s.ok(); i++) {
+    std::string line = "{\"time_us\":" + ToString(env->NowMicros()) +
+                       ",\"db\":" + ToString(i) + "," + fields;
+    for (const char* property : kProperties) {
+      std::map<std::string, std::string> values;
+      if (!dbs[i]->GetMapProperty(property, &values)) {
+        continue;
+      }
+      line += ",\"" + std::string(property) + "\":{";
+      for (auto it = values.begin(); it != values.end(); ++it) {
+        line += it == values.begin() ? "\"" : ",\"";
+        line += it->first + "\":" + TropoStatsJSONValue(it->second);
+      }
+      line += "}";
+    }
+    s = file->Append(line + "}\n");
+  }
+  return s.ok() ? file->Flush() : s;
+}
+
+// Writes the TropoDB stats of a running benchmark periodically and once more
+// when it is done.
+class TropoStatsAgent {
+ public:
+  TropoStatsAgent(Env* env, WritableFile* file, const std::string& benchmark,
+                  const std::vector<DB*>& dbs, uint64_t report_interval_secs)
+      : env_(env),
+        file_(file),
+        benchmark_(benchmark),
+        dbs_(dbs),
+        report_interval_secs_(report_interval_secs),
+        started_(env->NowMicros()),
+        stop_(false) {
+    if (report_interval_secs_ > 0) {
+      reporting_thread_ = port::Thread([&]() { SleepAndReport(); });
+    }
+  }
+
+  ~TropoStatsAgent() {
+    if (report_interval_secs_ > 0) {
+      {
+        std::unique_lock<std::mutex> lk(mutex_);
+        stop_ = true;
+        stop_cv_.notify_all();
+      }
+      reporting_thread_.join();
+    }
+    Report(true);
+  }
+
+ private:
+  void SleepAndReport() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lk(mutex_);
+        if (stop_ ||
+            stop_cv_.wait_for(lk, std::chrono::seconds(report_interval_secs_),
+                              [&]() { return stop_; })) {
+          break;
+        }
+      }
+      if (!Report(false)) {
+        break;
+      }
+    }
+  }
+
+  bool Report(bool done) {
+    std::string fields = "\"benchmark\":\"" + benchmark_ +
+                         "\",\"secs_elapsed\":" +
+                         ToString((env_->NowMicros() - started_) /
+                                  static_cast<double>(kMicrosInSecond)) +
+                         ",\"done\":" + (done ? "true" : "false");
+    Status s = AppendTropoStats(env_, file_, fields, dbs_);
+    if (!s.ok()) {
+      fprintf(stderr,
+              "Can't write to TropoDB stats file (%s), stopping the "
+              "reporting\n",
+              s.ToString().c_str());
+    }
+    return s.ok();
+  }
+
+  Env* env_;
+  WritableFile* file_;
+  const std::string benchmark_;
+  const std::vector<DB*> dbs_;
+  const uint64_t report_interval_secs_;
+  const uint64_t started_;
+  ROCKSDB_NAMESPACE::port::Thread reporting_thread_;
+  std::mutex mutex_;
+  // will notify on stop
+  std::condition_variable stop_cv_;
+  bool stop_;
+};
+#endif
+
 enum OperationType : unsigned char {
   kRead = 0,
   kWrite,
@@ -2484,6 +2636,7 @@ class Benchmark {
   std::vector<std::string> keys_;
 #ifdef TROPODB_PLUGIN_ENABLED
   bool use_tropodb_;
+  std::unique_ptr<WritableFile> tropodb_stats_file_;
 #endif
   class ErrorHandlerListener : public EventListener {
    public:
@@ -2939,6 +3092,18 @@ class Benchmark {
       }
     }
 
+#ifdef TROPODB_PLUGIN_ENABLED
+    if (use_tropodb_ && !FLAGS_tropodb_stats_file.empty()) {
+      Status s = FLAGS_env->NewWritableFile(
+          FLAGS_tropodb_stats_file, &tropodb_stats_file_, EnvOptions());
+      if (!s.ok()) {
+        fprintf(stderr, "Can't open %s: %s\n",
+                FLAGS_tropodb_stats_file.c_str(), s.ToString().c_str());
+        exit(1);
+      }
+    }
+#endif
+
     listener_.reset(new ErrorHandlerListener());
     if (user_timestamp_size_ > 0) {
       mock_app_clock_.reset(new TimestampEmulator());
@@ -3357,6 +3522,8 @@ class Benchmark {
         }
         fresh_db = true;
         method = &Benchmark::TimeSeries;
+      } else if (name == "reopen") {
+        Reopen();
       } else if (name == "stats") {
         PrintStats("rocksdb.stats");
       } else if (name == "resetstats") {
@@ -3630,6 +3797,14 @@ class Benchmark {
       reporter_agent.reset(new ReporterAgent(FLAGS_env, FLAGS_report_file,
                                              FLAGS_report_interval_seconds));
     }
+#ifdef TROPODB_PLUGIN_ENABLED
+    std::unique_ptr<TropoStatsAgent> tropodb_stats_agent;
+    if (tropodb_stats_file_ != nullptr) {
+      tropodb_stats_agent.reset(new TropoStatsAgent(
+          FLAGS_env, tropodb_stats_file_.get(), name.ToString(), AllDBs(),
+          FLAGS_tropodb_stats_interval_seconds));
+    }
+#endif
 
     ThreadArg* arg = new ThreadArg[n];
 
@@ -7880,6 +8055,41 @@ class Benchmark {
     }
   }
 
+  std::vector<DB*> AllDBs() {
+    std::vector<DB*> dbs;
+    if (db_.db != nullptr) {
+      dbs.push_back(db_.db);
+    }
+    for (const auto& db_with_cfh : multi_dbs_) {
+      dbs.push_back(db_with_cfh.db);
+    }
+    return dbs;
+  }
+
+  // Closes and reopens all databases. The open time is the recovery time,
+  // e.g. of the WALs and memtables left by a preceding fillrandom.
+  void Reopen() {
+    DeleteDBs();
+    multi_dbs_.clear();
+    const uint64_t start = FLAGS_env->NowMicros();
+    Open(&open_options_);
+    const uint64_t micros = FLAGS_env->NowMicros() - start;
+    fprintf(stdout, "%-12s : %11.3f ms to reopen %zu database(s)\n",
+            "reopen", micros / 1000.0, AllDBs().size());
+#ifdef TROPODB_PLUGIN_ENABLED
+    if (tropodb_stats_file_ != nullptr) {
+      Status s = AppendTropoStats(
+          FLAGS_env, tropodb_stats_file_.get(),
+          "\"benchmark\":\"reopen\",\"open_micros\":" + ToString(micros),
+          AllDBs());
+      if (!s.ok()) {
+        fprintf(stderr, "Can't write to TropoDB stats file: %s\n",
+                s.ToString().c_str());
+      }
+    }
+#endif
+  }
+
   void PrintStats(const char* key) {
     if (db_.db != nullptr) {
       PrintStats(db_.db, key, false);
@@ -0,0 +1,222 @@
+// Copyright (c) 2013 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+// Crash-recovery harness. A child process fills the database with synced puts
+// and is killed at an injected crash point. The parent then reopens the
+// database, verifies that the puts that survived are a prefix of all puts and
+// contain every acknowledged put, and reports where the restart time went.
+//
+// Usage: crash_recovery <trid> <crash point> <keys> [hits] [value size]
+// The child is killed on the hits-th time it reaches the crash point:
+//   none        no crash, the child closes the database
+//   kill        SIGKILL from the parent after hits acknowledged puts
+//   wal-append  before a WAL append reaches the device
+//   flush       after a flush wrote L0, before its version is committed
+//   manifest    between writing a new manifest and setting it as current
+//   zone-reset  before the zones of a WAL are reset
+// All points but none and kill use sync points and need a debug build.
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include "db/tropodb/tropodb_properties.h"
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+#include "rocksdb/status.h"
+#include "test_util/sync_point.h"
+
+namespace {
+constexpr int kCrashedExitCode = 42;
+
+const std::map<std::string, std::string> kCrashPoints = {
+    {"wal-append", "TropoWAL::Append:BeforeWrite"},
+    {"flush", "TropoDBImpl::CompactMemtable:AfterWriteL0"},
+    {"manifest", "TropoVersionSet::CommitVersion:BeforeSetCurrent"},
+    {"zone-reset", "TropoWAL::Reset:BeforeReset"}};
+
+std::string Key(uint64_t i) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "key%016" PRIu64, i);
+  return buf;
+}
+
+std::string Value(uint64_t i, size_t value_size) {
+  std::string value = "value" + std::to_string(i);
+  value.resize(value_size, 'v');
+  return value;
+}
+
+rocksdb::Options TropoOptions() {
+  rocksdb::Options options;
+  options.create_if_missing = true;
+  options.compression = rocksdb::kNoCompression;
+  options.use_tropodb_impl = true;
+  return options;
+}
+
+// Fills a fresh database, reports every acknowledged put on fd.
+int RunWorkload(const std::string& trid, const std::string& crash_point,
+                uint64_t keys, uint64_t hits, size_t value_size, int fd) {
+  rocksdb::Options options = TropoOptions();
+  rocksdb::DestroyDB(trid, options);
+  if (kCrashPoints.count(crash_point) != 0) {
+#ifndef NDEBUG
+    auto* sync_point = rocksdb::SyncPoint::GetInstance();
+    sync_point->SetCallBack(kCrashPoints.at(crash_point), [hits](void*) {
+      static uint64_t reached = 0;
+      if (++reached >= hits) {
+        _exit(kCrashedExitCode);
+      }
+    });
+    sync_point->EnableProcessing();
+#else
+    fprintf(stderr, "Crash point %s needs a debug build\n",
+            crash_point.c_str());
+    return 1;
+#endif
+  }
+
+  rocksdb::DB* db;
+  rocksdb::Status s = rocksdb::DB::Open(options, trid, &db);
+  if (!s.ok()) {
+    fprintf(stderr, "Workload: open failed: %s\n", s.ToString().c_str());
+    return 1;
+  }
+  rocksdb::WriteOptions wo;
+  wo.sync = true;
+  for (uint64_t i = 0; i < keys && s.ok(); i++) {
+    s = db->Put(wo, Key(i), Value(i, value_size));
+    const uint64_t acked = i + 1;
+    if (s.ok() && write(fd, &acked, sizeof(acked)) != sizeof(acked)) {
+      break;
+    }
+  }
+  if (!s.ok()) {
+    fprintf(stderr, "Workload: put failed: %s\n", s.ToString().c_str());
+  }
+  delete db;
+  return s.ok() ? 0 : 1;
+}
+
+// Reopens the database and checks that exactly keys [0, recovered) exist.
+int Verify(const std::string& trid, const std::string& crash_point,
+           uint64_t keys, uint64_t acked, size_t value_size) {
+  rocksdb::DB* db;
+  const auto start = std::chrono::steady_clock::now();
+  rocksdb::Status s = rocksdb::DB::Open(TropoOptions(), trid, &db);
+  const auto open_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  if (!s.ok()) {
+    fprintf(stderr, "Recovery: open failed: %s\n", s.ToString().c_str());
+    return 1;
+  }
+
+  bool corrupt = false;
+  uint64_t recovered = keys;
+  std::string value;
+  for (uint64_t i = 0; i < keys && !corrupt; i++) {
+    s = db->Get(rocksdb::ReadOptions(), Key(i), &value);
+    if (s.IsNotFound()) {
+      recovered = recovered == keys ? i : recovered;
+    } else if (!s.ok() || recovered != keys ||
+               value != Value(i, value_size)) {
+      fprintf(stderr, "Recovery: key %" PRIu64 " is wrong (%s)\n", i,
+              s.ToString().c_str());
+      corrupt = true;
+    }
+  }
+  if (recovered < acked) {
+    fprintf(stderr,
+            "Recovery: lost acknowledged puts, %" PRIu64 " of %" PRIu64 "\n",
+            recovered, acked);
+    corrupt = true;
+  }
+
+  std::map<std::string, std::string> stats;
+  db->GetMapProperty(rocksdb::TropoDBProperties::kRecoveryStats, &stats);
+  printf("{\"crash_point\":\"%s\",\"acked\":%" PRIu64
+         ",\"recovered\":%" PRIu64 ",\"verified\":%s,\"open_us\":%lld",
+         crash_point.c_str(), acked, recovered, corrupt ? "false" : "true",
+         static_cast<long long>(open_us));
+  for (const char* part :
+       {"total", "manifest", "wal", "wal.pointers", "wal.replay",
+        "background-flow"}) {
+    printf(",\"%s_us\":%s", part, stats[std::string(part) + ".sum"].c_str());
+  }
+  printf("}\n");
+  delete db;
+  return corrupt ? 1 : 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    fprintf(stderr,
+            "Usage: %s <trid> <none|kill|wal-append|flush|manifest|"
+            "zone-reset> <keys> [hits] [value size]\n",
+            argv[0]);
+    return 1;
+  }
+  const std::string trid = argv[1];
+  const std::string crash_point = argv[2];
+  const uint64_t keys = strtoull(argv[3], nullptr, 10);
+  const uint64_t hits = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1;
+  const size_t value_size = argc > 5 ? strtoull(argv[5], nullptr, 10) : 1000;
+  if (crash_point != "none" && crash_point != "kill" &&
+      kCrashPoints.count(crash_point) == 0) {
+    fprintf(stderr, "Unknown crash point %s\n", crash_point.c_str());
+    return 1;
+  }
+
+  // SPDK must only be initialised after the fork, so the parent only touches
+  // the device once the child is gone.
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    perror("fork");
+    return 1;
+  }
+  if (child == 0) {
+    close(fds[0]);
+    _exit(RunWorkload(trid, crash_point, keys, hits, value_size, fds[1]));
+  }
+  close(fds[1]);
+  uint64_t acked = 0;
+  uint64_t ack;
+  while (read(fds[0], &ack, sizeof(ack)) == sizeof(ack)) {
+    acked = ack;
+    if (crash_point == "kill" && acked >= hits) {
+      kill(child, SIGKILL);
+      break;
+    }
+  }
+  close(fds[0]);
+  int status;
+  waitpid(child, &status, 0);
+  const bool crashed =
+      (WIFEXITED(status) && WEXITSTATUS(status) == kCrashedExitCode) ||
+      (WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+  if (!crashed && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+    fprintf(stderr, "Workload failed\n");
+    return 1;
+  }
+  if (!crashed && crash_point != "none") {
+    fprintf(stderr, "Crash point %s was not reached\n", crash_point.c_str());
+  }
+  return Verify(trid, crash_point, keys, acked, value_size);
+}